@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "AnimationClip.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+AnimationClip::AnimationClip() noexcept :
+    m_boneCount(0), m_frameCount(0), m_duration(0.0f), m_framesPerSecond(0.0f)
+{
+}
+
+AnimationClip::AnimationClip(uint32_t boneCount, uint32_t frameCount, float duration) :
+    m_boneCount(boneCount), m_frameCount(frameCount), m_duration(duration), m_framesPerSecond(0.0f)
+{
+    assert(frameCount >= 1);
+    assert(duration >= 0.0f);
+
+    if (frameCount > 1 && duration > 0.0f)
+        m_framesPerSecond = static_cast<float>(frameCount - 1) / duration;
+
+    m_keys.resize(static_cast<size_t>(boneCount) * frameCount, { Quaternion::Identity, Vector3::Zero, Vector3::One });
+}
+
+AnimationClip::AnimationClip(uint32_t boneCount, uint32_t frameCount, float duration, const BoneTransform* keys) :
+    AnimationClip(boneCount, frameCount, duration)
+{
+    std::copy(keys, keys + m_keys.size(), m_keys.begin());
+}
+
+void AnimationClip::SetKey(uint32_t frame, uint32_t bone, Matrix const& localTransform)
+{
+    assert(frame < m_frameCount && bone < m_boneCount);
+
+    auto& key = m_keys[static_cast<size_t>(frame) * m_boneCount + bone];
+
+    auto matrix = localTransform;
+    if (!matrix.Decompose(key.scale, key.rotation, key.translation))
+    {
+        // Singular matrix, such as a bone scaled to zero. Keep the translation and an identity rotation.
+        key.translation = localTransform.Translation();
+        key.rotation    = Quaternion::Identity;
+        key.scale       = Vector3::Zero;
+    }
+
+    key.rotation.Normalize();
+
+    if (frame > 0)
+    {
+        const auto& previous = m_keys[static_cast<size_t>(frame - 1) * m_boneCount + bone];
+        if (key.rotation.Dot(previous.rotation) < 0.0f)
+            key.rotation = -key.rotation;
+    }
+}
+
+void AnimationClip::GetFrames(float time, uint32_t& frame0, uint32_t& frame1, float& blend) const noexcept
+{
+    frame0 = frame1 = 0;
+    blend = 0.0f;
+
+    if (m_frameCount < 2 || m_framesPerSecond <= 0.0f)
+        return;
+
+    time = std::fmod(time, m_duration);
+    if (time < 0.0f)
+        time += m_duration;
+
+    const float frame = time * m_framesPerSecond;
+    frame0 = std::min(static_cast<uint32_t>(frame), m_frameCount - 2);
+    frame1 = frame0 + 1;
+    blend  = std::clamp(frame - static_cast<float>(frame0), 0.0f, 1.0f);
+}
+
+void AnimationClip::Sample(float time, BoneTransform* pose) const
+{
+    if (m_keys.empty())
+        return;
+
+    uint32_t frame0, frame1;
+    float blend;
+    GetFrames(time, frame0, frame1, blend);
+
+    const auto key0 = &m_keys[static_cast<size_t>(frame0) * m_boneCount];
+    const auto key1 = &m_keys[static_cast<size_t>(frame1) * m_boneCount];
+
+    for (uint32_t i = 0; i < m_boneCount; ++i)
+    {
+        pose[i].rotation    = Quaternion::Slerp(key0[i].rotation, key1[i].rotation, blend);
+        pose[i].translation = Vector3::Lerp(key0[i].translation, key1[i].translation, blend);
+        pose[i].scale       = Vector3::Lerp(key0[i].scale, key1[i].scale, blend);
+    }
+}
+
+Matrix AnimationClip::ToMatrix(BoneTransform const& transform) noexcept
+{
+    // Scale, then rotate, then translate, for row vectors.
+    return XMMatrixAffineTransformation(transform.scale, XMVectorZero(), transform.rotation, transform.translation);
+}
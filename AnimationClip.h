@@ -0,0 +1,62 @@
+#pragma once
+
+// Animation clip baked from an FBX animation stack at load time.
+// Each frame stores one local transform per bone, decomposed into rotation, translation and scale,
+// so playback interpolates between keys without calling the FBX SDK.
+// Keys are stored frame by frame, so sampling reads two contiguous runs of boneCount keys.
+
+struct BoneTransform
+{
+    DirectX::SimpleMath::Quaternion rotation;
+    DirectX::SimpleMath::Vector3    translation;
+    DirectX::SimpleMath::Vector3    scale;
+};
+
+class AnimationClip
+{
+public:
+
+    AnimationClip() noexcept;
+
+    // Keys are spaced evenly over duration, in seconds, with the first key at time 0 and the last at duration.
+    AnimationClip(uint32_t boneCount, uint32_t frameCount, float duration);
+
+    // As above, with frameCount * boneCount keys already baked, frame major, such as those read from a cooked model.
+    AnimationClip(uint32_t boneCount, uint32_t frameCount, float duration, const BoneTransform* keys);
+
+    AnimationClip(AnimationClip const&) = delete;
+    AnimationClip& operator= (AnimationClip const&) = delete;
+
+    AnimationClip(AnimationClip&&) = default;
+    AnimationClip& operator= (AnimationClip&&) = default;
+
+    ~AnimationClip() = default;
+
+    // Sets the key for one bone, decomposing its local transform matrix.
+    // Rotations are kept in the same hemisphere as the previous frame's key, so interpolation takes the short path.
+    void SetKey(uint32_t frame, uint32_t bone, DirectX::SimpleMath::Matrix const& localTransform);
+
+    // Samples every bone at time seconds, wrapping time to the clip duration.
+    // Translation and scale are interpolated linearly and rotation spherically between the two nearest keys.
+    void Sample(float time, BoneTransform* pose) const;
+
+    static DirectX::SimpleMath::Matrix ToMatrix(BoneTransform const& transform) noexcept;
+
+    const auto GetBoneCount() const noexcept    { return m_boneCount; }
+    const auto GetFrameCount() const noexcept   { return m_frameCount; }
+    const auto GetDuration() const noexcept     { return m_duration; }
+    const auto GetKeys() const noexcept         { return m_keys.data(); }
+    const auto IsEmpty() const noexcept         { return m_keys.empty(); }
+
+private:
+
+    // Finds the keys either side of time and the blend factor between them.
+    void GetFrames(float time, uint32_t& frame0, uint32_t& frame1, float& blend) const noexcept;
+
+    std::vector<BoneTransform> m_keys;  // frameCount * boneCount keys, frame major.
+
+    uint32_t m_boneCount;
+    uint32_t m_frameCount;
+    float    m_duration;                // In seconds.
+    float    m_framesPerSecond;         // Key rate, (frameCount - 1) / duration.
+};
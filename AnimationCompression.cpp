@@ -0,0 +1,319 @@
+#include "pch.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+namespace
+{
+    constexpr float    SmallestThreeRange = 0.707106781f;  // Largest possible value of all but the largest quaternion component.
+    constexpr uint32_t RotationMax        = 0x7FFF;        // 15 bits per rotation component.
+    constexpr uint32_t VectorMax          = 0xFFFF;        // 16 bits per translation or scale component.
+
+    // Returns the frames of the keys to keep for one track. The first and last frames are always kept,
+    // unless every frame is within error of the first, in which case only the first is kept.
+    // isWithinError(a, b, i) tests frame i against the interpolation of frames a and b.
+    template<typename ErrorTest>
+    std::vector<uint32_t> ReduceKeys(uint32_t frameCount, ErrorTest isWithinError)
+    {
+        std::vector<uint32_t> frames = { 0 };
+
+        bool isConstant = true;
+        for (uint32_t i = 1; i < frameCount && isConstant; ++i)
+            isConstant = isWithinError(0, 0, i);
+
+        if (isConstant)
+            return frames;
+
+        const uint32_t lastFrame = frameCount - 1;
+        uint32_t a = 0;
+
+        while (a < lastFrame)
+        {
+            // Extend the segment from key a for as long as every frame it spans stays within error.
+            uint32_t b = a + 1;
+
+            for (; b < lastFrame; ++b)
+            {
+                bool isValid = true;
+                for (uint32_t i = a + 1; i <= b && isValid; ++i)
+                    isValid = isWithinError(a, b + 1, i);
+
+                if (!isValid)
+                    break;
+            }
+
+            frames.push_back(b);
+            a = b;
+        }
+        return frames;
+    }
+
+    float GetBlend(uint32_t a, uint32_t b, uint32_t i) noexcept
+    {
+        return b > a ? static_cast<float>(i - a) / static_cast<float>(b - a) : 0.0f;
+    }
+
+    uint16_t Quantize(float value, float minimum, float extent, uint32_t maxValue) noexcept
+    {
+        if (extent <= 0.0f)
+            return 0;
+
+        const float q = std::round((value - minimum) / extent * static_cast<float>(maxValue));
+        return static_cast<uint16_t>(std::clamp(q, 0.0f, static_cast<float>(maxValue)));
+    }
+}
+
+CompressedAnimationClip::CompressedAnimationClip() noexcept :
+    m_boneCount(0), m_frameCount(0), m_duration(0.0f), m_framesPerSecond(0.0f)
+{
+}
+
+CompressedAnimationClip::CompressedAnimationClip(AnimationClip const& clip, AnimationCompressionSettings const& settings) :
+    m_boneCount(clip.GetBoneCount()), m_frameCount(clip.GetFrameCount()), m_duration(clip.GetDuration()), m_framesPerSecond(0.0f)
+{
+    if (clip.IsEmpty())
+        return;
+
+    assert(m_frameCount <= UINT16_MAX + 1u);
+    assert(m_boneCount * TrackTypeCount <= UINT16_MAX + 1u);
+
+    if (m_frameCount > 1 && m_duration > 0.0f)
+        m_framesPerSecond = static_cast<float>(m_frameCount - 1) / m_duration;
+
+    const auto sourceKeys = clip.GetKeys();
+    auto source = [&](uint32_t frame, uint32_t bone) -> BoneTransform const& { return sourceKeys[static_cast<size_t>(frame) * m_boneCount + bone]; };
+
+    // Each key is paired with the frame it is first needed, which is the frame of the previous key on its track.
+    std::vector<std::pair<uint32_t, PackedKey>> stream;
+    m_ranges.resize(static_cast<size_t>(m_boneCount) * 2);
+
+    for (uint32_t bone = 0; bone < m_boneCount; ++bone)
+    {
+        // Range reduce translation and scale over the clip.
+        auto& translationRange = m_ranges[bone * 2 + 0];
+        auto& scaleRange       = m_ranges[bone * 2 + 1];
+
+        Vector3 minT = source(0, bone).translation, maxT = minT;
+        Vector3 minS = source(0, bone).scale,       maxS = minS;
+
+        for (uint32_t frame = 1; frame < m_frameCount; ++frame)
+        {
+            minT = Vector3::Min(minT, source(frame, bone).translation);
+            maxT = Vector3::Max(maxT, source(frame, bone).translation);
+            minS = Vector3::Min(minS, source(frame, bone).scale);
+            maxS = Vector3::Max(maxS, source(frame, bone).scale);
+        }
+
+        translationRange = { minT, maxT - minT };
+        scaleRange       = { minS, maxS - minS };
+
+        for (uint32_t type = 0; type < TrackTypeCount; ++type)
+        {
+            std::vector<uint32_t> frames;
+
+            switch (type)
+            {
+            case Rotation:
+                frames = ReduceKeys(m_frameCount, [&](uint32_t a, uint32_t b, uint32_t i)
+                {
+                    const auto q = Quaternion::Slerp(source(a, bone).rotation, source(b, bone).rotation, GetBlend(a, b, i));
+                    const auto d = std::min(std::abs(q.Dot(source(i, bone).rotation)), 1.0f);
+                    return 2.0f * std::acos(d) <= settings.rotationError;
+                });
+                break;
+
+            case Translation:
+                frames = ReduceKeys(m_frameCount, [&](uint32_t a, uint32_t b, uint32_t i)
+                {
+                    const auto t = Vector3::Lerp(source(a, bone).translation, source(b, bone).translation, GetBlend(a, b, i));
+                    return Vector3::Distance(t, source(i, bone).translation) <= settings.translationError;
+                });
+                break;
+
+            case Scale:
+                frames = ReduceKeys(m_frameCount, [&](uint32_t a, uint32_t b, uint32_t i)
+                {
+                    const auto s = Vector3::Lerp(source(a, bone).scale, source(b, bone).scale, GetBlend(a, b, i)) - source(i, bone).scale;
+                    return std::max({ std::abs(s.x), std::abs(s.y), std::abs(s.z) }) <= settings.scaleError;
+                });
+                break;
+            }
+
+            for (size_t j = 0; j < frames.size(); ++j)
+            {
+                const auto& transform = source(frames[j], bone);
+
+                PackedKey key;
+                key.frame = static_cast<uint16_t>(frames[j]);
+                key.track = static_cast<uint16_t>(bone * TrackTypeCount + type);
+
+                switch (type)
+                {
+                case Rotation:    PackRotation(transform.rotation, key.value); break;
+                case Translation: PackVector(transform.translation, translationRange, key.value); break;
+                case Scale:       PackVector(transform.scale, scaleRange, key.value); break;
+                }
+
+                stream.emplace_back(j == 0 ? 0 : frames[j - 1], key);
+            }
+        }
+    }
+
+    // A stable sort keeps each track's keys in order, with the first two keys of every track at the start.
+    std::stable_sort(stream.begin(), stream.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    m_keys.reserve(stream.size());
+    for (const auto& entry : stream)
+        m_keys.push_back(entry.second);
+}
+
+size_t CompressedAnimationClip::GetSizeInBytes() const noexcept
+{
+    return m_keys.size() * sizeof(PackedKey) + m_ranges.size() * sizeof(TrackRange);
+}
+
+void CompressedAnimationClip::PackRotation(Quaternion const& rotation, uint16_t value[3]) noexcept
+{
+    // Drop the largest component, which is rebuilt from the unit length. Negating the quaternion makes it positive.
+    const float c[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        if (std::abs(c[i]) > std::abs(c[largest]))
+            largest = i;
+    }
+
+    const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint16_t q[3];
+    for (uint32_t i = 0, j = 0; i < 4; ++i)
+    {
+        if (i != largest)
+            q[j++] = Quantize(c[i] * sign, -SmallestThreeRange, 2.0f * SmallestThreeRange, RotationMax);
+    }
+
+    // The two bit index of the dropped component uses the top bit of the first two values.
+    value[0] = static_cast<uint16_t>(((largest >> 1) << 15) | q[0]);
+    value[1] = static_cast<uint16_t>(((largest & 1) << 15) | q[1]);
+    value[2] = q[2];
+}
+
+void CompressedAnimationClip::PackVector(Vector3 const& vector, TrackRange const& range, uint16_t value[3]) noexcept
+{
+    value[0] = Quantize(vector.x, range.minimum.x, range.extent.x, VectorMax);
+    value[1] = Quantize(vector.y, range.minimum.y, range.extent.y, VectorMax);
+    value[2] = Quantize(vector.z, range.minimum.z, range.extent.z, VectorMax);
+}
+
+XMVECTOR XM_CALLCONV CompressedAnimationClip::UnpackRotation(const uint16_t value[3]) noexcept
+{
+    constexpr float scale = 2.0f * SmallestThreeRange / static_cast<float>(RotationMax);
+
+    const uint32_t largest = ((value[0] >> 15) << 1) | (value[1] >> 15);
+
+    const float a = static_cast<float>(value[0] & RotationMax) * scale - SmallestThreeRange;
+    const float b = static_cast<float>(value[1] & RotationMax) * scale - SmallestThreeRange;
+    const float c = static_cast<float>(value[2] & RotationMax) * scale - SmallestThreeRange;
+    const float d = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+
+    switch (largest)
+    {
+    case 0:  return XMVectorSet(d, a, b, c);
+    case 1:  return XMVectorSet(a, d, b, c);
+    case 2:  return XMVectorSet(a, b, d, c);
+    default: return XMVectorSet(a, b, c, d);
+    }
+}
+
+XMVECTOR XM_CALLCONV CompressedAnimationClip::UnpackVector(const uint16_t value[3], TrackRange const& range) noexcept
+{
+    constexpr float scale = 1.0f / static_cast<float>(VectorMax);
+
+    const auto q = XMVectorSet(static_cast<float>(value[0]), static_cast<float>(value[1]), static_cast<float>(value[2]), 0.0f);
+    return XMVectorMultiplyAdd(XMVectorScale(q, scale), XMLoadFloat3(&range.extent), XMLoadFloat3(&range.minimum));
+}
+
+XMVECTOR XM_CALLCONV CompressedAnimationClip::Unpack(PackedKey const& key) const noexcept
+{
+    const auto bone = key.track / TrackTypeCount;
+    const auto type = key.track % TrackTypeCount;
+
+    if (type == Rotation)
+        return UnpackRotation(key.value);
+
+    return UnpackVector(key.value, m_ranges[bone * 2 + (type - Translation)]);
+}
+
+AnimationDecoder::AnimationDecoder() noexcept :
+    m_clip(nullptr), m_cursor(0), m_frame(0.0f)
+{
+}
+
+void AnimationDecoder::Reset(CompressedAnimationClip const& clip)
+{
+    const TrackWindow start = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, 0.0f };
+    m_tracks.assign(static_cast<size_t>(clip.GetBoneCount()) * CompressedAnimationClip::TrackTypeCount, start);
+
+    m_clip   = &clip;
+    m_cursor = 0;
+    m_frame  = 0.0f;
+}
+
+void AnimationDecoder::Sample(CompressedAnimationClip const& clip, float time, BoneTransform* pose)
+{
+    if (clip.IsEmpty())
+        return;
+
+    float frame = 0.0f;
+    if (clip.m_framesPerSecond > 0.0f)
+    {
+        time = std::fmod(time, clip.m_duration);
+        if (time < 0.0f)
+            time += clip.m_duration;
+
+        frame = time * clip.m_framesPerSecond;
+    }
+
+    if (m_clip != &clip || frame < m_frame)
+        Reset(clip);
+
+    m_frame = frame;
+
+    // Read every key needed up to this frame. A key is needed once its track reaches the frame of the previous key.
+    const auto& keys = clip.m_keys;
+
+    while (m_cursor < keys.size())
+    {
+        const auto& key = keys[m_cursor];
+        auto& window = m_tracks[key.track];
+
+        if (window.frame1 > frame)
+            break;
+
+        window.key0   = window.key1;
+        window.frame0 = window.frame1;
+        XMStoreFloat4A(&window.key1, clip.Unpack(key));
+        window.frame1 = static_cast<float>(key.frame);
+
+        ++m_cursor;
+    }
+
+    auto blend = [frame](TrackWindow const& window)
+    {
+        return window.frame1 > window.frame0 ? std::clamp((frame - window.frame0) / (window.frame1 - window.frame0), 0.0f, 1.0f) : 1.0f;
+    };
+
+    for (uint32_t i = 0; i < clip.GetBoneCount(); ++i)
+    {
+        const auto& r = m_tracks[i * CompressedAnimationClip::TrackTypeCount + CompressedAnimationClip::Rotation];
+        const auto& t = m_tracks[i * CompressedAnimationClip::TrackTypeCount + CompressedAnimationClip::Translation];
+        const auto& s = m_tracks[i * CompressedAnimationClip::TrackTypeCount + CompressedAnimationClip::Scale];
+
+        pose[i].rotation    = XMQuaternionSlerp(XMLoadFloat4A(&r.key0), XMLoadFloat4A(&r.key1), blend(r));
+        pose[i].translation = XMVectorLerp(XMLoadFloat4A(&t.key0), XMLoadFloat4A(&t.key1), blend(t));
+        pose[i].scale       = XMVectorLerp(XMLoadFloat4A(&s.key0), XMLoadFloat4A(&s.key1), blend(s));
+    }
+}
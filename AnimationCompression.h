@@ -0,0 +1,129 @@
+#pragma once
+
+// AnimationClip.h must be in the #include list before this header.
+
+// Compressed animation clips, built from a baked AnimationClip.
+//
+// Rotations are quantized to 48 bits with the smallest three components of the quaternion.
+// Translations and scales are quantized to 16 bits per component, within the range of each bone's track.
+// Keys that linear interpolation reproduces within the error budget are removed, so constant tracks keep a single key.
+//
+// Keys are stored in one stream, sorted by the frame at which playback first needs them.
+// AnimationDecoder reads the stream forward as time advances, so sampling touches only new keys and a small window per track.
+
+struct AnimationCompressionSettings
+{
+    float rotationError;    // Maximum rotation error in radians.
+    float translationError; // Maximum translation error in model units.
+    float scaleError;       // Maximum error of each scale component.
+};
+
+class CompressedAnimationClip
+{
+public:
+
+    static constexpr AnimationCompressionSettings DefaultSettings = { 0.001f, 0.0001f, 0.0001f };
+
+    CompressedAnimationClip() noexcept;
+    CompressedAnimationClip(AnimationClip const& clip, AnimationCompressionSettings const& settings = DefaultSettings);
+
+    CompressedAnimationClip(CompressedAnimationClip const&) = delete;
+    CompressedAnimationClip& operator= (CompressedAnimationClip const&) = delete;
+
+    CompressedAnimationClip(CompressedAnimationClip&&) = default;
+    CompressedAnimationClip& operator= (CompressedAnimationClip&&) = default;
+
+    ~CompressedAnimationClip() = default;
+
+    const auto GetBoneCount() const noexcept    { return m_boneCount; }
+    const auto GetFrameCount() const noexcept   { return m_frameCount; }
+    const auto GetDuration() const noexcept     { return m_duration; }
+    const auto GetKeyCount() const noexcept     { return m_keys.size(); }
+    const auto IsEmpty() const noexcept         { return m_keys.empty(); }
+
+    // Total bytes of key and range data.
+    size_t GetSizeInBytes() const noexcept;
+
+private:
+
+    friend class AnimationDecoder;
+
+    // Each bone has a rotation, a translation and a scale track, in that order.
+    enum TrackType : uint32_t
+    {
+        Rotation,
+        Translation,
+        Scale,
+        TrackTypeCount
+    };
+
+    // One quantized key. Every track type packs into three 16 bit values.
+    struct PackedKey
+    {
+        uint16_t frame;
+        uint16_t track;
+        uint16_t value[3];
+    };
+
+    // Quantization range of a translation or scale track.
+    struct TrackRange
+    {
+        DirectX::XMFLOAT3 minimum;
+        DirectX::XMFLOAT3 extent;
+    };
+
+    static void PackRotation(DirectX::SimpleMath::Quaternion const& rotation, uint16_t value[3]) noexcept;
+    static void PackVector(DirectX::SimpleMath::Vector3 const& vector, TrackRange const& range, uint16_t value[3]) noexcept;
+
+    static DirectX::XMVECTOR XM_CALLCONV UnpackRotation(const uint16_t value[3]) noexcept;
+    static DirectX::XMVECTOR XM_CALLCONV UnpackVector(const uint16_t value[3], TrackRange const& range) noexcept;
+
+    DirectX::XMVECTOR XM_CALLCONV Unpack(PackedKey const& key) const noexcept;
+
+    std::vector<PackedKey>  m_keys;     // Sorted by the frame each key is first needed.
+    std::vector<TrackRange> m_ranges;   // Two per bone, for the translation and scale tracks.
+
+    uint32_t m_boneCount;
+    uint32_t m_frameCount;
+    float    m_duration;                // In seconds.
+    float    m_framesPerSecond;
+};
+
+// Per-instance playback state for a CompressedAnimationClip, which may be shared by many decoders.
+// Sampling forwards in time only reads keys the previous sample didn't, and sampling backwards restarts the stream.
+class AnimationDecoder
+{
+public:
+
+    AnimationDecoder() noexcept;
+
+    AnimationDecoder(AnimationDecoder const&) = delete;
+    AnimationDecoder& operator= (AnimationDecoder const&) = delete;
+
+    AnimationDecoder(AnimationDecoder&&) = default;
+    AnimationDecoder& operator= (AnimationDecoder&&) = default;
+
+    ~AnimationDecoder() = default;
+
+    // Samples every bone of clip at time seconds, wrapping time to the clip duration.
+    // Changing to a different clip restarts the stream.
+    void Sample(CompressedAnimationClip const& clip, float time, BoneTransform* pose);
+
+private:
+
+    // The two keys either side of the current frame, for one track.
+    struct TrackWindow
+    {
+        DirectX::XMFLOAT4A key0;
+        DirectX::XMFLOAT4A key1;
+        float              frame0;
+        float              frame1;
+    };
+
+    void Reset(CompressedAnimationClip const& clip);
+
+    const CompressedAnimationClip* m_clip;      // Clip the windows were read from.
+    std::vector<TrackWindow>       m_tracks;
+    size_t                         m_cursor;    // Next key to read from the stream.
+    float                          m_frame;     // Frame of the previous sample.
+};
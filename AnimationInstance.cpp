@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+AnimationInstance::AnimationInstance() noexcept :
+    m_clip(nullptr), m_blendClip(nullptr), m_time(0.0f), m_speed(1.0f), m_blendWeight(0.0f),
+    m_lodLevel(0), m_framesUntilUpdate(0), m_paletteVersion(0), m_isPoseDirty(true), m_hasNextPalette(false), m_nextTime(0.0f)
+{
+}
+
+AnimationInstance::AnimationInstance(Skeleton const& skeleton, CompressedAnimationClip const* clip) :
+    m_clip(clip), m_blendClip(nullptr), m_time(0.0f), m_speed(1.0f), m_blendWeight(0.0f),
+    m_lodLevel(0), m_framesUntilUpdate(0), m_paletteVersion(0), m_isPoseDirty(true), m_hasNextPalette(false), m_nextTime(0.0f)
+{
+    assert(!clip || clip->GetBoneCount() == skeleton.GetBoneCount());
+
+    // Sized once here, so evaluation never allocates.
+    const auto boneCount = skeleton.GetBoneCount();
+    m_pose.resize(boneCount, { Quaternion::Identity, Vector3::Zero, Vector3::One });
+    m_blendPose.resize(boneCount);
+    m_combined.resize(boneCount);
+    m_palette.resize(boneCount);
+    m_previousPalette.resize(boneCount);
+    m_nextPalette.resize(boneCount);
+}
+
+void AnimationInstance::SetBlendClip(CompressedAnimationClip const* clip, float weight) noexcept
+{
+    assert(!clip || clip->GetBoneCount() == m_pose.size());
+
+    m_blendClip   = clip;
+    m_blendWeight = weight;
+    m_isPoseDirty = true;
+}
+
+void AnimationInstance::EvaluatePalette(Skeleton const& skeleton, float time, const uint32_t* boneRemap, XMFLOAT3X4* palette)
+{
+    assert(m_pose.size() == skeleton.GetBoneCount());
+
+    if (m_clip)
+        m_decoder.Sample(*m_clip, time, m_pose.data());
+
+    if (m_blendClip && m_blendWeight > 0.0f)
+    {
+        m_blendDecoder.Sample(*m_blendClip, time, m_blendPose.data());
+
+        for (size_t i = 0; i < m_pose.size(); ++i)
+        {
+            m_pose[i].rotation    = Quaternion::Slerp(m_pose[i].rotation, m_blendPose[i].rotation, m_blendWeight);
+            m_pose[i].translation = Vector3::Lerp(m_pose[i].translation, m_blendPose[i].translation, m_blendWeight);
+            m_pose[i].scale       = Vector3::Lerp(m_pose[i].scale, m_blendPose[i].scale, m_blendWeight);
+        }
+    }
+
+    skeleton.CalculatePalette(m_pose.data(), m_combined.data(), palette, boneRemap);
+}
+
+void AnimationInstance::Evaluate(Skeleton const& skeleton)
+{
+    EvaluatePalette(skeleton, m_time, nullptr, m_palette.data());
+
+    m_isPoseDirty    = false;
+    m_hasNextPalette = false;
+    ++m_paletteVersion;
+}
+
+void AnimationInstance::SetLodLevel(uint32_t level, uint32_t phase) noexcept
+{
+    m_lodLevel          = level;
+    m_framesUntilUpdate = phase;
+
+    // The bone subset and interval may differ, so the palette sampled ahead no longer applies.
+    m_isPoseDirty    = true;
+    m_hasNextPalette = false;
+}
+
+bool AnimationInstance::EvaluateLod(Skeleton const& skeleton, uint32_t updateInterval, bool interpolate, const uint32_t* boneRemap,
+                                    float frameTime)
+{
+    assert(updateInterval > 0);
+
+    // An instance that has never been evaluated has no palette to hold, so it is due straight away.
+    if (m_framesUntilUpdate > 0 && m_paletteVersion > 0)
+    {
+        --m_framesUntilUpdate;
+
+        if (!interpolate || !m_hasNextPalette)
+            return false;
+
+        // Blend the cached palettes. Linear blending of 3x4 matrices is what the skinning shader does per vertex anyway.
+        const auto frame = static_cast<float>(updateInterval - 1 - m_framesUntilUpdate);
+        const auto t = XMVectorReplicate(frame / static_cast<float>(updateInterval));
+
+        for (size_t i = 0; i < m_palette.size(); ++i)
+        {
+            for (size_t r = 0; r < 3; ++r)
+            {
+                const auto previous = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_previousPalette[i].m[r]));
+                const auto next     = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_nextPalette[i].m[r]));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(m_palette[i].m[r]), XMVectorLerpV(previous, next, t));
+            }
+        }
+
+        ++m_paletteVersion;
+        return true;
+    }
+
+    // Keeps the phase the instance was given, if it was evaluated early.
+    m_framesUntilUpdate = m_framesUntilUpdate > 0 ? m_framesUntilUpdate - 1 : updateInterval - 1;
+
+    // Nothing that feeds the pose changed since it was last evaluated, so the palette still stands.
+    if (!m_isPoseDirty)
+    {
+        m_hasNextPalette = false;
+        return false;
+    }
+
+    if (!interpolate || updateInterval == 1)
+    {
+        EvaluatePalette(skeleton, m_time, boneRemap, m_palette.data());
+        m_hasNextPalette = false;
+    }
+    else
+    {
+        // The palette sampled ahead at the last evaluation is the pose for now, unless the play time went elsewhere.
+        const auto tolerance = 0.5f * std::abs(frameTime * m_speed) + 1e-4f;
+
+        if (m_hasNextPalette && std::abs(m_nextTime - m_time) <= tolerance)
+            std::swap(m_palette, m_nextPalette);
+        else
+            EvaluatePalette(skeleton, m_time, boneRemap, m_palette.data());
+
+        m_previousPalette = m_palette;
+
+        m_nextTime = m_time + static_cast<float>(updateInterval) * frameTime * m_speed;
+        EvaluatePalette(skeleton, m_nextTime, boneRemap, m_nextPalette.data());
+        m_hasNextPalette = true;
+    }
+
+    m_isPoseDirty = false;
+    ++m_paletteVersion;
+    return true;
+}
+
+void AnimationInstance::Evaluate(Skeleton const& skeleton, AnimationInstance* instances, size_t count)
+{
+    if (count <= EvaluateChunkSize)
+    {
+        for (size_t i = 0; i < count; ++i)
+            instances[i].Evaluate(skeleton);
+        return;
+    }
+
+    // Instances are independent, so each chunk is evaluated on its own thread pool work item.
+    std::vector<size_t> chunks((count + EvaluateChunkSize - 1) / EvaluateChunkSize);
+    std::iota(chunks.begin(), chunks.end(), size_t(0));
+
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+    {
+        const auto first = chunk * EvaluateChunkSize;
+        const auto last  = std::min(first + EvaluateChunkSize, count);
+
+        for (auto i = first; i < last; ++i)
+            instances[i].Evaluate(skeleton);
+    });
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// AnimationClip.h, AnimationCompression.h and Skeleton.h must be in the #include list before this header.
+
+// Per-instance playback state for an animated model. The skeleton, clips and vertex buffers stay with the model,
+// so each instance holds only its play time, clip weights, world matrix and the bone palette it evaluates.
+// Instances of one skeleton are evaluated together with Evaluate, which splits them across the thread pool,
+// or by AnimationLodManager, which also chooses how often and how many bones each instance evaluates.
+
+class AnimationInstance
+{
+public:
+
+    AnimationInstance() noexcept;
+    AnimationInstance(Skeleton const& skeleton, CompressedAnimationClip const* clip);
+
+    AnimationInstance(AnimationInstance const&) = delete;
+    AnimationInstance& operator= (AnimationInstance const&) = delete;
+
+    AnimationInstance(AnimationInstance&&) = default;
+    AnimationInstance& operator= (AnimationInstance&&) = default;
+
+    ~AnimationInstance() = default;
+
+    // Blends a second clip over the first, sampled at the same time. A weight of 0 plays the first clip only.
+    void SetBlendClip(CompressedAnimationClip const* clip, float weight) noexcept;
+    void SetBlendWeight(float weight) noexcept                      { m_blendWeight = weight; m_isPoseDirty = true; }
+
+    void SetTime(float time) noexcept                               { m_time = time; m_isPoseDirty = true; }
+    void SetSpeed(float speed) noexcept                             { m_speed = speed; }
+    void SetWorld(DirectX::SimpleMath::Matrix const& world) noexcept { m_world = world; }
+
+    // Advances the play time by elapsedTime seconds, scaled by the playback speed.
+    void Advance(float elapsedTime) noexcept
+    {
+        m_time += elapsedTime * m_speed;
+        m_isPoseDirty |= elapsedTime * m_speed != 0.0f;
+    }
+
+    const auto GetTime() const noexcept                             { return m_time; }
+    const auto GetSpeed() const noexcept                            { return m_speed; }
+    const auto GetWorld() const noexcept                            { return m_world; }
+    const auto GetBonePalette3X4() const noexcept                   { return m_palette.data(); }
+    const auto GetBonePaletteSize() const noexcept                  { return static_cast<uint32_t>(m_palette.size() * sizeof(DirectX::XMFLOAT3X4)); }
+
+    // Incremented whenever the palette is written. Skinning and BLAS refits can be skipped while it is unchanged.
+    const auto GetPaletteVersion() const noexcept                   { return m_paletteVersion; }
+    const auto GetLodLevel() const noexcept                         { return m_lodLevel; }
+
+    // Samples the clips at the current time and writes the bone palette.
+    void Evaluate(Skeleton const& skeleton);
+
+    // Moves the instance to a level of detail. The next EvaluateLod evaluates the pose after phase frames,
+    // so instances entering a level together are spread over its update interval.
+    void SetLodLevel(uint32_t level, uint32_t phase) noexcept;
+
+    // Level of detail evaluation, called once per frame after Advance. The pose is evaluated only every
+    // updateInterval frames, with the bones of boneRemap (see Skeleton::BuildLodRemap), or all of them if null.
+    // In between, if interpolate is set, the palette is blended from the pose at the last evaluation towards the pose
+    // sampled updateInterval frames of frameTime ahead, otherwise it is held. Returns true if the palette changed.
+    bool EvaluateLod(Skeleton const& skeleton, uint32_t updateInterval, bool interpolate, const uint32_t* boneRemap, float frameTime);
+
+    // Evaluates count instances of one skeleton in a data parallel pass.
+    static void Evaluate(Skeleton const& skeleton, AnimationInstance* instances, size_t count);
+
+private:
+
+    static constexpr size_t EvaluateChunkSize = 16; // Instances per thread pool work item.
+
+    // Samples and blends the clips at time, then writes the palette of the bones kept by boneRemap.
+    void EvaluatePalette(Skeleton const& skeleton, float time, const uint32_t* boneRemap, DirectX::XMFLOAT3X4* palette);
+
+    const CompressedAnimationClip*   m_clip;
+    const CompressedAnimationClip*   m_blendClip;
+    AnimationDecoder                 m_decoder;
+    AnimationDecoder                 m_blendDecoder;
+
+    float                            m_time;         // In seconds.
+    float                            m_speed;
+    float                            m_blendWeight;
+
+    DirectX::SimpleMath::Matrix      m_world;
+
+    std::vector<BoneTransform>       m_pose;
+    std::vector<BoneTransform>       m_blendPose;
+    std::vector<DirectX::XMMATRIX>   m_combined;     // Scratch space for Skeleton::CalculatePalette.
+    std::vector<DirectX::XMFLOAT3X4> m_palette;
+
+    // Level of detail state.
+    uint32_t                         m_lodLevel;
+    uint32_t                         m_framesUntilUpdate;
+    uint32_t                         m_paletteVersion;
+    bool                             m_isPoseDirty;  // Time or clip weights changed since the last evaluation.
+    bool                             m_hasNextPalette;
+    float                            m_nextTime;     // Play time m_nextPalette was sampled at.
+    std::vector<DirectX::XMFLOAT3X4> m_previousPalette;
+    std::vector<DirectX::XMFLOAT3X4> m_nextPalette;
+};
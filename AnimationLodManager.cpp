@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "AnimationLodManager.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+AnimationLodManager::AnimationLodManager(Skeleton const& skeleton, std::vector<AnimationLodLevel> const& levels) :
+    m_skeleton(&skeleton), m_levels(levels), m_cameraPosition(Vector3::Zero), m_projectionScale(1.0f)
+{
+    if (m_levels.empty())
+        throw std::exception("AnimationLodManager needs at least one level");
+
+    m_boneRemaps.resize(m_levels.size());
+
+    for (size_t i = 0; i < m_levels.size(); ++i)
+    {
+        assert(m_levels[i].updateInterval > 0);
+        assert(i == 0 || m_levels[i].minScreenHeight <= m_levels[i - 1].minScreenHeight);
+
+        // Levels that keep every bone don't need a remap.
+        if (m_levels[i].maxBoneDepth != UINT32_MAX)
+            skeleton.BuildLodRemap(m_levels[i].maxBoneDepth, m_boneRemaps[i]);
+    }
+}
+
+std::vector<AnimationLodLevel> AnimationLodManager::GetDefaultLevels()
+{
+    return
+    {
+        { 200.0f, 1, UINT32_MAX, false },   // Close up: every frame, every bone.
+        {  80.0f, 2, UINT32_MAX, true  },
+        {  30.0f, 4, 6,          true  },
+        {   0.0f, 8, 3,          false },   // Distant: the palette holds between evaluations, so skinning is mostly skipped.
+    };
+}
+
+void AnimationLodManager::SetView(Vector3 const& cameraPosition, float fovY, float viewportHeight) noexcept
+{
+    m_cameraPosition  = cameraPosition;
+    m_projectionScale = 0.5f * viewportHeight / std::tan(0.5f * fovY);
+}
+
+float AnimationLodManager::GetScreenHeight(BoundingSphere const& bounds) const noexcept
+{
+    const auto distance = Vector3::Distance(m_cameraPosition, bounds.Center);
+
+    // Inside the sphere it covers the screen.
+    if (distance <= bounds.Radius)
+        return FLT_MAX;
+
+    return 2.0f * bounds.Radius * m_projectionScale / distance;
+}
+
+uint32_t AnimationLodManager::SelectLevel(BoundingSphere const& bounds, uint32_t currentLevel) const noexcept
+{
+    const auto screenHeight = GetScreenHeight(bounds);
+
+    uint32_t level = 0;
+    while (level + 1 < GetLevelCount())
+    {
+        // Moving to a more detailed level than the current one needs a margin above its threshold.
+        const auto threshold = m_levels[level].minScreenHeight * (level < currentLevel ? Hysteresis : 1.0f);
+
+        if (screenHeight >= threshold)
+            break;
+
+        ++level;
+    }
+    return level;
+}
+
+size_t AnimationLodManager::Update(AnimationInstance* instances, const BoundingSphere* bounds, size_t count, float frameTime)
+{
+    auto updateRange = [&](size_t first, size_t last)
+    {
+        size_t changed = 0;
+
+        for (auto i = first; i < last; ++i)
+        {
+            auto& instance = instances[i];
+
+            const auto level = SelectLevel(bounds[i], instance.GetLodLevel());
+            const auto& settings = m_levels[level];
+
+            // Stagger instances over the interval by index, so a level evaluates about count / interval poses each frame.
+            if (level != instance.GetLodLevel())
+                instance.SetLodLevel(level, static_cast<uint32_t>(i % settings.updateInterval));
+
+            if (instance.EvaluateLod(*m_skeleton, settings.updateInterval, settings.interpolate, GetBoneRemap(level), frameTime))
+                ++changed;
+        }
+        return changed;
+    };
+
+    if (count <= UpdateChunkSize)
+        return updateRange(0, count);
+
+    // Instances are independent, so each chunk is updated on its own thread pool work item.
+    std::vector<size_t> chunks((count + UpdateChunkSize - 1) / UpdateChunkSize);
+    std::iota(chunks.begin(), chunks.end(), size_t(0));
+
+    return std::transform_reduce(std::execution::par, chunks.begin(), chunks.end(), size_t(0), std::plus<size_t>(), [&](size_t chunk)
+    {
+        const auto first = chunk * UpdateChunkSize;
+        return updateRange(first, std::min(first + UpdateChunkSize, count));
+    });
+}
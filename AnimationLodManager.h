@@ -0,0 +1,71 @@
+#pragma once
+
+// AnimationClip.h, AnimationCompression.h, Skeleton.h and AnimationInstance.h must be in the #include list before this header.
+
+// Distance based animation level of detail for the instances of one skeleton.
+// Each frame, every instance's bounding sphere is projected to a screen height in pixels, which picks a level.
+// Lower levels evaluate the pose less often, spread over the frames of their interval so the cost per frame stays flat,
+// and collapse the deepest bones onto their ancestors. Between evaluations, the palette is interpolated or held,
+// and instances whose palette didn't change report so, so their skinning and BLAS refit can be skipped.
+
+struct AnimationLodLevel
+{
+    float    minScreenHeight;   // Projected bounding sphere height in pixels from which this level is used.
+    uint32_t updateInterval;    // Frames per pose evaluation. 1 evaluates every frame.
+    uint32_t maxBoneDepth;      // Bones deeper than this below a root follow their ancestor. UINT32_MAX keeps every bone.
+    bool     interpolate;       // Blend between cached palettes between evaluations, rather than hold the last one.
+};
+
+class AnimationLodManager
+{
+public:
+
+    // Levels are ordered from most to least detailed, with decreasing minScreenHeight.
+    AnimationLodManager(Skeleton const& skeleton, std::vector<AnimationLodLevel> const& levels = GetDefaultLevels());
+
+    AnimationLodManager(AnimationLodManager const&) = delete;
+    AnimationLodManager& operator= (AnimationLodManager const&) = delete;
+
+    AnimationLodManager(AnimationLodManager&&) = default;
+    AnimationLodManager& operator= (AnimationLodManager&&) = default;
+
+    ~AnimationLodManager() = default;
+
+    static std::vector<AnimationLodLevel> GetDefaultLevels();
+
+    // Call once per frame, before Update or SelectLevel. fovY is in radians, viewportHeight in pixels.
+    void SetView(DirectX::SimpleMath::Vector3 const& cameraPosition, float fovY, float viewportHeight) noexcept;
+
+    // Projected height in pixels of a world space bounding sphere.
+    float GetScreenHeight(DirectX::BoundingSphere const& bounds) const noexcept;
+
+    // Level for a world space bounding sphere. currentLevel adds hysteresis, so an object sitting on a threshold
+    // doesn't switch back and forth every frame.
+    uint32_t SelectLevel(DirectX::BoundingSphere const& bounds, uint32_t currentLevel) const noexcept;
+
+    // Selects the level of count instances from their world space bounds, then evaluates or interpolates
+    // their palettes on the thread pool. frameTime is the elapsed time of this frame, and instances must already have
+    // been advanced by it. Returns the number of instances whose palette changed.
+    size_t Update(AnimationInstance* instances, const DirectX::BoundingSphere* bounds, size_t count, float frameTime);
+
+    const auto& GetLevel(uint32_t level) const noexcept         { return m_levels[level]; }
+    const auto  GetLevelCount() const noexcept                  { return static_cast<uint32_t>(m_levels.size()); }
+
+    // Bone remap for Skeleton::CalculatePalette at a level, or null if the level keeps every bone.
+    const uint32_t* GetBoneRemap(uint32_t level) const noexcept
+    {
+        return m_boneRemaps[level].empty() ? nullptr : m_boneRemaps[level].data();
+    }
+
+private:
+
+    static constexpr size_t UpdateChunkSize = 64;   // Instances per thread pool work item.
+    static constexpr float  Hysteresis      = 1.1f; // Screen height must exceed a threshold by this to move up a level.
+
+    const Skeleton*                    m_skeleton;
+    std::vector<AnimationLodLevel>     m_levels;
+    std::vector<std::vector<uint32_t>> m_boneRemaps;
+
+    DirectX::SimpleMath::Vector3       m_cameraPosition;
+    float                              m_projectionScale;  // Pixels per world unit of height at unit distance.
+};
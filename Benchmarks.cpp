@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "Benchmarks.h"
+
+using namespace Benchmarks;
+
+namespace
+{
+    constexpr wchar_t BenchmarkSwitch[] = L"-benchmark";
+
+    struct BenchmarkEntry
+    {
+        const wchar_t* name;
+        void (*run)(Report& report);
+    };
+
+    const BenchmarkEntry g_benchmarks[] =
+    {
+        { L"welding",    VertexWelding },
+        { L"cooked",     CookedModelLoading },
+        { L"import",     ImportScratchMemory },
+        { L"memory",     MeshMemoryFootprint },
+        { L"vcache",     VertexCacheOptimization },
+        { L"meshlets",   MeshletCulling },
+        { L"simplify",   LevelOfDetail },
+        { L"collision",  GroundCollision },
+        { L"batch",      CollisionBatch },
+        { L"broadphase", BroadPhaseCollision },
+        { L"sweep",      SweptGroundCollision },
+        { L"simulation", FixedStepSimulation },
+        { L"fleet",      CarFleetSimulation },
+        { L"racingline", RacingLineQueries },
+        { L"animation",  AnimationCompression },
+        { L"instances",  AnimationInstances },
+        { L"lod",        AnimationLod },
+        { L"palette",    BonePalette },
+        { L"skinning",   CpuSkinning },
+        { L"dqskinning", DualQuaternionSkinning },
+        { L"compact",    CompactVertexSkinning },
+        { L"bounds",     SkinnedMeshBounds },
+    };
+
+    // Returns the benchmark name following the -benchmark switch, or an empty string to run them all.
+    std::wstring GetBenchmarkName(const wchar_t* cmdLine)
+    {
+        std::wistringstream args(cmdLine ? cmdLine : L"");
+        std::wstring arg;
+
+        while (args >> arg)
+        {
+            if (_wcsicmp(arg.c_str(), BenchmarkSwitch) == 0)
+            {
+                std::wstring name;
+                args >> name;
+                return name;
+            }
+        }
+        return {};
+    }
+}
+
+Stopwatch::Stopwatch() noexcept
+{
+    QueryPerformanceFrequency(&m_frequency);
+    QueryPerformanceCounter(&m_start);
+}
+
+void Stopwatch::Restart() noexcept
+{
+    QueryPerformanceCounter(&m_start);
+}
+
+double Stopwatch::GetElapsedMilliseconds() const noexcept
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return static_cast<double>(now.QuadPart - m_start.QuadPart) * 1000.0 / static_cast<double>(m_frequency.QuadPart);
+}
+
+HeadlessDevice::HeadlessDevice() noexcept(false)
+{
+    if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(m_d3dDevice.ReleaseAndGetAddressOf()))))
+    {
+        Microsoft::WRL::ComPtr<IDXGIFactory4> dxgiFactory;
+        DX::ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.GetAddressOf())));
+
+        Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
+        DX::ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(adapter.GetAddressOf())));
+        DX::ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(m_d3dDevice.ReleaseAndGetAddressOf())));
+    }
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type  = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    DX::ThrowIfFailed(m_d3dDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_commandQueue.ReleaseAndGetAddressOf())));
+
+    m_graphicsMemory = std::make_unique<DirectX::GraphicsMemory>(m_d3dDevice.Get());
+}
+
+HeadlessDevice::~HeadlessDevice()
+{
+    m_graphicsMemory.reset();
+}
+
+Report::Report() noexcept(false) :
+    m_file("Benchmarks.txt", std::ios::app)
+{
+}
+
+Report::~Report()
+{
+    Line("");
+}
+
+void Report::Heading(const char* title)
+{
+    Line("");
+    Line("%s", title);
+    Line("%s", std::string(strlen(title), '-').c_str());
+}
+
+void Report::Line(const char* format, ...)
+{
+    char buffer[512];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    OutputDebugStringA(buffer);
+    OutputDebugStringA("\n");
+
+    if (m_file)
+        m_file << buffer << '\n';
+}
+
+bool Benchmarks::HasSwitch(const wchar_t* cmdLine, const wchar_t* switchName) noexcept
+{
+    constexpr wchar_t Whitespace[] = L" \t\r\n";
+
+    if (!cmdLine)
+        return false;
+
+    const auto switchLength = wcslen(switchName);
+
+    for (auto arg = cmdLine + wcsspn(cmdLine, Whitespace); *arg != L'\0'; )
+    {
+        const auto argLength = wcscspn(arg, Whitespace);
+
+        if (argLength == switchLength && _wcsnicmp(arg, switchName, argLength) == 0)
+            return true;
+
+        arg += argLength;
+        arg += wcsspn(arg, Whitespace);
+    }
+    return false;
+}
+
+bool Benchmarks::IsRequested(const wchar_t* cmdLine) noexcept
+{
+    return HasSwitch(cmdLine, BenchmarkSwitch);
+}
+
+int Benchmarks::Run(const wchar_t* cmdLine)
+{
+    const auto name = GetBenchmarkName(cmdLine);
+    bool isFound = false;
+
+    Report report;
+
+    for (const auto& benchmark : g_benchmarks)
+    {
+        if (!name.empty() && _wcsicmp(name.c_str(), benchmark.name) != 0)
+            continue;
+
+        isFound = true;
+
+        try
+        {
+            benchmark.run(report);
+        }
+        catch (const std::exception& e)
+        {
+            report.Line("Benchmark failed: %s", e.what());
+            return 1;
+        }
+    }
+
+    if (!isFound)
+    {
+        report.Line("Unknown benchmark: %ls", name.c_str());
+        return 1;
+    }
+    return 0;
+}
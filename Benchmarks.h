@@ -0,0 +1,132 @@
+#pragma once
+
+// Headless benchmarks, run from the command line instead of the game:
+//
+//   Win32GameDR.exe -benchmark          runs every benchmark
+//   Win32GameDR.exe -benchmark welding  runs the named benchmark only
+//
+// Results are written to the debugger output window and appended to Benchmarks.txt.
+
+class FBXModel;
+
+namespace Benchmarks
+{
+    // High resolution timer, using the same QueryPerformanceCounter source as StepTimer.
+    class Stopwatch
+    {
+    public:
+
+        Stopwatch() noexcept;
+
+        void   Restart() noexcept;
+        double GetElapsedMilliseconds() const noexcept;
+
+    private:
+
+        LARGE_INTEGER m_frequency;
+        LARGE_INTEGER m_start;
+    };
+
+    // Collects benchmark output lines.
+    class Report
+    {
+    public:
+
+        Report() noexcept(false);
+        ~Report();
+
+        Report(Report const&) = delete;
+        Report& operator= (Report const&) = delete;
+
+        void Heading(const char* title);
+        void Line(const char* format, ...);
+
+    private:
+
+        std::ofstream m_file;
+    };
+
+    // Minimal D3D12 device, command queue and graphics memory, so models can be loaded without a window.
+    // Falls back to the WARP adapter if no hardware device is available.
+    class HeadlessDevice
+    {
+    public:
+
+        HeadlessDevice() noexcept(false);
+        ~HeadlessDevice();
+
+        HeadlessDevice(HeadlessDevice const&) = delete;
+        HeadlessDevice& operator= (HeadlessDevice const&) = delete;
+
+        auto GetD3DDevice() const noexcept      { return m_d3dDevice.Get(); }
+        auto GetCommandQueue() const noexcept   { return m_commandQueue.Get(); }
+
+    private:
+
+        Microsoft::WRL::ComPtr<ID3D12Device>        m_d3dDevice;
+        Microsoft::WRL::ComPtr<ID3D12CommandQueue>  m_commandQueue;
+        std::unique_ptr<DirectX::GraphicsMemory>    m_graphicsMemory;
+    };
+
+    // A model loaded on a headless device of its own, as most of the model benchmarks start. options are passed on to
+    // the FBXModel constructor after the path. FBXModel.h must be included wherever one is created.
+    class HeadlessModel
+    {
+    public:
+
+        template<class... Options>
+        explicit HeadlessModel(const char* path, Options... options) :
+            m_model(std::make_unique<FBXModel>(m_device.GetD3DDevice(), m_device.GetCommandQueue(), path, options...))
+        {
+        }
+
+        HeadlessModel(HeadlessModel const&) = delete;
+        HeadlessModel& operator= (HeadlessModel const&) = delete;
+
+        auto& GetDevice() const noexcept        { return m_device; }
+        auto  operator->() const noexcept       { return m_model.get(); }
+
+    private:
+
+        // The model is released before the device it was loaded on.
+        HeadlessDevice             m_device;
+        std::unique_ptr<FBXModel>  m_model;
+    };
+
+    // True if one of the whitespace separated arguments in cmdLine is switchName, ignoring case. An argument that only
+    // contains switchName, such as a path, doesn't count.
+    bool HasSwitch(const wchar_t* cmdLine, const wchar_t* switchName) noexcept;
+
+    bool IsRequested(const wchar_t* cmdLine) noexcept;
+    int  Run(const wchar_t* cmdLine);
+
+    // Benchmarks_Mesh.cpp
+    void VertexWelding(Report& report);
+    void CookedModelLoading(Report& report);
+    void ImportScratchMemory(Report& report);
+    void MeshMemoryFootprint(Report& report);
+    void VertexCacheOptimization(Report& report);
+    void MeshletCulling(Report& report);
+    void LevelOfDetail(Report& report);
+
+    // Benchmarks_Collision.cpp
+    void GroundCollision(Report& report);
+    void CollisionBatch(Report& report);
+    void BroadPhaseCollision(Report& report);
+    void SweptGroundCollision(Report& report);
+
+    // Benchmarks_Simulation.cpp
+    void FixedStepSimulation(Report& report);
+    void CarFleetSimulation(Report& report);
+    void RacingLineQueries(Report& report);
+
+    // Benchmarks_Animation.cpp
+    void AnimationCompression(Report& report);
+    void AnimationInstances(Report& report);
+    void AnimationLod(Report& report);
+    void BonePalette(Report& report);
+    void CpuSkinning(Report& report);
+    void DualQuaternionSkinning(Report& report);
+    void CompactVertexSkinning(Report& report);
+    void SkinnedMeshBounds(Report& report);
+}
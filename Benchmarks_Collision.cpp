@@ -0,0 +1,528 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+#include "BroadPhase.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "SDKMESHModel.h"
+#include "Benchmarks.h"
+
+using namespace Benchmarks;
+
+namespace
+{
+    constexpr wchar_t RacetrackFile[] = L"Models\\AlbertParkAll.sdkmesh";
+
+    // The original Game::TestGroundCollision loop, kept as the baseline.
+    // Walks every triangle, recomputing its normal, and returns the first hit.
+    template<typename Volume>
+    bool TestGroundCollisionBruteForce(const SDKMESHModel* groundModel, const Volume& volume, CollisionTriangle& triangle)
+    {
+        const auto triCount  = groundModel->GetCollisionTriangleCount();
+        const auto vertices  = groundModel->GetCollisionVertices();
+        const auto indices16 = groundModel->GetCollisionIndices16();
+        const auto indices32 = groundModel->GetCollisionIndices32();
+        const auto isIndex16 = groundModel->GetCollisionIndexFormat() == DXGI_FORMAT_R16_UINT;
+
+        for (uint32_t i = 0; i < triCount; ++i)
+        {
+            if (isIndex16)
+            {
+                triangle.pointa = vertices[indices16[i * 3 + 0]].Position;
+                triangle.pointb = vertices[indices16[i * 3 + 1]].Position;
+                triangle.pointc = vertices[indices16[i * 3 + 2]].Position;
+            }
+            else
+            {
+                triangle.pointa = vertices[indices32[i * 3 + 0]].Position;
+                triangle.pointb = vertices[indices32[i * 3 + 1]].Position;
+                triangle.pointc = vertices[indices32[i * 3 + 2]].Position;
+            }
+
+            triangle.collision = ContainmentType::DISJOINT;
+
+            const auto N = XMVector3Normalize(XMVector3Cross(
+                XMVectorSubtract(triangle.pointb, triangle.pointa),
+                XMVectorSubtract(triangle.pointc, triangle.pointa)));
+
+            if (!XMVector3Equal(N, XMVectorZero()))
+            {
+                if (volume.Intersects(triangle.pointa, triangle.pointb, triangle.pointc))
+                {
+                    triangle.collision = ContainmentType::INTERSECTS;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Query centres just above random collision triangles, as the camera and cars would be,
+    // plus a share of random points over the whole model bounds that mostly miss.
+    std::vector<Vector3> CreateQueryPoints(const SDKMESHModel* groundModel, size_t count)
+    {
+        const auto triCount  = groundModel->GetCollisionTriangleCount();
+        const auto vertices  = groundModel->GetCollisionVertices();
+        const auto indices16 = groundModel->GetCollisionIndices16();
+        const auto indices32 = groundModel->GetCollisionIndices32();
+        const auto isIndex16 = groundModel->GetCollisionIndexFormat() == DXGI_FORMAT_R16_UINT;
+        const auto bounds    = groundModel->GetBoundingBox(0);
+
+        auto position = [&](uint32_t i) { return Vector3(vertices[isIndex16 ? indices16[i] : indices32[i]].Position); };
+
+        std::mt19937 rng(5678);
+        std::uniform_int_distribution<uint32_t> triangleDist(0, triCount - 1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<Vector3> points;
+        points.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i % 4 == 3)
+            {
+                points.emplace_back(
+                    bounds.Center.x + unit(rng) * bounds.Extents.x,
+                    bounds.Center.y + unit(rng) * bounds.Extents.y,
+                    bounds.Center.z + unit(rng) * bounds.Extents.z);
+            }
+            else
+            {
+                const auto t = triangleDist(rng);
+                const auto centroid = (position(t * 3) + position(t * 3 + 1) + position(t * 3 + 2)) / 3.0f;
+                points.push_back(centroid + Vector3(0.0f, 0.4f * unit(rng), 0.0f));
+            }
+        }
+        return points;
+    }
+
+    // Sweeps the volume against every triangle, returning the earliest time of impact.
+    template<typename Volume, typename TriangleSweep>
+    bool SweepBruteForce(const SDKMESHModel* groundModel, const Volume& volume, const Vector3& displacement,
+        TriangleSweep sweep, float& time)
+    {
+        const auto triCount  = groundModel->GetCollisionTriangleCount();
+        const auto vertices  = groundModel->GetCollisionVertices();
+        const auto indices16 = groundModel->GetCollisionIndices16();
+        const auto indices32 = groundModel->GetCollisionIndices32();
+        const auto isIndex16 = groundModel->GetCollisionIndexFormat() == DXGI_FORMAT_R16_UINT;
+
+        auto position = [&](uint32_t i) { return Vector3(vertices[isIndex16 ? indices16[i] : indices32[i]].Position); };
+
+        bool isHit = false;
+        time = 1.0f;
+
+        for (uint32_t i = 0; i < triCount; ++i)
+        {
+            const auto a = position(i * 3 + 0);
+            const auto b = position(i * 3 + 1);
+            const auto c = position(i * 3 + 2);
+
+            // Degenerate triangles are left out of the collision mesh.
+            if ((b - a).Cross(c - a).LengthSquared() == 0.0f)
+                continue;
+
+            float t;
+            if (sweep(volume, displacement, a, b, c, t) && t <= time)
+            {
+                time = t;
+                isHit = true;
+            }
+        }
+        return isHit;
+    }
+
+    template<typename Volume>
+    void CompareQueries(Report& report, const char* name, const SDKMESHModel* groundModel, const std::vector<Volume>& volumes)
+    {
+        const auto& collisionMesh = groundModel->GetCollisionMesh();
+
+        std::vector<uint8_t> bruteHits(volumes.size());
+        std::vector<uint8_t> indexedHits(volumes.size());
+        CollisionTriangle triangle = {};
+
+        Stopwatch stopwatch;
+        for (size_t i = 0; i < volumes.size(); ++i)
+            bruteHits[i] = TestGroundCollisionBruteForce(groundModel, volumes[i], triangle);
+        const double bruteMs = stopwatch.GetElapsedMilliseconds();
+
+        stopwatch.Restart();
+        for (size_t i = 0; i < volumes.size(); ++i)
+            indexedHits[i] = collisionMesh.Intersects(volumes[i], triangle);
+        const double indexedMs = stopwatch.GetElapsedMilliseconds();
+
+        const auto hits = std::count(bruteHits.begin(), bruteHits.end(), uint8_t(1));
+        const auto agree = std::equal(bruteHits.begin(), bruteHits.end(), indexedHits.begin());
+
+        report.Line("%-8s %8zu %6zd %14.3f %14.3f %9.1fx %8s", name, volumes.size(), hits,
+            bruteMs * 1000.0 / volumes.size(), indexedMs * 1000.0 / volumes.size(),
+            bruteMs / std::max(indexedMs, 0.001), agree ? "yes" : "NO");
+    }
+}
+
+void Benchmarks::GroundCollision(Report& report)
+{
+    constexpr size_t QueryCount = 4096;
+
+    HeadlessDevice device;
+
+    Stopwatch stopwatch;
+    auto racetrack = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), RacetrackFile, RacetrackFile);
+    const double loadMs = stopwatch.GetElapsedMilliseconds();
+
+    const auto& collisionMesh = racetrack->GetCollisionMesh();
+
+    report.Heading("Ground collision, AlbertParkAll.sdkmesh");
+    report.Line("Triangles %u (%u non-degenerate, %u packets of 4), grid %u x %u, model load and index build %.1f ms",
+        racetrack->GetCollisionTriangleCount(), collisionMesh.GetTriangleCount(), collisionMesh.GetPacketCount(),
+        collisionMesh.GetCellCountX(), collisionMesh.GetCellCountZ(), loadMs);
+    report.Line("%-8s %8s %6s %14s %14s %10s %8s", "volume", "queries", "hits", "brute us/qry", "grid us/qry", "speedup", "agree");
+
+    const auto points = CreateQueryPoints(racetrack.get(), QueryCount);
+
+    std::vector<BoundingSphere> spheres;
+    std::vector<BoundingBox> boxes;
+
+    for (const auto& p : points)
+    {
+        spheres.emplace_back(p, 0.5f);                       // Camera sphere.
+        boxes.emplace_back(p, XMFLOAT3(0.6f, 0.25f, 1.2f));  // Roughly car sized box.
+    }
+
+    CompareQueries(report, "sphere", racetrack.get(), spheres);
+    CompareQueries(report, "box", racetrack.get(), boxes);
+
+    // Ground height under each point, checked against a ray cast straight down from well above the model.
+    const auto bounds = racetrack->GetBoundingBox(0);
+    const auto rayY = bounds.Center.y + 2.0f * bounds.Extents.y;
+    std::vector<float> heights(points.size());
+    std::vector<uint8_t> heightHits(points.size());
+    Vector3 normal;
+
+    stopwatch.Restart();
+    for (size_t i = 0; i < points.size(); ++i)
+        heightHits[i] = collisionMesh.GetGroundHeight(points[i].x, points[i].z, heights[i], normal);
+    const double heightMs = stopwatch.GetElapsedMilliseconds();
+
+    CollisionTriangle triangle = {};
+    size_t agree = 0;
+
+    stopwatch.Restart();
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const CollisionRay ray = { Vector3(points[i].x, rayY, points[i].z), -Vector3::UnitY };
+        const bool isHit = collisionMesh.Intersects(ray, 4.0f * bounds.Extents.y, triangle);
+        agree += isHit == bool(heightHits[i]) && (!isHit || std::abs(triangle.height - heights[i]) < 1e-3f);
+    }
+    const double rayMs = stopwatch.GetElapsedMilliseconds();
+
+    report.Line("Ground height %.3f us/qry, downward ray %.3f us/qry, %zd hits, %zu of %zu agree",
+        heightMs * 1000.0 / points.size(), rayMs * 1000.0 / points.size(),
+        std::count(heightHits.begin(), heightHits.end(), uint8_t(1)), agree, points.size());
+
+    // Queries that aren't finite, as a physics blow up produces, must find nothing rather than index cells out of range.
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float infinity = std::numeric_limits<float>::infinity();
+    bool isRejected = true;
+
+    for (const auto value : { nan, infinity, -infinity })
+    {
+        const Vector3 center(value, bounds.Center.y, value);
+        const CollisionRay ray = { Vector3(value, rayY, bounds.Center.z), -Vector3::UnitY };
+        float height = 0.0f;
+
+        isRejected = isRejected &&
+                     !collisionMesh.Intersects(BoundingSphere(center, 0.5f), triangle) &&
+                     !collisionMesh.Intersects(BoundingBox(center, XMFLOAT3(0.6f, 0.25f, 1.2f)), triangle) &&
+                     !collisionMesh.Intersects(ray, 4.0f * bounds.Extents.y, triangle) &&
+                     !collisionMesh.GetGroundHeight(value, value, height, normal);
+    }
+
+    report.Line("NaN and infinite queries find nothing: %s", isRejected ? "yes" : "NO");
+}
+
+void Benchmarks::CollisionBatch(Report& report)
+{
+    constexpr size_t MinQueriesTimed = 16384; // Small batches are repeated so timings are stable.
+    constexpr float  RayHeight       = 10.0f;
+
+    HeadlessDevice device;
+    auto racetrack = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), RacetrackFile, RacetrackFile);
+    const auto& collisionMesh = racetrack->GetCollisionMesh();
+
+    report.Heading("Batched ground collision, AlbertParkAll.sdkmesh");
+    report.Line("%-8s %8s %14s %14s %10s %8s", "query", "batch", "single us/qry", "batch us/qry", "speedup", "agree");
+
+    const size_t batchSizes[] = { 1, 16, 256, 4096 };
+
+    for (auto batchSize : batchSizes)
+    {
+        const auto points = CreateQueryPoints(racetrack.get(), batchSize);
+
+        std::vector<BoundingSphere> spheres;
+        std::vector<BoundingBox> boxes;
+        std::vector<CollisionRay> rays;
+
+        for (const auto& p : points)
+        {
+            spheres.emplace_back(p, 0.5f);
+            boxes.emplace_back(p, XMFLOAT3(0.6f, 0.25f, 1.2f));
+            rays.push_back({ p + Vector3(0.0f, RayHeight, 0.0f), -Vector3::UnitY });
+        }
+
+        const size_t repeats = std::max(size_t(1), MinQueriesTimed / batchSize);
+
+        std::vector<CollisionTriangle> single(batchSize);
+        std::vector<CollisionTriangle> batch(batchSize);
+
+        auto compare = [&](const char* name, auto singleQuery, auto batchQuery)
+        {
+            Stopwatch stopwatch;
+            for (size_t r = 0; r < repeats; ++r)
+                for (size_t i = 0; i < batchSize; ++i)
+                    singleQuery(i);
+            const double singleMs = stopwatch.GetElapsedMilliseconds();
+
+            stopwatch.Restart();
+            for (size_t r = 0; r < repeats; ++r)
+                batchQuery();
+            const double batchMs = stopwatch.GetElapsedMilliseconds();
+
+            bool agree = true;
+            for (size_t i = 0; i < batchSize; ++i)
+            {
+                agree &= single[i].collision == batch[i].collision;
+                agree &= single[i].collision != ContainmentType::INTERSECTS || single[i].index == batch[i].index;
+            }
+
+            const double queries = static_cast<double>(repeats * batchSize);
+            report.Line("%-8s %8zu %14.3f %14.3f %9.1fx %8s", name, batchSize,
+                singleMs * 1000.0 / queries, batchMs * 1000.0 / queries,
+                singleMs / std::max(batchMs, 0.001), agree ? "yes" : "NO");
+        };
+
+        compare("sphere",
+            [&](size_t i) { collisionMesh.Intersects(spheres[i], single[i]); },
+            [&]() { collisionMesh.Intersects(spheres.data(), batchSize, batch.data()); });
+
+        compare("box",
+            [&](size_t i) { collisionMesh.Intersects(boxes[i], single[i]); },
+            [&]() { collisionMesh.Intersects(boxes.data(), batchSize, batch.data()); });
+
+        compare("ray",
+            [&](size_t i) { collisionMesh.Intersects(rays[i], 2.0f * RayHeight, single[i]); },
+            [&]() { collisionMesh.Intersects(rays.data(), batchSize, 2.0f * RayHeight, batch.data()); });
+    }
+}
+
+void Benchmarks::BroadPhaseCollision(Report& report)
+{
+    constexpr uint32_t FrameCount      = 300;
+    constexpr uint32_t RespawnInterval = 60;       // Every so often a share of the boxes is removed and added again.
+    constexpr float    AreaPerBox      = 25.0f;    // Square metres of track per car, so density is the same at any count.
+    constexpr float    MaxSpeed        = 0.5f;     // Metres per frame.
+
+    report.Heading("Broad phase, car sized boxes moving over a flat world");
+    report.Line("%-8s %12s %12s %10s %8s %8s %10s %8s %8s", "boxes", "sap ms/frm", "brute ms/frm", "speedup",
+        "pairs", "moves", "tests", "axis", "agree");
+
+    const size_t boxCounts[] = { 10, 100, 1000, 10000 };
+
+    for (auto boxCount : boxCounts)
+    {
+        const auto side = std::sqrt(AreaPerBox * static_cast<float>(boxCount));
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<BoundingBox> boxes(boxCount);
+        std::vector<Vector3> velocities(boxCount);
+        std::vector<uint32_t> proxies(boxCount);
+
+        BroadPhase broadPhase;
+
+        for (size_t i = 0; i < boxCount; ++i)
+        {
+            boxes[i] = BoundingBox(XMFLOAT3(unit(rng) * side, 0.25f, unit(rng) * side), XMFLOAT3(0.6f, 0.25f, 1.2f));
+            velocities[i] = Vector3(unit(rng) - 0.5f, 0.0f, unit(rng) - 0.5f) * 2.0f * MaxSpeed;
+            proxies[i] = broadPhase.Add(boxes[i]);
+        }
+
+        // Brute force is only run where it finishes in reasonable time.
+        const bool isBruteForce = boxCount <= 1000;
+
+        double sweepMs = 0.0;
+        double bruteMs = 0.0;
+        size_t pairCount = 0;
+        size_t moveCount = 0;
+        size_t testCount = 0;
+        bool agree = true;
+
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        std::vector<std::pair<uint32_t, uint32_t>> expected;
+
+        for (uint32_t frame = 0; frame < FrameCount; ++frame)
+        {
+            for (size_t i = 0; i < boxCount; ++i)
+            {
+                auto& center = boxes[i].Center;
+                auto& velocity = velocities[i];
+
+                center.x += velocity.x;
+                center.z += velocity.z;
+
+                if (center.x < 0.0f || center.x > side)
+                    velocity.x = -velocity.x;
+                if (center.z < 0.0f || center.z > side)
+                    velocity.z = -velocity.z;
+
+                broadPhase.Update(proxies[i], boxes[i]);
+            }
+
+            if (frame % RespawnInterval == RespawnInterval - 1)
+            {
+                for (size_t i = 0; i < boxCount; i += 16)
+                    broadPhase.Remove(proxies[i]);
+
+                for (size_t i = 0; i < boxCount; i += 16)
+                {
+                    boxes[i].Center = XMFLOAT3(unit(rng) * side, 0.25f, unit(rng) * side);
+                    proxies[i] = broadPhase.Add(boxes[i]);
+                }
+            }
+
+            Stopwatch stopwatch;
+            broadPhase.FindPairs();
+            sweepMs += stopwatch.GetElapsedMilliseconds();
+
+            // The first frame sorts from scratch, so it is left out of the work counts.
+            if (frame > 0)
+            {
+                pairCount += broadPhase.GetPairs().size();
+                moveCount += broadPhase.GetMoveCount();
+                testCount += broadPhase.GetTestCount();
+            }
+
+            if (!isBruteForce)
+                continue;
+
+            expected.clear();
+
+            stopwatch.Restart();
+            for (size_t i = 0; i < boxCount; ++i)
+            {
+                for (size_t j = i + 1; j < boxCount; ++j)
+                {
+                    if (boxes[i].Intersects(boxes[j]))
+                        expected.emplace_back(std::min(proxies[i], proxies[j]), std::max(proxies[i], proxies[j]));
+                }
+            }
+            bruteMs += stopwatch.GetElapsedMilliseconds();
+
+            found.clear();
+            for (const auto& pair : broadPhase.GetPairs())
+                found.emplace_back(pair.first, pair.second);
+
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+            agree &= found == expected;
+        }
+
+        const double frames = FrameCount - 1.0;
+
+        if (isBruteForce)
+        {
+            report.Line("%-8zu %12.4f %12.4f %9.1fx %8.1f %8.1f %10.1f %8u %8s", boxCount,
+                sweepMs / FrameCount, bruteMs / FrameCount, bruteMs / std::max(sweepMs, 0.001),
+                pairCount / frames, moveCount / frames, testCount / frames, broadPhase.GetSweepAxis(), agree ? "yes" : "NO");
+        }
+        else
+        {
+            report.Line("%-8zu %12.4f %12s %10s %8.1f %8.1f %10.1f %8u %8s", boxCount,
+                sweepMs / FrameCount, "-", "-",
+                pairCount / frames, moveCount / frames, testCount / frames, broadPhase.GetSweepAxis(), "-");
+        }
+    }
+}
+
+void Benchmarks::SweptGroundCollision(Report& report)
+{
+    constexpr size_t QueryCount  = 1024;
+    constexpr float  MaxDistance = 8.0f;    // Metres moved in a frame, a fast car at a low frame rate.
+
+    HeadlessDevice device;
+    auto racetrack = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), RacetrackFile, RacetrackFile);
+    const auto& collisionMesh = racetrack->GetCollisionMesh();
+
+    report.Heading("Swept collision, AlbertParkAll.sdkmesh");
+    report.Line("%-8s %8s %6s %9s %14s %14s %10s %8s", "volume", "queries", "hits", "tunnels", "brute us/qry", "grid us/qry",
+        "speedup", "agree");
+
+    // Moves starting above the surface and heading across and down through it.
+    const auto points = CreateQueryPoints(racetrack.get(), QueryCount);
+
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<Vector3> displacements;
+    for (size_t i = 0; i < points.size(); ++i)
+        displacements.emplace_back(unit(rng) * MaxDistance, -std::abs(unit(rng)) * 2.0f, unit(rng) * MaxDistance);
+
+    auto compare = [&](const char* name, const auto& volumes, auto sweep)
+    {
+        std::vector<uint8_t> bruteHits(volumes.size());
+        std::vector<float>   bruteTimes(volumes.size());
+        std::vector<uint8_t> gridHits(volumes.size());
+        std::vector<float>   gridTimes(volumes.size());
+        CollisionTriangle triangle = {};
+
+        Stopwatch stopwatch;
+        for (size_t i = 0; i < volumes.size(); ++i)
+            bruteHits[i] = SweepBruteForce(racetrack.get(), volumes[i], displacements[i], sweep, bruteTimes[i]);
+        const double bruteMs = stopwatch.GetElapsedMilliseconds();
+
+        stopwatch.Restart();
+        for (size_t i = 0; i < volumes.size(); ++i)
+            gridHits[i] = collisionMesh.Sweep(volumes[i], displacements[i], triangle, gridTimes[i]);
+        const double gridMs = stopwatch.GetElapsedMilliseconds();
+
+        // Tunnels are hits that a test of the volume at only its start and end positions would miss.
+        size_t hits = 0;
+        size_t tunnels = 0;
+        bool agree = true;
+
+        for (size_t i = 0; i < volumes.size(); ++i)
+        {
+            agree &= bruteHits[i] == gridHits[i] && (!bruteHits[i] || std::abs(bruteTimes[i] - gridTimes[i]) < 1e-4f);
+
+            if (!gridHits[i])
+                continue;
+
+            ++hits;
+
+            auto end = volumes[i];
+            end.Center = Vector3(end.Center) + displacements[i];
+            tunnels += !collisionMesh.Intersects(volumes[i], triangle) && !collisionMesh.Intersects(end, triangle);
+        }
+
+        report.Line("%-8s %8zu %6zu %9zu %14.3f %14.3f %9.1fx %8s", name, volumes.size(), hits, tunnels,
+            bruteMs * 1000.0 / volumes.size(), gridMs * 1000.0 / volumes.size(),
+            bruteMs / std::max(gridMs, 0.001), agree ? "yes" : "NO");
+    };
+
+    std::vector<BoundingSphere> spheres;
+    std::vector<BoundingBox> boxes;
+
+    for (const auto& p : points)
+    {
+        const auto start = p + Vector3(0.0f, 1.5f, 0.0f);
+        spheres.emplace_back(start, 0.5f);
+        boxes.emplace_back(start, XMFLOAT3(0.6f, 0.25f, 1.2f));
+    }
+
+    compare("sphere", spheres, SweptCollision::SweepSphereTriangle);
+    compare("box", boxes, SweptCollision::SweepBoxTriangle);
+}
@@ -0,0 +1,838 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
+#include "FBXModel.h"
+#include "CookedModel.h"
+#include "SDKMESHModel.h"
+#include "MonotonicArena.h"
+#include "Benchmarks.h"
+#include "VertexWelder.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+using namespace Benchmarks;
+
+namespace
+{
+    // Matches the attributes FBXModel::DedupeVertices welds on.
+    struct WeldVertex
+    {
+        Vector3 pos;
+        Vector3 normal;
+        Vector2 texC;
+        Vector3 tangent;
+    };
+
+    // Builds an un-indexed triangle list from a rippled grid, the way FBXModel::LoadNormalTexTangent
+    // emits one vertex per polygon corner. Each interior grid vertex is repeated six times.
+    std::vector<WeldVertex> CreateTriangleSoup(uint32_t targetVertexCount, float jitter)
+    {
+        const auto quads = std::max(1u, targetVertexCount / 6u);
+        const auto columns = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<float>(quads))));
+        const auto rows = std::max(1u, quads / columns);
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> noise(-jitter, jitter);
+
+        auto gridVertex = [&](uint32_t x, uint32_t z)
+        {
+            const float fx = static_cast<float>(x);
+            const float fz = static_cast<float>(z);
+
+            WeldVertex v;
+            v.pos     = Vector3(fx, std::sin(fx * 0.1f) * std::cos(fz * 0.1f), -fz);
+            v.normal  = Vector3(-0.1f * std::cos(fx * 0.1f), 1.0f, 0.1f * std::sin(fz * 0.1f));
+            v.normal.Normalize();
+            v.texC    = Vector2(fx / columns, fz / rows);
+            v.tangent = Vector3::UnitX;
+
+            if (jitter > 0.0f)
+                v.pos += Vector3(noise(rng), noise(rng), noise(rng));
+            return v;
+        };
+
+        std::vector<WeldVertex> vertices;
+        vertices.reserve(static_cast<size_t>(rows) * columns * 6);
+
+        for (uint32_t z = 0; z < rows; ++z)
+        {
+            for (uint32_t x = 0; x < columns; ++x)
+            {
+                vertices.push_back(gridVertex(x,     z));
+                vertices.push_back(gridVertex(x + 1, z));
+                vertices.push_back(gridVertex(x,     z + 1));
+
+                vertices.push_back(gridVertex(x + 1, z));
+                vertices.push_back(gridVertex(x + 1, z + 1));
+                vertices.push_back(gridVertex(x,     z + 1));
+            }
+        }
+        return vertices;
+    }
+
+    // The original FBXModel::FindVertex search, kept as the baseline.
+    std::vector<uint32_t> WeldSequential(const std::vector<WeldVertex>& vertices)
+    {
+        std::vector<WeldVertex> finalVertices;
+        std::vector<uint32_t> indices;
+        indices.reserve(vertices.size());
+
+        for (const auto& v : vertices)
+        {
+            uint32_t findIndex = UINT32_MAX;
+
+            for (uint32_t i = 0; i < static_cast<uint32_t>(finalVertices.size()); ++i)
+            {
+                if (v.pos == finalVertices[i].pos
+                    && v.normal == finalVertices[i].normal
+                    && v.texC == finalVertices[i].texC
+                    && v.tangent == finalVertices[i].tangent)
+                {
+                    findIndex = i;
+                    break;
+                }
+            }
+
+            if (findIndex == UINT32_MAX)
+            {
+                findIndex = static_cast<uint32_t>(finalVertices.size());
+                finalVertices.push_back(v);
+            }
+            indices.push_back(findIndex);
+        }
+        return indices;
+    }
+
+    std::vector<uint32_t> WeldHashed(const std::vector<WeldVertex>& vertices, float epsilon, uint32_t& uniqueCount)
+    {
+        VertexWelder<11> welder(epsilon, vertices.size());
+        std::vector<uint32_t> indices;
+        indices.reserve(vertices.size());
+
+        for (const auto& v : vertices)
+        {
+            auto findIndex = welder.FindOrAdd({
+                v.pos.x,     v.pos.y,    v.pos.z,
+                v.normal.x,  v.normal.y, v.normal.z,
+                v.texC.x,    v.texC.y,
+                v.tangent.x, v.tangent.y, v.tangent.z });
+
+            indices.push_back(findIndex == UINT32_MAX ? welder.GetVertexCount() - 1 : findIndex);
+        }
+        uniqueCount = welder.GetVertexCount();
+        return indices;
+    }
+
+    // Heap allocations and live bytes, counted by CountingAllocator.
+    struct AllocationCounter
+    {
+        size_t count     = 0;
+        size_t bytes     = 0;
+        size_t peakBytes = 0;
+    };
+
+    template<typename T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+
+        explicit CountingAllocator(AllocationCounter* counter) noexcept : counter(counter) {}
+
+        template<typename U>
+        CountingAllocator(CountingAllocator<U> const& other) noexcept : counter(other.counter) {}
+
+        T* allocate(size_t n)
+        {
+            ++counter->count;
+            counter->bytes += n * sizeof(T);
+            counter->peakBytes = std::max(counter->peakBytes, counter->bytes);
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            counter->bytes -= n * sizeof(T);
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template<typename U>
+        bool operator==(CountingAllocator<U> const& other) const noexcept { return counter == other.counter; }
+
+        AllocationCounter* counter;
+    };
+
+    struct BlendingPair
+    {
+        uint32_t blendingIndex;
+        float    blendingWeight;
+    };
+
+    // The control point FBXModel allocated with new for every control point before the import arena.
+    struct LegacyControlPoint
+    {
+        explicit LegacyControlPoint(AllocationCounter* counter) : blendingInfo(CountingAllocator<BlendingPair>(counter))
+        {
+            blendingInfo.reserve(4);
+        }
+
+        Vector3 position;
+        std::vector<BlendingPair, CountingAllocator<BlendingPair>> blendingInfo;
+    };
+
+    using LegacyControlPointMap = std::unordered_map<uint32_t, LegacyControlPoint*, std::hash<uint32_t>, std::equal_to<uint32_t>,
+        CountingAllocator<std::pair<const uint32_t, LegacyControlPoint*>>>;
+
+    // Replays the control point tables of an import with the old per control point allocations.
+    // influences[i] is the number of bone influences of control point i.
+    void ImportControlPointsLegacy(std::vector<uint32_t> const& influences, AllocationCounter& counter)
+    {
+        CountingAllocator<LegacyControlPoint> pointAllocator(&counter);
+        LegacyControlPointMap controlPoints(0, std::hash<uint32_t>(), std::equal_to<uint32_t>(),
+            CountingAllocator<std::pair<const uint32_t, LegacyControlPoint*>>(&counter));
+
+        const auto count = static_cast<uint32_t>(influences.size());
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto point = pointAllocator.allocate(1);
+            new (point) LegacyControlPoint(&counter);
+            controlPoints.insert(std::make_pair(i, point));
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            for (uint32_t j = 0; j < influences[i]; ++j)
+                controlPoints[i]->blendingInfo.push_back({ j, 0.25f });
+        }
+
+        for (auto& point : controlPoints)
+        {
+            for (size_t i = point.second->blendingInfo.size(); i <= 4; ++i)
+                point.second->blendingInfo.push_back({ 0, 0.0f });
+        }
+
+        for (auto& point : controlPoints)
+        {
+            point.second->~LegacyControlPoint();
+            pointAllocator.deallocate(point.second, 1);
+        }
+    }
+
+    // The same tables as flat arrays in an arena, as FBXModel::LoadControlPoints now builds them.
+    void ImportControlPointsArena(std::vector<uint32_t> const& influences, MonotonicArena& arena)
+    {
+        constexpr uint32_t MaxInfluences = 4;
+        const auto count = influences.size();
+
+        auto positions = arena.Allocate<Vector3>(count);
+        auto blending = arena.Allocate<BlendingPair>(count * MaxInfluences);
+        auto blendingCounts = arena.Allocate<uint8_t>(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            positions[i] = Vector3::Zero;
+
+            for (uint32_t j = 0; j < influences[i]; ++j)
+            {
+                if (blendingCounts[i] < MaxInfluences)
+                    blending[i * MaxInfluences + blendingCounts[i]++] = { j, 0.25f };
+            }
+        }
+    }
+}
+
+void Benchmarks::VertexWelding(Report& report)
+{
+    // The sequential search is quadratic, so it is only run where it finishes in reasonable time.
+    constexpr uint32_t MaxSequentialVertexCount = 65536;
+
+    const uint32_t vertexCounts[] = { 1000, 4000, 16000, 64000, 250000, 1000000 };
+
+    report.Heading("Vertex welding, exact mode");
+    report.Line("%10s %10s %14s %12s %9s %10s", "vertices", "unique", "sequential ms", "hashed ms", "speedup", "identical");
+
+    for (auto count : vertexCounts)
+    {
+        const auto vertices = CreateTriangleSoup(count, 0.0f);
+
+        uint32_t uniqueCount = 0;
+        Stopwatch stopwatch;
+        const auto hashed = WeldHashed(vertices, 0.0f, uniqueCount);
+        const double hashedMs = stopwatch.GetElapsedMilliseconds();
+
+        if (vertices.size() <= MaxSequentialVertexCount)
+        {
+            stopwatch.Restart();
+            const auto sequential = WeldSequential(vertices);
+            const double sequentialMs = stopwatch.GetElapsedMilliseconds();
+
+            report.Line("%10zu %10u %14.2f %12.2f %8.1fx %10s", vertices.size(), uniqueCount, sequentialMs, hashedMs,
+                sequentialMs / std::max(hashedMs, 0.001), sequential == hashed ? "yes" : "NO");
+        }
+        else
+        {
+            report.Line("%10zu %10u %14s %12.2f %9s %10s", vertices.size(), uniqueCount, "skipped", hashedMs, "-", "-");
+        }
+    }
+
+    // Positions jittered by up to 1e-5 no longer weld exactly, but do within epsilon.
+    report.Heading("Vertex welding, epsilon mode (positions jittered by 1e-5)");
+    report.Line("%10s %10s %10s %12s", "vertices", "exact", "epsilon", "hashed ms");
+
+    for (auto count : vertexCounts)
+    {
+        const auto vertices = CreateTriangleSoup(count, 1e-5f);
+
+        uint32_t exactCount = 0;
+        WeldHashed(vertices, 0.0f, exactCount);
+
+        uint32_t epsilonCount = 0;
+        Stopwatch stopwatch;
+        WeldHashed(vertices, 1e-3f, epsilonCount);
+        const double hashedMs = stopwatch.GetElapsedMilliseconds();
+
+        report.Line("%10zu %10u %10u %12.2f", vertices.size(), exactCount, epsilonCount, hashedMs);
+    }
+}
+
+void Benchmarks::CookedModelLoading(Report& report)
+{
+    constexpr char   FbxFile[]     = "Models\\Dove.fbx";
+    constexpr size_t FbxRepeats    = 3;
+    constexpr size_t CookedRepeats = 10;
+
+    HeadlessDevice device;
+
+    // Cooked to the temp folder, so the benchmark doesn't replace a cooked model the game would load.
+    char tempPath[MAX_PATH] = {};
+    GetTempPathA(MAX_PATH, tempPath);
+    const auto cookedFile = std::string(tempPath) + "Dove" + CookedModel::FileExtension;
+
+    auto load = [&](const char* path) { return std::make_unique<FBXModel>(device.GetD3DDevice(), device.GetCommandQueue(), path); };
+
+    // The first load also warms the file cache, so neither path is timed reading from disk.
+    auto fbx = load(FbxFile);
+
+    Stopwatch stopwatch;
+    for (size_t r = 0; r < FbxRepeats; ++r)
+        fbx = load(FbxFile);
+    const double fbxMs = stopwatch.GetElapsedMilliseconds() / FbxRepeats;
+
+    stopwatch.Restart();
+    fbx->SaveCooked(cookedFile.c_str());
+    const double cookMs = stopwatch.GetElapsedMilliseconds();
+
+    auto cooked = load(cookedFile.c_str());
+
+    stopwatch.Restart();
+    for (size_t r = 0; r < CookedRepeats; ++r)
+        cooked = load(cookedFile.c_str());
+    const double cookedMs = stopwatch.GetElapsedMilliseconds() / CookedRepeats;
+
+    uint64_t fileSize = 0;
+    {
+        CookedModel::MappedFile file;
+        if (file.Open(cookedFile.c_str()))
+            fileSize = file.GetSize();
+    }
+
+    report.Heading("Model loading, FBX SDK against cooked, Dove.fbx");
+    report.Line("Cooked file %llu bytes, written in %.1f ms", fileSize, cookMs);
+    report.Line("%-8s %12s %10s", "source", "load ms", "speedup");
+    report.Line("%-8s %12.2f %10s", "fbx", fbxMs, "-");
+    report.Line("%-8s %12.2f %9.1fx", "cooked", cookedMs, fbxMs / std::max(cookedMs, 0.001));
+
+    // The cooked model must match the one it was cooked from, down to the bits of its vertices and palette.
+    bool isIdentical = cooked->GetMeshCount() == fbx->GetMeshCount() &&
+                       cooked->GetSkeleton().GetBoneCount() == fbx->GetSkeleton().GetBoneCount() &&
+                       cooked->GetAnimDuration() == fbx->GetAnimDuration();
+
+    for (size_t mesh = 0; isIdentical && mesh < fbx->GetMeshCount(); ++mesh)
+    {
+        isIdentical = cooked->GetVertexCount(mesh) == fbx->GetVertexCount(mesh) &&
+                      cooked->GetIndexCount(mesh) == fbx->GetIndexCount(mesh) &&
+                      cooked->GetIndexFormat(mesh) == fbx->GetIndexFormat(mesh) &&
+                      memcmp(cooked->GetVertices(mesh), fbx->GetVertices(mesh), fbx->GetVertexCount(mesh) * sizeof(FBXModel::Vertex)) == 0;
+
+        const auto& cookedMeshlets = cooked->GetMeshlets(mesh);
+        const auto& fbxMeshlets = fbx->GetMeshlets(mesh);
+
+        isIdentical = isIdentical &&
+                      cookedMeshlets.GetMeshletCount() == fbxMeshlets.GetMeshletCount() &&
+                      cookedMeshlets.GetPrimitiveCount() == fbxMeshlets.GetPrimitiveCount() &&
+                      memcmp(cookedMeshlets.GetBounds(), fbxMeshlets.GetBounds(), fbxMeshlets.GetMeshletCount() * sizeof(Meshlets::MeshletBounds)) == 0;
+    }
+
+    if (isIdentical)
+    {
+        fbx->AdvanceTime(0.5f);
+        cooked->AdvanceTime(0.5f);
+        isIdentical = memcmp(cooked->GetBonePalette3X4(), fbx->GetBonePalette3X4(), fbx->GetBonePaletteSize()) == 0;
+    }
+
+    report.Line("Meshes, meshlets, skeleton and palette at t = 0.5 s identical: %s", isIdentical ? "yes" : "NO");
+
+    cooked.reset();
+
+    // A file that passes the header checks, but indexes past its vertices or has more bones than the palette holds,
+    // must fail to load, so the game imports the FBX file instead.
+    std::vector<char> bytes;
+    {
+        std::ifstream in(cookedFile, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    CookedModel::FileHeader header = {};
+    CookedModel::MeshHeader meshHeader = {};
+    memcpy(&header, bytes.data(), sizeof(header));
+    memcpy(&meshHeader, bytes.data() + header.meshesOffset, sizeof(meshHeader));
+
+    auto isRejected = [&](auto&& corrupt)
+    {
+        auto corrupted = bytes;
+        corrupt(corrupted.data());
+        {
+            std::ofstream out(cookedFile, std::ios::binary | std::ios::trunc);
+            out.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+        }
+
+        try
+        {
+            load(cookedFile.c_str());
+            return false;
+        }
+        catch (const std::exception&)
+        {
+            return true;
+        }
+    };
+
+    const auto isIndexRejected = isRejected([&](char* data)
+    {
+        // The last index, so the first triangle is still whole.
+        const auto offset = meshHeader.indicesOffset + static_cast<uint64_t>(meshHeader.indexCount - 1) * meshHeader.indexSize;
+        const uint32_t index = meshHeader.vertexCount;
+        memcpy(data + offset, &index, meshHeader.indexSize);
+    });
+    const auto isBoneCountRejected = isRejected([&](char* data)
+    {
+        const uint32_t boneCount = FBXModel::MaxBones + 1;
+        memcpy(data + offsetof(CookedModel::FileHeader, boneCount), &boneCount, sizeof(boneCount));
+    });
+
+    report.Line("Index past the vertices rejected: %s, %u bones rejected: %s", isIndexRejected ? "yes" : "NO",
+        FBXModel::MaxBones + 1, isBoneCountRejected ? "yes" : "NO");
+
+    DeleteFileA(cookedFile.c_str());
+}
+
+void Benchmarks::ImportScratchMemory(Report& report)
+{
+    constexpr size_t Repeats = 20;
+
+    HeadlessModel dove("Models\\Dove.fbx");
+    const auto& statistics = dove->GetImportStatistics();
+
+    report.Heading("FBX import scratch memory, Dove.fbx");
+    report.Line("%zu control points, %zu bone influences", statistics.controlPointCount, statistics.influenceCount);
+    report.Line("Import arena: %zu bytes used, %zu bytes reserved in %zu blocks, released after UploadMeshes",
+        statistics.arenaBytesUsed, statistics.arenaBytesReserved, statistics.arenaBlockCount);
+
+    // Replay the Dove's control point tables both ways, with its influences spread evenly over its control points.
+    const auto controlPointCount = std::max<size_t>(statistics.controlPointCount, 1);
+    std::vector<uint32_t> influences(controlPointCount);
+
+    for (size_t i = 0; i < controlPointCount; ++i)
+    {
+        influences[i] = static_cast<uint32_t>((statistics.influenceCount * (i + 1)) / controlPointCount -
+                                              (statistics.influenceCount * i) / controlPointCount);
+    }
+
+    AllocationCounter legacy;
+    Stopwatch stopwatch;
+    for (size_t r = 0; r < Repeats; ++r)
+    {
+        legacy = AllocationCounter();
+        ImportControlPointsLegacy(influences, legacy);
+    }
+    const double legacyMs = stopwatch.GetElapsedMilliseconds() / Repeats;
+
+    MonotonicArena arena;
+    size_t arenaBlocks = 0;
+    size_t arenaBytes = 0;
+
+    stopwatch.Restart();
+    for (size_t r = 0; r < Repeats; ++r)
+    {
+        ImportControlPointsArena(influences, arena);
+        arenaBlocks = arena.GetBlockCount();
+        arenaBytes = arena.GetBytesReserved();
+        arena.Release();
+    }
+    const double arenaMs = stopwatch.GetElapsedMilliseconds() / Repeats;
+
+    report.Line("%-22s %12s %12s %10s", "control point tables", "allocations", "peak bytes", "ms");
+    report.Line("%-22s %12zu %12zu %10.3f", "new per point, map", legacy.count, legacy.peakBytes, legacyMs);
+    report.Line("%-22s %12zu %12zu %10.3f", "flat arrays, arena", arenaBlocks, arenaBytes, arenaMs);
+}
+
+void Benchmarks::MeshMemoryFootprint(Report& report)
+{
+    constexpr char FbxFile[] = "Models\\Dove.fbx";
+
+    struct Policy
+    {
+        const char*             name;
+        FBXModel::MeshRetention retention;
+    };
+
+    const Policy policies[] =
+    {
+        { "all",       FBXModel::MeshRetention::All },
+        { "collision", FBXModel::MeshRetention::Collision },
+        { "none",      FBXModel::MeshRetention::None },
+    };
+
+    report.Heading("Resident memory per mesh retention policy, Dove.fbx");
+    report.Line("%-10s %14s %14s %14s %14s", "policy", "cpu mesh", "cpu animation", "gpu buffers", "gpu allocated");
+
+    bool isDrawable = true;
+    size_t gpuBytes = 0;
+
+    for (const auto& policy : policies)
+    {
+        HeadlessModel dove(FbxFile, 0.0f, 30.0f, policy.retention);
+        dove->CompressAnimation();
+
+        const auto footprint = dove->GetMemoryFootprint();
+        report.Line("%-10s %14zu %14zu %14zu %14zu", policy.name, footprint.cpuMeshBytes, footprint.cpuAnimationBytes,
+            footprint.gpuBufferBytes, footprint.gpuAllocatedBytes);
+
+        // Every policy must leave the same GPU buffers and the bounds the game culls with.
+        if (gpuBytes == 0)
+            gpuBytes = footprint.gpuBufferBytes;
+
+        dove->AdvanceTime(0.5f);
+        isDrawable = isDrawable && footprint.gpuBufferBytes == gpuBytes && dove->GetMeshCount() > 0 &&
+                     dove->GetBoundingSphere(0).Radius > 0.0f;
+    }
+
+    report.Line("Buffers and animated bounds unchanged by the policy: %s", isDrawable ? "yes" : "NO");
+}
+
+void Benchmarks::VertexCacheOptimization(Report& report)
+{
+    struct SdkmeshFile
+    {
+        const char*    name;
+        const wchar_t* path;
+    };
+
+    const SdkmeshFile sdkmeshFiles[] =
+    {
+        { "Suzanne",       L"Models\\Suzanne.sdkmesh" },
+        { "Palmtree",      L"Models\\Palmtree.sdkmesh" },
+        { "MiniRaceCar",   L"Models\\MiniRaceCar.sdkmesh" },
+        { "Racetrack",     L"Models\\Racetrack.sdkmesh" },
+        { "AlbertParkAll", L"Models\\AlbertParkAll.sdkmesh" },
+    };
+
+    // Statistics are measured while importing, so the Dove is loaded from its FBX file rather than a cooked copy. The
+    // SDKMESH models are loaded on its device.
+    HeadlessModel dove("Models\\Dove.fbx");
+    const auto& device = dove.GetDevice();
+
+    report.Heading("Vertex cache and fetch order, as loaded and after MeshOptimizer");
+    report.Line("Post-transform cache of %u vertices, fetch cache of %u x %u byte lines",
+        MeshOptimizer::CacheSize, MeshOptimizer::FetchLines, MeshOptimizer::FetchLineSize);
+    report.Line("%-20s %9s %15s %15s %15s", "model", "triangles", "ACMR", "ATVR", "overfetch");
+
+    auto line = [&](const char* name, MeshOptimizer::MeshStatistics const& statistics)
+    {
+        const auto& before = statistics.before;
+        const auto& after  = statistics.after;
+
+        report.Line("%-20s %9zu %6.3f -> %5.3f %6.3f -> %5.3f %6.3f -> %5.3f", name, before.triangleCount,
+            before.GetAcmr(), after.GetAcmr(), before.GetAtvr(), after.GetAtvr(), before.GetOverfetch(), after.GetOverfetch());
+    };
+
+    for (const auto& file : sdkmeshFiles)
+    {
+        auto model = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), file.path, file.path);
+        line(file.name, model->GetMeshStatistics());
+    }
+
+    line("Dove", dove->GetMeshStatistics());
+}
+
+void Benchmarks::MeshletCulling(Report& report)
+{
+    constexpr size_t FrameCount  = 600;             // One lap, 10 seconds at 60 frames per second.
+    constexpr float  LapRadius   = 0.6f;            // Of the track's half extents.
+    constexpr float  EyeHeight   = 1.5f;            // Above the ground.
+    constexpr float  FieldOfView = 1.0f;            // As Game::CreateWindowSizeDependentResources sets the lens.
+    constexpr float  AspectRatio = 16.0f / 9.0f;
+    constexpr float  NearPlane   = 0.1f;
+    constexpr float  FarPlane    = 5000.0f;
+
+    constexpr wchar_t RacetrackFile[] = L"Models\\AlbertParkAll.sdkmesh";
+
+    struct SdkmeshFile
+    {
+        const char*    name;
+        const wchar_t* path;
+    };
+
+    struct MeshletTotals
+    {
+        size_t triangles = 0;
+        size_t meshlets  = 0;
+        size_t vertices  = 0;   // Meshlet vertex index entries.
+        size_t bytes     = 0;
+
+        void Add(Meshlets const& source)
+        {
+            triangles += source.GetPrimitiveCount();
+            meshlets  += source.GetMeshletCount();
+            vertices  += source.GetVertexIndexCount();
+            bytes     += source.GetSizeInBytes();
+        }
+    };
+
+    const SdkmeshFile sdkmeshFiles[] =
+    {
+        { "Suzanne",       L"Models\\Suzanne.sdkmesh" },
+        { "Palmtree",      L"Models\\Palmtree.sdkmesh" },
+        { "MiniRaceCar",   L"Models\\MiniRaceCar.sdkmesh" },
+        { "AlbertParkAll", RacetrackFile },
+    };
+
+    // The SDKMESH models are loaded on the Dove's device.
+    HeadlessModel dove("Models\\Dove.fbx");
+    const auto& device = dove.GetDevice();
+
+    report.Heading("Meshlets of the game's models");
+    report.Line("At most %u vertices and %u triangles per meshlet", Meshlets::MaxVertices, Meshlets::MaxPrimitives);
+    report.Line("%-16s %10s %10s %12s %12s %10s", "model", "triangles", "meshlets", "verts/mlet", "tris/mlet", "KB");
+
+    auto line = [&](const char* name, MeshletTotals const& totals)
+    {
+        const auto meshletCount = static_cast<double>(std::max<size_t>(totals.meshlets, 1));
+
+        report.Line("%-16s %10zu %10zu %12.1f %12.1f %10.1f", name, totals.triangles, totals.meshlets,
+            totals.vertices / meshletCount, totals.triangles / meshletCount, totals.bytes / 1024.0);
+    };
+
+    std::unique_ptr<SDKMESHModel> racetrack;
+
+    for (const auto& file : sdkmeshFiles)
+    {
+        auto model = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), file.path, file.path);
+        MeshletTotals totals;
+
+        for (size_t mesh = 0; mesh < model->GetMeshCount(); ++mesh)
+        {
+            for (size_t part = 0; part < model->GetMeshPartCount(mesh); ++part)
+            {
+                totals.Add(model->GetMeshlets(mesh, part));
+            }
+        }
+        line(file.name, totals);
+
+        if (wcscmp(file.path, RacetrackFile) == 0)
+            racetrack = std::move(model);
+    }
+
+    {
+        MeshletTotals totals;
+
+        for (size_t mesh = 0; mesh < dove->GetMeshCount(); ++mesh)
+        {
+            totals.Add(dove->GetMeshlets(mesh));
+        }
+        line("Dove (bind pose)", totals);
+    }
+
+    // A lap of the track on an ellipse through its bounds, following the ground and looking ahead.
+    BoundingBox trackBounds = racetrack->GetBoundingBox(0);
+    for (size_t mesh = 1; mesh < racetrack->GetMeshCount(); ++mesh)
+    {
+        BoundingBox::CreateMerged(trackBounds, trackBounds, racetrack->GetBoundingBox(mesh));
+    }
+
+    const auto projection = Matrix::CreatePerspectiveFieldOfView(FieldOfView, AspectRatio, NearPlane, FarPlane);
+
+    auto isInside = [](Meshlets::View const& view, BoundingSphere const& sphere)
+    {
+        return std::all_of(std::begin(view.planes), std::end(view.planes), [&](XMFLOAT4 const& plane)
+        {
+            return plane.x * sphere.Center.x + plane.y * sphere.Center.y + plane.z * sphere.Center.z + plane.w >= -sphere.Radius;
+        });
+    };
+
+    Meshlets::CullStatistics statistics = {};
+    size_t meshTriangles = 0;       // Triangles drawn when whole meshes are frustum culled.
+    std::vector<uint32_t> visible;
+    double cullMs = 0.0;
+
+    for (size_t frame = 0; frame < FrameCount; ++frame)
+    {
+        const float angle = XM_2PI * static_cast<float>(frame) / FrameCount;
+        const float radiusX = LapRadius * trackBounds.Extents.x;
+        const float radiusZ = LapRadius * trackBounds.Extents.z;
+
+        Vector3 eye(trackBounds.Center.x + radiusX * std::cos(angle), 0.0f, trackBounds.Center.z + radiusZ * std::sin(angle));
+        Vector3 forward(-radiusX * std::sin(angle), 0.0f, radiusZ * std::cos(angle));
+        forward.Normalize();
+
+        float groundHeight;
+        Vector3 normal;
+        if (!racetrack->GetGroundHeight(eye.x, eye.z, groundHeight, normal))
+            groundHeight = trackBounds.Center.y - trackBounds.Extents.y;
+        eye.y = groundHeight + EyeHeight;
+
+        const auto view = Meshlets::View::Create(Matrix::CreateLookAt(eye, eye + forward, Vector3::Up) * projection, eye);
+
+        for (size_t mesh = 0; mesh < racetrack->GetMeshCount(); ++mesh)
+        {
+            if (!isInside(view, racetrack->GetBoundingSphere(mesh)))
+                continue;
+
+            for (size_t part = 0; part < racetrack->GetMeshPartCount(mesh); ++part)
+            {
+                meshTriangles += racetrack->GetMeshlets(mesh, part).GetPrimitiveCount();
+            }
+        }
+
+        Stopwatch stopwatch;
+        for (size_t mesh = 0; mesh < racetrack->GetMeshCount(); ++mesh)
+        {
+            for (size_t part = 0; part < racetrack->GetMeshPartCount(mesh); ++part)
+            {
+                visible.clear();
+                racetrack->GetMeshlets(mesh, part).Cull(view, visible, statistics);
+            }
+        }
+        cullMs += stopwatch.GetElapsedMilliseconds();
+    }
+
+    const auto percent = [](size_t count, size_t total) { return total ? 100.0 * count / total : 0.0; };
+
+    report.Heading("Meshlet culling over a lap of AlbertParkAll.sdkmesh");
+    report.Line("%zu frames, eye %.1f above the ground, field of view %.1f rad", FrameCount, EyeHeight, FieldOfView);
+    report.Line("Triangles drawn with whole mesh frustum culling: %5.1f%%", percent(meshTriangles, statistics.triangleCount));
+    report.Line("Meshlets frustum culled:                         %5.1f%%", percent(statistics.frustumCulled, statistics.meshletCount));
+    report.Line("Meshlets backface culled by their normal cone:   %5.1f%%", percent(statistics.backfaceCulled, statistics.meshletCount));
+    report.Line("Triangles drawn with meshlet culling:            %5.1f%%", percent(statistics.visibleTriangles, statistics.triangleCount));
+    report.Line("Meshlet culling %.2f us per frame", cullMs * 1000.0 / FrameCount);
+}
+
+void Benchmarks::LevelOfDetail(Report& report)
+{
+    constexpr float FieldOfView    = 1.0f;      // As Game::CreateWindowSizeDependentResources sets the lens.
+    constexpr float ViewportHeight = 1080.0f;
+    constexpr float EyeHeight      = 1.5f;
+
+    constexpr wchar_t PalmtreeFile[] = L"Models\\Palmtree.sdkmesh";
+
+    struct SdkmeshFile
+    {
+        const char*    name;
+        const wchar_t* path;
+    };
+
+    const SdkmeshFile sdkmeshFiles[] =
+    {
+        { "Suzanne",       L"Models\\Suzanne.sdkmesh" },
+        { "Palmtree",      PalmtreeFile },
+        { "MiniRaceCar",   L"Models\\MiniRaceCar.sdkmesh" },
+        { "AlbertParkAll", L"Models\\AlbertParkAll.sdkmesh" },
+    };
+
+    const float distances[] = { 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f, 320.0f };
+
+    HeadlessDevice device;
+
+    report.Heading("Levels of detail built by MeshSimplifier");
+    report.Line("%-16s %5s %6s %10s %10s", "model", "mesh", "level", "triangles", "error");
+
+    std::unique_ptr<SDKMESHModel> palmtree;
+
+    // Level 0 must draw the part itself, including parts after the first in a shared index buffer that could not be
+    // simplified and so keep only that level.
+    bool isFullLevelInPlace = true;
+    size_t offsetSingleLevelParts = 0;
+
+    for (const auto& file : sdkmeshFiles)
+    {
+        auto model = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), file.path, file.path);
+
+        for (size_t mesh = 0; mesh < model->GetMeshCount(); ++mesh)
+        {
+            for (size_t part = 0; part < model->GetMeshPartCount(mesh); ++part)
+            {
+                for (size_t lod = 0; lod < model->GetLodCount(mesh, part); ++lod)
+                {
+                    const auto& level = model->GetLod(mesh, part, lod);
+                    report.Line("%-16s %5zu %6zu %10u %10.4f", lod == 0 ? file.name : "", mesh, lod, level.indexCount / 3, level.error);
+                }
+
+                const auto& fullLevel = model->GetLod(mesh, part, 0);
+                isFullLevelInPlace = isFullLevelInPlace && fullLevel.startIndex == model->GetIndexStart(mesh, part) &&
+                                     fullLevel.indexCount == model->GetIndexCount(mesh, part);
+
+                if (model->GetIndexStart(mesh, part) != 0 && model->GetLodCount(mesh, part) == 1)
+                    ++offsetSingleLevelParts;
+            }
+        }
+
+        if (wcscmp(file.path, PalmtreeFile) == 0)
+            palmtree = std::move(model);
+    }
+
+    report.Line("Level 0 draws each part's own indices: %s (%zu parts after the first in their buffer kept one level)",
+        isFullLevelInPlace ? "yes" : "NO", offsetSingleLevelParts);
+
+    // The palm tree seen from further and further away, as SceneMain::Render picks its levels.
+    const auto projectionScale = 0.5f * ViewportHeight / std::tan(0.5f * FieldOfView);
+
+    report.Heading("Palmtree triangles drawn by distance");
+    report.Line("%.0f pixel viewport, field of view %.1f rad, at most %.1f pixel error",
+        ViewportHeight, FieldOfView, SDKMESHModel::MaxLodPixelError);
+    report.Line("%10s %12s %12s %10s", "distance", "trunk level", "canopy level", "triangles");
+
+    size_t fullTriangles = 0;
+    for (size_t mesh = 0; mesh < palmtree->GetMeshCount(); ++mesh)
+    {
+        fullTriangles += palmtree->GetLod(mesh, 0, 0).indexCount / 3;
+    }
+
+    for (const auto distance : distances)
+    {
+        const Vector3 cameraPosition(0.0f, EyeHeight, distance);
+        size_t levels[2] = {};
+        size_t triangles = 0;
+
+        for (size_t mesh = 0; mesh < palmtree->GetMeshCount(); ++mesh)
+        {
+            const auto lod = palmtree->SelectLod(mesh, 0, cameraPosition, projectionScale);
+
+            if (mesh < 2)
+                levels[mesh] = lod;
+            triangles += palmtree->GetLod(mesh, 0, lod).indexCount / 3;
+        }
+
+        report.Line("%10.0f %12zu %12zu %10zu (%.0f%%)", distance, levels[0], levels[1], triangles,
+            100.0 * triangles / std::max<size_t>(fullTriangles, 1));
+    }
+}
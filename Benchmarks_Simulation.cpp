@@ -0,0 +1,254 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "SDKMESHModel.h"
+#include "AnimationStructs.h"
+#include "StepTimer.h"
+#include "RacingLine.h"
+#include "Simulation.h"
+#include "CarFleet.h"
+#include "Benchmarks.h"
+
+using namespace Benchmarks;
+
+namespace
+{
+    constexpr wchar_t CarFile[] = L"Models\\MiniRaceCar.sdkmesh";
+
+    // The car's starting place, as set by SceneMain::Initialize.
+    const Vector3 CarStartPosition = Vector3(6, 0, 12);
+    const Vector3 CarStartForward  = -Vector3::UnitZ;
+}
+
+void Benchmarks::FixedStepSimulation(Report& report)
+{
+    constexpr uint64_t HeadlessTicks = 1000000;
+    constexpr uint32_t ThreadedMs    = 1000;
+
+    HeadlessDevice device;
+    auto car = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), CarFile, CarFile);
+    const auto carBox = car->GetBoundingBox(0);
+
+    report.Heading("Fixed step simulation, one car on auto navigation");
+
+    // Headless, as fast as the simulation can step, with no thread and no rendering.
+    Simulation headless(CarStartPosition, CarStartForward, carBox);
+    headless.SetInput({ false, false, true });
+
+    Stopwatch stopwatch;
+    for (uint64_t i = 0; i < HeadlessTicks; ++i)
+        headless.Step();
+    const double headlessMs = stopwatch.GetElapsedMilliseconds();
+
+    // The same run again, checking that a fixed step gives the same result every time, and counting checkpoints.
+    Simulation repeat(CarStartPosition, CarStartForward, carBox);
+    repeat.SetInput({ false, false, true });
+
+    uint32_t checkpoints = 0;
+    auto nextCheckpoint = repeat.GetLatestCar().nextCheckpoint;
+
+    for (uint64_t i = 0; i < HeadlessTicks; ++i)
+    {
+        repeat.Step();
+
+        const auto checkpoint = repeat.GetLatestCar().nextCheckpoint;
+        checkpoints += checkpoint != nextCheckpoint;
+        nextCheckpoint = checkpoint;
+    }
+
+    const auto first  = headless.GetLatestCar();
+    const auto second = repeat.GetLatestCar();
+    const bool isDeterministic = first.position == second.position && first.forward == second.forward &&
+                                 first.velocity == second.velocity && first.nextCheckpoint == second.nextCheckpoint;
+
+    report.Line("Headless %llu ticks in %.1f ms: %.0f ticks/s, %.0fx real time at %.0f Hz, %.3f us/tick",
+        HeadlessTicks, headlessMs, HeadlessTicks * 1000.0 / headlessMs,
+        HeadlessTicks * Simulation::TickSeconds * 1000.0 / headlessMs, 1.0 / Simulation::TickSeconds,
+        headlessMs * 1000.0 / HeadlessTicks);
+    report.Line("Checkpoints passed %u, repeated run identical: %s", checkpoints, isDeterministic ? "yes" : "NO");
+
+    // On its own thread, which should keep to the tick rate however long the main thread takes.
+    Simulation threaded(CarStartPosition, CarStartForward, carBox);
+    threaded.SetInput({ false, false, true });
+
+    stopwatch.Restart();
+    threaded.Start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ThreadedMs));
+    threaded.Stop();
+    const double threadedMs = stopwatch.GetElapsedMilliseconds();
+
+    report.Line("Threaded %.1f ms: %llu ticks, %.1f expected at %.0f Hz", threadedMs, threaded.GetTicks(),
+        threadedMs / 1000.0 / Simulation::TickSeconds, 1.0 / Simulation::TickSeconds);
+}
+
+void Benchmarks::CarFleetSimulation(Report& report)
+{
+    constexpr uint32_t Ticks = 600;
+    const size_t counts[] = { 100, 1000, 10000, 100000 };
+
+    HeadlessDevice device;
+    auto car = std::make_unique<SDKMESHModel>(device.GetD3DDevice(), device.GetCommandQueue(), CarFile, CarFile);
+
+    // Cars reach a checkpoint when their nose does, as the box test in Simulation finds.
+    const auto carRadius = car->GetBoundingBox(0).Extents.z;
+    const auto& track = Racetracks::track;
+    const auto elapsedTime = static_cast<float>(Simulation::TickSeconds);
+
+    report.Heading("Car fleet on auto navigation, structure of arrays with a parallel step");
+
+    for (const auto count : counts)
+    {
+        CarFleet serial(track, carRadius);
+        CarFleet parallel(track, carRadius);
+
+        // Cars are spread along every stage of the track, each facing the checkpoint at the end of its stage.
+        const auto carsPerStage = (count + track.size() - 1) / track.size();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto stage = static_cast<uint32_t>(i % track.size());
+            const auto& next = track[stage];
+            const auto& prev = track[stage ? stage - 1 : track.size() - 1];
+
+            const auto from = Vector3::Lerp(prev.signpost1, prev.signpost2, 0.5f);
+            const auto to   = Vector3::Lerp(next.signpost1, next.signpost2, 0.5f);
+            const auto position = Vector3::Lerp(from, to, 0.8f * (i / track.size() + 0.5f) / carsPerStage);
+
+            auto forward = to - position;
+            forward.Normalize();
+
+            serial.Add(position, forward, stage);
+            parallel.Add(position, forward, stage);
+        }
+
+        Stopwatch stopwatch;
+        for (uint32_t tick = 0; tick < Ticks; ++tick)
+            serial.Step(elapsedTime, false);
+        const double serialMs = stopwatch.GetElapsedMilliseconds();
+
+        stopwatch.Restart();
+        for (uint32_t tick = 0; tick < Ticks; ++tick)
+            parallel.Step(elapsedTime);
+        const double parallelMs = stopwatch.GetElapsedMilliseconds();
+
+        // Cars don't interact, so splitting them across threads must not change where any of them ends up.
+        bool isIdentical = true;
+        uint64_t checkpoints = 0;
+        auto minLap = INT32_MAX;
+        auto maxLap = INT32_MIN;
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            isIdentical &= serial.GetPosition(i) == parallel.GetPosition(i) &&
+                           serial.GetNextCheckpoint(i) == parallel.GetNextCheckpoint(i);
+            checkpoints += parallel.GetCheckpointsPassed(i);
+            minLap = std::min(minLap, parallel.GetLap(i));
+            maxLap = std::max(maxLap, parallel.GetLap(i));
+        }
+
+        std::vector<uint32_t> order;
+        stopwatch.Restart();
+        parallel.Rank(order);
+        const double rankMs = stopwatch.GetElapsedMilliseconds();
+
+        report.Line("%6zu cars, %u ticks: serial %.3f ms/tick, parallel %.3f ms/tick (%.1fx), %.2f checkpoints per car, identical: %s",
+            count, Ticks, serialMs / Ticks, parallelMs / Ticks, serialMs / parallelMs,
+            static_cast<double>(checkpoints) / count, isIdentical ? "yes" : "NO");
+        report.Line("       laps %d to %d, leader %.1f m, ranked in %.3f ms", minLap, maxLap,
+            parallel.GetRaceDistance(order.front()), rankMs);
+    }
+}
+
+void Benchmarks::RacingLineQueries(Report& report)
+{
+    constexpr uint32_t Queries  = 100000;
+    constexpr uint32_t Checked  = 1000;
+    constexpr float    Margin   = 10.0f;    // Metres around the line that query points are spread over.
+
+    report.Heading("Racing line through Racetracks::track, nearest point queries");
+
+    Stopwatch stopwatch;
+    const RacingLine line(Racetracks::track);
+    const double buildMs = stopwatch.GetElapsedMilliseconds();
+
+    auto minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+    auto minLimit = FLT_MAX, maxLimit = 0.0f;
+    for (size_t k = 0; k < line.GetSampleCount(); ++k)
+    {
+        const auto& sample = line.GetSample(k);
+        minX = std::min(minX, sample.position.x);
+        minZ = std::min(minZ, sample.position.z);
+        maxX = std::max(maxX, sample.position.x);
+        maxZ = std::max(maxZ, sample.position.z);
+        minLimit = std::min(minLimit, sample.speedLimit);
+        maxLimit = std::max(maxLimit, sample.speedLimit);
+    }
+
+    report.Line("Length %.2f m, %zu samples, built in %.3f ms, speed limits %.1f to %.1f km/h", line.GetLength(),
+        line.GetSampleCount(), buildMs, minLimit * PhysicsConstants::MpsToKph, maxLimit * PhysicsConstants::MpsToKph);
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> x(minX - Margin, maxX + Margin);
+    std::uniform_real_distribution<float> z(minZ - Margin, maxZ + Margin);
+
+    std::vector<Vector3> points(Queries);
+    for (auto& point : points)
+        point = Vector3(x(generator), 0, z(generator));
+
+    // Grid queries against every segment of the line.
+    std::vector<float> offsets(Queries);
+    float checksum = 0;
+
+    stopwatch.Restart();
+    for (uint32_t i = 0; i < Queries; ++i)
+        checksum += line.FindNearest(points[i], &offsets[i]);
+    const double gridMs = stopwatch.GetElapsedMilliseconds();
+
+    uint32_t mismatches = 0;
+    stopwatch.Restart();
+    for (uint32_t i = 0; i < Checked; ++i)
+    {
+        auto bestSq = FLT_MAX;
+        for (size_t k = 0; k < line.GetSampleCount(); ++k)
+        {
+            const auto& a = line.GetSample(k).position;
+            const auto ab = line.GetSample((k + 1) % line.GetSampleCount()).position - a;
+            const auto t = std::clamp((points[i] - a).Dot(ab) / ab.LengthSquared(), 0.0f, 1.0f);
+            bestSq = std::min(bestSq, Vector3::DistanceSquared(points[i], a + t * ab));
+        }
+
+        mismatches += std::abs(std::sqrt(bestSq) - offsets[i]) > 1e-4f;
+    }
+    const double bruteMs = stopwatch.GetElapsedMilliseconds() * Queries / Checked;
+
+    report.Line("FindNearest %u points: grid %.3f us/query, all segments %.3f us/query, %u of %u differ (checksum %.1f)",
+        Queries, gridMs * 1000.0 / Queries, bruteMs * 1000.0 / Queries, mismatches, Checked, checksum);
+
+    // Tracking a point that moves along the line a little at a time, off to one side, as a car does.
+    constexpr float Offset = 0.25f;
+    const auto stepLength = 0.2f;
+    const auto steps = static_cast<uint32_t>(10 * line.GetLength() / stepLength);
+    auto distance = 0.0f;
+    float maxError = 0;
+
+    stopwatch.Restart();
+    for (uint32_t i = 1; i <= steps; ++i)
+    {
+        const auto expected = line.Wrap(i * stepLength);
+        const auto sample = line.Evaluate(expected);
+        const auto point = sample.position + Offset * Vector3(-sample.tangent.z, 0, sample.tangent.x);
+        distance = line.Track(point, distance);
+
+        const auto error = std::abs(distance - expected);
+        maxError = std::max(maxError, std::min(error, line.GetLength() - error));
+    }
+    const double trackMs = stopwatch.GetElapsedMilliseconds();
+
+    report.Line("Track %u steps of %.1f m: %.3f us/step, furthest from the distance moved %.2f m", steps, stepLength,
+        trackMs * 1000.0 / steps, maxError);
+}
@@ -0,0 +1,263 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "BroadPhase.h"
+
+BroadPhase::BroadPhase() noexcept :
+    m_removedCount(0),
+    m_addedCount(0),
+    m_axis(0),
+    m_moveCount(0),
+    m_testCount(0)
+{
+}
+
+uint32_t BroadPhase::Add(const BoundingBox& box)
+{
+    uint32_t proxy;
+    if (!m_freeProxies.empty())
+    {
+        proxy = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    }
+    else
+    {
+        proxy = static_cast<uint32_t>(m_proxySlots.size());
+        m_proxySlots.push_back(InvalidProxy);
+    }
+
+    // New boxes go at the end, and the next FindPairs sorts them into place.
+    m_proxySlots[proxy] = static_cast<uint32_t>(m_slotProxies.size());
+    m_slotProxies.push_back(proxy);
+
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_min[axis].push_back(0.0f);
+        m_max[axis].push_back(0.0f);
+    }
+
+    ++m_addedCount;
+
+    Update(proxy, box);
+    return proxy;
+}
+
+void BroadPhase::Remove(uint32_t proxy) noexcept
+{
+    assert(proxy < m_proxySlots.size() && m_proxySlots[proxy] != InvalidProxy);
+
+    const auto slot = m_proxySlots[proxy];
+
+    // An empty box overlaps nothing, and its minimum sorts it past every other box, where FindPairs drops it.
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_min[axis][slot] = FLT_MAX;
+        m_max[axis][slot] = -FLT_MAX;
+    }
+
+    m_slotProxies[slot] = InvalidProxy;
+    m_proxySlots[proxy] = InvalidProxy;
+    m_freeProxies.push_back(proxy);
+    ++m_removedCount;
+}
+
+void BroadPhase::Update(uint32_t proxy, const BoundingBox& box) noexcept
+{
+    assert(proxy < m_proxySlots.size() && m_proxySlots[proxy] != InvalidProxy);
+
+    const auto slot = m_proxySlots[proxy];
+    const float center[3]  = { box.Center.x, box.Center.y, box.Center.z };
+    const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_min[axis][slot] = center[axis] - extents[axis];
+        m_max[axis][slot] = center[axis] + extents[axis];
+    }
+}
+
+void BroadPhase::FindPairs()
+{
+    m_pairs.clear();
+    m_moveCount = 0;
+
+    // A few new boxes are cheap to insert, but many would make the insertion sort quadratic.
+    if (ChooseSweepAxis() || m_addedCount > m_slotProxies.size() / 4)
+        SortByAxis();
+    else
+        InsertionSort();
+
+    m_addedCount = 0;
+
+    // Removed boxes are now at the end.
+    const auto boxCount = m_slotProxies.size() - m_removedCount;
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_min[axis].resize(boxCount);
+        m_max[axis].resize(boxCount);
+    }
+    m_slotProxies.resize(boxCount);
+    m_removedCount = 0;
+
+    const auto axis1 = (m_axis + 1) % 3;
+    const auto axis2 = (m_axis + 2) % 3;
+
+    // Pack each box's bounds on the other two axes, with the maxima negated, so that one vector compare tests both
+    // axes: boxes i and j overlap where every component of j's packed bounds is <= the same of i's reference.
+    m_crossBounds.resize(boxCount);
+    for (size_t i = 0; i < boxCount; ++i)
+    {
+        m_crossBounds[i] = XMFLOAT4(m_min[axis1][i], m_min[axis2][i], -m_max[axis1][i], -m_max[axis2][i]);
+    }
+
+    const auto* sweepMin = m_min[m_axis].data();
+    const auto* sweepMax = m_max[m_axis].data();
+    const auto* crossBounds = m_crossBounds.data();
+    size_t testCount = 0;
+
+    // Every box that starts before box i ends on the sweep axis has already been paired with it, so only the boxes
+    // after it, up to its end, need testing.
+    for (size_t i = 0; i < boxCount; ++i)
+    {
+        const auto end = sweepMax[i];
+        const auto reference = XMVectorSet(m_max[axis1][i], m_max[axis2][i], -m_min[axis1][i], -m_min[axis2][i]);
+
+        auto j = i + 1;
+        for (; j < boxCount && sweepMin[j] <= end; ++j)
+        {
+            if (XMVector4LessOrEqual(XMLoadFloat4(&crossBounds[j]), reference))
+            {
+                const auto a = m_slotProxies[i];
+                const auto b = m_slotProxies[j];
+                m_pairs.push_back({ std::min(a, b), std::max(a, b) });
+            }
+        }
+
+        testCount += j - i - 1;
+    }
+
+    m_testCount = testCount;
+}
+
+bool BroadPhase::ChooseSweepAxis()
+{
+    const auto boxCount = m_slotProxies.size() - m_removedCount;
+    if (boxCount < 2)
+        return false;
+
+    // Variance of the box centres on each axis, skipping removed boxes.
+    double sum[3] = {};
+    double sumSquares[3] = {};
+
+    for (size_t slot = 0; slot < m_slotProxies.size(); ++slot)
+    {
+        if (m_slotProxies[slot] == InvalidProxy)
+            continue;
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            const double center = 0.5 * (static_cast<double>(m_min[axis][slot]) + m_max[axis][slot]);
+            sum[axis] += center;
+            sumSquares[axis] += center * center;
+        }
+    }
+
+    double variance[3];
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        variance[axis] = sumSquares[axis] / boxCount - (sum[axis] / boxCount) * (sum[axis] / boxCount);
+    }
+
+    const auto widest = static_cast<uint32_t>(std::max_element(variance, variance + 3) - variance);
+
+    if (variance[widest] <= AxisSwitchRatio * variance[m_axis])
+        return false;
+
+    m_axis = widest;
+    return true;
+}
+
+void BroadPhase::SortByAxis()
+{
+    const auto slotCount = m_slotProxies.size();
+    const auto& keys = m_min[m_axis];
+
+    std::vector<uint32_t> order(slotCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    std::vector<float> gathered(slotCount);
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        for (size_t i = 0; i < slotCount; ++i)
+        {
+            gathered[i] = m_min[axis][order[i]];
+        }
+        m_min[axis].swap(gathered);
+
+        for (size_t i = 0; i < slotCount; ++i)
+        {
+            gathered[i] = m_max[axis][order[i]];
+        }
+        m_max[axis].swap(gathered);
+    }
+
+    std::vector<uint32_t> proxies(slotCount);
+    for (size_t i = 0; i < slotCount; ++i)
+    {
+        proxies[i] = m_slotProxies[order[i]];
+
+        if (proxies[i] != InvalidProxy)
+            m_proxySlots[proxies[i]] = static_cast<uint32_t>(i);
+    }
+    m_slotProxies.swap(proxies);
+
+    m_moveCount += slotCount;
+}
+
+void BroadPhase::InsertionSort()
+{
+    auto& keys = m_min[m_axis];
+
+    for (size_t i = 1; i < m_slotProxies.size(); ++i)
+    {
+        const auto key = keys[i];
+        if (keys[i - 1] <= key)
+            continue;
+
+        // Lift the box out, shift the boxes before it that start later up a slot, and drop it in the gap.
+        float minimum[3];
+        float maximum[3];
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            minimum[axis] = m_min[axis][i];
+            maximum[axis] = m_max[axis][i];
+        }
+        const auto proxy = m_slotProxies[i];
+
+        auto j = i;
+        for (; j > 0 && keys[j - 1] > key; --j)
+        {
+            for (size_t axis = 0; axis < 3; ++axis)
+            {
+                m_min[axis][j] = m_min[axis][j - 1];
+                m_max[axis][j] = m_max[axis][j - 1];
+            }
+            m_slotProxies[j] = m_slotProxies[j - 1];
+
+            if (m_slotProxies[j] != InvalidProxy)
+                m_proxySlots[m_slotProxies[j]] = static_cast<uint32_t>(j);
+        }
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            m_min[axis][j] = minimum[axis];
+            m_max[axis][j] = maximum[axis];
+        }
+        m_slotProxies[j] = proxy;
+
+        if (proxy != InvalidProxy)
+            m_proxySlots[proxy] = static_cast<uint32_t>(j);
+
+        m_moveCount += i - j;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+
+// Sort and sweep broad phase over the world space boxes of dynamic objects.
+// Boxes are kept in structure of arrays form, ordered by their minimum on a sweep axis. Objects move little between
+// frames, so each update re-sorts an order that is already nearly sorted, with an insertion sort that runs close to
+// linear time. A sweep along the order then reports every pair of boxes that overlap on all three axes, as candidates
+// for a narrow phase to test with the DirectXCollision shapes.
+
+class BroadPhase
+{
+public:
+
+    static constexpr uint32_t InvalidProxy = UINT32_MAX;
+
+    // Proxies of two overlapping boxes, with first < second.
+    struct Pair
+    {
+        uint32_t first;
+        uint32_t second;
+    };
+
+    BroadPhase() noexcept;
+
+    BroadPhase(BroadPhase const&) = delete;
+    BroadPhase& operator= (BroadPhase const&) = delete;
+
+    BroadPhase(BroadPhase&&) = default;
+    BroadPhase& operator= (BroadPhase&&) = default;
+
+    ~BroadPhase() = default;
+
+    // Returns the proxy that identifies the box from now on. Proxies of removed boxes are reused.
+    uint32_t Add(const BoundingBox& box);
+    void Remove(uint32_t proxy) noexcept;
+    void Update(uint32_t proxy, const BoundingBox& box) noexcept;
+
+    // Re-sorts the boxes and replaces the pairs with those that overlap now.
+    void FindPairs();
+
+    const auto& GetPairs() const noexcept           { return m_pairs; }
+    const auto  GetBoxCount() const noexcept        { return m_slotProxies.size() - m_removedCount; }
+    const auto  GetSweepAxis() const noexcept       { return m_axis; }
+
+    // Work done by the last FindPairs: boxes moved by the insertion sort, and pairs of boxes compared by the sweep.
+    const auto  GetMoveCount() const noexcept       { return m_moveCount; }
+    const auto  GetTestCount() const noexcept       { return m_testCount; }
+
+private:
+
+    // The sweep moves to the axis with the widest spread of box centres once its variance is this many times the
+    // current axis's. A new axis costs a full sort, so the hysteresis stops objects on a diagonal flipping it.
+    static constexpr float AxisSwitchRatio = 2.0f;
+
+    // Returns true if the sweep axis changed.
+    bool ChooseSweepAxis();
+    void SortByAxis();
+    void InsertionSort();
+
+    // Box bounds per axis, indexed by slot, in sweep order. Removed boxes are empty and sort to the end.
+    std::vector<float>    m_min[3];
+    std::vector<float>    m_max[3];
+    std::vector<uint32_t> m_slotProxies;    // InvalidProxy for removed boxes.
+    std::vector<XMFLOAT4> m_crossBounds;    // Bounds on the two other axes, packed by FindPairs for its sweep.
+
+    std::vector<uint32_t> m_proxySlots;     // InvalidProxy for free proxies.
+    std::vector<uint32_t> m_freeProxies;
+    size_t                m_removedCount;   // Removed boxes still holding a slot.
+    size_t                m_addedCount;     // Boxes added since the last sort, unsorted at the end.
+
+    uint32_t              m_axis;
+    std::vector<Pair>     m_pairs;
+    size_t                m_moveCount;
+    size_t                m_testCount;
+};
@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationStructs.h"
+#include "RacingLine.h"
+#include "CarFleet.h"
+
+CarFleet::CarFleet(const std::vector<Checkpoint>& track, float carRadius) :
+    m_racingLine(track),
+    m_carRadius(carRadius),
+    m_count(0)
+{
+    if (track.empty())
+        throw std::exception("CarFleet needs a track with at least one checkpoint.");
+
+    m_gates.resize(track.size());
+
+    for (size_t i = 0; i < track.size(); ++i)
+    {
+        const auto& checkpoint = track[i];
+        auto& gate = m_gates[i];
+
+        gate.target     = Vector3::Lerp(checkpoint.signpost1, checkpoint.signpost2, 0.5f);
+        gate.forward    = checkpoint.forward;
+        gate.forward.Normalize();
+        gate.across     = checkpoint.signpost2 - checkpoint.signpost1;
+        gate.halfWidth  = 0.5f * gate.across.Length();
+        gate.across.Normalize();
+    }
+}
+
+uint32_t CarFleet::Add(const Vector3& position, const Vector3& forward, uint32_t nextCheckpoint)
+{
+    assert(nextCheckpoint < m_gates.size());
+
+    // Arrays grow a vector's worth at a time, so the padding cars are stationary with no acceleration.
+    if (m_count % VectorWidth == 0)
+    {
+        const auto size = m_count + VectorWidth;
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            m_position[axis].resize(size);
+            m_velocity[axis].resize(size);
+            m_forward[axis].resize(size);
+            m_acceleration[axis].resize(size);
+        }
+
+        m_speedLimit.resize(size);
+        m_lineDistance.resize(size);
+        m_laps.resize(size);
+        m_nextCheckpoint.resize(size);
+        m_checkpointsPassed.resize(size);
+    }
+
+    const auto car = m_count++;
+
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_position[axis][car] = (&position.x)[axis];
+        m_forward[axis][car]  = (&forward.x)[axis];
+    }
+
+    m_lineDistance[car]   = m_racingLine.FindNearest(position);
+    m_speedLimit[car]     = m_racingLine.Evaluate(m_lineDistance[car]).speedLimit;
+    m_nextCheckpoint[car] = nextCheckpoint;
+
+    return static_cast<uint32_t>(car);
+}
+
+void CarFleet::Clear() noexcept
+{
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        m_position[axis].clear();
+        m_velocity[axis].clear();
+        m_forward[axis].clear();
+        m_acceleration[axis].clear();
+    }
+
+    m_speedLimit.clear();
+    m_lineDistance.clear();
+    m_laps.clear();
+    m_nextCheckpoint.clear();
+    m_checkpointsPassed.clear();
+    m_count = 0;
+}
+
+void CarFleet::Step(float elapsedTime, bool isParallel)
+{
+    auto stepChunk = [&](size_t chunk)
+    {
+        const auto first = chunk * StepChunkSize;
+        const auto last  = std::min(first + StepChunkSize, m_count);
+
+        Navigate(first, last, elapsedTime);
+        Integrate(first, last, elapsedTime);
+        PassCheckpoints(first, last);
+    };
+
+    const auto chunkCount = (m_count + StepChunkSize - 1) / StepChunkSize;
+
+    if (!isParallel || chunkCount <= 1)
+    {
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+            stepChunk(chunk);
+        return;
+    }
+
+    std::vector<size_t> chunks(chunkCount);
+    std::iota(chunks.begin(), chunks.end(), size_t(0));
+
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), stepChunk);
+}
+
+void CarFleet::Navigate(size_t first, size_t last, float elapsedTime) noexcept
+{
+    const auto halfLength = 0.5f * m_racingLine.GetLength();
+
+    for (auto i = first; i < last; ++i)
+    {
+        const Vector3 position(m_position[0][i], m_position[1][i], m_position[2][i]);
+        const Vector3 velocity(m_velocity[0][i], m_velocity[1][i], m_velocity[2][i]);
+
+        // Cars move a fraction of the line in a step, so a jump of over half its length is the start line crossed.
+        const auto lineDistance = m_racingLine.Track(position, m_lineDistance[i]);
+        const auto moved = lineDistance - m_lineDistance[i];
+
+        if (moved < -halfLength)
+            ++m_laps[i];
+        else if (moved > halfLength)
+            --m_laps[i];
+
+        m_lineDistance[i] = lineDistance;
+
+        const auto acceleration = m_racingLine.Steer(position, velocity, lineDistance, elapsedTime, &m_speedLimit[i]);
+
+        m_acceleration[0][i] = acceleration.x;
+        m_acceleration[1][i] = acceleration.y;
+        m_acceleration[2][i] = acceleration.z;
+
+        // Face the direction of travel.
+        const auto speedSq = velocity.LengthSquared();
+        if (speedSq > 0.0f)
+        {
+            const auto scale = 1.0f / std::sqrt(speedSq);
+            m_forward[0][i] = velocity.x * scale;
+            m_forward[1][i] = velocity.y * scale;
+            m_forward[2][i] = velocity.z * scale;
+        }
+    }
+}
+
+void CarFleet::Integrate(size_t first, size_t last, float elapsedTime) noexcept
+{
+    assert(first % VectorWidth == 0);
+
+    const auto dt    = XMVectorReplicate(elapsedTime);
+    const auto brake = XMVectorReplicate(1 - PhysicsConstants::BrakeForce);
+
+    // The padding past the last car keeps each chunk a whole number of vectors.
+    for (auto i = first; i < last; i += VectorWidth)
+    {
+        auto vx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_velocity[0][i]));
+        auto vy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_velocity[1][i]));
+        auto vz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_velocity[2][i]));
+
+        // Speed before this step's acceleration is what the speed limit is tested against.
+        const auto speedSq = XMVectorMultiplyAdd(vx, vx, XMVectorMultiplyAdd(vy, vy, XMVectorMultiply(vz, vz)));
+
+        // Using v = u + at
+        vx = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_acceleration[0][i])), dt, vx);
+        vy = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_acceleration[1][i])), dt, vy);
+        vz = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_acceleration[2][i])), dt, vz);
+
+        const auto speedLimit = XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_speedLimit[i])), dt);
+        const auto scale = XMVectorSelect(g_XMOne, brake, XMVectorGreater(speedSq, XMVectorMultiply(speedLimit, speedLimit)));
+
+        vx = XMVectorMultiply(vx, scale);
+        vy = XMVectorMultiply(vy, scale);
+        vz = XMVectorMultiply(vz, scale);
+
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_velocity[0][i]), vx);
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_velocity[1][i]), vy);
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_velocity[2][i]), vz);
+
+        // position + velocity = new position
+        auto px = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_position[0][i]));
+        auto py = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_position[1][i]));
+        auto pz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_position[2][i]));
+
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_position[0][i]), XMVectorAdd(px, vx));
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_position[1][i]), XMVectorAdd(py, vy));
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&m_position[2][i]), XMVectorAdd(pz, vz));
+    }
+}
+
+void CarFleet::PassCheckpoints(size_t first, size_t last) noexcept
+{
+    const auto lastGate = static_cast<uint32_t>(m_gates.size()) - 1;
+
+    for (auto i = first; i < last; ++i)
+    {
+        const auto& gate = m_gates[m_nextCheckpoint[i]];
+
+        const Vector3 position(m_position[0][i], m_position[1][i], m_position[2][i]);
+        const Vector3 velocity(m_velocity[0][i], m_velocity[1][i], m_velocity[2][i]);
+        const auto start = position - velocity;
+
+        // Distances ahead of the gate's line at the start and end of the step. The car reaches the line when it is
+        // within carRadius behind it, and a test of the whole step can't be tunnelled through however fast it moves.
+        const auto d0 = (start - gate.target).Dot(gate.forward);
+        const auto d1 = (position - gate.target).Dot(gate.forward);
+
+        if (d1 < -m_carRadius || d0 > m_carRadius)
+            continue;
+
+        // Where the car was when it reached the line, which must be between the signposts.
+        const auto t = d1 > d0 ? std::clamp((-m_carRadius - d0) / (d1 - d0), 0.0f, 1.0f) : 0.0f;
+        const auto across = (start + t * velocity - gate.target).Dot(gate.across);
+
+        if (std::abs(across) > gate.halfWidth + m_carRadius)
+            continue;
+
+        m_nextCheckpoint[i] = m_nextCheckpoint[i] < lastGate ? m_nextCheckpoint[i] + 1 : 0;
+        ++m_checkpointsPassed[i];
+    }
+}
+
+double CarFleet::GetRaceDistance(uint32_t car) const noexcept
+{
+    return static_cast<double>(m_laps[car]) * m_racingLine.GetLength() + m_lineDistance[car];
+}
+
+void CarFleet::Rank(std::vector<uint32_t>& order) const
+{
+    std::vector<double> raceDistances(m_count);
+    for (uint32_t car = 0; car < m_count; ++car)
+        raceDistances[car] = GetRaceDistance(car);
+
+    order.resize(m_count);
+    std::iota(order.begin(), order.end(), 0u);
+
+    // Cars level on distance keep their index order, so ranking is repeatable.
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return raceDistances[a] > raceDistances[b]; });
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+// AnimationStructs.h and RacingLine.h must also be included before this header.
+
+// Many AI cars driving round a track of checkpoints, in structure of arrays form.
+// Each step runs the auto navigation of Simulation's car for every car, a scalar pass in which each car tracks how far
+// along the track's racing line it is and steers for a point ahead on it. Integration then moves the cars four at a
+// time, with one DirectXMath vector per component, and the cars that reached their checkpoint move on to the next.
+// Cars are independent, so the fleet is split into chunks that run all three passes on the thread pool.
+//
+// Laps and distance along the racing line give each car's race distance, by which Rank orders the field.
+
+class CarFleet
+{
+public:
+
+    // carRadius is how far in front of a car's position it reaches a checkpoint.
+    CarFleet(const std::vector<Checkpoint>& track, float carRadius);
+
+    CarFleet(CarFleet const&) = delete;
+    CarFleet& operator= (CarFleet const&) = delete;
+
+    CarFleet(CarFleet&&) = default;
+    CarFleet& operator= (CarFleet&&) = default;
+
+    ~CarFleet() = default;
+
+    // Adds a stationary car heading for checkpoint nextCheckpoint, and returns its index. The car starts on lap 0, at
+    // the point on the racing line nearest position.
+    uint32_t Add(const Vector3& position, const Vector3& forward, uint32_t nextCheckpoint);
+    void Clear() noexcept;
+
+    // Advances every car by elapsedTime. As in Simulation, velocities are in metres per step, so the step size should
+    // be fixed. Splitting the cars across the thread pool gives the same result as stepping them on one thread.
+    void Step(float elapsedTime, bool isParallel = true);
+
+    const auto GetCount() const noexcept                            { return m_count; }
+    const auto GetPosition(uint32_t car) const noexcept             { return Vector3(m_position[0][car], m_position[1][car], m_position[2][car]); }
+    const auto GetForward(uint32_t car) const noexcept              { return Vector3(m_forward[0][car], m_forward[1][car], m_forward[2][car]); }
+    const auto GetVelocity(uint32_t car) const noexcept             { return Vector3(m_velocity[0][car], m_velocity[1][car], m_velocity[2][car]); }
+    const auto GetNextCheckpoint(uint32_t car) const noexcept       { return m_nextCheckpoint[car]; }
+    const auto GetCheckpointsPassed(uint32_t car) const noexcept    { return m_checkpointsPassed[car]; }
+    const auto GetLineDistance(uint32_t car) const noexcept         { return m_lineDistance[car]; }
+    const auto GetLap(uint32_t car) const noexcept                  { return m_laps[car]; }
+    const auto& GetRacingLine() const noexcept                      { return m_racingLine; }
+
+    // Distance covered along the racing line since the start of lap 0.
+    double GetRaceDistance(uint32_t car) const noexcept;
+
+    // Fills order with the indices of the cars, leader first.
+    void Rank(std::vector<uint32_t>& order) const;
+
+private:
+
+    static constexpr size_t VectorWidth    = 4;      // Cars integrated together.
+    static constexpr size_t StepChunkSize  = 256;    // Cars per thread pool work item, a multiple of VectorWidth.
+
+    // A checkpoint, with what the passes need from it precomputed.
+    struct Gate
+    {
+        Vector3 target;         // Halfway between the signposts.
+        Vector3 forward;        // Normal to the gate, in the direction cars pass it.
+        Vector3 across;         // Unit vector from the first signpost to the second.
+        float   halfWidth;
+    };
+
+    void Navigate(size_t first, size_t last, float elapsedTime) noexcept;
+    void Integrate(size_t first, size_t last, float elapsedTime) noexcept;
+    void PassCheckpoints(size_t first, size_t last) noexcept;
+
+    RacingLine            m_racingLine;
+    std::vector<Gate>     m_gates;
+    float                 m_carRadius;
+    size_t                m_count;
+
+    // Per car state, padded with stationary cars to a multiple of VectorWidth.
+    std::vector<float>    m_position[3];
+    std::vector<float>    m_velocity[3];        // Metres per step.
+    std::vector<float>    m_forward[3];
+    std::vector<float>    m_acceleration[3];    // Written by Navigate for Integrate.
+    std::vector<float>    m_speedLimit;         // Of the racing line where the car is, in metres per second.
+    std::vector<float>    m_lineDistance;       // Distance along the racing line.
+    std::vector<int32_t>  m_laps;               // Times the car has crossed the start of the racing line.
+    std::vector<uint32_t> m_nextCheckpoint;
+    std::vector<uint32_t> m_checkpointsPassed;
+};
@@ -0,0 +1,884 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+
+namespace
+{
+    // Dot products of four 3D vectors, in structure of arrays form.
+    inline XMVECTOR XM_CALLCONV Dot3(FXMVECTOR ax, FXMVECTOR ay, FXMVECTOR az, GXMVECTOR bx, HXMVECTOR by, HXMVECTOR bz) noexcept
+    {
+        return XMVectorMultiplyAdd(az, bz, XMVectorMultiplyAdd(ay, by, XMVectorMultiply(ax, bx)));
+    }
+
+    // Mask of the four triangles, with vertex coordinates a, b and c on one axis, that overlap a box on that axis.
+    inline XMVECTOR XM_CALLCONV OverlapAxis(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c, GXMVECTOR centre, HXMVECTOR extent) noexcept
+    {
+        const auto lo = XMVectorSubtract(XMVectorMin(a, XMVectorMin(b, c)), centre);
+        const auto hi = XMVectorSubtract(XMVectorMax(a, XMVectorMax(b, c)), centre);
+        return XMVectorAndInt(XMVectorLessOrEqual(lo, extent), XMVectorGreaterOrEqual(hi, XMVectorNegate(extent)));
+    }
+
+    struct BuildTriangle
+    {
+        Vector3  pointa;
+        Vector3  pointb;
+        Vector3  pointc;
+        Vector3  normal;
+        uint32_t index;
+    };
+}
+
+CollisionMesh::CollisionMesh() noexcept :
+    m_gridMin(Vector2::Zero), m_invCellSize(0.0f), m_cellCountX(0), m_cellCountZ(0), m_triangleCount(0)
+{
+}
+
+void CollisionMesh::Build(
+    const Vector3* positions,
+    uint32_t vertexStride,
+    const uint16_t* indices16,
+    const uint32_t* indices32,
+    uint32_t triangleCount)
+{
+    assert(positions && (indices16 || indices32));
+
+    auto getPosition = [&](uint32_t i)
+    {
+        const auto index = indices16 ? indices16[i] : indices32[i];
+        return *reinterpret_cast<const Vector3*>(reinterpret_cast<const uint8_t*>(positions) + size_t(index) * vertexStride);
+    };
+
+    std::vector<BuildTriangle> triangles;
+    triangles.reserve(triangleCount);
+
+    const float maxFloat = std::numeric_limits<float>::max();
+    Vector2 boundsMin( maxFloat,  maxFloat);
+    Vector2 boundsMax(-maxFloat, -maxFloat);
+
+    for (uint32_t i = 0; i < triangleCount; ++i)
+    {
+        BuildTriangle t = {};
+        t.pointa = getPosition(i * 3 + 0);
+        t.pointb = getPosition(i * 3 + 1);
+        t.pointc = getPosition(i * 3 + 2);
+        t.index  = i;
+
+        // Precompute the surface normal, and filter out degenerate triangles.
+        const auto N = XMVector3Normalize(XMVector3Cross(
+            XMVectorSubtract(t.pointb, t.pointa),
+            XMVectorSubtract(t.pointc, t.pointa)));
+
+        if (XMVector3Equal(N, XMVectorZero()) || XMVector3IsNaN(N))
+            continue;
+
+        t.normal = N;
+        triangles.push_back(t);
+
+        boundsMin.x = std::min({ boundsMin.x, t.pointa.x, t.pointb.x, t.pointc.x });
+        boundsMin.y = std::min({ boundsMin.y, t.pointa.z, t.pointb.z, t.pointc.z });
+        boundsMax.x = std::max({ boundsMax.x, t.pointa.x, t.pointb.x, t.pointc.x });
+        boundsMax.y = std::max({ boundsMax.y, t.pointa.z, t.pointb.z, t.pointc.z });
+    }
+
+    m_triangleCount = static_cast<uint32_t>(triangles.size());
+    m_packets.clear();
+    m_cellStart.clear();
+
+    if (triangles.empty())
+    {
+        m_cellCountX = m_cellCountZ = 0;
+        return;
+    }
+
+    // Size square cells to hold roughly TargetTrianglesPerCell triangles each, if triangles were spread evenly.
+    const auto extent   = Vector2::Max(boundsMax - boundsMin, Vector2(1e-3f, 1e-3f));
+    const auto cells    = std::max(1.0f, static_cast<float>(triangles.size()) / TargetTrianglesPerCell);
+    auto       cellSize = std::sqrt(extent.x * extent.y / cells);
+
+    m_cellCountX = std::clamp(static_cast<uint32_t>(std::ceil(extent.x / cellSize)), 1u, MaxCellsPerAxis);
+    m_cellCountZ = std::clamp(static_cast<uint32_t>(std::ceil(extent.y / cellSize)), 1u, MaxCellsPerAxis);
+    cellSize     = std::max(extent.x / m_cellCountX, extent.y / m_cellCountZ);
+
+    m_gridMin     = boundsMin;
+    m_invCellSize = 1.0f / cellSize;
+
+    // Bin each triangle into every cell its XZ bounds overlap.
+    const size_t cellCount = size_t(m_cellCountX) * m_cellCountZ;
+    std::vector<uint32_t> binStart(cellCount + 1, 0);
+    std::vector<CellRange> triangleCells(triangles.size());
+
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        const auto& t = triangles[i];
+        auto& range = triangleCells[i];
+
+        // A triangle with a corner that isn't finite is binned into no cell, so no query returns it.
+        if (!GetCellRange(
+            std::min({ t.pointa.x, t.pointb.x, t.pointc.x }),
+            std::min({ t.pointa.z, t.pointb.z, t.pointc.z }),
+            std::max({ t.pointa.x, t.pointb.x, t.pointc.x }),
+            std::max({ t.pointa.z, t.pointb.z, t.pointc.z }), range))
+        {
+            range = { 1, 1, 0, 0 };
+        }
+
+        for (auto z = range.minZ; z <= range.maxZ; ++z)
+            for (auto x = range.minX; x <= range.maxX; ++x)
+                ++binStart[z * m_cellCountX + x + 1];
+    }
+
+    for (size_t c = 1; c < binStart.size(); ++c)
+        binStart[c] += binStart[c - 1];
+
+    std::vector<uint32_t> bins(binStart.back());
+    std::vector<uint32_t> cursor(binStart.begin(), binStart.end() - 1);
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(triangles.size()); ++i)
+    {
+        const auto& range = triangleCells[i];
+
+        for (auto z = range.minZ; z <= range.maxZ; ++z)
+            for (auto x = range.minX; x <= range.maxX; ++x)
+                bins[cursor[z * m_cellCountX + x]++] = i;
+    }
+
+    // Pack each cell's triangles into groups of four, padding the last packet by repeating the last triangle.
+    // A repeated triangle reports the same distance, so it never changes the closest hit.
+    m_cellStart.resize(cellCount + 1);
+    m_packets.reserve((bins.size() + 3) / 4 + cellCount);
+
+    for (size_t c = 0; c < cellCount; ++c)
+    {
+        m_cellStart[c] = static_cast<uint32_t>(m_packets.size());
+
+        for (auto k = binStart[c]; k < binStart[c + 1]; k += 4)
+        {
+            XMFLOAT4A lanes[12];
+            TrianglePacket packet;
+
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                const auto& t = triangles[bins[std::min(k + lane, binStart[c + 1] - 1)]];
+                const float values[12] = {
+                    t.pointa.x, t.pointa.y, t.pointa.z,
+                    t.pointb.x, t.pointb.y, t.pointb.z,
+                    t.pointc.x, t.pointc.y, t.pointc.z,
+                    t.normal.x, t.normal.y, t.normal.z };
+
+                for (uint32_t j = 0; j < 12; ++j)
+                    reinterpret_cast<float*>(&lanes[j])[lane] = values[j];
+
+                packet.index[lane] = t.index;
+            }
+
+            XMVECTOR* components[12] = {
+                &packet.ax, &packet.ay, &packet.az,
+                &packet.bx, &packet.by, &packet.bz,
+                &packet.cx, &packet.cy, &packet.cz,
+                &packet.nx, &packet.ny, &packet.nz };
+
+            for (uint32_t j = 0; j < 12; ++j)
+                *components[j] = XMLoadFloat4A(&lanes[j]);
+
+            m_packets.push_back(packet);
+        }
+    }
+    m_cellStart[cellCount] = static_cast<uint32_t>(m_packets.size());
+}
+
+bool CollisionMesh::GetCellRange(float minX, float minZ, float maxX, float maxZ, CellRange& range) const noexcept
+{
+    // NaN passes through std::clamp, and converting it or infinity to an unsigned cell is undefined, so a volume
+    // that isn't finite overlaps no cells.
+    if (!std::isfinite(minX) || !std::isfinite(minZ) || !std::isfinite(maxX) || !std::isfinite(maxZ))
+        return false;
+
+    const float x0 = (minX - m_gridMin.x) * m_invCellSize;
+    const float z0 = (minZ - m_gridMin.y) * m_invCellSize;
+    const float x1 = (maxX - m_gridMin.x) * m_invCellSize;
+    const float z1 = (maxZ - m_gridMin.y) * m_invCellSize;
+
+    const float countX = static_cast<float>(m_cellCountX);
+    const float countZ = static_cast<float>(m_cellCountZ);
+
+    // Reject volumes entirely outside the grid.
+    if (x1 < 0.0f || z1 < 0.0f || x0 > countX || z0 > countZ)
+        return false;
+
+    range.minX = static_cast<uint32_t>(std::clamp(x0, 0.0f, countX - 1.0f));
+    range.minZ = static_cast<uint32_t>(std::clamp(z0, 0.0f, countZ - 1.0f));
+    range.maxX = static_cast<uint32_t>(std::clamp(x1, 0.0f, countX - 1.0f));
+    range.maxZ = static_cast<uint32_t>(std::clamp(z1, 0.0f, countZ - 1.0f));
+    return true;
+}
+
+XMVECTOR XM_CALLCONV CollisionMesh::ClosestPointDistSq(const TrianglePacket& t, FXMVECTOR px, FXMVECTOR py, FXMVECTOR pz) noexcept
+{
+    // Closest point on triangle, from Ericson, Real-Time Collision Detection, 5.1.5.
+    // The Voronoi region tests are evaluated for all four lanes, then selected in reverse priority order,
+    // so the closest point is a + ab * v + ac * w for the barycentric weights v and w of the winning region.
+    const auto zero = XMVectorZero();
+    const auto one  = XMVectorSplatOne();
+
+    const auto abx = XMVectorSubtract(t.bx, t.ax), aby = XMVectorSubtract(t.by, t.ay), abz = XMVectorSubtract(t.bz, t.az);
+    const auto acx = XMVectorSubtract(t.cx, t.ax), acy = XMVectorSubtract(t.cy, t.ay), acz = XMVectorSubtract(t.cz, t.az);
+
+    const auto apx = XMVectorSubtract(px, t.ax), apy = XMVectorSubtract(py, t.ay), apz = XMVectorSubtract(pz, t.az);
+    const auto d1 = Dot3(abx, aby, abz, apx, apy, apz);
+    const auto d2 = Dot3(acx, acy, acz, apx, apy, apz);
+
+    const auto bpx = XMVectorSubtract(px, t.bx), bpy = XMVectorSubtract(py, t.by), bpz = XMVectorSubtract(pz, t.bz);
+    const auto d3 = Dot3(abx, aby, abz, bpx, bpy, bpz);
+    const auto d4 = Dot3(acx, acy, acz, bpx, bpy, bpz);
+
+    const auto cpx = XMVectorSubtract(px, t.cx), cpy = XMVectorSubtract(py, t.cy), cpz = XMVectorSubtract(pz, t.cz);
+    const auto d5 = Dot3(abx, aby, abz, cpx, cpy, cpz);
+    const auto d6 = Dot3(acx, acy, acz, cpx, cpy, cpz);
+
+    const auto va = XMVectorSubtract(XMVectorMultiply(d3, d6), XMVectorMultiply(d5, d4));
+    const auto vb = XMVectorSubtract(XMVectorMultiply(d5, d2), XMVectorMultiply(d1, d6));
+    const auto vc = XMVectorSubtract(XMVectorMultiply(d1, d4), XMVectorMultiply(d3, d2));
+
+    // Face region.
+    const auto denom = XMVectorReciprocal(XMVectorAdd(va, XMVectorAdd(vb, vc)));
+    auto v = XMVectorMultiply(vb, denom);
+    auto w = XMVectorMultiply(vc, denom);
+
+    // Edge BC.
+    const auto d43 = XMVectorSubtract(d4, d3);
+    const auto d56 = XMVectorSubtract(d5, d6);
+    auto region = XMVectorAndInt(XMVectorLessOrEqual(va, zero),
+                  XMVectorAndInt(XMVectorGreaterOrEqual(d43, zero), XMVectorGreaterOrEqual(d56, zero)));
+    auto edge = XMVectorDivide(d43, XMVectorAdd(d43, d56));
+    v = XMVectorSelect(v, XMVectorSubtract(one, edge), region);
+    w = XMVectorSelect(w, edge, region);
+
+    // Edge AC.
+    region = XMVectorAndInt(XMVectorLessOrEqual(vb, zero),
+             XMVectorAndInt(XMVectorGreaterOrEqual(d2, zero), XMVectorLessOrEqual(d6, zero)));
+    edge = XMVectorDivide(d2, XMVectorSubtract(d2, d6));
+    v = XMVectorSelect(v, zero, region);
+    w = XMVectorSelect(w, edge, region);
+
+    // Vertex C.
+    region = XMVectorAndInt(XMVectorGreaterOrEqual(d6, zero), XMVectorLessOrEqual(d5, d6));
+    v = XMVectorSelect(v, zero, region);
+    w = XMVectorSelect(w, one, region);
+
+    // Edge AB.
+    region = XMVectorAndInt(XMVectorLessOrEqual(vc, zero),
+             XMVectorAndInt(XMVectorGreaterOrEqual(d1, zero), XMVectorLessOrEqual(d3, zero)));
+    edge = XMVectorDivide(d1, XMVectorSubtract(d1, d3));
+    v = XMVectorSelect(v, edge, region);
+    w = XMVectorSelect(w, zero, region);
+
+    // Vertex B.
+    region = XMVectorAndInt(XMVectorGreaterOrEqual(d3, zero), XMVectorLessOrEqual(d4, d3));
+    v = XMVectorSelect(v, one, region);
+    w = XMVectorSelect(w, zero, region);
+
+    // Vertex A.
+    region = XMVectorAndInt(XMVectorLessOrEqual(d1, zero), XMVectorLessOrEqual(d2, zero));
+    v = XMVectorSelect(v, zero, region);
+    w = XMVectorSelect(w, zero, region);
+
+    // Vector from p to the closest point: (a - p) + ab * v + ac * w.
+    const auto qx = XMVectorMultiplyAdd(acx, w, XMVectorMultiplyAdd(abx, v, XMVectorNegate(apx)));
+    const auto qy = XMVectorMultiplyAdd(acy, w, XMVectorMultiplyAdd(aby, v, XMVectorNegate(apy)));
+    const auto qz = XMVectorMultiplyAdd(acz, w, XMVectorMultiplyAdd(abz, v, XMVectorNegate(apz)));
+
+    return Dot3(qx, qy, qz, qx, qy, qz);
+}
+
+void CollisionMesh::GetTriangle(const TrianglePacket& t, uint32_t lane, CollisionTriangle& triangle) noexcept
+{
+    triangle.pointa = Vector3(XMVectorGetByIndex(t.ax, lane), XMVectorGetByIndex(t.ay, lane), XMVectorGetByIndex(t.az, lane));
+    triangle.pointb = Vector3(XMVectorGetByIndex(t.bx, lane), XMVectorGetByIndex(t.by, lane), XMVectorGetByIndex(t.bz, lane));
+    triangle.pointc = Vector3(XMVectorGetByIndex(t.cx, lane), XMVectorGetByIndex(t.cy, lane), XMVectorGetByIndex(t.cz, lane));
+    triangle.normal = Vector3(XMVectorGetByIndex(t.nx, lane), XMVectorGetByIndex(t.ny, lane), XMVectorGetByIndex(t.nz, lane));
+    triangle.index  = t.index[lane];
+}
+
+void CollisionMesh::SetHeight(CollisionTriangle& triangle, float x, float z) noexcept
+{
+    // Height of the triangle plane at (x, z), which equals barycentric interpolation of the vertex heights.
+    // Near vertical triangles have no meaningful height, so fall back to the vertex average.
+    const auto& a = triangle.pointa;
+    const auto& n = triangle.normal;
+
+    if (std::abs(n.y) > 1e-4f)
+        triangle.height = a.y - (n.x * (x - a.x) + n.z * (z - a.z)) / n.y;
+    else
+        triangle.height = (triangle.pointa.y + triangle.pointb.y + triangle.pointc.y) / 3.f;
+}
+
+XMVECTOR XM_CALLCONV CollisionMesh::RayDistances(const TrianglePacket& t, const XMFLOAT3& origin, const XMFLOAT3& direction,
+    float maxDistance, XMVECTOR& distance) noexcept
+{
+    // Moller-Trumbore ray/triangle test, four triangles at a time.
+    const auto dx = XMVectorReplicate(direction.x);
+    const auto dy = XMVectorReplicate(direction.y);
+    const auto dz = XMVectorReplicate(direction.z);
+
+    const auto e1x = XMVectorSubtract(t.bx, t.ax), e1y = XMVectorSubtract(t.by, t.ay), e1z = XMVectorSubtract(t.bz, t.az);
+    const auto e2x = XMVectorSubtract(t.cx, t.ax), e2y = XMVectorSubtract(t.cy, t.ay), e2z = XMVectorSubtract(t.cz, t.az);
+
+    // p = d x e2
+    const auto px = XMVectorNegativeMultiplySubtract(dz, e2y, XMVectorMultiply(dy, e2z));
+    const auto py = XMVectorNegativeMultiplySubtract(dx, e2z, XMVectorMultiply(dz, e2x));
+    const auto pz = XMVectorNegativeMultiplySubtract(dy, e2x, XMVectorMultiply(dx, e2y));
+
+    const auto det = Dot3(e1x, e1y, e1z, px, py, pz);
+    const auto invDet = XMVectorReciprocal(det);
+
+    const auto sx = XMVectorSubtract(XMVectorReplicate(origin.x), t.ax);
+    const auto sy = XMVectorSubtract(XMVectorReplicate(origin.y), t.ay);
+    const auto sz = XMVectorSubtract(XMVectorReplicate(origin.z), t.az);
+
+    const auto u = XMVectorMultiply(Dot3(sx, sy, sz, px, py, pz), invDet);
+
+    // q = s x e1
+    const auto qx = XMVectorNegativeMultiplySubtract(sz, e1y, XMVectorMultiply(sy, e1z));
+    const auto qy = XMVectorNegativeMultiplySubtract(sx, e1z, XMVectorMultiply(sz, e1x));
+    const auto qz = XMVectorNegativeMultiplySubtract(sy, e1x, XMVectorMultiply(sx, e1y));
+
+    const auto v = XMVectorMultiply(Dot3(dx, dy, dz, qx, qy, qz), invDet);
+    distance = XMVectorMultiply(Dot3(e2x, e2y, e2z, qx, qy, qz), invDet);
+
+    const auto zero = XMVectorZero();
+    auto hit = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(1e-12f));
+    hit = XMVectorAndInt(hit, XMVectorAndInt(XMVectorGreaterOrEqual(u, zero), XMVectorGreaterOrEqual(v, zero)));
+    hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAdd(u, v), XMVectorSplatOne()));
+    hit = XMVectorAndInt(hit, XMVectorAndInt(XMVectorGreaterOrEqual(distance, zero),
+                                             XMVectorLessOrEqual(distance, XMVectorReplicate(maxDistance))));
+    return hit;
+}
+
+template<typename PacketTest>
+bool CollisionMesh::FindClosest(const CellRange& range, PacketTest test, CollisionTriangle& triangle, float* closestKey) const
+{
+    const TrianglePacket* closest = nullptr;
+    uint32_t closestLane = 0;
+    float closestDistSq = std::numeric_limits<float>::max();
+
+    for (auto z = range.minZ; z <= range.maxZ; ++z)
+    {
+        for (auto x = range.minX; x <= range.maxX; ++x)
+        {
+            const auto cell = z * m_cellCountX + x;
+
+            for (auto k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+            {
+                const auto& packet = m_packets[k];
+
+                // Triangles spanning several cells may be tested more than once, which is harmless.
+                XMVECTOR distSq = XMVectorZero();
+                const auto hit = test(packet, distSq);
+
+                if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+                    continue;
+
+                XMUINT4 hits;
+                XMFLOAT4A dists;
+                XMStoreUInt4(&hits, hit);
+                XMStoreFloat4A(&dists, distSq);
+
+                const uint32_t laneHits[4]  = { hits.x, hits.y, hits.z, hits.w };
+                const float    laneDists[4] = { dists.x, dists.y, dists.z, dists.w };
+
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    if (laneHits[lane] && laneDists[lane] < closestDistSq)
+                    {
+                        closestDistSq = laneDists[lane];
+                        closest = &packet;
+                        closestLane = lane;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!closest)
+    {
+        triangle.collision = ContainmentType::DISJOINT;
+        return false;
+    }
+
+    if (closestKey)
+        *closestKey = closestDistSq;
+
+    GetTriangle(*closest, closestLane, triangle);
+    triangle.collision = ContainmentType::INTERSECTS;
+    return true;
+}
+
+bool CollisionMesh::Intersects(const BoundingSphere& sphere, CollisionTriangle& triangle) const
+{
+    CellRange range;
+
+    if (m_packets.empty() || !GetCellRange(
+        sphere.Center.x - sphere.Radius, sphere.Center.z - sphere.Radius,
+        sphere.Center.x + sphere.Radius, sphere.Center.z + sphere.Radius, range))
+    {
+        triangle.collision = ContainmentType::DISJOINT;
+        return false;
+    }
+
+    const auto px = XMVectorReplicate(sphere.Center.x);
+    const auto py = XMVectorReplicate(sphere.Center.y);
+    const auto pz = XMVectorReplicate(sphere.Center.z);
+    const auto radiusSq = XMVectorReplicate(sphere.Radius * sphere.Radius);
+
+    // The sphere intersects a triangle when the closest point on the triangle lies within the radius.
+    if (!FindClosest(range, [&](const TrianglePacket& t, XMVECTOR& distSq)
+        {
+            distSq = ClosestPointDistSq(t, px, py, pz);
+            return XMVectorLessOrEqual(distSq, radiusSq);
+        }, triangle))
+    {
+        return false;
+    }
+
+    SetHeight(triangle, sphere.Center.x, sphere.Center.z);
+    return true;
+}
+
+bool CollisionMesh::Intersects(const BoundingBox& box, CollisionTriangle& triangle) const
+{
+    CellRange range;
+
+    if (m_packets.empty() || !GetCellRange(
+        box.Center.x - box.Extents.x, box.Center.z - box.Extents.z,
+        box.Center.x + box.Extents.x, box.Center.z + box.Extents.z, range))
+    {
+        triangle.collision = ContainmentType::DISJOINT;
+        return false;
+    }
+
+    const auto px = XMVectorReplicate(box.Center.x);
+    const auto py = XMVectorReplicate(box.Center.y);
+    const auto pz = XMVectorReplicate(box.Center.z);
+    const auto ex = XMVectorReplicate(box.Extents.x);
+    const auto ey = XMVectorReplicate(box.Extents.y);
+    const auto ez = XMVectorReplicate(box.Extents.z);
+
+    if (!FindClosest(range, [&](const TrianglePacket& t, XMVECTOR& distSq)
+        {
+            // Four wide separating axis tests on the box face normals and the triangle normal.
+            auto hit = XMVectorAndInt(OverlapAxis(t.ax, t.bx, t.cx, px, ex),
+                       XMVectorAndInt(OverlapAxis(t.ay, t.by, t.cy, py, ey), OverlapAxis(t.az, t.bz, t.cz, pz, ez)));
+
+            const auto planeDist = Dot3(t.nx, t.ny, t.nz,
+                XMVectorSubtract(px, t.ax), XMVectorSubtract(py, t.ay), XMVectorSubtract(pz, t.az));
+            const auto planeRadius = Dot3(XMVectorAbs(t.nx), XMVectorAbs(t.ny), XMVectorAbs(t.nz), ex, ey, ez);
+            hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAbs(planeDist), planeRadius));
+
+            if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+                return hit;
+
+            // Confirm the few survivors with the exact scalar test, which adds the edge cross product axes.
+            XMUINT4 lanes;
+            XMStoreUInt4(&lanes, hit);
+            uint32_t laneHits[4] = { lanes.x, lanes.y, lanes.z, lanes.w };
+
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                if (!laneHits[lane])
+                    continue;
+
+                CollisionTriangle candidate;
+                GetTriangle(t, lane, candidate);
+                laneHits[lane] = box.Intersects(candidate.pointa, candidate.pointb, candidate.pointc) ? 0xFFFFFFFF : 0;
+            }
+
+            distSq = ClosestPointDistSq(t, px, py, pz);
+            return XMVectorSetInt(laneHits[0], laneHits[1], laneHits[2], laneHits[3]);
+        }, triangle))
+    {
+        return false;
+    }
+
+    SetHeight(triangle, box.Center.x, box.Center.z);
+    return true;
+}
+
+template<typename Volume, typename TriangleSweep>
+bool CollisionMesh::SweepVolume(const Volume& volume, const Vector3& displacement, TriangleSweep sweep,
+    CollisionTriangle& triangle, float& time) const
+{
+    const auto bounds = SweptCollision::GetSweptBounds(volume, displacement);
+    CellRange range;
+
+    if (m_packets.empty() || !GetCellRange(
+        bounds.Center.x - bounds.Extents.x, bounds.Center.z - bounds.Extents.z,
+        bounds.Center.x + bounds.Extents.x, bounds.Center.z + bounds.Extents.z, range))
+    {
+        triangle.collision = ContainmentType::DISJOINT;
+        return false;
+    }
+
+    const auto px = XMVectorReplicate(bounds.Center.x);
+    const auto py = XMVectorReplicate(bounds.Center.y);
+    const auto pz = XMVectorReplicate(bounds.Center.z);
+    const auto ex = XMVectorReplicate(bounds.Extents.x);
+    const auto ey = XMVectorReplicate(bounds.Extents.y);
+    const auto ez = XMVectorReplicate(bounds.Extents.z);
+
+    // The time of impact is the key, so the first triangle touched is returned.
+    if (!FindClosest(range, [&](const TrianglePacket& t, XMVECTOR& times)
+        {
+            // Only triangles overlapping the bounds of the whole move can be touched. The few that are get the exact
+            // scalar sweep.
+            const auto hit = XMVectorAndInt(OverlapAxis(t.ax, t.bx, t.cx, px, ex),
+                             XMVectorAndInt(OverlapAxis(t.ay, t.by, t.cy, py, ey), OverlapAxis(t.az, t.bz, t.cz, pz, ez)));
+
+            if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+                return hit;
+
+            XMUINT4 lanes;
+            XMStoreUInt4(&lanes, hit);
+            uint32_t laneHits[4] = { lanes.x, lanes.y, lanes.z, lanes.w };
+            float laneTimes[4] = {};
+
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                if (!laneHits[lane])
+                    continue;
+
+                CollisionTriangle candidate;
+                GetTriangle(t, lane, candidate);
+                laneHits[lane] = sweep(volume, displacement, candidate.pointa, candidate.pointb, candidate.pointc,
+                    laneTimes[lane]) ? 0xFFFFFFFF : 0;
+            }
+
+            times = XMVectorSet(laneTimes[0], laneTimes[1], laneTimes[2], laneTimes[3]);
+            return XMVectorSetInt(laneHits[0], laneHits[1], laneHits[2], laneHits[3]);
+        }, triangle, &time))
+    {
+        return false;
+    }
+
+    SetHeight(triangle, volume.Center.x + displacement.x * time, volume.Center.z + displacement.z * time);
+    return true;
+}
+
+bool CollisionMesh::Sweep(const BoundingSphere& sphere, const Vector3& displacement, CollisionTriangle& triangle, float& time) const
+{
+    return SweepVolume(sphere, displacement, SweptCollision::SweepSphereTriangle, triangle, time);
+}
+
+bool CollisionMesh::Sweep(const BoundingBox& box, const Vector3& displacement, CollisionTriangle& triangle, float& time) const
+{
+    return SweepVolume(box, displacement, SweptCollision::SweepBoxTriangle, triangle, time);
+}
+
+bool CollisionMesh::Intersects(const CollisionRay& ray, float maxDistance, CollisionTriangle& triangle) const
+{
+    triangle.collision = ContainmentType::DISJOINT;
+
+    if (m_packets.empty())
+        return false;
+
+    const auto& o = ray.origin;
+    const auto& d = ray.direction;
+    const float cellSize = 1.0f / m_invCellSize;
+
+    // As GetCellRange, a ray that isn't finite on the XZ plane crosses no cells.
+    if (!std::isfinite(o.x) || !std::isfinite(o.z) || !std::isfinite(d.x) || !std::isfinite(d.z) || std::isnan(maxDistance))
+        return false;
+
+    // Clip the ray to the grid on the XZ plane.
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+
+    const float origin[2]    = { o.x, o.z };
+    const float direction[2] = { d.x, d.z };
+    const float gridMin[2]   = { m_gridMin.x, m_gridMin.y };
+    const float gridMax[2]   = { m_gridMin.x + m_cellCountX * cellSize, m_gridMin.y + m_cellCountZ * cellSize };
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (std::abs(direction[axis]) < 1e-12f)
+        {
+            if (origin[axis] < gridMin[axis] || origin[axis] > gridMax[axis])
+                return false;
+            continue;
+        }
+
+        float t0 = (gridMin[axis] - origin[axis]) / direction[axis];
+        float t1 = (gridMax[axis] - origin[axis]) / direction[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax)
+            return false;
+    }
+
+    // Walk the cells under the ray in order (Amanatides and Woo), stopping once the nearest hit
+    // lies before the exit from the current cell.
+    auto cellX = static_cast<int>(std::clamp((o.x + d.x * tMin - m_gridMin.x) * m_invCellSize, 0.0f, m_cellCountX - 1.0f));
+    auto cellZ = static_cast<int>(std::clamp((o.z + d.z * tMin - m_gridMin.y) * m_invCellSize, 0.0f, m_cellCountZ - 1.0f));
+
+    const int stepX = d.x > 0.0f ? 1 : -1;
+    const int stepZ = d.z > 0.0f ? 1 : -1;
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float deltaX = std::abs(d.x) < 1e-12f ? infinity : cellSize / std::abs(d.x);
+    const float deltaZ = std::abs(d.z) < 1e-12f ? infinity : cellSize / std::abs(d.z);
+
+    float nextX = std::abs(d.x) < 1e-12f ? infinity : (m_gridMin.x + (cellX + (stepX > 0 ? 1 : 0)) * cellSize - o.x) / d.x;
+    float nextZ = std::abs(d.z) < 1e-12f ? infinity : (m_gridMin.y + (cellZ + (stepZ > 0 ? 1 : 0)) * cellSize - o.z) / d.z;
+
+    const TrianglePacket* closest = nullptr;
+    uint32_t closestLane = 0;
+    float closestDistance = infinity;
+
+    for (;;)
+    {
+        const auto cell = static_cast<uint32_t>(cellZ) * m_cellCountX + static_cast<uint32_t>(cellX);
+
+        for (auto k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+        {
+            const auto& packet = m_packets[k];
+
+            XMVECTOR distance;
+            const auto hit = RayDistances(packet, o, d, std::min(tMax, closestDistance), distance);
+
+            if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+                continue;
+
+            XMUINT4 hits;
+            XMFLOAT4A dists;
+            XMStoreUInt4(&hits, hit);
+            XMStoreFloat4A(&dists, distance);
+
+            const uint32_t laneHits[4]  = { hits.x, hits.y, hits.z, hits.w };
+            const float    laneDists[4] = { dists.x, dists.y, dists.z, dists.w };
+
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                if (laneHits[lane] && laneDists[lane] < closestDistance)
+                {
+                    closestDistance = laneDists[lane];
+                    closest = &packet;
+                    closestLane = lane;
+                }
+            }
+        }
+
+        const float cellExit = std::min(nextX, nextZ);
+
+        if (closestDistance <= cellExit || cellExit > tMax)
+            break;
+
+        if (nextX < nextZ)
+        {
+            cellX += stepX;
+            nextX += deltaX;
+        }
+        else
+        {
+            cellZ += stepZ;
+            nextZ += deltaZ;
+        }
+
+        if (cellX < 0 || cellZ < 0 || cellX >= static_cast<int>(m_cellCountX) || cellZ >= static_cast<int>(m_cellCountZ))
+            break;
+    }
+
+    if (!closest)
+        return false;
+
+    GetTriangle(*closest, closestLane, triangle);
+    triangle.height    = o.y + d.y * closestDistance;
+    triangle.collision = ContainmentType::INTERSECTS;
+    return true;
+}
+
+bool CollisionMesh::GetGroundHeight(float x, float z, float& height, Vector3& normal) const
+{
+    const float maxFloat = std::numeric_limits<float>::max();
+    return FindSurface(x, z, -maxFloat, maxFloat, height, normal);
+}
+
+bool CollisionMesh::RaycastDown(const Vector3& origin, float maxDistance, float& height, Vector3& normal) const
+{
+    return FindSurface(origin.x, origin.z, origin.y - maxDistance, origin.y, height, normal);
+}
+
+bool CollisionMesh::FindSurface(float x, float z, float minHeight, float maxHeight, float& height, Vector3& normal) const
+{
+    if (m_packets.empty() || !std::isfinite(x) || !std::isfinite(z))
+        return false;
+
+    const float cellX = (x - m_gridMin.x) * m_invCellSize;
+    const float cellZ = (z - m_gridMin.y) * m_invCellSize;
+
+    if (cellX < 0.0f || cellZ < 0.0f || cellX > static_cast<float>(m_cellCountX) || cellZ > static_cast<float>(m_cellCountZ))
+        return false;
+
+    const auto cell = GetCellIndex(x, z);
+
+    const auto px = XMVectorReplicate(x);
+    const auto pz = XMVectorReplicate(z);
+    const auto lo = XMVectorReplicate(minHeight);
+    const auto hi = XMVectorReplicate(maxHeight);
+    const auto zero = XMVectorZero();
+
+    // Edge functions of (x, z) against the triangle projected onto the XZ plane. These are the
+    // unnormalized barycentric weights of a, b and c, so the point is inside when all share the sign of the area.
+    auto edge = [&](FXMVECTOR ux, FXMVECTOR uz, FXMVECTOR vx, GXMVECTOR vz)
+    {
+        return XMVectorSubtract(
+            XMVectorMultiply(XMVectorSubtract(vx, ux), XMVectorSubtract(pz, uz)),
+            XMVectorMultiply(XMVectorSubtract(vz, uz), XMVectorSubtract(px, ux)));
+    };
+
+    const TrianglePacket* highest = nullptr;
+    uint32_t highestLane = 0;
+    float highestHeight = -std::numeric_limits<float>::max();
+
+    for (auto k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+    {
+        const auto& t = m_packets[k];
+
+        const auto wa = edge(t.bx, t.bz, t.cx, t.cz);
+        const auto wb = edge(t.cx, t.cz, t.ax, t.az);
+        const auto wc = edge(t.ax, t.az, t.bx, t.bz);
+        const auto area = XMVectorAdd(wa, XMVectorAdd(wb, wc));
+
+        const auto positive = XMVectorAndInt(XMVectorGreater(area, zero), XMVectorAndInt(XMVectorGreaterOrEqual(wa, zero),
+                              XMVectorAndInt(XMVectorGreaterOrEqual(wb, zero), XMVectorGreaterOrEqual(wc, zero))));
+        const auto negative = XMVectorAndInt(XMVectorLess(area, zero), XMVectorAndInt(XMVectorLessOrEqual(wa, zero),
+                              XMVectorAndInt(XMVectorLessOrEqual(wb, zero), XMVectorLessOrEqual(wc, zero))));
+
+        const auto h = XMVectorDivide(
+            XMVectorMultiplyAdd(wc, t.cy, XMVectorMultiplyAdd(wb, t.by, XMVectorMultiply(wa, t.ay))), area);
+
+        auto hit = XMVectorOrInt(positive, negative);
+        hit = XMVectorAndInt(hit, XMVectorAndInt(XMVectorGreaterOrEqual(h, lo), XMVectorLessOrEqual(h, hi)));
+
+        if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+            continue;
+
+        XMUINT4 hits;
+        XMFLOAT4A heights;
+        XMStoreUInt4(&hits, hit);
+        XMStoreFloat4A(&heights, h);
+
+        const uint32_t laneHits[4]    = { hits.x, hits.y, hits.z, hits.w };
+        const float    laneHeights[4] = { heights.x, heights.y, heights.z, heights.w };
+
+        for (uint32_t lane = 0; lane < 4; ++lane)
+        {
+            if (laneHits[lane] && laneHeights[lane] > highestHeight)
+            {
+                highestHeight = laneHeights[lane];
+                highest = &t;
+                highestLane = lane;
+            }
+        }
+    }
+
+    if (!highest)
+        return false;
+
+    height = highestHeight;
+    normal = Vector3(XMVectorGetByIndex(highest->nx, highestLane), XMVectorGetByIndex(highest->ny, highestLane),
+                     XMVectorGetByIndex(highest->nz, highestLane));
+
+    if (normal.y < 0.0f)
+        normal = -normal;
+    return true;
+}
+
+uint32_t CollisionMesh::GetCellIndex(float x, float z) const noexcept
+{
+    // Batches sort by this key before the query rejects the point, so a point that isn't finite sorts first.
+    if (!std::isfinite(x) || !std::isfinite(z))
+        return 0;
+
+    const auto cellX = static_cast<uint32_t>(std::clamp((x - m_gridMin.x) * m_invCellSize, 0.0f, m_cellCountX - 1.0f));
+    const auto cellZ = static_cast<uint32_t>(std::clamp((z - m_gridMin.y) * m_invCellSize, 0.0f, m_cellCountZ - 1.0f));
+    return cellZ * m_cellCountX + cellX;
+}
+
+template<typename CellKey, typename Query>
+void CollisionMesh::RunBatch(size_t count, CellKey cellKey, Query query) const
+{
+    assert(count <= UINT32_MAX);
+
+    // Sort the queries by grid cell, so queries running together touch the same packets.
+    std::vector<uint64_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = (static_cast<uint64_t>(cellKey(i)) << 32) | i;
+
+    std::sort(order.begin(), order.end());
+
+    const size_t chunkCount = (count + BatchChunkSize - 1) / BatchChunkSize;
+
+    auto runChunk = [&](size_t chunk)
+    {
+        const auto end = std::min(count, (chunk + 1) * BatchChunkSize);
+        for (auto k = chunk * BatchChunkSize; k < end; ++k)
+            query(static_cast<size_t>(order[k] & UINT32_MAX));
+    };
+
+    // Small batches aren't worth waking the thread pool for.
+    if (chunkCount <= 1)
+    {
+        runChunk(0);
+        return;
+    }
+
+    std::vector<size_t> chunks(chunkCount);
+    std::iota(chunks.begin(), chunks.end(), size_t(0));
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), runChunk);
+}
+
+void CollisionMesh::Intersects(const BoundingSphere* spheres, size_t count, CollisionTriangle* results) const
+{
+    if (m_packets.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+            results[i].collision = ContainmentType::DISJOINT;
+        return;
+    }
+
+    RunBatch(count,
+        [&](size_t i) { return GetCellIndex(spheres[i].Center.x, spheres[i].Center.z); },
+        [&](size_t i) { Intersects(spheres[i], results[i]); });
+}
+
+void CollisionMesh::Intersects(const BoundingBox* boxes, size_t count, CollisionTriangle* results) const
+{
+    if (m_packets.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+            results[i].collision = ContainmentType::DISJOINT;
+        return;
+    }
+
+    RunBatch(count,
+        [&](size_t i) { return GetCellIndex(boxes[i].Center.x, boxes[i].Center.z); },
+        [&](size_t i) { Intersects(boxes[i], results[i]); });
+}
+
+void CollisionMesh::Intersects(const CollisionRay* rays, size_t count, float maxDistance, CollisionTriangle* results) const
+{
+    if (m_packets.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+            results[i].collision = ContainmentType::DISJOINT;
+        return;
+    }
+
+    RunBatch(count,
+        [&](size_t i) { return GetCellIndex(rays[i].origin.x, rays[i].origin.z); },
+        [&](size_t i) { Intersects(rays[i], maxDistance, results[i]); });
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+// CollisionStructs.h and SweptCollision.h must also be included before this header.
+
+// Static spatial index over a collision triangle mesh, built once at model load time.
+// Triangles are binned into a uniform grid over the XZ plane, so queries only test triangles near the query volume.
+// Each cell stores its triangles in structure of arrays packets of four, which are tested together with SIMD.
+// Queries are const and may be called from multiple threads.
+
+class CollisionMesh
+{
+public:
+
+    CollisionMesh() noexcept;
+
+    CollisionMesh(CollisionMesh const&) = delete;
+    CollisionMesh& operator= (CollisionMesh const&) = delete;
+
+    CollisionMesh(CollisionMesh&&) = default;
+    CollisionMesh& operator= (CollisionMesh&&) = default;
+
+    ~CollisionMesh() = default;
+
+    // positions points to the first vertex position, with vertexStride bytes between vertices.
+    // Pass either 16 or 32 bit indices, with the other set to nullptr.
+    void Build(
+        const Vector3* positions,
+        uint32_t vertexStride,
+        const uint16_t* indices16,
+        const uint32_t* indices32,
+        uint32_t triangleCount);
+
+    // Finds the intersecting triangle closest to the centre of the volume.
+    // Returns false, with triangle.collision set to DISJOINT, if no triangle intersects.
+    bool Intersects(const BoundingSphere& sphere, CollisionTriangle& triangle) const;
+    bool Intersects(const BoundingBox& box, CollisionTriangle& triangle) const;
+
+    // Finds the nearest triangle hit by the ray within maxDistance. The ray direction must be normalized.
+    bool Intersects(const CollisionRay& ray, float maxDistance, CollisionTriangle& triangle) const;
+
+    // Finds the first triangle the volume touches as it moves by displacement, so fast movement can't tunnel through
+    // the mesh. time receives the fraction of displacement travelled before contact, and triangle.height the height
+    // of the triangle plane under the volume's centre at that time. Returns false if nothing is touched.
+    bool Sweep(const BoundingSphere& sphere, const Vector3& displacement, CollisionTriangle& triangle, float& time) const;
+    bool Sweep(const BoundingBox& box, const Vector3& displacement, CollisionTriangle& triangle, float& time) const;
+
+    // Height of the highest surface at (x, z), interpolated from the triangle's vertex heights,
+    // and its surface normal facing up. Only the grid cell containing (x, z) is visited.
+    bool GetGroundHeight(float x, float z, float& height, Vector3& normal) const;
+
+    // As GetGroundHeight, for the first surface straight down from origin within maxDistance.
+    bool RaycastDown(const Vector3& origin, float maxDistance, float& height, Vector3& normal) const;
+
+    // Batched queries, with results[i] receiving the result for query i.
+    // Queries are sorted by grid cell for cache locality, then split across the thread pool.
+    void Intersects(const BoundingSphere* spheres, size_t count, CollisionTriangle* results) const;
+    void Intersects(const BoundingBox* boxes, size_t count, CollisionTriangle* results) const;
+    void Intersects(const CollisionRay* rays, size_t count, float maxDistance, CollisionTriangle* results) const;
+
+    const auto GetTriangleCount() const noexcept    { return m_triangleCount; }
+    const auto GetPacketCount() const noexcept      { return static_cast<uint32_t>(m_packets.size()); }
+    const auto GetCellCountX() const noexcept       { return m_cellCountX; }
+    const auto GetCellCountZ() const noexcept       { return m_cellCountZ; }
+
+private:
+
+    static constexpr uint32_t TargetTrianglesPerCell = 8;
+    static constexpr uint32_t MaxCellsPerAxis        = 1024;
+    static constexpr size_t   BatchChunkSize         = 32;   // Queries per thread pool work item.
+
+    // Four triangles in structure of arrays form. Unused lanes repeat the last triangle in the cell.
+    struct TrianglePacket
+    {
+        XMVECTOR ax, ay, az;
+        XMVECTOR bx, by, bz;
+        XMVECTOR cx, cy, cz;
+        XMVECTOR nx, ny, nz;    // Precomputed unit normals.
+        uint32_t index[4];      // Source triangle indices.
+    };
+
+    struct CellRange
+    {
+        uint32_t minX;
+        uint32_t minZ;
+        uint32_t maxX;
+        uint32_t maxZ;
+    };
+
+    bool GetCellRange(float minX, float minZ, float maxX, float maxZ, CellRange& range) const noexcept;
+    uint32_t GetCellIndex(float x, float z) const noexcept;
+
+    bool FindSurface(float x, float z, float minHeight, float maxHeight, float& height, Vector3& normal) const;
+
+    template<typename CellKey, typename Query>
+    void RunBatch(size_t count, CellKey cellKey, Query query) const;
+
+    // Returns the hit triangle with the smallest key, such as its squared distance, from all packets in range.
+    // closestKey receives the key of the triangle returned.
+    template<typename PacketTest>
+    bool FindClosest(const CellRange& range, PacketTest test, CollisionTriangle& triangle, float* closestKey = nullptr) const;
+
+    template<typename Volume, typename TriangleSweep>
+    bool SweepVolume(const Volume& volume, const Vector3& displacement, TriangleSweep sweep, CollisionTriangle& triangle,
+        float& time) const;
+
+    // Squared distances from p to the closest points on each of the four triangles.
+    static XMVECTOR XM_CALLCONV ClosestPointDistSq(const TrianglePacket& t, FXMVECTOR px, FXMVECTOR py, FXMVECTOR pz) noexcept;
+
+    // Distances along the rays to each of the four triangles, with a mask of the hits within maxDistance.
+    static XMVECTOR XM_CALLCONV RayDistances(const TrianglePacket& t, const XMFLOAT3& origin, const XMFLOAT3& direction,
+        float maxDistance, XMVECTOR& distance) noexcept;
+
+    static void GetTriangle(const TrianglePacket& t, uint32_t lane, CollisionTriangle& triangle) noexcept;
+    static void SetHeight(CollisionTriangle& triangle, float x, float z) noexcept;
+
+    std::vector<TrianglePacket> m_packets;  // Packets grouped by cell.
+    std::vector<uint32_t>       m_cellStart; // Offsets into m_packets, one per cell plus an end offset.
+
+    Vector2  m_gridMin;                     // Grid origin on the XZ plane (x = X, y = Z).
+    float    m_invCellSize;
+    uint32_t m_cellCountX;
+    uint32_t m_cellCountZ;
+    uint32_t m_triangleCount;               // Non-degenerate triangles.
+};
@@ -35,6 +35,9 @@ struct CollisionTriangle
     Vector3 pointa;
     Vector3 pointb;
     Vector3 pointc;
+    Vector3 normal;
+    float height;       // Triangle plane height below the query point, from barycentric interpolation.
+    uint32_t index;     // Collision mesh triangle index.
     ContainmentType collision;
 };
 
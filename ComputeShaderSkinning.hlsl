@@ -6,6 +6,10 @@
 
 #define HLSL
 #include "RaytracingHlslCompat.h"
+// ComputeShaderSkinningCompact.hlsl builds this again with COMPACT_VERTICES defined, for FBXModel::VertexFormat::Compact.
+#ifdef COMPACT_VERTICES
+#include "VertexCompression.hlsli"
+#endif
 //#include "Common.hlsli"
 
 ConstantBuffer<BoneConstants> boneCB : register(b1);
@@ -16,15 +20,28 @@ ConstantBuffer<BoneConstants> boneCB : register(b1);
 void main(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
     // Dynamic heap indexing introduced in SM6.6
+#ifdef COMPACT_VERTICES
+    StructuredBuffer<VertexFbxBonesCompact> Input = ResourceDescriptorHeap[SrvUAVs::DoveVertexBufferSrv];
+#else
     StructuredBuffer<VertexFbxBones> Input = ResourceDescriptorHeap[SrvUAVs::DoveVertexBufferSrv];
+#endif
     RWStructuredBuffer<VertexPosNormalTexTangent> Output = ResourceDescriptorHeap[SrvUAVs::DoveSkinnedVertexBufferUav];
 
+#ifdef COMPACT_VERTICES
+    const float3 InPos         = Input[dispatchThreadID.x].position;
+    const float3 InNormal      = DecodeOctahedral(Input[dispatchThreadID.x].normal);
+    const float2 InTexCoord    = DecodeHalf2(Input[dispatchThreadID.x].texCoord);
+    const float3 InTangent     = DecodeOctahedral(Input[dispatchThreadID.x].tangent);
+    const uint   packedIndices = Input[dispatchThreadID.x].boneIndices;
+    float4       InWeights     = DecodeUnorm4(Input[dispatchThreadID.x].boneWeights);
+#else
     const float3 InPos         = Input[dispatchThreadID.x].position;
     const float3 InNormal      = Input[dispatchThreadID.x].normal;
     const float2 InTexCoord    = Input[dispatchThreadID.x].texCoord;
     const float3 InTangent     = Input[dispatchThreadID.x].tangent;
     const uint   packedIndices = Input[dispatchThreadID.x].boneIndices;
     float4       InWeights     = Input[dispatchThreadID.x].boneWeights;
+#endif
 
     // Ignore input.boneWeights.w and instead calculate the last weight value to ensure all bone weights sum to unity.
     InWeights.w = 1.f - InWeights.x - InWeights.y - InWeights.z;
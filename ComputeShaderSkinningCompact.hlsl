@@ -0,0 +1,9 @@
+//=============================================================================
+// ComputeShaderSkinningCompact.hlsl by Maico De Blasio (C) 2023 All Rights Reserved.
+//
+// ComputeShaderSkinning.hlsl built for models loaded with
+// FBXModel::VertexFormat::Compact.
+//=============================================================================
+
+#define COMPACT_VERTICES
+#include "ComputeShaderSkinning.hlsl"
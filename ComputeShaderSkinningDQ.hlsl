@@ -0,0 +1,95 @@
+//=============================================================================
+// ComputeShaderSkinningDQ.hlsl by Maico De Blasio (C) 2023 All Rights Reserved.
+//
+// Performs dual quaternion vertex skinning of bone rigged FBX models for
+// raytraced animation. Unlike the linear blend in ComputeShaderSkinning.hlsl,
+// blending rigid transforms keeps the volume of bending and twisting joints.
+//=============================================================================
+
+#define HLSL
+#include "RaytracingHlslCompat.h"
+// ComputeShaderSkinningDQCompact.hlsl builds this again with COMPACT_VERTICES defined, for FBXModel::VertexFormat::Compact.
+#ifdef COMPACT_VERTICES
+#include "VertexCompression.hlsli"
+#endif
+
+ConstantBuffer<BoneDualQuaternionConstants> boneCB : register(b1);
+
+#define N 64
+
+// q * v * conjugate(q) for a unit quaternion q.
+float3 Rotate(float3 v, float4 q)
+{
+    return v + 2.f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+[numthreads(N, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    // Dynamic heap indexing introduced in SM6.6
+#ifdef COMPACT_VERTICES
+    StructuredBuffer<VertexFbxBonesCompact> Input = ResourceDescriptorHeap[SrvUAVs::DoveVertexBufferSrv];
+#else
+    StructuredBuffer<VertexFbxBones> Input = ResourceDescriptorHeap[SrvUAVs::DoveVertexBufferSrv];
+#endif
+    RWStructuredBuffer<VertexPosNormalTexTangent> Output = ResourceDescriptorHeap[SrvUAVs::DoveSkinnedVertexBufferUav];
+
+#ifdef COMPACT_VERTICES
+    const float3 InPos         = Input[dispatchThreadID.x].position;
+    const float3 InNormal      = DecodeOctahedral(Input[dispatchThreadID.x].normal);
+    const float2 InTexCoord    = DecodeHalf2(Input[dispatchThreadID.x].texCoord);
+    const float3 InTangent     = DecodeOctahedral(Input[dispatchThreadID.x].tangent);
+    const uint   packedIndices = Input[dispatchThreadID.x].boneIndices;
+    float4       InWeights     = DecodeUnorm4(Input[dispatchThreadID.x].boneWeights);
+#else
+    const float3 InPos         = Input[dispatchThreadID.x].position;
+    const float3 InNormal      = Input[dispatchThreadID.x].normal;
+    const float2 InTexCoord    = Input[dispatchThreadID.x].texCoord;
+    const float3 InTangent     = Input[dispatchThreadID.x].tangent;
+    const uint   packedIndices = Input[dispatchThreadID.x].boneIndices;
+    float4       InWeights     = Input[dispatchThreadID.x].boneWeights;
+#endif
+
+    // Ignore input.boneWeights.w and instead calculate the last weight value to ensure all bone weights sum to unity.
+    InWeights.w = 1.f - InWeights.x - InWeights.y - InWeights.z;
+
+    // Manually unpack bone indices.
+    uint4 InBoneIndices = 0;
+    InBoneIndices.x = (packedIndices >> 0) & 0x000000ff;
+    InBoneIndices.y = (packedIndices >> 8) & 0x000000ff;
+    InBoneIndices.z = (packedIndices >> 16) & 0x000000ff;
+    InBoneIndices.w = (packedIndices >> 24) & 0x000000ff;
+
+    const BoneDualQuaternion Bone0 = boneCB.bones[InBoneIndices.x];
+    const BoneDualQuaternion Bone1 = boneCB.bones[InBoneIndices.y];
+    const BoneDualQuaternion Bone2 = boneCB.bones[InBoneIndices.z];
+    const BoneDualQuaternion Bone3 = boneCB.bones[InBoneIndices.w];
+
+    // q and -q are the same rotation. Blend every bone in the hemisphere of the first, so they don't cancel out.
+    float4 Weights = InWeights;
+    Weights.y = dot(Bone0.real, Bone1.real) < 0.f ? -Weights.y : Weights.y;
+    Weights.z = dot(Bone0.real, Bone2.real) < 0.f ? -Weights.z : Weights.z;
+    Weights.w = dot(Bone0.real, Bone3.real) < 0.f ? -Weights.w : Weights.w;
+
+    // Do vertex skinning.
+    float4 Real = Bone0.real * Weights.x + Bone1.real * Weights.y + Bone2.real * Weights.z + Bone3.real * Weights.w;
+    float4 Dual = Bone0.dual * Weights.x + Bone1.dual * Weights.y + Bone2.dual * Weights.z + Bone3.dual * Weights.w;
+
+    // Dividing both parts by the length of the real part gives a unit dual quaternion.
+    const float InvLength = rsqrt(dot(Real, Real));
+    Real *= InvLength;
+    Dual *= InvLength;
+
+    const float3 Translation = 2.f * (Real.w * Dual.xyz - Dual.w * Real.xyz + cross(Real.xyz, Dual.xyz));
+
+    const float3 OutPos     = Rotate(InPos, Real) + Translation;
+    const float3 OutNormal  = Rotate(InNormal, Real);
+    const float3 OutTangent = Rotate(InTangent, Real);
+    // Ends vertex skinning.
+
+    Output[dispatchThreadID.x].position = OutPos;
+    // A unit rotation keeps the length of the normal, so no renormalization is needed.
+    Output[dispatchThreadID.x].normal   = OutNormal;
+    Output[dispatchThreadID.x].texCoord = InTexCoord;
+    Output[dispatchThreadID.x].tangent  = OutTangent;
+}
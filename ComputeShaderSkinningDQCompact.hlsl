@@ -0,0 +1,9 @@
+//=============================================================================
+// ComputeShaderSkinningDQCompact.hlsl by Maico De Blasio (C) 2023 All Rights Reserved.
+//
+// ComputeShaderSkinningDQ.hlsl built for models loaded with
+// FBXModel::VertexFormat::Compact.
+//=============================================================================
+
+#define COMPACT_VERTICES
+#include "ComputeShaderSkinningDQ.hlsl"
@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "CookedModel.h"
+
+namespace
+{
+    // Closes a Win32 handle that is null on failure, or INVALID_HANDLE_VALUE for files.
+    struct HandleCloser
+    {
+        void operator()(HANDLE handle) const noexcept
+        {
+            if (handle && handle != INVALID_HANDLE_VALUE)
+                CloseHandle(handle);
+        }
+    };
+
+    using ScopedHandle = std::unique_ptr<void, HandleCloser>;
+
+    bool GetLastWriteTime(const char* path, ULARGE_INTEGER& time) noexcept
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data = {};
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+            return false;
+
+        time.LowPart  = data.ftLastWriteTime.dwLowDateTime;
+        time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+        return true;
+    }
+}
+
+std::string CookedModel::GetCookedPath(const char* path)
+{
+    std::string cookedPath(path);
+
+    // Only a dot after the last path separator starts an extension.
+    const auto dot = cookedPath.find_last_of('.');
+    const auto separator = cookedPath.find_last_of("\\/");
+
+    if (dot != std::string::npos && (separator == std::string::npos || dot > separator))
+        cookedPath.erase(dot);
+
+    return cookedPath + FileExtension;
+}
+
+bool CookedModel::IsCookedPath(const char* path) noexcept
+{
+    const auto length = strlen(path);
+    const auto extensionLength = strlen(FileExtension);
+
+    return length >= extensionLength && _stricmp(path + length - extensionLength, FileExtension) == 0;
+}
+
+bool CookedModel::IsHeaderCurrent(const FileHeader& header, uint64_t fileSize, Strides const& strides) noexcept
+{
+    // A file cooked with other struct layouts would be misread, so it is rejected instead.
+    return header.magic == Magic && header.version == Version && header.headerSize == sizeof(FileHeader) &&
+           header.vertexStride == strides.vertex && header.skinnedVertexStride == strides.skinnedVertex &&
+           header.keyStride == strides.key && header.fileSize == fileSize;
+}
+
+bool CookedModel::IsCookedFileCurrent(const char* cookedPath, const char* sourcePath, Strides const& strides)
+{
+    ULARGE_INTEGER cookedTime, sourceTime;
+
+    if (!GetLastWriteTime(cookedPath, cookedTime))
+        return false;
+
+    // Without the source, the cooked file is all there is.
+    if (GetLastWriteTime(sourcePath, sourceTime) && cookedTime.QuadPart < sourceTime.QuadPart)
+        return false;
+
+    MappedFile file;
+    if (!file.Open(cookedPath))
+        return false;
+
+    const auto header = static_cast<const FileHeader*>(file.GetArray(0, 1, sizeof(FileHeader)));
+    return header && IsHeaderCurrent(*header, file.GetSize(), strides);
+}
+
+bool CookedModel::MappedFile::Open(const char* path)
+{
+    m_view.reset();
+    m_size = 0;
+
+    ScopedHandle file(CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (file.get() == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file.get(), &size) || size.QuadPart <= 0)
+        return false;
+
+    ScopedHandle mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping)
+        return false;
+
+    m_view.reset(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+    if (!m_view)
+        return false;
+
+    m_size = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+const void* CookedModel::MappedFile::GetArray(uint64_t offset, uint64_t count, uint64_t stride) const noexcept
+{
+    // Views are page aligned, so an aligned offset is an aligned address.
+    if (!m_view || offset % Alignment != 0 || offset > m_size)
+        return nullptr;
+
+    if (stride != 0 && count > (m_size - offset) / stride)
+        return nullptr;
+
+    return GetData() + offset;
+}
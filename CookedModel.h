@@ -0,0 +1,127 @@
+#pragma once
+
+// Binary model format written offline from an FBX file by FBXModel::SaveCooked, and loaded at runtime without the
+// FBX SDK. Every array is stored in the exact layout FBXModel uploads or plays back, so a loader maps the file and
+// copies from the mapping rather than parsing it:
+//
+//   FileHeader
+//   MeshHeader[meshCount]
+//   per mesh: FBXModel::Vertex[vertexCount], FBXModel::SkinnedVertex[vertexCount] (bind pose),
+//             uint16_t or uint32_t[indexCount],
+//             Meshlets::Meshlet[meshletCount], Meshlets::MeshletBounds[meshletCount],
+//             uint32_t[meshletVertexCount]    meshlet vertex indices
+//             uint32_t[meshletPrimitiveCount] meshlet triangles, packed by Meshlets::PackPrimitive
+//   int32_t[boneCount]                  parent indices, -1 for a root, parents before children
+//   XMFLOAT4X4[boneCount]               inverse bind pose offsets
+//   BoneTransform[frameCount * boneCount] baked keys, frame major, as in AnimationClip
+//
+// Every array starts on an Alignment byte boundary. Offsets are from the start of the file.
+// Meshes are stored as MeshOptimizer ordered them, so the loader uploads them as they are.
+// The version is bumped whenever a layout or the processing of the meshes changes, so stale cooked files are rejected
+// and cooked again rather than misread.
+
+namespace CookedModel
+{
+    constexpr uint32_t Magic     = 0x4C444D43;   // "CMDL" as little endian bytes.
+    constexpr uint32_t Version   = 3;   // 2: meshes reordered by MeshOptimizer. 3: meshlets.
+    constexpr uint64_t Alignment = 16;
+
+    constexpr char FileExtension[] = ".cmdl";
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t headerSize;            // sizeof(FileHeader).
+        uint32_t meshCount;
+        uint32_t boneCount;
+        uint32_t frameCount;
+        float    duration;              // Clip duration in seconds.
+        uint32_t animationDurationMs;   // FBX take duration, as FBXModel::GetAnimDuration reports it.
+        uint32_t vertexStride;          // sizeof(FBXModel::Vertex).
+        uint32_t skinnedVertexStride;   // sizeof(FBXModel::SkinnedVertex).
+        uint32_t keyStride;             // sizeof(BoneTransform).
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t meshesOffset;
+        uint64_t parentsOffset;
+        uint64_t offsetsOffset;
+        uint64_t keysOffset;
+    };
+
+    struct MeshHeader
+    {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexSize;             // 2 if vertexCount fits 16 bit indices, otherwise 4.
+        uint32_t meshletCount;
+        uint32_t meshletVertexCount;
+        uint32_t meshletPrimitiveCount;
+        uint64_t verticesOffset;
+        uint64_t skinnedVerticesOffset;
+        uint64_t indicesOffset;
+        uint64_t meshletsOffset;
+        uint64_t meshletBoundsOffset;
+        uint64_t meshletVerticesOffset;
+        uint64_t meshletPrimitivesOffset;
+    };
+
+    static_assert(sizeof(FileHeader) == 88, "FileHeader layout is part of the file format.");
+    static_assert(sizeof(MeshHeader) == 80, "MeshHeader layout is part of the file format.");
+
+    // Sizes of the structs a loader reads the vertex, skinned vertex and key arrays as.
+    struct Strides
+    {
+        uint32_t vertex;
+        uint32_t skinnedVertex;
+        uint32_t key;
+    };
+
+    // Returns path with its extension replaced by FileExtension.
+    std::string GetCookedPath(const char* path);
+
+    // True if path names a cooked model, by its extension.
+    bool IsCookedPath(const char* path) noexcept;
+
+    // True if header has the current version, was written with strides and describes a file of fileSize bytes.
+    bool IsHeaderCurrent(const FileHeader& header, uint64_t fileSize, Strides const& strides) noexcept;
+
+    // True if cookedPath exists, is at least as new as sourcePath and has a current header, as IsHeaderCurrent.
+    bool IsCookedFileCurrent(const char* cookedPath, const char* sourcePath, Strides const& strides);
+
+    // Read only memory mapping of a whole file. The mapping is released when the object is destroyed.
+    class MappedFile
+    {
+    public:
+
+        MappedFile() noexcept = default;
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator= (MappedFile const&) = delete;
+
+        MappedFile(MappedFile&&) = default;
+        MappedFile& operator= (MappedFile&&) = default;
+
+        ~MappedFile() = default;
+
+        // Returns false, leaving the object empty, if the file can't be opened or is empty.
+        bool Open(const char* path);
+
+        // Returns the count elements of stride bytes at offset, or nullptr if they are misaligned or past the end.
+        const void* GetArray(uint64_t offset, uint64_t count, uint64_t stride) const noexcept;
+
+        const auto GetData() const noexcept     { return static_cast<const uint8_t*>(m_view.get()); }
+        const auto GetSize() const noexcept     { return m_size; }
+
+    private:
+
+        struct ViewDeleter
+        {
+            void operator()(const void* view) const noexcept { UnmapViewOfFile(view); }
+        };
+
+        // The view keeps the file mapping alive, so the file and mapping handles are closed once it is mapped.
+        std::unique_ptr<const void, ViewDeleter> m_view;
+        uint64_t                                 m_size = 0;
+    };
+}
@@ -3,7 +3,20 @@
 //***************************************************************************************
 
 #include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
 #include "FBXModel.h"
+#include "Skinning.h"
+#include "VertexWelder.h"
+#include "CookedModel.h"
+#include "MonotonicArena.h"
+#include "VertexCompression.h"
 
 #ifdef  IOS_REF
 #undef  IOS_REF
@@ -20,10 +33,28 @@ template<class T> constexpr const T& clamp(const T& v, const T& lo, const T& hi)
     return (v < lo) ? lo : (hi < v) ? hi : v;
 }
 
-FBXModel::FBXModel(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const char* pFbxFilePath) noexcept :
+// Struct sizes a cooked model must have been written with for LoadCookedModel to read it.
+const CookedModel::Strides CookedStrides = { sizeof(FBXModel::Vertex), sizeof(FBXModel::SkinnedVertex), sizeof(BoneTransform) };
+
+FBXModel::FBXModel(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const char* pFbxFilePath,
+                   float weldEpsilon, float animationSampleRate, MeshRetention retention,
+                   VertexFormat vertexFormat) noexcept(false) :
 //FbxLoader::FbxLoader(const char* pFbxFilePath) noexcept :
-  m_d3dDevice(device),  m_commandQueue(commandQueue), m_initialAnimDuration_ms(0)
+  m_sdkManager(nullptr), m_scene(nullptr),
+  m_d3dDevice(device),  m_commandQueue(commandQueue), m_skinningMode(SkinningMode::Linear), m_initialAnimDuration_ms(0),
+  m_weldEpsilon(weldEpsilon), m_animationSampleRate(animationSampleRate), m_meshRetention(retention), m_vertexFormat(vertexFormat),
+  m_lodNextTime(0), m_lodFramesUntilUpdate(0), m_hasLodNextPalette(false),
+  m_importArena(nullptr), m_importStatistics(), m_meshStatistics()
 {
+    // Cooked models don't need the FBX SDK, so no SDK manager is created for them.
+    if (CookedModel::IsCookedPath(pFbxFilePath))
+    {
+        // Nothing has been created when loading fails, but an empty model must not be mistaken for a loaded one.
+        if (!LoadCookedModel(pFbxFilePath))
+            throw std::exception("Cooked model is missing, corrupt or out of date. Cook it again with -cook.");
+        return;
+    }
+
     InitializeSdkManagerAndScene();
     LoadFBXScene(pFbxFilePath);
 }
@@ -33,7 +64,7 @@ FBXModel::~FBXModel()
     DestroySdkObjects(m_sdkManager);
 }
 
-FBXModel::Mesh::Mesh() : numIndices(0), vertexBufferSize(0), indexBufferSize(0) {}
+FBXModel::Mesh::Mesh() : controlPoints(), numIndices(0), vertexBufferSize(0), indexBufferSize(0) {}
 
 FBXModel::Mesh::~Mesh(){}
 
@@ -45,25 +76,309 @@ bool FBXModel::LoadFBXScene(const char* pFbxFilePath)
 
     // Initialize 3X4 packed bone palette smart pointer.
     m_bonePalette3X4 = std::make_unique<DirectX::XMFLOAT3X4[]>(MaxBones);
+    m_boneDualQuaternions = std::make_unique<BoneDualQuaternion[]>(MaxBones);
 
     FbxNode* pRootNode = m_scene->GetRootNode();
 
     if (pRootNode == nullptr)
         return false;
 
+    // Control point tables are carved from one arena, and freed together once the meshes are uploaded.
+    MonotonicArena importArena;
+    m_importArena = &importArena;
+
     LoadBones(pRootNode, -1);
     LoadMeshes(pRootNode);
 
     UploadMeshes();
-    //CreateMeshBoundingBoxes();
-    //CreateMeshBoundingSpheres();
+    BuildMeshlets();
+
+    m_importStatistics.arenaBytesUsed     = importArena.GetBytesUsed();
+    m_importStatistics.arenaBytesReserved = importArena.GetBytesReserved();
+    m_importStatistics.arenaBlockCount    = importArena.GetBlockCount();
+
+    for (auto& mesh : m_meshes)
+    {
+        mesh.controlPoints = {};
+    }
+    importArena.Release();
+    m_importArena = nullptr;
 
     // We just need the duration of the first animation track.
     m_initialAnimDuration_ms = GetAnimationDuration();
 
+    // Sample the track once now, so AdvanceTime only interpolates between keys.
+    BakeAnimation();
+    BuildSkeleton();
+
+    // The skinned bounds are fitted from the welded vertices, so the CPU copies are released after BuildSkeleton.
+    ApplyMeshRetention();
+
     return true;
 }
 
+bool FBXModel::IsCookedFileCurrent(const char* pCookedFilePath, const char* pFbxFilePath)
+{
+    return CookedModel::IsCookedFileCurrent(pCookedFilePath, pFbxFilePath, CookedStrides);
+}
+
+bool FBXModel::LoadCookedModel(const char* pCookedFilePath)
+{
+    using namespace CookedModel;
+
+    MappedFile file;
+    if (!file.Open(pCookedFilePath))
+        return false;
+
+    const auto header = static_cast<const FileHeader*>(file.GetArray(0, 1, sizeof(FileHeader)));
+
+    if (!header || !IsHeaderCurrent(*header, file.GetSize(), CookedStrides))
+        return false;
+
+    const auto boneCount = header->boneCount;
+    const auto keyCount  = static_cast<uint64_t>(header->frameCount) * boneCount;
+
+    const auto meshHeaders = static_cast<const MeshHeader*>(file.GetArray(header->meshesOffset, header->meshCount, sizeof(MeshHeader)));
+    const auto parents = static_cast<const int32_t*>(file.GetArray(header->parentsOffset, boneCount, sizeof(int32_t)));
+    const auto offsets = static_cast<const XMFLOAT4X4*>(file.GetArray(header->offsetsOffset, boneCount, sizeof(XMFLOAT4X4)));
+    const auto keys = static_cast<const BoneTransform*>(file.GetArray(header->keysOffset, keyCount, sizeof(BoneTransform)));
+
+    if (!meshHeaders || !parents || !offsets || !keys)
+        return false;
+
+    if (boneCount > 0 && (header->frameCount < 1 || !(header->duration >= 0.0f)))
+        return false;
+
+    // The skinning shaders' palette holds MaxBones bones, as an FBX import asserts.
+    if (boneCount > MaxBones)
+        return false;
+
+    // Bones must be in topological order, as Skeleton requires.
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+        if (parents[i] < -1 || parents[i] >= static_cast<int32_t>(i))
+            return false;
+    }
+
+    // Check every mesh before creating any buffers.
+    struct MeshData
+    {
+        const Vertex*        vertices;
+        const SkinnedVertex* skinnedVertices;
+        const void*          indices;
+    };
+    std::vector<MeshData> meshData(header->meshCount);
+    std::vector<Meshlets> meshlets(header->meshCount);
+
+    for (uint32_t i = 0; i < header->meshCount; ++i)
+    {
+        const auto& meshHeader = meshHeaders[i];
+        const auto indexSize = meshHeader.vertexCount <= UINT16_MAX ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        if (meshHeader.indexSize != indexSize)
+            return false;
+
+        auto& data = meshData[i];
+        data.vertices        = static_cast<const Vertex*>(file.GetArray(meshHeader.verticesOffset, meshHeader.vertexCount, sizeof(Vertex)));
+        data.skinnedVertices = static_cast<const SkinnedVertex*>(file.GetArray(meshHeader.skinnedVerticesOffset, meshHeader.vertexCount, sizeof(SkinnedVertex)));
+        data.indices         = file.GetArray(meshHeader.indicesOffset, meshHeader.indexCount, indexSize);
+
+        if (!data.vertices || !data.skinnedVertices || !data.indices)
+            return false;
+
+        // Indices and bone indices reach the GPU and CPU skinning unchecked, so out of range ones would read past the arrays.
+        const auto isIndexInRange = [&](uint32_t index) { return index < meshHeader.vertexCount; };
+        const auto areIndicesInRange = indexSize == sizeof(uint16_t) ?
+            std::all_of(static_cast<const uint16_t*>(data.indices), static_cast<const uint16_t*>(data.indices) + meshHeader.indexCount, isIndexInRange) :
+            std::all_of(static_cast<const uint32_t*>(data.indices), static_cast<const uint32_t*>(data.indices) + meshHeader.indexCount, isIndexInRange);
+
+        if (!areIndicesInRange)
+            return false;
+
+        if (std::any_of(data.vertices, data.vertices + meshHeader.vertexCount, [](const Vertex& vertex)
+                        { return std::any_of(std::begin(vertex.boneIndices), std::end(vertex.boneIndices), [](uint8_t bone) { return bone >= MaxBones; }); }))
+            return false;
+
+        const auto meshletArray   = static_cast<const Meshlets::Meshlet*>(file.GetArray(meshHeader.meshletsOffset, meshHeader.meshletCount, sizeof(Meshlets::Meshlet)));
+        const auto boundsArray    = static_cast<const Meshlets::MeshletBounds*>(file.GetArray(meshHeader.meshletBoundsOffset, meshHeader.meshletCount, sizeof(Meshlets::MeshletBounds)));
+        const auto vertexIndices  = static_cast<const uint32_t*>(file.GetArray(meshHeader.meshletVerticesOffset, meshHeader.meshletVertexCount, sizeof(uint32_t)));
+        const auto primitiveArray = static_cast<const uint32_t*>(file.GetArray(meshHeader.meshletPrimitivesOffset, meshHeader.meshletPrimitiveCount, sizeof(uint32_t)));
+
+        if (!meshletArray || !boundsArray || !vertexIndices || !primitiveArray)
+            return false;
+
+        if (!meshlets[i].Assign(meshletArray, boundsArray, meshHeader.meshletCount, vertexIndices, meshHeader.meshletVertexCount,
+                                primitiveArray, meshHeader.meshletPrimitiveCount))
+            return false;
+
+        if (std::any_of(vertexIndices, vertexIndices + meshHeader.meshletVertexCount,
+                        [&](uint32_t vertex) { return vertex >= meshHeader.vertexCount; }))
+            return false;
+    }
+
+    // Initialize 3X4 packed bone palette smart pointer.
+    m_bonePalette3X4 = std::make_unique<DirectX::XMFLOAT3X4[]>(MaxBones);
+    m_boneDualQuaternions = std::make_unique<BoneDualQuaternion[]>(MaxBones);
+
+    // The GPU buffers are uploaded straight from the mapping. The vertices are always copied to fit the skinned bounds,
+    // anything else only if the MeshRetention policy keeps it.
+    ResourceUploadBatch resourceUpload(m_d3dDevice);
+    resourceUpload.Begin();
+
+    m_meshes.resize(header->meshCount);
+
+    for (uint32_t i = 0; i < header->meshCount; ++i)
+    {
+        auto& mesh = m_meshes[i];
+        const auto& data = meshData[i];
+
+        mesh.numVertices = meshHeaders[i].vertexCount;
+        mesh.numIndices  = meshHeaders[i].indexCount;
+        mesh.finalVertices.assign(data.vertices, data.vertices + mesh.numVertices);
+
+        if (m_meshRetention != MeshRetention::None)
+        {
+            if (meshHeaders[i].indexSize == sizeof(uint16_t))
+            {
+                const auto indices16 = static_cast<const uint16_t*>(data.indices);
+                mesh.finalIndices32.assign(indices16, indices16 + mesh.numIndices);
+
+                if (m_meshRetention == MeshRetention::All)
+                    mesh.finalIndices16.assign(indices16, indices16 + mesh.numIndices);
+            }
+            else
+            {
+                const auto indices32 = static_cast<const uint32_t*>(data.indices);
+                mesh.finalIndices32.assign(indices32, indices32 + mesh.numIndices);
+            }
+        }
+
+        if (m_meshRetention == MeshRetention::All)
+            mesh.finalSkinnedVertices.assign(data.skinnedVertices, data.skinnedVertices + mesh.numVertices);
+
+        CreateMeshBuffers(resourceUpload, mesh, data.vertices, data.skinnedVertices, data.indices);
+    }
+
+    auto uploadResourcesFinished = resourceUpload.End(m_commandQueue);
+    uploadResourcesFinished.wait();
+
+    m_meshlets = std::move(meshlets);
+    m_initialAnimDuration_ms = header->animationDurationMs;
+
+    if (boneCount > 0)
+    {
+        for (uint32_t i = 0; i < boneCount; ++i)
+        {
+            m_skeleton.AddBone(parents[i], Matrix(offsets[i]));
+        }
+
+        m_animationClip = AnimationClip(boneCount, header->frameCount, header->duration, keys);
+        m_pose.resize(boneCount);
+    }
+
+    BuildSkeleton();
+    ApplyMeshRetention();
+
+    return true;
+}
+
+void FBXModel::SaveCooked(const char* pCookedFilePath) const
+{
+    using namespace CookedModel;
+
+    static_assert(std::is_trivially_copyable_v<Vertex> && std::is_trivially_copyable_v<SkinnedVertex> &&
+                  std::is_trivially_copyable_v<BoneTransform>, "Cooked arrays are copied byte for byte.");
+
+    const auto boneCount = m_skeleton.GetBoneCount();
+
+    if (boneCount > 0 && m_animationClip.IsEmpty())
+        throw std::exception("SaveCooked needs the baked clip, so must be called before CompressAnimation.");
+
+    std::vector<uint8_t> buffer;
+
+    // Appends count elements, starting on an aligned boundary, and returns their offset.
+    auto append = [&buffer](const void* data, size_t count, size_t stride)
+    {
+        buffer.resize((buffer.size() + Alignment - 1) / Alignment * Alignment);
+
+        const auto offset = static_cast<uint64_t>(buffer.size());
+        const auto bytes = static_cast<const uint8_t*>(data);
+
+        buffer.insert(buffer.end(), bytes, bytes + count * stride);
+        return offset;
+    };
+
+    FileHeader header = {};
+    header.magic               = Magic;
+    header.version             = Version;
+    header.headerSize          = sizeof(FileHeader);
+    header.meshCount           = static_cast<uint32_t>(m_meshes.size());
+    header.boneCount           = boneCount;
+    header.frameCount          = m_animationClip.GetFrameCount();
+    header.duration            = m_animationClip.GetDuration();
+    header.animationDurationMs = static_cast<uint32_t>(m_initialAnimDuration_ms);
+    header.vertexStride        = sizeof(Vertex);
+    header.skinnedVertexStride = sizeof(SkinnedVertex);
+    header.keyStride           = sizeof(BoneTransform);
+
+    // The headers are written first and patched once the offsets of the arrays are known.
+    append(&header, 1, sizeof(FileHeader));
+
+    std::vector<MeshHeader> meshHeaders(m_meshes.size());
+    header.meshesOffset = append(meshHeaders.data(), meshHeaders.size(), sizeof(MeshHeader));
+
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        const auto& mesh = m_meshes[i];
+        auto& meshHeader = meshHeaders[i];
+        const bool isIndex16 = mesh.indexBufferView.Format == DXGI_FORMAT_R16_UINT;
+
+        // The bind pose skinned vertices are only kept on the CPU by MeshRetention::All.
+        if (mesh.finalSkinnedVertices.size() != mesh.numVertices || mesh.finalIndices32.size() != mesh.numIndices)
+            throw std::exception("SaveCooked needs a model loaded with MeshRetention::All.");
+
+        meshHeader.vertexCount           = mesh.numVertices;
+        meshHeader.indexCount            = mesh.numIndices;
+        meshHeader.indexSize             = isIndex16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        meshHeader.verticesOffset        = append(mesh.finalVertices.data(), mesh.finalVertices.size(), sizeof(Vertex));
+        meshHeader.skinnedVerticesOffset = append(mesh.finalSkinnedVertices.data(), mesh.finalSkinnedVertices.size(), sizeof(SkinnedVertex));
+        meshHeader.indicesOffset         = isIndex16 ?
+            append(mesh.finalIndices16.data(), mesh.finalIndices16.size(), sizeof(uint16_t)) :
+            append(mesh.finalIndices32.data(), mesh.finalIndices32.size(), sizeof(uint32_t));
+
+        const auto& meshlets = m_meshlets[i];
+
+        meshHeader.meshletCount            = static_cast<uint32_t>(meshlets.GetMeshletCount());
+        meshHeader.meshletVertexCount      = static_cast<uint32_t>(meshlets.GetVertexIndexCount());
+        meshHeader.meshletPrimitiveCount   = static_cast<uint32_t>(meshlets.GetPrimitiveCount());
+        meshHeader.meshletsOffset          = append(meshlets.GetMeshlets(), meshlets.GetMeshletCount(), sizeof(Meshlets::Meshlet));
+        meshHeader.meshletBoundsOffset     = append(meshlets.GetBounds(), meshlets.GetMeshletCount(), sizeof(Meshlets::MeshletBounds));
+        meshHeader.meshletVerticesOffset   = append(meshlets.GetVertexIndices(), meshlets.GetVertexIndexCount(), sizeof(uint32_t));
+        meshHeader.meshletPrimitivesOffset = append(meshlets.GetPrimitives(), meshlets.GetPrimitiveCount(), sizeof(uint32_t));
+    }
+
+    std::vector<int32_t> parents(boneCount);
+    std::vector<XMFLOAT4X4> offsets(boneCount);
+
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+        parents[i] = m_skeleton.GetParentIndex(i);
+        XMStoreFloat4x4(&offsets[i], m_skeleton.GetOffset(i));
+    }
+
+    header.parentsOffset = append(parents.data(), parents.size(), sizeof(int32_t));
+    header.offsetsOffset = append(offsets.data(), offsets.size(), sizeof(XMFLOAT4X4));
+    header.keysOffset    = append(m_animationClip.GetKeys(), static_cast<size_t>(header.frameCount) * boneCount, sizeof(BoneTransform));
+    header.fileSize      = buffer.size();
+
+    memcpy(buffer.data(), &header, sizeof(FileHeader));
+    memcpy(buffer.data() + header.meshesOffset, meshHeaders.data(), meshHeaders.size() * sizeof(MeshHeader));
+
+    std::ofstream file(pCookedFilePath, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())))
+        throw std::exception("Failed to write the cooked model file.");
+}
+
 // Creates an instance of the SDK manager
 // and use the SDK manager to create a new scene
 void FBXModel::InitializeSdkManagerAndScene()
@@ -263,60 +578,9 @@ void FBXModel::UploadMeshes()
             //}
         }
 
-        mesh.vertexBufferSize = static_cast<uint32_t>(mesh.numVertices * sizeof(Vertex));
-        mesh.skinnedVertexBufferSize = static_cast<uint32_t>(mesh.numVertices * sizeof(SkinnedVertex));
-        mesh.indexBufferSize  = static_cast<uint32_t>(mesh.numIndices  * (isIndex16 ? sizeof(uint16_t) : sizeof(uint32_t)));
-        //mMeshes[i].mVertexBufferSize = UINT(mMeshes[i].mVertices.size() * sizeof(Vertex));
-        //mMeshes[i].mIndexBufferSize = UINT(mMeshes[i].mIndices.size() * sizeof(USHORT));
-
-        ThrowIfFailed(CreateStaticBuffer(
-            m_d3dDevice,
-            resourceUpload,
-            mesh.finalVertices,
-            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-            &mesh.vertexBuffer
-        ));
-        ThrowIfFailed(CreateStaticBuffer(
-            m_d3dDevice,
-            resourceUpload,
-            mesh.finalSkinnedVertices,
-            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            &mesh.skinnedVertexBuffer,
-            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS // Buffer will be updated by a compute shader.
-        ));
         // The data type of index buffer depends on vertex count.
-        if (isIndex16)
-        {
-            ThrowIfFailed(CreateStaticBuffer(
-                m_d3dDevice,
-                resourceUpload,
-                mesh.finalIndices16,
-                D3D12_RESOURCE_STATE_INDEX_BUFFER,
-                &mesh.indexBuffer
-            ));
-        }
-        else
-        {
-            ThrowIfFailed(CreateStaticBuffer(
-                m_d3dDevice,
-                resourceUpload,
-                mesh.finalIndices32,
-                D3D12_RESOURCE_STATE_INDEX_BUFFER,
-                &mesh.indexBuffer
-            ));
-        }
-
-        mesh.vertexBufferView.BufferLocation = mesh.vertexBuffer->GetGPUVirtualAddress();
-        mesh.vertexBufferView.SizeInBytes    = mesh.vertexBufferSize;
-        mesh.vertexBufferView.StrideInBytes  = sizeof(Vertex);
-
-        mesh.skinnedVertexBufferView.BufferLocation = mesh.skinnedVertexBuffer->GetGPUVirtualAddress();
-        mesh.skinnedVertexBufferView.SizeInBytes    = mesh.skinnedVertexBufferSize;
-        mesh.skinnedVertexBufferView.StrideInBytes  = sizeof(SkinnedVertex);
-
-        mesh.indexBufferView.BufferLocation  = mesh.indexBuffer->GetGPUVirtualAddress();
-        mesh.indexBufferView.SizeInBytes     = mesh.indexBufferSize;
-        mesh.indexBufferView.Format          = isIndex16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        CreateMeshBuffers(resourceUpload, mesh, mesh.finalVertices.data(), mesh.finalSkinnedVertices.data(),
+            isIndex16 ? static_cast<const void*>(mesh.finalIndices16.data()) : static_cast<const void*>(mesh.finalIndices32.data()));
 
         //mesh.vertexBufferSharedResource = GraphicsMemory::Get().Allocate(mesh.vertexBufferSize);
         //mesh.indexBufferSharedResource = GraphicsMemory::Get().Allocate(mesh.indexBufferSize);
@@ -366,6 +630,78 @@ void FBXModel::UploadMeshes()
     uploadResourcesFinished.wait();
 }
 
+void FBXModel::CreateMeshBuffers(ResourceUploadBatch& resourceUpload, Mesh& mesh,
+                                 const Vertex* vertices, const SkinnedVertex* skinnedVertices, const void* indices)
+{
+    const bool isIndex16 = mesh.numVertices <= UINT16_MAX;
+    const size_t indexSize = isIndex16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    mesh.vertexBufferSize = static_cast<uint32_t>(mesh.numVertices * GetVertexStride());
+    mesh.skinnedVertexBufferSize = static_cast<uint32_t>(mesh.numVertices * sizeof(SkinnedVertex));
+    mesh.indexBufferSize  = static_cast<uint32_t>(mesh.numIndices  * indexSize);
+
+    if (m_vertexFormat == VertexFormat::Compact)
+    {
+        std::vector<CompactVertex> compactVertices(mesh.numVertices);
+        std::transform(vertices, vertices + mesh.numVertices, compactVertices.begin(), VertexCompression::Compress);
+
+        ThrowIfFailed(CreateStaticBuffer(
+            m_d3dDevice,
+            resourceUpload,
+            compactVertices,
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+            &mesh.vertexBuffer
+        ));
+
+        // The CPU copy becomes exactly what the skinning shader decodes.
+        if (mesh.finalVertices.size() == mesh.numVertices)
+        {
+            std::transform(compactVertices.begin(), compactVertices.end(), mesh.finalVertices.begin(), VertexCompression::Decompress);
+        }
+    }
+    else
+    {
+        ThrowIfFailed(CreateStaticBuffer(
+            m_d3dDevice,
+            resourceUpload,
+            vertices,
+            mesh.numVertices,
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+            &mesh.vertexBuffer
+        ));
+    }
+    ThrowIfFailed(CreateStaticBuffer(
+        m_d3dDevice,
+        resourceUpload,
+        skinnedVertices,
+        mesh.numVertices,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        &mesh.skinnedVertexBuffer,
+        D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS // Buffer will be updated by a compute shader.
+    ));
+    ThrowIfFailed(CreateStaticBuffer(
+        m_d3dDevice,
+        resourceUpload,
+        indices,
+        mesh.numIndices,
+        indexSize,
+        D3D12_RESOURCE_STATE_INDEX_BUFFER,
+        &mesh.indexBuffer
+    ));
+
+    mesh.vertexBufferView.BufferLocation = mesh.vertexBuffer->GetGPUVirtualAddress();
+    mesh.vertexBufferView.SizeInBytes    = mesh.vertexBufferSize;
+    mesh.vertexBufferView.StrideInBytes  = GetVertexStride();
+
+    mesh.skinnedVertexBufferView.BufferLocation = mesh.skinnedVertexBuffer->GetGPUVirtualAddress();
+    mesh.skinnedVertexBufferView.SizeInBytes    = mesh.skinnedVertexBufferSize;
+    mesh.skinnedVertexBufferView.StrideInBytes  = sizeof(SkinnedVertex);
+
+    mesh.indexBufferView.BufferLocation  = mesh.indexBuffer->GetGPUVirtualAddress();
+    mesh.indexBufferView.SizeInBytes     = mesh.indexBufferSize;
+    mesh.indexBufferView.Format          = isIndex16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
 /*
 void FbxLoader::CreateBufferResources(Mesh& mesh)
 //void FbxLoader::CreateBufferResources(ID3D12Device* device, Mesh& mesh)
@@ -422,26 +758,6 @@ void FbxLoader::CreateBufferViews(Mesh& mesh)
 }
 */
 
-// Debugger indicates that vertex extents are not being calculated correctly for bounding volumes.
-
-void FBXModel::CreateMeshBoundingBoxes()
-{
-    for (auto& mesh : m_meshes)
-    {
-        BoundingBox::CreateFromPoints(
-            mesh.boundingBox, mesh.finalVertices.size(), &mesh.finalVertices[0].pos, sizeof(Vertex));
-    }
-}
-
-void FBXModel::CreateMeshBoundingSpheres()
-{
-    for (auto& mesh : m_meshes)
-    {
-        BoundingSphere::CreateFromPoints(
-            mesh.boundingSphere, mesh.finalVertices.size(), &mesh.finalVertices[0].pos, sizeof(Vertex));
-    }
-}
-
 /*
 VOID FbxLoader::Mesh::ProcessSkeleton(FbxNode* pNode)
 {
@@ -505,6 +821,7 @@ void FBXModel::LoadMesh(FbxNode* pNode)
                     CopyBoneWeightsToVertex(pMesh, mesh);
                     //CopyBoneWeightsToVertex(mesh);
                     DedupeVertices(mesh);
+                    OptimizeMesh(mesh);
                     // CompressVertices(mesh);
                 }
             }
@@ -533,13 +850,13 @@ void FBXModel::LoadNormalTexTangent(FbxMesh* pMesh, Mesh& mesh)
         for (int j = 0; j < polyVerts; j++)
         {
             auto cpi = pMesh->GetPolygonVertex(i, j);
-            CtrlPoint* currCP = mesh.controlPoints[cpi];
+            const auto& position = mesh.controlPoints.positions[cpi];
             ReadNormal(pMesh, cpi, vCounter, normal[j]);
             ReadTangent(pMesh, cpi, vCounter, tangent[j]);
             ReadTexCoord(pMesh, cpi, pMesh->GetTextureUVIndex(i, j), texCoord[j][0]);
 
-            auto v  = Vertex(currCP->position, normal[j], texCoord[j][0], tangent[j]);
-            auto sv = SkinnedVertex(currCP->position, normal[j], texCoord[j][0], tangent[j]);
+            auto v  = Vertex(position, normal[j], texCoord[j][0], tangent[j]);
+            auto sv = SkinnedVertex(position, normal[j], texCoord[j][0], tangent[j]);
             //Vertex v(currCP->position, normal[j], texCoord[j][0], tangent[j]);
 
             mesh.vertices.push_back(v);
@@ -552,20 +869,27 @@ void FBXModel::LoadNormalTexTangent(FbxMesh* pMesh, Mesh& mesh)
 
 void FBXModel::LoadControlPoints(FbxMesh* pMesh, Mesh& mesh)
 {
-    auto cpCount = pMesh->GetControlPointsCount();
+    auto cpCount = static_cast<uint32_t>(pMesh->GetControlPointsCount());
+
+    // One allocation per table rather than one per control point. Blending slots start zeroed.
+    auto& controlPoints = mesh.controlPoints;
+    controlPoints.count          = cpCount;
+    controlPoints.positions      = m_importArena->Allocate<Vector3>(cpCount);
+    controlPoints.blending       = m_importArena->Allocate<BlendingIndexWeightPair>(static_cast<size_t>(cpCount) * MaxInfluences);
+    controlPoints.blendingCounts = m_importArena->Allocate<uint8_t>(cpCount);
 
-    for (int i = 0; i < cpCount; i++)
+    for (uint32_t i = 0; i < cpCount; i++)
     {
-        CtrlPoint* currCP = new CtrlPoint();
-        FbxVector4 currPos = pMesh->GetControlPointAt(i);
-        
-        currCP->position.x = static_cast<float>(currPos.mData[0]);
-        currCP->position.y = static_cast<float>(currPos.mData[1]);
-        currCP->position.z =-static_cast<float>(currPos.mData[2]); // Flip z for a RH world coord system.
-        //currCP->mPosition.z = FLOAT(currPos.mData[2u]);
+        FbxVector4 currPos = pMesh->GetControlPointAt(static_cast<int>(i));
+        auto& position = controlPoints.positions[i];
 
-        mesh.controlPoints.insert(std::make_pair(i, currCP));
+        position.x = static_cast<float>(currPos.mData[0]);
+        position.y = static_cast<float>(currPos.mData[1]);
+        position.z =-static_cast<float>(currPos.mData[2]); // Flip z for a RH world coord system.
+        //currCP->mPosition.z = FLOAT(currPos.mData[2u]);
     }
+
+    m_importStatistics.controlPointCount += cpCount;
 }
 
 void FBXModel::ReadNormal(FbxMesh* pMesh, int cpIndex, int vCounter, Vector3& n)
@@ -985,7 +1309,7 @@ void FBXModel::LoadMeshBoneWeightsIndices(FbxMesh* pMesh, Mesh& mesh)
     //FbxMesh* pMesh = pNode->GetMesh();
     //FbxAMatrix geometryTransform;
     //Matrix geometryTransform;
-    //tControlPointRemap controlPointRemap;
+    //ControlPointRemap controlPointRemap;
 
     // maps control points to vertex indexes
     //LoadControlPointRemap(pMesh, controlPointRemap);
@@ -1038,7 +1362,17 @@ void FBXModel::LoadMeshBoneWeightsIndices(FbxMesh* pMesh, Mesh& mesh)
             currBlendingIndexWeightPair.blendingIndex = boneIndex;
 
             currBlendingIndexWeightPair.blendingWeight = static_cast<float>(clusterPtr->GetControlPointWeights()[i]);
-            mesh.controlPoints[clusterPtr->GetControlPointIndices()[i]]->blendingInfo.push_back(currBlendingIndexWeightPair);
+
+            // A vertex holds MaxInfluences bones, so any influences past those of a control point are not kept.
+            const auto cpi = clusterPtr->GetControlPointIndices()[i];
+            auto& blendingCount = mesh.controlPoints.blendingCounts[cpi];
+
+            if (blendingCount < MaxInfluences)
+            {
+                mesh.controlPoints.blending[static_cast<size_t>(cpi) * MaxInfluences + blendingCount] = currBlendingIndexWeightPair;
+                ++blendingCount;
+            }
+            ++m_importStatistics.influenceCount;
             
             //FLOAT weight = FLOAT(weightPtr[i]);
             //
@@ -1063,32 +1397,35 @@ void FBXModel::LoadMeshBoneWeightsIndices(FbxMesh* pMesh, Mesh& mesh)
     // Some of the control points only have less than 4 joints 
     // affecting them. 
     // For a normal renderer, there are usually 4 joints 
-    // I am adding more dummy joints if there isn't enough 
-    BlendingIndexWeightPair currBlendingIndexWeightPair;
-    currBlendingIndexWeightPair.blendingIndex = 0;
-    currBlendingIndexWeightPair.blendingWeight = 0;
-    for (auto itr = mesh.controlPoints.begin(); itr != mesh.controlPoints.end(); ++itr)
-    {
-        for (size_t i = itr->second->blendingInfo.size(); i <= 4; ++i)
-        {
-            itr->second->blendingInfo.push_back(currBlendingIndexWeightPair);
-        }
-    }
+    // The unused blending slots were zeroed when the table was allocated, so they are already dummy joints.
 }
 
-void FBXModel::LoadControlPointRemap(FbxMesh* pMesh,tControlPointRemap& controlPointRemap)
+void FBXModel::LoadControlPointRemap(FbxMesh* pMesh, ControlPointRemap& controlPointRemap)
 {
     const auto lPolygonCount = pMesh->GetPolygonCount();
-    controlPointRemap.resize(lPolygonCount);
+    const auto cpCount = static_cast<uint32_t>(pMesh->GetControlPointsCount());
+
+    // Count the vertices of each control point, then sum the counts into the end offset of each control point.
+    controlPointRemap.first    = m_importArena->Allocate<uint32_t>(cpCount + 1);
+    controlPointRemap.vertices = m_importArena->Allocate<uint32_t>(static_cast<size_t>(lPolygonCount) * 3);
 
     for (int lPolygonIndex = 0; lPolygonIndex < lPolygonCount; lPolygonIndex++)
     {
-        auto lPolygonSize = pMesh->GetPolygonSize(lPolygonIndex);
+        for (int lVertexIndex = 0; lVertexIndex < pMesh->GetPolygonSize(lPolygonIndex); lVertexIndex++)
+        {
+            ++controlPointRemap.first[pMesh->GetPolygonVertex(lPolygonIndex, lVertexIndex)];
+        }
+    }
+
+    std::partial_sum(controlPointRemap.first, controlPointRemap.first + cpCount + 1, controlPointRemap.first);
 
-        for (int lVertexIndex = 0; lVertexIndex < lPolygonSize; lVertexIndex++)
+    // Filled backwards, moving each end offset down to the start, so each control point keeps its vertices in polygon order.
+    for (int lPolygonIndex = lPolygonCount - 1; lPolygonIndex >= 0; lPolygonIndex--)
+    {
+        for (int lVertexIndex = pMesh->GetPolygonSize(lPolygonIndex) - 1; lVertexIndex >= 0; lVertexIndex--)
         {
-            auto lControlPointIndex = pMesh->GetPolygonVertex(lPolygonIndex, lVertexIndex);
-            controlPointRemap[lControlPointIndex].push_back(lPolygonIndex * 3 + lVertexIndex);
+            const auto lControlPointIndex = pMesh->GetPolygonVertex(lPolygonIndex, lVertexIndex);
+            controlPointRemap.vertices[--controlPointRemap.first[lControlPointIndex]] = lPolygonIndex * 3 + lVertexIndex;
         }
     }
 }
@@ -1218,11 +1555,7 @@ void FBXModel::CopyBoneWeightsToVertex(Mesh& mesh)
         }
     }
 
-    // unallocate control point memory
-
-    for (auto i = mesh.controlPoints.begin(); i != mesh.controlPoints.end(); i++)
-        delete i->second;
-    mesh.controlPoints.clear();
+    // Control point memory is released with the import arena.
 }
 
 void FBXModel::CopyBoneWeightsToVertex(FbxMesh* pMesh, Mesh& mesh)
@@ -1238,7 +1571,7 @@ void FBXModel::CopyBoneWeightsToVertex(FbxMesh* pMesh, Mesh& mesh)
         for (int j = 0; j < polyVerts; j++)
         {
             auto cpi = pMesh->GetPolygonVertex(i, j);
-            CtrlPoint* currCP = mesh.controlPoints[cpi];
+            const auto blending = &mesh.controlPoints.blending[static_cast<size_t>(cpi) * MaxInfluences];
 
             // Copy the blending info from each control point 
             float* boneWeight = &mesh.vertices[vCounter].boneWeights.x;
@@ -1248,30 +1581,167 @@ void FBXModel::CopyBoneWeightsToVertex(FbxMesh* pMesh, Mesh& mesh)
                 //currBlendingInfo.mBlendingIndex = currCP->mBlendingInfo[k].mBlendingIndex;
                 //currBlendingInfo.mBlendingWeight = currCP->mBlendingInfo[k].mBlendingWeight;
 
-                mesh.vertices[vCounter].boneIndices[k] = currCP->blendingInfo[k].blendingIndex;
-                *boneWeight = currCP->blendingInfo[k].blendingWeight;
+                mesh.vertices[vCounter].boneIndices[k] = static_cast<uint8_t>(blending[k].blendingIndex);
+                *boneWeight = blending[k].blendingWeight;
                 //mesh.vertices[vCounter].boneWeights[k] = currCP->blendingInfo[k].blendingWeight;
                 boneWeight++; // Increment reference to the next vector component.
             }
             ++vCounter;
         }
     }
-    // unallocate control point memory
+    // Control point memory is released with the import arena.
+}
 
-    for (auto i = mesh.controlPoints.begin(); i != mesh.controlPoints.end(); i++)
-        delete i->second;
-    mesh.controlPoints.clear();
+void FBXModel::AdvanceTime(float time, const uint32_t* boneRemap)
+{
+    BuildMatrices(time, boneRemap);
 }
 
-void FBXModel::AdvanceTime(float time)
+bool FBXModel::AdvanceTimeLod(float time, uint32_t updateInterval, bool interpolate, const uint32_t* boneRemap, float frameTime)
 {
-    FbxTime fbxFrameTime;
-    FbxLongLong localAnimTime = static_cast<size_t>(1000.f * time) % m_initialAnimDuration_ms;
-    //unsigned long long localAnimationTime = GetTickCount64() % m_initialAnimationDurationInMs;
-    
-    fbxFrameTime.SetMilliSeconds(localAnimTime);
-    
-    BuildMatrices(fbxFrameTime);
+    assert(updateInterval > 0);
+
+    if (m_skeleton.GetBoneCount() == 0)
+    {
+        return false;
+    }
+
+    if (m_lodFramesUntilUpdate > 0)
+    {
+        --m_lodFramesUntilUpdate;
+
+        if (!interpolate || !m_hasLodNextPalette)
+        {
+            return false;
+        }
+
+        const auto frame = static_cast<float>(updateInterval - 1 - m_lodFramesUntilUpdate);
+        BlendLodPalettes(frame / static_cast<float>(updateInterval));
+        UpdateMeshBounds();
+        return true;
+    }
+
+    m_lodFramesUntilUpdate = updateInterval - 1;
+
+    if (!interpolate || updateInterval == 1)
+    {
+        BuildMatrices(time, boneRemap);
+        m_hasLodNextPalette = false;
+        return true;
+    }
+
+    const auto boneCount = m_skeleton.GetBoneCount();
+    const auto isDualQuaternion = m_skinningMode == SkinningMode::DualQuaternion;
+    m_lodPreviousPalette3X4.resize(boneCount);
+    m_lodNextPalette3X4.resize(boneCount);
+    m_lodPreviousDualQuaternions.resize(boneCount);
+    m_lodNextDualQuaternions.resize(boneCount);
+
+    // The pose sampled ahead at the last update is the pose for now, unless the play time went elsewhere.
+    const auto tolerance = 0.5f * std::abs(frameTime) + 1e-4f;
+
+    if (m_hasLodNextPalette && std::abs(m_lodNextTime - time) <= tolerance)
+    {
+        m_lodPreviousPalette3X4.swap(m_lodNextPalette3X4);
+        m_lodPreviousDualQuaternions.swap(m_lodNextDualQuaternions);
+    }
+    else
+    {
+        BuildMatrices(time, boneRemap);
+        std::copy_n(m_bonePalette3X4.get(), boneCount, m_lodPreviousPalette3X4.data());
+        std::copy_n(m_boneDualQuaternions.get(), boneCount, m_lodPreviousDualQuaternions.data());
+    }
+
+    // The model's palette is the scratch the pose ahead is evaluated into. Only the active mode's palette is read back.
+    m_lodNextTime = time + static_cast<float>(updateInterval) * frameTime;
+    BuildMatrices(m_lodNextTime, boneRemap);
+    std::copy_n(m_bonePalette3X4.get(), boneCount, m_lodNextPalette3X4.data());
+    std::copy_n(m_boneDualQuaternions.get(), boneCount, m_lodNextDualQuaternions.data());
+    m_hasLodNextPalette = true;
+
+    if (isDualQuaternion)
+    {
+        std::copy_n(m_lodPreviousDualQuaternions.data(), boneCount, m_boneDualQuaternions.get());
+    }
+    else
+    {
+        std::copy_n(m_lodPreviousPalette3X4.data(), boneCount, m_bonePalette3X4.get());
+    }
+    UpdateMeshBounds();
+    return true;
+}
+
+void FBXModel::BlendLodPalettes(float t)
+{
+    const auto boneCount = m_skeleton.GetBoneCount();
+    const auto weight = XMVectorReplicate(t);
+
+    if (m_skinningMode == SkinningMode::DualQuaternion)
+    {
+        // Blend along the shorter arc and renormalize, as the dual quaternion skinning shader does per vertex.
+        for (uint32_t i = 0; i < boneCount; ++i)
+        {
+            const auto& previous = m_lodPreviousDualQuaternions[i];
+            const auto& next = m_lodNextDualQuaternions[i];
+            const auto previousReal = XMLoadFloat4(&previous.real);
+            auto nextReal = XMLoadFloat4(&next.real);
+            auto nextDual = XMLoadFloat4(&next.dual);
+
+            if (XMVectorGetX(XMVector4Dot(previousReal, nextReal)) < 0)
+            {
+                nextReal = XMVectorNegate(nextReal);
+                nextDual = XMVectorNegate(nextDual);
+            }
+
+            const auto real = XMVectorLerpV(previousReal, nextReal, weight);
+            const auto dual = XMVectorLerpV(XMLoadFloat4(&previous.dual), nextDual, weight);
+            const auto length = XMVector4Length(real);
+            XMStoreFloat4(&m_boneDualQuaternions[i].real, XMVectorDivide(real, length));
+            XMStoreFloat4(&m_boneDualQuaternions[i].dual, XMVectorDivide(dual, length));
+        }
+    }
+    else
+    {
+        // Linear blending of 3x4 matrices is what the skinning shader does per vertex anyway.
+        for (uint32_t i = 0; i < boneCount; ++i)
+        {
+            for (size_t r = 0; r < 3; ++r)
+            {
+                const auto previous = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_lodPreviousPalette3X4[i].m[r]));
+                const auto next     = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_lodNextPalette3X4[i].m[r]));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(m_bonePalette3X4[i].m[r]), XMVectorLerpV(previous, next, weight));
+            }
+        }
+    }
+}
+
+void FBXModel::SkinVertices(size_t meshPos, SkinnedVertex* output) const
+{
+    const auto& mesh = m_meshes.at(meshPos);
+    const auto paletteCount = std::max(m_skeleton.GetBoneCount(), MaxBones);
+
+    if (mesh.finalVertices.size() != mesh.numVertices)
+        throw std::exception("SkinVertices needs a model loaded with MeshRetention::Collision or All.");
+
+    if (m_skinningMode == SkinningMode::DualQuaternion)
+    {
+        Skinning::SkinVerticesDualQuaternion(mesh.finalVertices.data(), output, mesh.finalVertices.size(), m_boneDualQuaternions.get(), paletteCount);
+    }
+    else
+    {
+        Skinning::SkinVertices(mesh.finalVertices.data(), output, mesh.finalVertices.size(), m_bonePalette3X4.get(), paletteCount);
+    }
+}
+
+void FBXModel::CompressAnimation(AnimationCompressionSettings const& settings)
+{
+    if (m_animationClip.IsEmpty())
+    {
+        return;
+    }
+
+    m_compressedClip = CompressedAnimationClip(m_animationClip, settings);
+    m_animationClip  = AnimationClip();
 }
 
 void FBXModel::Draw(ID3D12GraphicsCommandList* commandList)
@@ -1331,84 +1801,225 @@ size_t FBXModel::GetAnimationDuration()
     return animTime;
 }
 
-void FBXModel::BuildMatrices(const FbxTime& frameTime)
+void FBXModel::BakeAnimation()
 {
     if (m_boneVector.empty())
     {
         return;
     }
 
-    // Here's most of the matrix bone operations from start to finish.
-    // The exception is the offset matrix calculation that happens once
-    // when the bone is created.
+    // Keys span the same 0 to duration range that was previously evaluated each frame.
+    // Always bake at least two keys, so a zero length track still holds its pose.
+    const auto duration   = static_cast<float>(m_initialAnimDuration_ms) / 1000.f;
+    const auto frameCount = std::max(2u, static_cast<uint32_t>(std::ceil(duration * m_animationSampleRate)) + 1);
+    const auto boneCount  = static_cast<uint32_t>(m_boneVector.size());
 
-    // Set the matrices that change by time and animation keys.
-    LoadNodeLocalTransformMatrices(frameTime);
+    m_animationClip = AnimationClip(boneCount, frameCount, duration);
+    m_pose.resize(boneCount);
 
-    // Propagate the local transform matrices from parent to child.
-    CalculateCombinedTransforms();
+    Matrix localTransform;
 
-    // This is the final pass that prepends the offset matrix.
-    CalculatePaletteMatrices();
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        FbxTime fbxFrameTime;
+        fbxFrameTime.SetSecondDouble(static_cast<double>(duration) * frame / (frameCount - 1));
+
+        for (uint32_t i = 0; i < boneCount; ++i)
+        {
+            GetNodeLocalTransform(m_boneVector[i].boneNodePtr, fbxFrameTime, localTransform);
+            m_animationClip.SetKey(frame, i, localTransform);
+        }
+    }
 }
 
-void FBXModel::CalculateCombinedTransforms()
+void FBXModel::BuildSkeleton()
 {
-    if (m_boneVector.empty())
+    // Bones are loaded depth first, so every parent already precedes its children.
+    // A cooked model has no FBX bones, its skeleton has already been read from the file.
+    for (const auto& bone : m_boneVector)
     {
-        return;
+        m_skeleton.AddBone(bone.parentIndex, bone.offset);
+    }
+
+    m_combined.resize(m_skeleton.GetBoneCount());
+
+    // Fit a bind pose box per bone to each mesh, so animated bounds only transform boxes, not vertices.
+    // Sized like the palette, which covers every index a vertex can hold.
+    const auto paletteCount = std::max(m_skeleton.GetBoneCount(), MaxBones);
+    m_skinnedBounds.resize(m_meshes.size());
+
+    for (size_t i = 0; i < m_meshes.size(); ++i)
+    {
+        auto& bounds = m_skinnedBounds[i];
+        bounds.Reset(paletteCount);
+
+        for (const auto& vertex : m_meshes[i].finalVertices)
+        {
+            bounds.AddVertex(vertex.pos, vertex.boneIndices, vertex.boneWeights);
+        }
+        bounds.Finalize();
     }
 
-    if (m_boneVector.size() == 1)
+    if (m_skeleton.GetBoneCount() > MaxBones)
+    {
+        m_bonePalette3X4 = std::make_unique<DirectX::XMFLOAT3X4[]>(m_skeleton.GetBoneCount());
+        m_boneDualQuaternions = std::make_unique<BoneDualQuaternion[]>(m_skeleton.GetBoneCount());
+    }
+}
+
+AnimationInstance FBXModel::CreateAnimationInstance() const
+{
+    assert(!m_compressedClip.IsEmpty());
+    return AnimationInstance(m_skeleton, &m_compressedClip);
+}
+
+void FBXModel::BuildMatrices(float time, const uint32_t* boneRemap)
+{
+    if (m_skeleton.GetBoneCount() == 0)
     {
         return;
     }
 
-    for (auto& bone : m_boneVector)
+    // Set the transforms that change by time and animation keys.
+    LoadNodeLocalTransformMatrices(time);
+
+    // Propagate the local transforms from parent to child, prepend the offset matrices and pack the
+    // palette for the shader, in one pass over the flattened hierarchy. Nothing here allocates.
+    if (m_skinningMode == SkinningMode::DualQuaternion)
     {
-        if (bone.parentIndex != -1)
-        {
-            bone.combinedTransform = bone.nodeLocalTransform * m_boneVector[bone.parentIndex].combinedTransform;
-        }
-        else
-        {
-            bone.combinedTransform = bone.nodeLocalTransform;
-        }
+        m_skeleton.CalculateDualQuaternionPalette(m_pose.data(), m_combined.data(), m_boneDualQuaternions.get(), boneRemap);
     }
+    else
+    {
+        m_skeleton.CalculatePalette(m_pose.data(), m_combined.data(), m_bonePalette3X4.get(), boneRemap);
+    }
+
+    UpdateMeshBounds();
 }
 
-void FBXModel::LoadNodeLocalTransformMatrices(const FbxTime& frameTime)
+void FBXModel::BuildMeshlets()
 {
-    for (size_t i = 0; i < m_boneVector.size(); ++i)
+    m_meshlets.resize(m_meshes.size());
+
+    for (size_t i = 0; i < m_meshes.size(); ++i)
     {
-        GetNodeLocalTransform(m_boneVector[i].boneNodePtr, frameTime, m_boneVector[i].nodeLocalTransform);
+        const auto& mesh = m_meshes[i];
+
+        if (!mesh.finalIndices32.empty())
+            m_meshlets[i].Build(&mesh.finalVertices.data()->pos, sizeof(Vertex), mesh.finalIndices32.data(), mesh.finalIndices32.size());
+    }
+}
+
+void FBXModel::ApplyMeshRetention()
+{
+    if (m_meshRetention == MeshRetention::All)
+        return;
+
+    // clear keeps the capacity, so each vector is swapped with an empty one to free its memory.
+    auto release = [](auto& vector) { std::decay_t<decltype(vector)>().swap(vector); };
+
+    for (auto& mesh : m_meshes)
+    {
+        // Import intermediates, only read while welding.
+        release(mesh.vertices);
+        release(mesh.skinnedVertices);
+        release(mesh.indices);
+        release(mesh.verticeVector);
+        release(mesh.indexVector);
+
+        // Bind pose skinned vertices and 16 bit indices were only kept to upload them.
+        release(mesh.finalSkinnedVertices);
+        release(mesh.finalIndices16);
+
+        if (m_meshRetention == MeshRetention::None)
+        {
+            release(mesh.finalVertices);
+            release(mesh.finalIndices32);
+        }
     }
 }
 
-void FBXModel::CalculatePaletteMatrices()
+FBXModel::MemoryFootprint FBXModel::GetMemoryFootprint() const
 {
-    m_bonePalette.clear();
+    auto bytes = [](const auto& vector) { return vector.capacity() * sizeof(vector[0]); };
 
-    for (auto& bone : m_boneVector)
+    MemoryFootprint footprint = {};
+
+    for (const auto& mesh : m_meshes)
+    {
+        footprint.cpuMeshBytes += bytes(mesh.vertices) + bytes(mesh.skinnedVertices) + bytes(mesh.indices) +
+                                  bytes(mesh.finalVertices) + bytes(mesh.finalSkinnedVertices) +
+                                  bytes(mesh.finalIndices16) + bytes(mesh.finalIndices32) +
+                                  bytes(mesh.verticeVector) + bytes(mesh.indexVector);
+
+        footprint.gpuBufferBytes += static_cast<size_t>(mesh.vertexBufferSize) + mesh.skinnedVertexBufferSize + mesh.indexBufferSize;
+
+        for (auto resource : { mesh.vertexBuffer.Get(), mesh.skinnedVertexBuffer.Get(), mesh.indexBuffer.Get() })
+        {
+            if (resource)
+            {
+                const auto desc = resource->GetDesc();
+                footprint.gpuAllocatedBytes += static_cast<size_t>(m_d3dDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes);
+            }
+        }
+    }
+
+    // Both palettes are allocated for at least MaxBones.
+    const auto boneCount = static_cast<size_t>(m_skeleton.GetBoneCount());
+    const auto paletteCount = m_bonePalette3X4 ? std::max(boneCount, static_cast<size_t>(MaxBones)) : 0;
+
+    footprint.cpuAnimationBytes = static_cast<size_t>(m_animationClip.GetFrameCount()) * m_animationClip.GetBoneCount() * sizeof(BoneTransform) +
+                                  m_compressedClip.GetSizeInBytes() +
+                                  boneCount * (sizeof(int) + sizeof(XMMATRIX)) +
+                                  bytes(m_pose) + bytes(m_combined) +
+                                  bytes(m_lodPreviousPalette3X4) + bytes(m_lodNextPalette3X4) +
+                                  bytes(m_lodPreviousDualQuaternions) + bytes(m_lodNextDualQuaternions) +
+                                  paletteCount * (sizeof(XMFLOAT3X4) + sizeof(BoneDualQuaternion));
+
+    for (const auto& bounds : m_skinnedBounds)
+    {
+        footprint.cpuAnimationBytes += bounds.GetBoxCount() * (sizeof(uint32_t) + 2 * sizeof(XMFLOAT4));
+    }
+
+    for (const auto& meshlets : m_meshlets)
     {
-        bone.boneMatrice = bone.offset * bone.combinedTransform;
-        m_bonePalette.push_back(bone.boneMatrice);
+        footprint.cpuMeshBytes += meshlets.GetSizeInBytes();
     }
 
-    // Added XMFLOAT3X4 packing code here to save the game from doing it when skinned models are rendered.
+    return footprint;
+}
 
-    int i = 0;
-    for (const auto& bone : m_bonePalette)
-    //for (auto i = 0u; i < mBonePalette.size(); i++)
+void FBXModel::UpdateMeshBounds()
+{
+    for (size_t i = 0; i < m_meshes.size(); ++i)
     {
-        // We do not transpose bone matrices for HLSL because the original FbxMatrix is in column-vector math format.
-        // XMFLOAT3X4 matrices are also column-major, so can be also be loaded without transpose.
+        auto& mesh = m_meshes[i];
+
+        const auto isBounded = m_skinningMode == SkinningMode::DualQuaternion ?
+            m_skinnedBounds[i].Calculate(m_boneDualQuaternions.get(), mesh.boundingBox) :
+            m_skinnedBounds[i].Calculate(m_bonePalette3X4.get(), mesh.boundingBox);
 
-        XMStoreFloat3x4(&m_bonePalette3X4[i++], bone);
-        //XMStoreFloat3x4(&mBonePalette3X4[i], mBonePalette[i]);
+        if (isBounded)
+        {
+            BoundingSphere::CreateFromBoundingBox(mesh.boundingSphere, mesh.boundingBox);
+        }
     }
 }
 
+void FBXModel::LoadNodeLocalTransformMatrices(float time)
+{
+    // Interpolate the baked keys, rather than evaluating the FBX scene for every bone.
+    if (m_compressedClip.IsEmpty())
+    {
+        m_animationClip.Sample(time, m_pose.data());
+    }
+    else
+    {
+        m_animationDecoder.Sample(m_compressedClip, time, m_pose.data());
+    }
+}
+
+/*
 int FBXModel::FindVertex(const std::vector<Vertex>& finalVertices, const Vertex& v)
 //uint16_t FbxLoader::FindVertex(const std::vector<Vertex>& finalVertices, const Vertex& v)
 {
@@ -1428,19 +2039,32 @@ int FBXModel::FindVertex(const std::vector<Vertex>& finalVertices, const Vertex&
     return UINT32_MAX;
     //return 0xFFFF;
 }
+*/
 
 void FBXModel::DedupeVertices(Mesh& mesh)
 {
+    // The sequential FindVertex search was O(n^2) in the vertex count, so vertices are now welded with a hash map.
+    // In exact mode the first occurrence of a vertex keeps its slot, so output order is unchanged.
+    VertexWelder<11> welder(m_weldEpsilon, mesh.vertices.size());
+
     //tSkinnedVerticeVector newVertices;
     uint32_t findIndex = 0;
     //uint16_t findIndex = 0;
 
+    mesh.finalVertices.reserve(mesh.vertices.size());
+    mesh.finalSkinnedVertices.reserve(mesh.vertices.size());
+    mesh.finalIndices32.reserve(mesh.indices.size());
+
     for (auto& i : mesh.indices)
     {
-        Vertex testVertex = mesh.vertices[i];
-        SkinnedVertex tsv = mesh.skinnedVertices[i]; // The corresponding skinned vertex.
+        const Vertex& testVertex = mesh.vertices[i];
+        const SkinnedVertex& tsv = mesh.skinnedVertices[i]; // The corresponding skinned vertex.
 
-        findIndex = FindVertex(mesh.finalVertices, testVertex);
+        findIndex = welder.FindOrAdd({
+            testVertex.pos.x,     testVertex.pos.y,    testVertex.pos.z,
+            testVertex.normal.x,  testVertex.normal.y, testVertex.normal.z,
+            testVertex.texC.x,    testVertex.texC.y,
+            testVertex.tangent.x, testVertex.tangent.y, testVertex.tangent.z });
 
         if (findIndex == UINT32_MAX) // Not found.
         //if (findIndex == 0xFFFF) // Not found.
@@ -1458,4 +2082,30 @@ void FBXModel::DedupeVertices(Mesh& mesh)
         //mesh.finalIndices.push_back(i);
     }
     //modelRec.verticeVector.swap(newVertices);
+
+    mesh.finalVertices.shrink_to_fit();
+    mesh.finalSkinnedVertices.shrink_to_fit();
+}
+
+void FBXModel::OptimizeMesh(Mesh& mesh)
+{
+    if (mesh.finalIndices32.empty())
+        return;
+
+    // Welded indices are in polygon order, as the FBX file lists them.
+    auto indices = mesh.finalIndices32.data();
+    const auto indexCount  = mesh.finalIndices32.size();
+    const auto vertexCount = mesh.finalVertices.size();
+
+    m_meshStatistics.before += MeshOptimizer::Analyze(indices, indexCount, vertexCount, GetVertexStride());
+
+    MeshOptimizer::OptimizeTriangleOrder(indices, indexCount, &mesh.finalVertices.data()->pos, sizeof(Vertex), vertexCount);
+
+    // Skinned vertices are the bind pose copies of the vertices, so both are renumbered alike.
+    std::vector<uint32_t> remap(vertexCount);
+    MeshOptimizer::OptimizeVertexFetch(indices, indexCount, vertexCount, remap.data());
+    MeshOptimizer::RemapVertices(mesh.finalVertices, remap.data());
+    MeshOptimizer::RemapVertices(mesh.finalSkinnedVertices, remap.data());
+
+    m_meshStatistics.after += MeshOptimizer::Analyze(indices, indexCount, vertexCount, GetVertexStride());
 }
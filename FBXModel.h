@@ -5,6 +5,11 @@
 
 #pragma once
 
+// RaytracingHlslCompat.h, MeshOptimizer.h, Meshlets.h, AnimationClip.h, AnimationCompression.h, Skeleton.h,
+// AnimationInstance.h and SkinnedBounds.h must be in the #include list before this header.
+
+class MonotonicArena;
+
 // AutodeskMemoryStream fails FBX file load in VS2022 17.4 Release build.
 //#include "AutodeskMemoryStream.h"
 
@@ -16,7 +21,27 @@ class FBXModel
 {
 public:
 
-    FBXModel(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const char* pFbxFilePath) noexcept;
+    // CPU copies of the mesh data kept after upload. Rendering only reads the GPU buffers, so a model that is only
+    // drawn needs None. Collision keeps the welded vertices and 32 bit indices, which SkinVertices and CPU collision
+    // read, as the vertices hold the bone weights that pose their positions. All keeps every copy made during the
+    // import, which SaveCooked and other tools need.
+    enum class MeshRetention { None, Collision, All };
+
+    // Layout of the vertex buffer the skinning compute shader reads. Full uploads Vertex as is. Compact uploads
+    // CompactVertex, half the size, which the Compact variants of the skinning shaders read.
+    enum class VertexFormat { Full, Compact };
+
+    // weldEpsilon = 0 welds bit equal vertices only, otherwise vertex attributes are welded within epsilon.
+    // The first animation stack is baked into keyframes at animationSampleRate keys per second.
+    // A path with the CookedModel::FileExtension extension loads a model written by SaveCooked instead, without the
+    // FBX SDK. Its vertices were welded and its keys baked when it was cooked, so weldEpsilon and animationSampleRate
+    // are ignored. Throws if the cooked model can't be loaded, so check it with IsCookedFileCurrent first.
+    // retention selects the CPU copies of the mesh data kept once the GPU buffers are uploaded.
+    // A Compact vertexFormat quantizes the CPU vertices to the precision of the compact layout at import, so CPU
+    // skinning, bounds and cooked files see exactly the vertices the GPU decodes.
+    FBXModel(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const char* pFbxFilePath,
+             float weldEpsilon = 0.0f, float animationSampleRate = 30.0f,
+             MeshRetention retention = MeshRetention::All, VertexFormat vertexFormat = VertexFormat::Full) noexcept(false);
     //FbxLoader(const char* pFbxFilePath) noexcept;
     ~FBXModel(); // implemented
 
@@ -30,8 +55,33 @@ public:
 
     static const uint32_t MaxBones = 50;
 
-private:
+    // Linear blends 3x4 bone matrices, as ComputeShaderSkinning.hlsl does. DualQuaternion blends the bones as unit
+    // dual quaternions, as ComputeShaderSkinningDQ.hlsl does, which keeps the volume of bending and twisting joints
+    // and uploads 8 floats per bone instead of 12, but ignores any scale in the bone transforms.
+    enum class SkinningMode { Linear, DualQuaternion };
 
+    // Scratch memory used by the last FBX import, recorded before its arena was released.
+    struct ImportStatistics
+    {
+        size_t controlPointCount;
+        size_t influenceCount;      // Bone influences read from the skin clusters.
+        size_t arenaBytesUsed;
+        size_t arenaBytesReserved;
+        size_t arenaBlockCount;     // Heap allocations made for the scratch data.
+    };
+
+    // Resident memory of one model. CPU sizes count array capacities, not heap overhead, and leave out the FBX SDK
+    // scene of a model loaded from an FBX file.
+    struct MemoryFootprint
+    {
+        size_t cpuMeshBytes;        // Vertex and index copies kept by the MeshRetention policy, and the meshlets.
+        size_t cpuAnimationBytes;   // Clips, skeleton, pose, palettes and skinned bounds.
+        size_t gpuBufferBytes;      // Vertex, skinned vertex and index buffer contents.
+        size_t gpuAllocatedBytes;   // The same buffers as the device allocates them, rounded up to its placement alignment.
+    };
+
+    // Vertex layouts of the skinning compute shader input (VertexFbxBones) and output (VertexPosNormalTexTangent).
+    // Public so the CPU skinning path in Skinning.h can read and write them.
     struct Vertex
     {
         // Added constructors.
@@ -64,6 +114,18 @@ private:
         //UINT BoneIndices[4u];
     };
     
+    // Quantized Vertex, matching VertexFbxBonesCompact, encoded and decoded by VertexCompression.h.
+    // The position stays full precision, as it is skinned and then built into the acceleration structure.
+    struct CompactVertex
+    {
+        DirectX::SimpleMath::Vector3 pos;
+        uint32_t normal;        // Octahedral encoded unit vector, 2 x SNORM16.
+        uint32_t texC;          // 2 x FLOAT16.
+        uint32_t tangent;       // Octahedral encoded unit vector, 2 x SNORM16.
+        uint32_t boneWeights;   // 4 x UNORM8. As with Vertex, the fourth weight is recalculated when skinning.
+        uint8_t  boneIndices[4];
+    };
+
     // This new vertex struct will be used to store the results of skinning in the compute shader.
     struct SkinnedVertex
     {
@@ -93,6 +155,8 @@ private:
         DirectX::SimpleMath::Vector3 tangent;
     };
 
+private:
+
     struct IndexWeightPair
     {
         uint32_t boneWeights;
@@ -110,15 +174,24 @@ private:
         {}
     };
 
-    struct CtrlPoint
+    static constexpr uint32_t MaxInfluences = 4; // Bone influences per vertex.
+
+    // Control point tables of one mesh, as flat arrays indexed by control point id.
+    // They are allocated from the import arena, so they are only valid until the import finishes.
+    struct ControlPoints
     {
-        DirectX::SimpleMath::Vector3 position;
-        std::vector<BlendingIndexWeightPair> blendingInfo;
+        uint32_t                      count;
+        DirectX::SimpleMath::Vector3* positions;
+        BlendingIndexWeightPair*      blending;       // MaxInfluences per control point. Unused slots are zero.
+        uint8_t*                      blendingCounts; // Influences stored per control point.
+    };
 
-        CtrlPoint()
-        {
-            blendingInfo.reserve(4);
-        }
+    // Reverse lookup from control points to the polygon vertices that use them, also from the import arena.
+    // The vertices of control point i are vertices[first[i]] up to vertices[first[i + 1]].
+    struct ControlPointRemap
+    {
+        uint32_t* first;    // Control point count + 1 offsets into vertices.
+        uint32_t* vertices;
     };
 
     typedef std::vector<IndexWeightPair>::iterator tSkinnedVerticeIterator;
@@ -160,7 +233,7 @@ private:
         Microsoft::WRL::ComPtr<ID3D12Resource> skinnedVertexBuffer;
         Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
 
-        std::unordered_map<uint32_t, CtrlPoint*> controlPoints;
+        ControlPoints controlPoints;
         std::string materialName;
         std::string meshName;
 
@@ -208,28 +281,11 @@ private:
         uint32_t number;
     };
 
-    // This stores the information of each key frame of each joint
-    // This is a linked list and each node is a snapshot of the
-    // global transformation of the joint at a certain frame
-    struct Keyframe
-    {
-        FbxLongLong frameNum;
-        FbxAMatrix  globalTransform;
-        Keyframe*   next;
-
-        Keyframe() :
-            next(nullptr) {}
-    };
-
     struct Bone
     {
         std::string name;
 
-        // calculates the locals together depth first
-        // equals localTransform * parentMatrix
-        DirectX::SimpleMath::Matrix combinedTransform;
-
-        // updated for animation
+        // Local transform at time 0. Animated transforms are sampled into m_pose.
         DirectX::SimpleMath::Matrix nodeLocalTransform;
 
         // This is an inverse of the parent to child matrix,
@@ -237,9 +293,6 @@ private:
         // It's set at mesh load time and doesn't change.
         DirectX::SimpleMath::Matrix offset;
 
-        // Ready for a skinned mesh shader as the bone matrice.
-        // equals offset * combinedTransform
-        DirectX::SimpleMath::Matrix boneMatrice;
         FbxNode*     boneNodePtr;
         FbxSkeleton* fbxSkeletonPtr;
         FbxCluster*  fbxClusterPtr;
@@ -264,19 +317,56 @@ private:
     DirectX::SimpleMath::Matrix  m_world;
 
     std::unique_ptr<DirectX::XMFLOAT3X4[]> m_bonePalette3X4; // final bone matrix for shader consumption
+    std::unique_ptr<BoneDualQuaternion[]>  m_boneDualQuaternions; // Dual quaternion palette, used instead in that mode.
+    SkinningMode                           m_skinningMode;
     //DirectX::XMFLOAT3X4* mBonePalette3X4;
 
-    // Used to do a reverse lookup.
-    typedef std::vector<uint32_t> tControlPointIndexes;
-    typedef std::vector<tControlPointIndexes> tControlPointRemap;
-
     std::vector<Bone>            m_boneVector;
     std::vector<Mesh>            m_meshes;
 
-    std::vector<DirectX::SimpleMath::Matrix> m_bonePalette; // final bone matrix
 
     size_t                       m_initialAnimDuration_ms;
 
+    float                        m_weldEpsilon;
+    float                        m_animationSampleRate;
+    MeshRetention                m_meshRetention;
+    VertexFormat                 m_vertexFormat;
+
+    // Keyframes for every bone, baked from the FBX scene at load time, so playback doesn't call the FBX SDK.
+    AnimationClip                m_animationClip;
+    std::vector<BoneTransform>   m_pose; // Sampled local transforms, one per bone.
+
+    // Played instead of m_animationClip once CompressAnimation has been called.
+    CompressedAnimationClip      m_compressedClip;
+    AnimationDecoder             m_animationDecoder;
+
+    // Bone hierarchy and offsets shared with every AnimationInstance of this model.
+    // The per-frame palette is evaluated from these flat arrays rather than m_boneVector.
+    Skeleton                     m_skeleton;
+    std::vector<DirectX::XMMATRIX> m_combined; // Scratch model space transforms, sized once at load.
+
+    // Poses AdvanceTimeLod blends between, in the current skinning mode. Sized on first use.
+    std::vector<DirectX::XMFLOAT3X4>  m_lodPreviousPalette3X4;
+    std::vector<DirectX::XMFLOAT3X4>  m_lodNextPalette3X4;
+    std::vector<BoneDualQuaternion>   m_lodPreviousDualQuaternions;
+    std::vector<BoneDualQuaternion>   m_lodNextDualQuaternions;
+    float                        m_lodNextTime;
+    uint32_t                     m_lodFramesUntilUpdate;
+    bool                         m_hasLodNextPalette;
+
+    // Per-bone bind pose boxes for each mesh, fitted at load from the skin weights.
+    std::vector<SkinnedBounds>   m_skinnedBounds;
+
+    // Meshlets of each mesh, built from the bind pose vertices.
+    std::vector<Meshlets>        m_meshlets;
+
+    // Control point tables are allocated from an arena that only lives while LoadFBXScene runs.
+    MonotonicArena*              m_importArena;
+    ImportStatistics             m_importStatistics;
+
+    // Vertex cache cost of the meshes as welded and as optimized, measured while importing an FBX file.
+    MeshOptimizer::MeshStatistics m_meshStatistics;
+
 private:
 
     // To read a file using an FBX SDK reader.
@@ -288,6 +378,10 @@ private:
     // to build a scene from an FBX file
     bool LoadFBXScene(const char* pFbxFilePath);
 
+    // Maps a cooked model file and uploads its buffers straight from the mapping. Returns false if the file is
+    // missing, truncated or was cooked with another format version.
+    bool LoadCookedModel(const char* pCookedFilePath);
+
     // to destroy an instance of the SDK manager
     void DestroySdkObjects(FbxManager* pSdkManager);
 
@@ -313,11 +407,14 @@ private:
 
     size_t GetAnimationDuration();
 
-    int FindVertex(const std::vector<Vertex>& finalVertices, const Vertex& v);
+    //int FindVertex(const std::vector<Vertex>& finalVertices, const Vertex& v);
     //uint16_t FindVertex(const std::vector<Vertex>& finalVertices, const Vertex& v);
     void AddBoneInfluence(std::vector<IndexWeightPair>& skinnedVerticeVector, int vertexIndex, int boneIndex, float boneWeight);
     //VOID AddBoneInfluence(tSkinnedVerticeVector& skinnedVerticeVector, UINT vertexIndex, UINT boneIndex, FLOAT boneWeight);
-    void BuildMatrices(const FbxTime& frameTime);
+    void BakeAnimation();
+    void BuildSkeleton();
+    void BuildMatrices(float time, const uint32_t* boneRemap = nullptr);
+    void BlendLodPalettes(float t);
     void CopyBoneWeightsToVertex(Mesh& mesh);
     void CopyBoneWeightsToVertex(FbxMesh* pMesh, Mesh& mesh);
     void DedupeVertices(Mesh& mesh);
@@ -326,9 +423,9 @@ private:
     //VOID GetGeometryTransformMatrix(FbxNode* pNode, DirectX::SimpleMath::Matrix& offsetMatrix);
     void GetNodeLocalTransform(FbxNode* pNode, DirectX::SimpleMath::Matrix& matrix);
     void GetNodeLocalTransform(FbxNode* pNode, const FbxTime& fbxTime, DirectX::SimpleMath::Matrix& matrix);
-    void LoadControlPointRemap(FbxMesh* pMesh, tControlPointRemap& controlPointRemap);
+    void LoadControlPointRemap(FbxMesh* pMesh, ControlPointRemap& controlPointRemap);
     void LoadControlPoints(FbxMesh* pMesh, Mesh& mesh);
-    void LoadNodeLocalTransformMatrices(const FbxTime& frameTime);
+    void LoadNodeLocalTransformMatrices(float time);
     void LoadNormalTexTangent(FbxMesh* pMesh, Mesh& mesh);
     void LoadBone(FbxNode* pNode, int parentBoneIndex);
     void LoadBones(FbxNode* pNode, int parentBoneIndex);
@@ -337,15 +434,29 @@ private:
     void LoadMeshBoneWeightsIndices(FbxMesh* pMesh, Mesh& mesh);
     //VOID LoadMeshBoneWeightsIndices(FbxNode* pNode, Mesh& mesh);
     void NormalizeBoneWeights(Mesh& mesh);
+
+    // Reorders the welded triangles for the vertex cache and overdraw, then renumbers the vertices in order of use.
+    void OptimizeMesh(Mesh& mesh);
+
     void ReadNormal(FbxMesh* pMesh, int cpIndex, int vCounter, DirectX::SimpleMath::Vector3& n);
     void ReadTexCoord(FbxMesh* pMesh, int cpIndex, int uvIndex, DirectX::SimpleMath::Vector2& t);
     void ReadTangent(FbxMesh* pMesh, int cpIndex, int vCounter, DirectX::SimpleMath::Vector3& u);
 
-    void CalculateCombinedTransforms();
-    void CalculatePaletteMatrices();
-    void CreateMeshBoundingBoxes();
-    void CreateMeshBoundingSpheres();
+    // Bounds each mesh in its current pose from its per-bone boxes, after the palette has been evaluated.
+    void UpdateMeshBounds();
     void UploadMeshes(); // populate DirectX vertex buffer & index buffer resources
+
+    // Builds the meshlets of each mesh from its optimized triangle order. Called before ApplyMeshRetention.
+    void BuildMeshlets();
+
+    // Frees the CPU mesh copies m_meshRetention doesn't keep. Called once the buffers are uploaded and the skinned
+    // bounds have been fitted from the vertices.
+    void ApplyMeshRetention();
+
+    // Creates the buffers and views of a mesh, whose vertex and index counts are set, from data in any memory.
+    // indices are 16 bit if the vertex count allows, as the mesh's index format is chosen from it.
+    void CreateMeshBuffers(DirectX::ResourceUploadBatch& resourceUpload, Mesh& mesh,
+                           const Vertex* vertices, const SkinnedVertex* skinnedVertices, const void* indices);
     //void CreateBufferResources(Mesh& mesh);
 
 public:
@@ -393,7 +504,12 @@ public:
         return mesh.numVertices;
     }
 
-    const auto GetVertexStride() const noexcept                     { return static_cast<uint32_t>(sizeof(Vertex)); }
+    // Stride of the vertex buffer, which depends on the vertex format.
+    const auto GetVertexStride() const noexcept
+    {
+        return static_cast<uint32_t>(m_vertexFormat == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex));
+    }
+    const auto GetVertexFormat() const noexcept                     { return m_vertexFormat; }
     const auto GetSkinnedVertexStride() const noexcept              { return static_cast<uint32_t>(sizeof(SkinnedVertex)); }
 
     //const auto  GetVertexBuffer(Mesh& mesh) const noexcept        { return mesh.vertexBuffer.Get(); }
@@ -408,6 +524,8 @@ public:
     //CONST auto& GetVBMemory(UINT index) CONST noexcept { return mMeshes[index].mSharedResourceVB; }
     //CONST auto& GetIBMemory(UINT index) CONST noexcept { return mMeshes[index].mSharedResourceIB; }
 
+    // Model space bounds of a mesh as skinned with the current palette. They move with the animation,
+    // but are only valid once AdvanceTime has been called.
     const auto GetBoundingBox(size_t pos) const noexcept
     {
         auto& mesh = m_meshes.at(pos);
@@ -422,6 +540,9 @@ public:
         //return mMeshes[index].mBoundingSphere;
     }
     //const auto GetBoundingBox(Mesh& mesh) const noexcept           { return mesh.boundingBox; }
+
+    // Per-bone bind pose boxes of a mesh, shared with AnimationInstances to bound them from their own palette.
+    const auto& GetSkinnedBounds(size_t pos) const noexcept         { return m_skinnedBounds.at(pos); }
     //const auto GetBoundingSphere(Mesh& mesh) const noexcept        { return mesh.boundingSphere; }
 
     const auto  GetPosition() const noexcept                        { return m_position; }
@@ -429,8 +550,55 @@ public:
     const auto  GetWorld() const noexcept                           { return m_world; }
 
     const auto  GetAnimDuration() const noexcept                    { return m_initialAnimDuration_ms; } // Debugging.
-
-    void AdvanceTime(float time);
+    const auto& GetAnimationClip() const noexcept                   { return m_animationClip; }
+    const auto& GetCompressedAnimationClip() const noexcept         { return m_compressedClip; }
+
+    // Offline cook step. Writes the welded vertices, indices, skeleton and baked clip to a cooked model file, which the
+    // constructor then loads without the FBX SDK. Must be called before CompressAnimation, as the baked keys are saved,
+    // on a model loaded with MeshRetention::All.
+    void SaveCooked(const char* pCookedFilePath) const;
+
+    // True if the cooked model at pCookedFilePath can be loaded in place of the FBX file at pFbxFilePath. It must be at
+    // least as new, and have been cooked with the current format version and the struct layouts of this build.
+    static bool IsCookedFileCurrent(const char* pCookedFilePath, const char* pFbxFilePath);
+
+    // Replaces the baked clip with a compressed copy, which playback then decodes from.
+    void CompressAnimation(AnimationCompressionSettings const& settings = CompressedAnimationClip::DefaultSettings);
+
+    // Shared data for drawing many animated copies of this model. Each instance keeps its own time and bone palette,
+    // and plays the compressed clip, so CompressAnimation must have been called.
+    const auto& GetSkeleton() const noexcept                        { return m_skeleton; }
+    AnimationInstance CreateAnimationInstance() const;
+
+    // boneRemap, from Skeleton::BuildLodRemap, evaluates a subset of the bones for a lower level of detail.
+    void AdvanceTime(float time, const uint32_t* boneRemap = nullptr);
+
+    // As AdvanceTime, for a level of detail that poses the model every updateInterval frames, like
+    // AnimationInstance::EvaluateLod. In between the palette holds, or with interpolate blends towards the pose
+    // sampled updateInterval frames of frameTime ahead. Returns whether the palette changed, so needs skinning.
+    bool AdvanceTimeLod(float time, uint32_t updateInterval, bool interpolate, const uint32_t* boneRemap, float frameTime);
+    // Poses the model on the next AdvanceTimeLod call, and drops the pose sampled ahead. Call when the level changes.
+    void ResetLod() noexcept                                        { m_lodFramesUntilUpdate = 0; m_hasLodNextPalette = false; }
+
+    // Skins the vertices of one mesh on the CPU with the current bone palette, matching the skinning compute shader
+    // of the current skinning mode.
+    // output must hold GetVertexCount(meshPos) vertices. Useful for CPU collision and bounds of the animated mesh.
+    // Needs a model loaded with MeshRetention::Collision or All.
+    void SkinVertices(size_t meshPos, SkinnedVertex* output) const;
+
+    const auto GetMeshCount() const noexcept                        { return m_meshes.size(); }
+    const auto& GetImportStatistics() const noexcept                { return m_importStatistics; }
+    const auto& GetMeshStatistics() const noexcept                  { return m_meshStatistics; }
+    const auto GetMeshRetention() const noexcept                    { return m_meshRetention; }
+    MemoryFootprint GetMemoryFootprint() const;
+
+    // Welded vertices and their 32 bit indices, or nullptr if the MeshRetention policy released them.
+    const auto GetVertices(size_t pos) const noexcept               { return m_meshes.at(pos).finalVertices.data(); }
+    const auto GetIndices(size_t pos) const noexcept                { return m_meshes.at(pos).finalIndices32.data(); }
+
+    // Meshlets of a mesh, in model space. Their bounds are fitted to the bind pose, so they only hold for poses
+    // that stay close to it.
+    const Meshlets& GetMeshlets(size_t pos) const noexcept          { return m_meshlets.at(pos); }
     //void CreateBufferResources(ID3D12Device* device, Mesh& mesh);
     //VOID CreateBufferResources(ID3D12Device* device, UINT index);
 
@@ -471,9 +639,27 @@ public:
     //}
     //CONST std::vector<DirectX::SimpleMath::Matrix>& GetMatrixPalette() { return mBonePalette; }
 
-    const auto GetBonePaletteSize() const { return static_cast<uint32_t>(m_bonePalette.size() * sizeof(DirectX::XMFLOAT3X4)); }
+    const auto GetBonePaletteSize() const { return static_cast<uint32_t>(m_skeleton.GetBoneCount() * sizeof(DirectX::XMFLOAT3X4)); }
     const auto GetBonePalette3X4()  const { return m_bonePalette3X4.get(); }
 
+    const auto GetDualQuaternionPaletteSize() const { return static_cast<uint32_t>(m_skeleton.GetBoneCount() * sizeof(BoneDualQuaternion)); }
+    const auto GetBoneDualQuaternions()       const { return m_boneDualQuaternions.get(); }
+
+    // Selects the palette AdvanceTime evaluates and the kernel SkinVertices runs. The other palette is not updated.
+    void SetSkinningMode(SkinningMode mode) noexcept                { m_skinningMode = mode; ResetLod(); }
+    const auto GetSkinningMode() const noexcept                     { return m_skinningMode; }
+
+    // The palette of the current skinning mode, ready to copy into the skinning shader's bone constant buffer.
+    const void* GetSkinningPalette() const noexcept
+    {
+        return m_skinningMode == SkinningMode::DualQuaternion ? static_cast<const void*>(m_boneDualQuaternions.get()) :
+                                                                static_cast<const void*>(m_bonePalette3X4.get());
+    }
+    const auto GetSkinningPaletteSize() const noexcept
+    {
+        return m_skinningMode == SkinningMode::DualQuaternion ? GetDualQuaternionPaletteSize() : GetBonePaletteSize();
+    }
+
     void Draw(ID3D12GraphicsCommandList* commandList);
     void DrawSkinned(ID3D12GraphicsCommandList* commandList);
 
@@ -7,6 +7,12 @@
 #include "DirectXRaytracingHelper.h"
 #include "RaytracingHlslCompat.h"
 #include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+#include "BroadPhase.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
 #include "AnimationStructs.h"
 #include "NameSpacedEnums.h"
 #include "DeviceResources.h"
@@ -16,7 +22,16 @@
 #include "SDKMESHModel.h"
 //#include "RaytracedAO.h"
 #include "StepTimer.h"
+#include "RacingLine.h"
+#include "Simulation.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
+#include "AnimationLodManager.h"
 #include "FBXModel.h"
+#include "CookedModel.h"
 #include "Camera.h"
 
 #include "SceneMain.h"
@@ -200,6 +215,8 @@ private:
     // FBX models
     std::unique_ptr<FBXModel> m_FBXModel[FBXModels::Count];
     //std::unique_ptr<FBXModel> m_dove;
+    FBXModel::SkinningMode    m_skinningMode;           // Skinning mode the FBX models are loaded with.
+    FBXModel::VertexFormat    m_skinnedVertexFormat;    // Vertex format of the FBX models, which selects the skinning shaders.
 
     // Geometric primitives
     std::unique_ptr<DirectX::GeometricPrimitive> m_geospherePrimitive;  // Viewed from inside.
@@ -442,6 +459,16 @@ public:
     void TestGroundCollision(SDKMESHModel* groundModel, const BoundingSphere& sphere, CollisionTriangle& triangle);
     void TestGroundCollision(SDKMESHModel* groundModel, const BoundingBox& box, CollisionTriangle& triangle);
 
+    // Batched versions for many cars at once, with triangles[i] receiving the result for query i.
+    void TestGroundCollision(SDKMESHModel* groundModel, const BoundingSphere* spheres, size_t count, CollisionTriangle* triangles);
+    void TestGroundCollision(SDKMESHModel* groundModel, const BoundingBox* boxes, size_t count, CollisionTriangle* triangles);
+    void TestGroundCollision(SDKMESHModel* groundModel, const CollisionRay* rays, size_t count, float maxDistance, CollisionTriangle* triangles);
+
+    // Swept versions for volumes moving by displacement over the frame, so fast movement can't pass through the ground.
+    // time receives the fraction of displacement travelled before contact.
+    void SweepGroundCollision(SDKMESHModel* groundModel, const BoundingSphere& sphere, const Vector3& displacement, CollisionTriangle& triangle, float& time);
+    void SweepGroundCollision(SDKMESHModel* groundModel, const BoundingBox& box, const Vector3& displacement, CollisionTriangle& triangle, float& time);
+
     // Public getters.
     const auto GetDeviceResources() const noexcept { return m_deviceResources.get(); }
     const auto GetTimer() const noexcept { return m_timer.get(); }
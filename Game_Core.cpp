@@ -24,6 +24,19 @@
 #include "Shaders/ComputeShaderShadowBlurHorz.hlsl.h"
 #include "Shaders/ComputeShaderShadowBlurVert.hlsl.h"
 #include "Shaders/ComputeShaderSkinning.hlsl.h"
+// Compiled outside the project, like every shader here, with their dxc lines in "DXC shader command line compilation.txt".
+#if !__has_include("Shaders/ComputeShaderSkinningDQ.hlsl.h")
+#error Shaders/ComputeShaderSkinningDQ.hlsl.h is missing. Compile ComputeShaderSkinningDQ.hlsl with its line in "DXC shader command line compilation.txt".
+#endif
+#include "Shaders/ComputeShaderSkinningDQ.hlsl.h"
+#if !__has_include("Shaders/ComputeShaderSkinningCompact.hlsl.h")
+#error Shaders/ComputeShaderSkinningCompact.hlsl.h is missing. Compile ComputeShaderSkinningCompact.hlsl with its line in "DXC shader command line compilation.txt".
+#endif
+#include "Shaders/ComputeShaderSkinningCompact.hlsl.h"
+#if !__has_include("Shaders/ComputeShaderSkinningDQCompact.hlsl.h")
+#error Shaders/ComputeShaderSkinningDQCompact.hlsl.h is missing. Compile ComputeShaderSkinningDQCompact.hlsl with its line in "DXC shader command line compilation.txt".
+#endif
+#include "Shaders/ComputeShaderSkinningDQCompact.hlsl.h"
 #include "Shaders/PixelShaderCubes.hlsl.h"
 #include "Shaders/PixelShaderEnvironmentMap.hlsl.h"
 #include "Shaders/PixelShaderFxaa.hlsl.h"
@@ -75,6 +88,11 @@ Game::Game() noexcept(false) //: m_isRaster(true)
     //m_planeConstants          = std::make_unique<ObjectConstants>();
     m_blurConstants             = std::make_unique<BlurConstants>();
 
+    // Both skinning PSOs are built, so this only picks the one the skinned models start with.
+    m_skinningMode              = FBXModel::SkinningMode::DualQuaternion;
+    // Compact halves the vertex buffer the skinning shaders read.
+    m_skinnedVertexFormat       = FBXModel::VertexFormat::Compact;
+
     m_procGeometry              = std::make_unique<ProcGeometryBuffersAndViews[]>(ProcGeometries::Count);
     //m_cubeBuffers             = std::make_unique<GeometryBuffers>();
     //m_planeBuffers            = std::make_unique<GeometryBuffers>();
@@ -583,7 +601,14 @@ void Game::CreateDeviceDependentResources()
         const auto computePostProcess    = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderFinalPostProcess), ARRAYSIZE(g_ComputeShaderFinalPostProcess));
         const auto computeShadowBlurHorz = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderShadowBlurHorz), ARRAYSIZE(g_ComputeShaderShadowBlurHorz));
         const auto computeShadowBlurVert = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderShadowBlurVert), ARRAYSIZE(g_ComputeShaderShadowBlurVert));
-        const auto computeSkinning       = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderSkinning), ARRAYSIZE(g_ComputeShaderSkinning));
+        // The skinning shaders must read the vertex format the skinned models are loaded with.
+        const auto isCompactSkinning     = m_skinnedVertexFormat == FBXModel::VertexFormat::Compact;
+        const auto computeSkinning       = isCompactSkinning
+            ? CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderSkinningCompact), ARRAYSIZE(g_ComputeShaderSkinningCompact))
+            : CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderSkinning), ARRAYSIZE(g_ComputeShaderSkinning));
+        const auto computeSkinningDQ     = isCompactSkinning
+            ? CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderSkinningDQCompact), ARRAYSIZE(g_ComputeShaderSkinningDQCompact))
+            : CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_ComputeShaderSkinningDQ), ARRAYSIZE(g_ComputeShaderSkinningDQ));
         const auto pixelShaderCubes      = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_PixelShaderCubes), ARRAYSIZE(g_PixelShaderCubes));
         const auto pixelShaderEnvMap     = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_PixelShaderEnvironmentMap), ARRAYSIZE(g_PixelShaderEnvironmentMap));
         const auto pixelShaderFxaa       = CD3DX12_SHADER_BYTECODE(reinterpret_cast<const void*>(g_PixelShaderFxaa), ARRAYSIZE(g_PixelShaderFxaa));
@@ -619,6 +644,17 @@ void Game::CreateDeviceDependentResources()
         const D3D12_INPUT_LAYOUT_DESC inputLayoutTangent = { inputElementDescTangent, ARRAYSIZE(inputElementDescTangent) };
         //const D3D12_INPUT_LAYOUT_DESC inputLayoutTangent = { inputElementDescTangent, static_cast<uint32_t>(std::size(inputElementDescTangent)) };
 
+        // FBXModel::CompactVertex. Normals and tangents are octahedral encoded, so the shader decodes their two
+        // components with DecodeOctahedral in VertexCompression.hlsli.
+        const D3D12_INPUT_ELEMENT_DESC inputElementDescSkinnedCompact[] =
+        {
+            { "SV_POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "NORMAL",      0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD",    0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT",     0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "BONEWEIGHT",  0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "BONEINDEX",   0, DXGI_FORMAT_R8G8B8A8_UINT,      0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
         const D3D12_INPUT_ELEMENT_DESC inputElementDescSkinned[] =
         {
             { "SV_POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -630,7 +666,9 @@ void Game::CreateDeviceDependentResources()
             // DXGI_FORMAT_R8G8B8A8_UINT unpacks to HLSL uint4.
             { "BONEINDEX",   0, DXGI_FORMAT_R8G8B8A8_UINT,      0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         };
-        const D3D12_INPUT_LAYOUT_DESC inputLayoutSkinned = { inputElementDescSkinned, ARRAYSIZE(inputElementDescSkinned) };
+        const D3D12_INPUT_LAYOUT_DESC inputLayoutSkinned = isCompactSkinning
+            ? D3D12_INPUT_LAYOUT_DESC{ inputElementDescSkinnedCompact, ARRAYSIZE(inputElementDescSkinnedCompact) }
+            : D3D12_INPUT_LAYOUT_DESC{ inputElementDescSkinned, ARRAYSIZE(inputElementDescSkinned) };
         //const D3D12_INPUT_LAYOUT_DESC inputLayoutSkinned = { inputElementDescSkinned, static_cast<uint32_t>(std::size(inputElementDescSkinned)) };
 
         // Create graphics pipeline state objects (PSOs), utilizing multithreading.
@@ -783,6 +821,13 @@ void Game::CreateDeviceDependentResources()
         computePsoThreads.push_back(std::thread(CreateComputePipelineStateOnWorkerThread, device, &psoComputeSkinDesc, &m_pipelineState[PSOs::Skinning]));
         //ThrowIfFailed(device->CreateComputePipelineState(&psoComputeSkinDesc, IID_PPV_ARGS(&m_pipelineState[PSOs::Skinning])));
 
+        // Dual quaternion vertex skinning compute PSO.
+        D3D12_COMPUTE_PIPELINE_STATE_DESC psoComputeSkinDQDesc = {};
+        psoComputeSkinDQDesc.pRootSignature = m_rootSig[RootSignatures::Compute].Get();
+        psoComputeSkinDQDesc.CS = computeSkinningDQ;
+        psoComputeSkinDQDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+        computePsoThreads.push_back(std::thread(CreateComputePipelineStateOnWorkerThread, device, &psoComputeSkinDQDesc, &m_pipelineState[PSOs::SkinningDualQuaternion]));
+
         // Postprocess compute PSO.
         D3D12_COMPUTE_PIPELINE_STATE_DESC psoPostProcessDesc = {};
         psoPostProcessDesc.pRootSignature = m_rootSig[RootSignatures::Compute].Get();
@@ -1229,9 +1274,33 @@ void Game::CreateGeometryAndMaterialResources(ID3D12Device* device)
         {
             _model = std::make_unique<SDKMESHModel>(device, commandQueue, _renderingFile, _collisionFile);
         };
+    // A cooked copy of the FBX file, made with Win32GameDR.exe -cook, loads much faster and skips the FBX SDK.
+    // It is only used while it is newer than the FBX file and matches the current cooked format, and the FBX file is
+    // imported instead if the cooked copy still fails to load.
     auto LoadSkinnedModel = [&](std::unique_ptr<FBXModel>& _model, const char* _renderingFile)
         {
-            _model = std::make_unique<FBXModel>(device, commandQueue, _renderingFile);
+            const auto cookedFile = CookedModel::GetCookedPath(_renderingFile);
+            _model.reset();
+
+            // The game only draws skinned models from their GPU buffers, so no CPU copies of the meshes are kept.
+            if (FBXModel::IsCookedFileCurrent(cookedFile.c_str(), _renderingFile))
+            {
+                try
+                {
+                    _model = std::make_unique<FBXModel>(device, commandQueue, cookedFile.c_str(),
+                                                        0.0f, 30.0f, FBXModel::MeshRetention::None, m_skinnedVertexFormat);
+                }
+                catch (const std::exception&)
+                {
+                    OutputDebugStringA("Cooked model failed to load, importing the FBX file instead.\n");
+                }
+            }
+
+            if (!_model)
+                _model = std::make_unique<FBXModel>(device, commandQueue, _renderingFile,
+                                                    0.0f, 30.0f, FBXModel::MeshRetention::None, m_skinnedVertexFormat);
+            _model->CompressAnimation();
+            _model->SetSkinningMode(m_skinningMode);
         };
 
     // Loading models with multithreading requires passing smart pointer with std::ref.
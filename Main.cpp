@@ -4,6 +4,8 @@
 
 #include "pch.h"
 #include "Game.h"
+#include "Benchmarks.h"
+#include "ModelCooker.h"
 
 #define USING_D3D12_AGILITY_SDK
 
@@ -39,7 +41,6 @@ void ExitGame() noexcept;
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
     UNREFERENCED_PARAMETER(nCmdShow); // added this
 
     if (!XMVerifyCPUSupport())
@@ -54,6 +55,13 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         return 1;
 #endif
 
+    // Headless cook and benchmark runs don't create a window.
+    if (ModelCooker::IsRequested(lpCmdLine))
+        return ModelCooker::Run(lpCmdLine);
+
+    if (Benchmarks::IsRequested(lpCmdLine))
+        return Benchmarks::Run(lpCmdLine);
+
     g_game = std::make_unique<Game>();
 
     // Register class and create window
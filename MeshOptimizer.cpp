@@ -0,0 +1,389 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    constexpr uint32_t NoVertex = UINT32_MAX;
+
+    // FIFO cache simulated with one timestamp per entry. An entry is cached while fewer than size newer entries
+    // have been added since its own, so a miss costs one store and flushing the whole cache costs nothing.
+    class FifoCache
+    {
+    public:
+
+        FifoCache(size_t entryCount, uint32_t size) : m_time(size + 1), m_size(size), m_timestamps(entryCount, 0) {}
+
+        // Returns true, and adds the entry, if it wasn't cached.
+        bool Miss(size_t entry) noexcept
+        {
+            if (m_time - m_timestamps[entry] <= m_size)
+                return false;
+
+            m_timestamps[entry] = m_time++;
+            return true;
+        }
+
+        bool IsCached(size_t entry) const noexcept      { return m_time - m_timestamps[entry] <= m_size; }
+        uint32_t GetAge(size_t entry) const noexcept    { return m_time - m_timestamps[entry]; }
+
+        void Flush() noexcept                           { m_time += m_size + 1; }
+
+    private:
+
+        uint32_t              m_time;
+        uint32_t              m_size;
+        std::vector<uint32_t> m_timestamps;
+    };
+
+    Vector3 GetPosition(const DirectX::XMFLOAT3* positions, size_t positionStride, uint32_t vertex) noexcept
+    {
+        return *reinterpret_cast<const DirectX::XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+    }
+}
+
+MeshOptimizer::VertexCacheStatistics& MeshOptimizer::VertexCacheStatistics::operator+= (VertexCacheStatistics const& other) noexcept
+{
+    triangleCount += other.triangleCount;
+    vertexCount   += other.vertexCount;
+    cacheMisses   += other.cacheMisses;
+    vertexBytes   += other.vertexBytes;
+    fetchedBytes  += other.fetchedBytes;
+    return *this;
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::Analyze(
+    const uint32_t* indices,
+    size_t indexCount,
+    size_t vertexCount,
+    size_t vertexStride)
+{
+    VertexCacheStatistics statistics = {};
+    statistics.triangleCount = indexCount / 3;
+
+    FifoCache vertexCache(vertexCount, CacheSize);
+    FifoCache fetchCache((vertexCount * vertexStride + FetchLineSize - 1) / FetchLineSize, FetchLines);
+    std::vector<uint8_t> isReferenced(vertexCount, 0);
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const auto vertex = indices[i];
+        assert(vertex < vertexCount);
+
+        statistics.vertexCount += isReferenced[vertex] ? 0 : 1;
+        isReferenced[vertex] = 1;
+
+        if (!vertexCache.Miss(vertex))
+            continue;
+
+        ++statistics.cacheMisses;
+
+        // A transformed vertex is read from every line it overlaps.
+        const auto firstLine = vertex * vertexStride / FetchLineSize;
+        const auto lastLine  = ((vertex + 1) * vertexStride - 1) / FetchLineSize;
+
+        for (auto line = firstLine; line <= lastLine; ++line)
+        {
+            statistics.fetchedBytes += fetchCache.Miss(line) ? FetchLineSize : 0;
+        }
+    }
+
+    statistics.vertexBytes = statistics.vertexCount * vertexStride;
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& clusters)
+{
+    assert(indexCount % 3 == 0);
+    clusters.clear();
+
+    const auto triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles around each vertex, stored as one array in vertex order. The triangles of vertex v are
+    // adjacency[firstTriangle[v]] to adjacency[firstTriangle[v + 1] - 1].
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        assert(indices[i] < vertexCount);
+        ++firstTriangle[indices[i] + 1];
+    }
+    std::partial_sum(firstTriangle.begin(), firstTriangle.end(), firstTriangle.begin());
+
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> liveTriangles(vertexCount); // Triangles around each vertex not yet emitted.
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        liveTriangles[v] = firstTriangle[v + 1] - firstTriangle[v];
+    }
+
+    {
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint8_t>  isEmitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds;     // Vertices of emitted triangles, most recent last.
+    std::vector<uint32_t> candidates;   // Vertices of the triangles emitted by the current fan.
+    std::vector<uint32_t> output(indexCount);
+    size_t outputCount = 0;
+    size_t cursor = 0;                  // Vertices before the cursor have no live triangles.
+
+    deadEnds.reserve(indexCount);
+    FifoCache cache(vertexCount, CacheSize);
+
+    // With no candidate left, resume from the most recently used vertex that still has triangles, and failing
+    // that from the first such vertex in index order.
+    auto skipDeadEnd = [&]() noexcept
+    {
+        while (!deadEnds.empty())
+        {
+            const auto vertex = deadEnds.back();
+            deadEnds.pop_back();
+
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveTriangles[cursor] > 0)
+                return static_cast<uint32_t>(cursor);
+        }
+        return NoVertex;
+    };
+
+    auto fanVertex = skipDeadEnd();
+
+    while (fanVertex != NoVertex)
+    {
+        // A fan around a vertex that has left the cache starts from a cold cache.
+        if (!cache.IsCached(fanVertex))
+            clusters.push_back(static_cast<uint32_t>(outputCount));
+
+        candidates.clear();
+
+        for (auto a = firstTriangle[fanVertex]; a < firstTriangle[fanVertex + 1]; ++a)
+        {
+            const auto triangle = adjacency[a];
+            if (isEmitted[triangle])
+                continue;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const auto vertex = indices[triangle * 3 + k];
+
+                output[outputCount++] = vertex;
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                cache.Miss(vertex);
+            }
+            isEmitted[triangle] = 1;
+        }
+
+        // Fan next around the candidate that entered the cache earliest, among those that stay cached while
+        // their remaining triangles are emitted.
+        auto nextVertex = NoVertex;
+        uint32_t bestPriority = 0;
+
+        for (auto vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            const auto age = cache.GetAge(vertex);
+            const auto priority = age + 2 * liveTriangles[vertex] <= CacheSize ? age : 0;
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        fanVertex = nextVertex != NoVertex ? nextVertex : skipDeadEnd();
+    }
+
+    assert(outputCount == indexCount);
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(
+    uint32_t* indices,
+    size_t indexCount,
+    const DirectX::XMFLOAT3* positions,
+    size_t positionStride,
+    size_t vertexCount,
+    const std::vector<uint32_t>& clusters,
+    float threshold)
+{
+    const auto triangleCount = indexCount / 3;
+    if (triangleCount == 0 || clusters.size() < 2)
+        return;
+
+    FifoCache cache(vertexCount, CacheSize);
+
+    auto countMisses = [&](size_t triangle) noexcept
+    {
+        const auto* triangleIndices = indices + triangle * 3;
+        return (cache.Miss(triangleIndices[0]) ? 1u : 0u) +
+               (cache.Miss(triangleIndices[1]) ? 1u : 0u) +
+               (cache.Miss(triangleIndices[2]) ? 1u : 0u);
+    };
+
+    // Split each cluster wherever the triangles so far, starting from a cold cache, have a miss ratio within
+    // threshold of the whole cluster's. Each split flushes the cache, as the clusters are about to be reordered.
+    std::vector<size_t> splits; // First triangle of each cluster, then triangleCount.
+
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const size_t first = clusters[c] / 3;
+        const size_t last  = c + 1 < clusters.size() ? clusters[c + 1] / 3 : triangleCount;
+
+        cache.Flush();
+        size_t clusterMisses = 0;
+        for (auto t = first; t < last; ++t)
+        {
+            clusterMisses += countMisses(t);
+        }
+
+        const auto maxAcmr = threshold * static_cast<float>(clusterMisses) / static_cast<float>(last - first);
+
+        cache.Flush();
+        splits.push_back(first);
+
+        size_t start  = first;
+        size_t misses = 0;
+
+        for (auto t = first; t < last; ++t)
+        {
+            misses += countMisses(t);
+
+            if (t + 1 < last && static_cast<float>(misses) <= maxAcmr * static_cast<float>(t + 1 - start))
+            {
+                splits.push_back(t + 1);
+                start  = t + 1;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+    splits.push_back(triangleCount);
+
+    const auto clusterCount = splits.size() - 1;
+
+    // Area weighted centroid and normal of each cluster, and the area weighted centroid of the mesh.
+    // Front faces are clockwise, as the rasterizer states cull counter clockwise triangles, so the outward
+    // normal of a triangle is (p2 - p0) x (p1 - p0).
+    std::vector<Vector3> centroids(clusterCount);
+    std::vector<Vector3> normals(clusterCount);
+    Vector3 meshCentroid;
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        Vector3 centroid;
+        Vector3 normal;
+        float area = 0.0f;
+
+        for (auto t = splits[c]; t < splits[c + 1]; ++t)
+        {
+            const auto p0 = GetPosition(positions, positionStride, indices[t * 3]);
+            const auto p1 = GetPosition(positions, positionStride, indices[t * 3 + 1]);
+            const auto p2 = GetPosition(positions, positionStride, indices[t * 3 + 2]);
+
+            const auto cross = (p2 - p0).Cross(p1 - p0);
+            const auto triangleArea = cross.Length();
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal   += cross;
+            area     += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea     += area;
+
+        centroids[c] = area > 0.0f ? centroid / area : GetPosition(positions, positionStride, indices[splits[c] * 3]);
+        normals[c]   = normal;
+        normals[c].Normalize();
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the centre of the mesh are the least likely to be hidden by the others.
+    std::vector<float> facing(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        facing[c] = (centroids[c] - meshCentroid).Dot(normals[c]);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return facing[a] > facing[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indexCount);
+
+    for (auto c : order)
+    {
+        sorted.insert(sorted.end(), indices + splits[c] * 3, indices + splits[c + 1] * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t* remap)
+{
+    std::fill(remap, remap + vertexCount, NoVertex);
+    uint32_t nextVertex = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        auto& vertex = remap[indices[i]];
+        if (vertex == NoVertex)
+            vertex = nextVertex++;
+
+        indices[i] = vertex;
+    }
+
+    const size_t referencedCount = nextVertex;
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] == NoVertex)
+            remap[v] = nextVertex++;
+    }
+    return referencedCount;
+}
+
+void MeshOptimizer::OptimizeTriangleOrder(
+    uint32_t* indices,
+    size_t indexCount,
+    const DirectX::XMFLOAT3* positions,
+    size_t positionStride,
+    size_t vertexCount)
+{
+    std::vector<uint32_t> clusters;
+    OptimizeVertexCache(indices, indexCount, vertexCount, clusters);
+    OptimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount, clusters);
+}
+
+void MeshOptimizer::RemapVertices(void* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* remap)
+{
+    auto bytes = static_cast<uint8_t*>(vertices);
+    std::vector<uint8_t> remapped(vertexCount * vertexStride);
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        memcpy(remapped.data() + remap[i] * vertexStride, bytes + i * vertexStride, vertexStride);
+    }
+    memcpy(bytes, remapped.data(), remapped.size());
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Triangle and vertex reordering, run once on imported or cooked meshes so the GPU transforms, shades and fetches
+// less per triangle drawn. Three passes, run in this order:
+//
+//   OptimizeVertexCache   orders triangles for a post-transform vertex cache of CacheSize entries, by fanning
+//                         around the most recently used vertices (Tipsify, Sander, Nehab and Barczak 2007).
+//   OptimizeOverdraw      splits the cache ordered triangles into clusters and draws the outward facing clusters
+//                         first, so that fewer pixels are shaded and then overwritten.
+//   OptimizeVertexFetch   renumbers vertices in the order the indices first use them, so the vertex buffer is read
+//                         front to back.
+//
+// Indices are triangle lists, relative to the first vertex of the positions and vertex arrays passed in.
+
+namespace MeshOptimizer
+{
+    constexpr uint32_t CacheSize     = 16;  // Post-transform cache entries, a conservative size for current GPUs.
+    constexpr uint32_t FetchLineSize = 64;  // Bytes per vertex fetch cache line.
+    constexpr uint32_t FetchLines    = 64;  // Lines held by the vertex fetch cache.
+
+    // Cost of an index order, as Analyze simulates it with a FIFO cache of CacheSize vertices.
+    struct VertexCacheStatistics
+    {
+        size_t triangleCount;
+        size_t vertexCount;     // Distinct vertices referenced by the indices.
+        size_t cacheMisses;     // Vertices transformed.
+        size_t vertexBytes;     // Bytes of the referenced vertices.
+        size_t fetchedBytes;    // Vertex buffer bytes read through the fetch cache.
+
+        // Average cache miss ratio, vertices transformed per triangle. 3 is the worst case and about 0.5 the best.
+        float GetAcmr() const noexcept      { return triangleCount ? static_cast<float>(cacheMisses) / triangleCount : 0.0f; }
+
+        // Average transform to vertex ratio, vertices transformed per vertex. 1 is the best case.
+        float GetAtvr() const noexcept      { return vertexCount ? static_cast<float>(cacheMisses) / vertexCount : 0.0f; }
+
+        // Vertex buffer bytes read per byte of vertex data. 1 is the best case.
+        float GetOverfetch() const noexcept { return vertexBytes ? static_cast<float>(fetchedBytes) / vertexBytes : 0.0f; }
+
+        VertexCacheStatistics& operator+= (VertexCacheStatistics const& other) noexcept;
+    };
+
+    // The cost of a model's meshes as they were imported, and after the passes above.
+    struct MeshStatistics
+    {
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+    };
+
+    VertexCacheStatistics Analyze(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t vertexStride);
+
+    // Reorders the triangles of indices in place. clusters receives the first index of each run of triangles that
+    // starts with a cold cache, where OptimizeOverdraw can cut the order without adding cache misses.
+    void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& clusters);
+
+    // Reorders the clusters of cache ordered indices, outward facing first. Clusters are split further wherever the
+    // cache miss ratio so far is within threshold of the whole cluster's, so threshold trades cache misses for overdraw.
+    void OptimizeOverdraw(
+        uint32_t* indices,
+        size_t indexCount,
+        const DirectX::XMFLOAT3* positions,
+        size_t positionStride,
+        size_t vertexCount,
+        const std::vector<uint32_t>& clusters,
+        float threshold = 1.05f);
+
+    // Rewrites indices so vertices are numbered in order of first use, and fills remap[old vertex] = new vertex.
+    // Vertices no index refers to are numbered last, in their original order. Returns the number of referenced vertices.
+    size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t* remap);
+
+    // Runs OptimizeVertexCache and then OptimizeOverdraw.
+    void OptimizeTriangleOrder(
+        uint32_t* indices,
+        size_t indexCount,
+        const DirectX::XMFLOAT3* positions,
+        size_t positionStride,
+        size_t vertexCount);
+
+    // Moves each vertex to the slot remap gives it.
+    void RemapVertices(void* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* remap);
+
+    template<typename T>
+    void RemapVertices(std::vector<T>& vertices, const uint32_t* remap)
+    {
+        std::vector<T> remapped(vertices.size());
+
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            remapped[remap[i]] = vertices[i];
+        }
+        vertices.swap(remapped);
+    }
+}
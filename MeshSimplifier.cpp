@@ -0,0 +1,479 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    constexpr uint32_t NoVertex = UINT32_MAX;
+
+    // A border edge adds a plane through it, perpendicular to its triangle, weighted this much more per unit of
+    // squared length than a triangle's plane per unit of area, so that borders keep their outline.
+    constexpr double BorderWeight = 10.0;
+
+    // A collapse is rejected as a fold if it turns a triangle's normal by more than about 80 degrees.
+    constexpr float MinNormalDot = 0.2f;
+
+    // Sum of weighted squared distances to a set of planes, x^T A x + 2 b.x + c.
+    struct Quadric
+    {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+
+        // The plane of points x for which normal.x + d = 0, with a unit length normal.
+        static Quadric FromPlane(Vector3 const& normal, double d, double weight) noexcept
+        {
+            const double x = normal.x;
+            const double y = normal.y;
+            const double z = normal.z;
+
+            return { weight * x * x, weight * y * y, weight * z * z, weight * x * y, weight * x * z, weight * y * z,
+                     weight * d * x, weight * d * y, weight * d * z, weight * d * d, weight };
+        }
+
+        Quadric& operator+= (Quadric const& other) noexcept
+        {
+            a00 += other.a00; a11 += other.a11; a22 += other.a22;
+            a01 += other.a01; a02 += other.a02; a12 += other.a12;
+            b0  += other.b0;  b1  += other.b1;  b2  += other.b2;
+            c   += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Mean squared distance of point from the planes, weighted as they were added.
+        double GetError(Vector3 const& point) const noexcept
+        {
+            const double x = point.x;
+            const double y = point.y;
+            const double z = point.z;
+
+            const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                                 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+            return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+        }
+    };
+
+    // Triangle edge between two welded positions, with the lower position first in the key.
+    struct Edge
+    {
+        uint64_t key;
+        uint32_t triangle;
+    };
+
+    struct Collapse
+    {
+        double   error;
+        uint32_t from;
+        uint32_t to;
+    };
+
+    Vector3 GetPosition(const DirectX::XMFLOAT3* positions, size_t vertexStride, uint32_t vertex) noexcept
+    {
+        return *reinterpret_cast<const DirectX::XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * vertexStride);
+    }
+
+    // Welds the referenced vertices at each position, naming the weld after its first vertex.
+    // Unreferenced vertices are left on their own.
+    std::vector<uint32_t> WeldPositions(
+        const DirectX::XMFLOAT3* positions,
+        size_t vertexStride,
+        size_t vertexCount,
+        std::vector<uint8_t> const& isReferenced)
+    {
+        std::vector<uint32_t> welds(vertexCount);
+        std::vector<uint32_t> order;
+        order.reserve(vertexCount);
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            welds[v] = v;
+            if (isReferenced[v])
+                order.push_back(v);
+        }
+
+        auto key = [&](uint32_t v)
+        {
+            const auto position = GetPosition(positions, vertexStride, v);
+            return std::make_tuple(position.x, position.y, position.z, v);
+        };
+
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+
+        for (size_t i = 1; i < order.size(); ++i)
+        {
+            const auto previous = GetPosition(positions, vertexStride, order[i - 1]);
+            const auto position = GetPosition(positions, vertexStride, order[i]);
+
+            if (position == previous)
+                welds[order[i]] = welds[order[i - 1]];
+        }
+        return welds;
+    }
+
+    // Edges of every triangle, sorted so that the triangles sharing an edge are adjacent.
+    void CollectEdges(std::vector<uint32_t> const& triangles, std::vector<uint32_t> const& welds, std::vector<Edge>& edges)
+    {
+        edges.clear();
+
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const uint64_t a = welds[triangles[i + k]];
+                const uint64_t b = welds[triangles[i + (k + 1) % 3]];
+
+                edges.push_back({ a < b ? (a << 32) | b : (b << 32) | a, static_cast<uint32_t>(i / 3) });
+            }
+        }
+
+        std::sort(edges.begin(), edges.end(), [](Edge const& a, Edge const& b) { return a.key < b.key; });
+    }
+}
+
+size_t MeshSimplifier::Simplify(
+    uint32_t* destination,
+    const uint32_t* indices,
+    size_t indexCount,
+    const DirectX::XMFLOAT3* positions,
+    size_t vertexStride,
+    size_t vertexCount,
+    size_t targetIndexCount,
+    float maxError,
+    float* resultError)
+{
+    assert(indexCount % 3 == 0);
+
+    std::vector<uint8_t> isReferenced(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        assert(indices[i] < vertexCount);
+        isReferenced[indices[i]] = 1;
+    }
+
+    // From here on, vertex state is kept by weld, indexed by the weld's first vertex.
+    const auto welds = WeldPositions(positions, vertexStride, vertexCount, isReferenced);
+
+    auto getPosition = [&](uint32_t vertex) { return GetPosition(positions, vertexStride, vertex); };
+
+    // A weld whose vertices differ in another attribute can't be moved without tearing the seam.
+    std::vector<uint8_t> isSeam(vertexCount, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        if (isReferenced[v] && welds[v] != v &&
+            memcmp(reinterpret_cast<const uint8_t*>(positions) + v * vertexStride,
+                   reinterpret_cast<const uint8_t*>(positions) + welds[v] * vertexStride, vertexStride) != 0)
+        {
+            isSeam[welds[v]] = 1;
+        }
+    }
+
+    // Triangles with two corners at one position have no area, so they are dropped.
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount);
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const auto a = welds[indices[i]];
+        const auto b = welds[indices[i + 1]];
+        const auto c = welds[indices[i + 2]];
+
+        if (a != b && a != c && b != c)
+            triangles.insert(triangles.end(), indices + i, indices + i + 3);
+    }
+
+    std::vector<Edge> edges;
+    CollectEdges(triangles, welds, edges);
+
+    // Each weld starts with the planes of its triangles, and of the border edges through it.
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+
+    for (size_t i = 0; i < triangles.size(); i += 3)
+    {
+        const auto p0 = getPosition(triangles[i]);
+        const auto p1 = getPosition(triangles[i + 1]);
+        const auto p2 = getPosition(triangles[i + 2]);
+
+        auto normal = (p2 - p0).Cross(p1 - p0);
+        const auto length = normal.Length();
+
+        if (length == 0.0f)
+            continue;
+
+        normal /= length;
+        const auto quadric = Quadric::FromPlane(normal, -normal.Dot(p0), 0.5 * length);
+
+        for (size_t k = 0; k < 3; ++k)
+        {
+            quadrics[welds[triangles[i + k]]] += quadric;
+        }
+    }
+
+    for (size_t i = 0; i < edges.size(); )
+    {
+        auto j = i + 1;
+        while (j < edges.size() && edges[j].key == edges[i].key)
+            ++j;
+
+        if (j - i == 1)
+        {
+            const auto a = static_cast<uint32_t>(edges[i].key >> 32);
+            const auto b = static_cast<uint32_t>(edges[i].key);
+            const auto triangle = edges[i].triangle * 3;
+
+            const auto p0 = getPosition(triangles[triangle]);
+            const auto p1 = getPosition(triangles[triangle + 1]);
+            const auto p2 = getPosition(triangles[triangle + 2]);
+
+            const auto pa = getPosition(a);
+            const auto edge = getPosition(b) - pa;
+            auto normal = edge.Cross((p2 - p0).Cross(p1 - p0));
+            const auto length = normal.Length();
+
+            if (length > 0.0f)
+            {
+                normal /= length;
+                const auto quadric = Quadric::FromPlane(normal, -normal.Dot(pa), BorderWeight * edge.LengthSquared());
+
+                quadrics[a] += quadric;
+                quadrics[b] += quadric;
+            }
+        }
+        i = j;
+    }
+
+    const double maxSquaredError = static_cast<double>(maxError) * maxError;
+    double squaredError = 0.0;
+
+    std::vector<uint8_t>  isBorder(vertexCount);
+    std::vector<uint8_t>  isPinned(vertexCount);   // Seams, and edges shared by more than two triangles.
+    std::vector<uint8_t>  isLocked(vertexCount);   // Welds a collapse this pass has moved or depends on.
+    std::vector<uint32_t> collapseVertex(vertexCount, NoVertex);
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds the triangles.
+    while (triangles.size() > targetIndexCount)
+    {
+        CollectEdges(triangles, welds, edges);
+
+        std::copy(isSeam.begin(), isSeam.end(), isPinned.begin());
+        std::fill(isBorder.begin(), isBorder.end(), uint8_t(0));
+
+        for (size_t i = 0; i < edges.size(); )
+        {
+            auto j = i + 1;
+            while (j < edges.size() && edges[j].key == edges[i].key)
+                ++j;
+
+            const auto a = static_cast<uint32_t>(edges[i].key >> 32);
+            const auto b = static_cast<uint32_t>(edges[i].key);
+
+            if (j - i == 1)
+                isBorder[a] = isBorder[b] = 1;
+            else if (j - i > 2)
+                isPinned[a] = isPinned[b] = 1;
+
+            i = j;
+        }
+
+        // Triangles around each weld.
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+        for (auto vertex : triangles)
+        {
+            ++triangleOffsets[welds[vertex] + 1];
+        }
+        std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+        vertexTriangles.resize(triangles.size());
+        {
+            auto fill = triangleOffsets;
+            for (size_t i = 0; i < triangles.size(); ++i)
+            {
+                vertexTriangles[fill[welds[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // The cheaper direction of each edge that can collapse. A border weld may only slide along the border.
+        collapses.clear();
+
+        for (size_t i = 0; i < edges.size(); )
+        {
+            auto j = i + 1;
+            while (j < edges.size() && edges[j].key == edges[i].key)
+                ++j;
+
+            const auto a = static_cast<uint32_t>(edges[i].key >> 32);
+            const auto b = static_cast<uint32_t>(edges[i].key);
+            const bool isBorderEdge = j - i == 1;
+            i = j;
+
+            auto canMove = [&](uint32_t weld) { return !isPinned[weld] && (!isBorder[weld] || isBorderEdge); };
+
+            auto getError = [&](uint32_t from, uint32_t to)
+            {
+                auto quadric = quadrics[from];
+                quadric += quadrics[to];
+                return quadric.GetError(getPosition(to));
+            };
+
+            const double errorAB = canMove(a) ? getError(a, b) : DBL_MAX;
+            const double errorBA = canMove(b) ? getError(b, a) : DBL_MAX;
+
+            if (std::min(errorAB, errorBA) > maxSquaredError)
+                continue;
+
+            if (errorAB <= errorBA)
+                collapses.push_back({ errorAB, a, b });
+            else
+                collapses.push_back({ errorBA, b, a });
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](Collapse const& a, Collapse const& b) { return a.error < b.error; });
+
+        std::fill(isLocked.begin(), isLocked.end(), uint8_t(0));
+
+        const size_t excessTriangles = (triangles.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+
+        for (const auto& collapse : collapses)
+        {
+            if (removedTriangles >= excessTriangles)
+                break;
+
+            if (isLocked[collapse.from] || isLocked[collapse.to])
+                continue;
+
+            // The vertex of the destination on this side of any seam is the one in a triangle the edge removes.
+            const auto target = getPosition(collapse.to);
+            uint32_t vertex = NoVertex;
+            size_t removed = 0;
+            bool isFolded = false;
+
+            for (auto t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !isFolded; ++t)
+            {
+                const auto* corners = &triangles[vertexTriangles[t] * 3];
+
+                const auto k = std::find_if(corners, corners + 3, [&](uint32_t v) { return welds[v] == collapse.to; });
+                if (k != corners + 3)
+                {
+                    vertex = *k;
+                    ++removed;
+                    continue;
+                }
+
+                const Vector3 before[3] = { getPosition(corners[0]), getPosition(corners[1]), getPosition(corners[2]) };
+                Vector3 after[3] = { before[0], before[1], before[2] };
+
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    if (welds[corners[c]] == collapse.from)
+                        after[c] = target;
+                }
+
+                const auto normalBefore = (before[2] - before[0]).Cross(before[1] - before[0]);
+                const auto normalAfter  = (after[2] - after[0]).Cross(after[1] - after[0]);
+
+                isFolded = normalBefore.Dot(normalAfter) < MinNormalDot * normalBefore.Length() * normalAfter.Length();
+            }
+
+            if (isFolded || vertex == NoVertex)
+                continue;
+
+            collapseVertex[collapse.from] = vertex;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            squaredError = std::max(squaredError, collapse.error);
+            removedTriangles += removed;
+
+            // Neighbours of the moved weld are locked too, as its fold test assumed they stay where they are.
+            for (auto t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t)
+            {
+                const auto* corners = &triangles[vertexTriangles[t] * 3];
+
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    isLocked[welds[corners[c]]] = 1;
+                }
+            }
+        }
+
+        if (removedTriangles == 0)
+            break;
+
+        // Move the corners of collapsed welds, and drop the triangles that lost their area.
+        size_t count = 0;
+
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            uint32_t corners[3];
+
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const auto vertex = triangles[i + c];
+                const auto moved = collapseVertex[welds[vertex]];
+
+                corners[c] = moved == NoVertex ? vertex : moved;
+            }
+
+            if (welds[corners[0]] == welds[corners[1]] || welds[corners[0]] == welds[corners[2]] ||
+                welds[corners[1]] == welds[corners[2]])
+                continue;
+
+            std::copy_n(corners, 3, &triangles[count]);
+            count += 3;
+        }
+        triangles.resize(count);
+
+        std::fill(collapseVertex.begin(), collapseVertex.end(), NoVertex);
+    }
+
+    std::copy(triangles.begin(), triangles.end(), destination);
+
+    if (resultError)
+        *resultError = static_cast<float>(std::sqrt(squaredError));
+
+    return triangles.size();
+}
+
+void MeshSimplifier::BuildLodChain(
+    std::vector<uint32_t>& indices,
+    const DirectX::XMFLOAT3* positions,
+    size_t vertexStride,
+    size_t vertexCount,
+    std::vector<Lod>& lods)
+{
+    lods.clear();
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    std::vector<uint32_t> level(indices);
+    float error = 0.0f;
+
+    while (lods.size() < MaxLods)
+    {
+        const auto previousCount = level.size();
+        const auto targetCount = static_cast<size_t>(previousCount / 3 * LodReduction) * 3;
+
+        if (targetCount < MinLodTriangles * 3)
+            break;
+
+        float levelError;
+        const auto count = Simplify(level.data(), level.data(), previousCount, positions, vertexStride, vertexCount,
+            targetCount, FLT_MAX, &levelError);
+
+        if (count == 0 || count > previousCount * MinLodReduction)
+            break;
+
+        level.resize(count);
+        MeshOptimizer::OptimizeTriangleOrder(level.data(), count, positions, vertexStride, vertexCount);
+
+        // Each level is simplified from the one before, so the distances add up.
+        error += levelError;
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(count), error });
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
+}
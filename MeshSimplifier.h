@@ -0,0 +1,51 @@
+#pragma once
+
+// Quadric error edge collapse simplification (Garland and Heckbert 1997), run once on imported meshes to build a chain
+// of coarser levels of detail. Vertices only ever move onto other existing vertices, so every level indexes the vertex
+// buffer of the full detail mesh and a level is just another range of its index buffer.
+//
+// Vertices at the same position are welded while simplifying, so meshes exported with a vertex per triangle corner
+// still collapse. Where welded vertices differ in another attribute, such as a texture coordinate seam, the position
+// is kept. Open borders only collapse along the border.
+//
+// Positions are the first attribute of each vertex, as in SDKMESH vertex buffers, and vertices are compared over
+// vertexStride bytes from their position. Indices are triangle lists, relative to the first vertex of positions.
+
+namespace MeshSimplifier
+{
+    constexpr size_t MaxLods         = 6;       // Levels in a chain, including the full detail mesh.
+    constexpr float  LodReduction    = 0.5f;    // Target triangle count of each level, relative to the level before.
+    constexpr float  MinLodReduction = 0.8f;    // A chain ends at a level that keeps more of the triangles than this.
+    constexpr size_t MinLodTriangles = 32;      // A chain ends at a level with fewer triangles than this.
+
+    // One level of detail, a range of the mesh's index buffer.
+    struct Lod
+    {
+        uint32_t startIndex;
+        uint32_t indexCount;
+        float    error;         // Model space distance the level's surface may be from the full detail mesh.
+    };
+
+    // Collapses edges in order of increasing error, until at most targetIndexCount indices remain or every remaining
+    // collapse would move the surface by more than maxError. Writes the remaining triangles to destination, which may
+    // be indices, and returns their index count. resultError receives the error of the simplified mesh.
+    size_t Simplify(
+        uint32_t* destination,
+        const uint32_t* indices,
+        size_t indexCount,
+        const DirectX::XMFLOAT3* positions,
+        size_t vertexStride,
+        size_t vertexCount,
+        size_t targetIndexCount,
+        float maxError,
+        float* resultError = nullptr);
+
+    // Appends coarser levels to indices, each simplified from the level before and ordered by MeshOptimizer, and fills
+    // lods with the full detail mesh followed by each level. Start indices are relative to the front of indices.
+    void BuildLodChain(
+        std::vector<uint32_t>& indices,
+        const DirectX::XMFLOAT3* positions,
+        size_t vertexStride,
+        size_t vertexCount,
+        std::vector<Lod>& lods);
+}
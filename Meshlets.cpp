@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "Meshlets.h"
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    constexpr uint8_t NoSlot = UINT8_MAX;
+
+    static_assert(Meshlets::MaxVertices < NoSlot, "Meshlet vertex slots are stored as uint8_t.");
+    static_assert(Meshlets::MaxVertices <= 1024, "Triangle corners are packed into 10 bits.");
+
+    Vector3 GetPosition(const XMFLOAT3* positions, size_t positionStride, uint32_t vertex) noexcept
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+    }
+}
+
+Meshlets::View Meshlets::View::Create(Matrix const& worldViewProjection, Vector3 const& eye) noexcept
+{
+    const auto& m = worldViewProjection;
+
+    // Clip space x, y, z and w are the dot products of a model space point with the columns of the matrix.
+    const Vector4 x(m._11, m._21, m._31, m._41);
+    const Vector4 y(m._12, m._22, m._32, m._42);
+    const Vector4 z(m._13, m._23, m._33, m._43);
+    const Vector4 w(m._14, m._24, m._34, m._44);
+
+    // -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    const Vector4 planes[6] = { w + x, w - x, w + y, w - y, z, w - z };
+
+    View view = {};
+    for (size_t i = 0; i < 6; ++i)
+    {
+        XMStoreFloat4(&view.planes[i], XMPlaneNormalize(planes[i]));
+    }
+    view.eye = eye;
+
+    return view;
+}
+
+Meshlets::CullStatistics& Meshlets::CullStatistics::operator+= (CullStatistics const& other) noexcept
+{
+    meshletCount     += other.meshletCount;
+    triangleCount    += other.triangleCount;
+    frustumCulled    += other.frustumCulled;
+    backfaceCulled   += other.backfaceCulled;
+    visibleTriangles += other.visibleTriangles;
+    return *this;
+}
+
+void Meshlets::Build(const XMFLOAT3* positions, size_t positionStride, const uint32_t* indices, size_t indexCount)
+{
+    assert(indexCount % 3 == 0);
+
+    m_meshlets.clear();
+    m_bounds.clear();
+    m_vertexIndices.clear();
+    m_primitives.clear();
+
+    if (indexCount < 3)
+        return;
+
+    // Slot of each vertex in the meshlet being filled.
+    const auto vertexCount = static_cast<size_t>(*std::max_element(indices, indices + indexCount)) + 1;
+    std::vector<uint8_t> slots(vertexCount, NoSlot);
+
+    m_vertexIndices.reserve(indexCount);
+    m_primitives.reserve(indexCount / 3);
+
+    Meshlet current = {};
+
+    auto finish = [&]()
+    {
+        for (auto i = current.vertexOffset; i < m_vertexIndices.size(); ++i)
+        {
+            slots[m_vertexIndices[i]] = NoSlot;
+        }
+
+        m_meshlets.push_back(current);
+
+        current.vertexOffset    = static_cast<uint32_t>(m_vertexIndices.size());
+        current.vertexCount     = 0;
+        current.primitiveOffset = static_cast<uint32_t>(m_primitives.size());
+        current.primitiveCount  = 0;
+    };
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const auto a = indices[i];
+        const auto b = indices[i + 1];
+        const auto c = indices[i + 2];
+
+        const uint32_t newVertices = (slots[a] == NoSlot ? 1u : 0u) +
+                                     (slots[b] == NoSlot && b != a ? 1u : 0u) +
+                                     (slots[c] == NoSlot && c != a && c != b ? 1u : 0u);
+
+        if (current.vertexCount + newVertices > MaxVertices || current.primitiveCount == MaxPrimitives)
+            finish();
+
+        uint32_t corners[3];
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const auto vertex = indices[i + k];
+
+            if (slots[vertex] == NoSlot)
+            {
+                slots[vertex] = static_cast<uint8_t>(current.vertexCount++);
+                m_vertexIndices.push_back(vertex);
+            }
+            corners[k] = slots[vertex];
+        }
+
+        m_primitives.push_back(PackPrimitive(corners[0], corners[1], corners[2]));
+        ++current.primitiveCount;
+    }
+
+    if (current.primitiveCount > 0)
+        finish();
+
+    m_meshlets.shrink_to_fit();
+    m_vertexIndices.shrink_to_fit();
+    m_bounds.resize(m_meshlets.size());
+
+    XMFLOAT3 points[MaxVertices];
+    Vector3  normals[MaxPrimitives];
+
+    for (size_t m = 0; m < m_meshlets.size(); ++m)
+    {
+        const auto& meshlet = m_meshlets[m];
+        auto& bounds = m_bounds[m];
+
+        const auto* vertexIndices = m_vertexIndices.data() + meshlet.vertexOffset;
+
+        for (uint32_t v = 0; v < meshlet.vertexCount; ++v)
+        {
+            points[v] = GetPosition(positions, positionStride, vertexIndices[v]);
+        }
+
+        BoundingSphere sphere;
+        BoundingSphere::CreateFromPoints(sphere, meshlet.vertexCount, points, sizeof(XMFLOAT3));
+        bounds.center = sphere.Center;
+        bounds.radius = sphere.Radius;
+
+        // The outward normal of a clockwise triangle is (p2 - p0) x (p1 - p0). Degenerate triangles face nowhere,
+        // so they don't widen the cone.
+        Vector3 axis;
+        uint32_t normalCount = 0;
+
+        for (uint32_t p = 0; p < meshlet.primitiveCount; ++p)
+        {
+            const auto primitive = m_primitives[meshlet.primitiveOffset + p];
+            const Vector3 p0 = points[GetCorner(primitive, 0)];
+            const Vector3 p1 = points[GetCorner(primitive, 1)];
+            const Vector3 p2 = points[GetCorner(primitive, 2)];
+
+            auto normal = (p2 - p0).Cross(p1 - p0);
+            const auto length = normal.Length();
+
+            if (length > 0.0f)
+            {
+                normal /= length;
+                normals[normalCount++] = normal;
+                axis += normal;
+            }
+        }
+
+        bounds.coneCutoff = 1.0f;
+
+        if (axis.LengthSquared() > 0.0f)
+        {
+            axis.Normalize();
+
+            float minDot = 1.0f;
+            for (uint32_t n = 0; n < normalCount; ++n)
+            {
+                minDot = std::min(minDot, normals[n].Dot(axis));
+            }
+
+            // A cone wider than a hemisphere always has a normal facing the eye.
+            if (minDot > 0.0f)
+                bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+        bounds.coneAxis = axis;
+    }
+}
+
+bool Meshlets::Assign(
+    const Meshlet* meshlets,
+    const MeshletBounds* bounds,
+    size_t meshletCount,
+    const uint32_t* vertexIndices,
+    size_t vertexIndexCount,
+    const uint32_t* primitives,
+    size_t primitiveCount)
+{
+    m_meshlets.assign(meshlets, meshlets + meshletCount);
+    m_bounds.assign(bounds, bounds + meshletCount);
+    m_vertexIndices.assign(vertexIndices, vertexIndices + vertexIndexCount);
+    m_primitives.assign(primitives, primitives + primitiveCount);
+
+    for (const auto& meshlet : m_meshlets)
+    {
+        bool isValid = meshlet.vertexCount <= MaxVertices && meshlet.primitiveCount <= MaxPrimitives &&
+                       meshlet.vertexOffset <= vertexIndexCount && meshlet.vertexCount <= vertexIndexCount - meshlet.vertexOffset &&
+                       meshlet.primitiveOffset <= primitiveCount && meshlet.primitiveCount <= primitiveCount - meshlet.primitiveOffset;
+
+        for (uint32_t p = 0; isValid && p < meshlet.primitiveCount; ++p)
+        {
+            const auto primitive = m_primitives[meshlet.primitiveOffset + p];
+            isValid = GetCorner(primitive, 0) < meshlet.vertexCount && GetCorner(primitive, 1) < meshlet.vertexCount &&
+                      GetCorner(primitive, 2) < meshlet.vertexCount;
+        }
+
+        if (!isValid)
+        {
+            *this = Meshlets();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Meshlets::Cull(View const& view, std::vector<uint32_t>& visible, CullStatistics& statistics) const
+{
+    const Vector3 eye(view.eye);
+
+    statistics.meshletCount += m_meshlets.size();
+
+    for (size_t i = 0; i < m_meshlets.size(); ++i)
+    {
+        const auto& bounds = m_bounds[i];
+        const Vector3 center(bounds.center);
+
+        statistics.triangleCount += m_meshlets[i].primitiveCount;
+
+        bool isOutside = false;
+        for (const auto& plane : view.planes)
+        {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -bounds.radius)
+            {
+                isOutside = true;
+                break;
+            }
+        }
+
+        if (isOutside)
+        {
+            ++statistics.frustumCulled;
+            continue;
+        }
+
+        const auto toCenter = center - eye;
+        if (toCenter.Dot(Vector3(bounds.coneAxis)) >= bounds.coneCutoff * toCenter.Length() + bounds.radius)
+        {
+            ++statistics.backfaceCulled;
+            continue;
+        }
+
+        visible.push_back(static_cast<uint32_t>(i));
+        statistics.visibleTriangles += m_meshlets[i].primitiveCount;
+    }
+}
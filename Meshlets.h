@@ -0,0 +1,110 @@
+#pragma once
+
+// Clusters of a triangle mesh, small enough to cull one at a time, built once at load or cook time.
+// Each meshlet holds at most MaxVertices unique vertices and MaxPrimitives triangles, the sizes mesh shaders are
+// tuned for, in the layout DirectXMesh uses: a range of vertex indices into the mesh's vertex buffer, and a range of
+// triangles whose corners index that range. The same arrays can later be uploaded for a mesh shader dispatch.
+// Each meshlet also has a bounding sphere, and a cone bounding its triangle normals, so a view can reject meshlets
+// that are outside the frustum or face entirely away from the eye.
+// Front faces are clockwise, as the rasterizer states cull counter clockwise triangles.
+
+class Meshlets
+{
+public:
+
+    static constexpr uint32_t MaxVertices   = 64;
+    static constexpr uint32_t MaxPrimitives = 124;
+
+    struct Meshlet
+    {
+        uint32_t vertexCount;
+        uint32_t vertexOffset;      // First entry in the vertex index array.
+        uint32_t primitiveCount;
+        uint32_t primitiveOffset;   // First entry in the primitive array.
+    };
+
+    // Every triangle of a meshlet faces away from an eye for which
+    // dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius.
+    struct MeshletBounds
+    {
+        DirectX::XMFLOAT3 center;
+        float             radius;
+        DirectX::XMFLOAT3 coneAxis;     // Average outward normal.
+        float             coneCutoff;   // Sine of the cone's half angle, or 1 if the normals are too spread to cull.
+    };
+
+    // Frustum planes and eye position, in the model space of the meshlets.
+    struct View
+    {
+        DirectX::XMFLOAT4 planes[6];    // Normalized, with the inside of the frustum on the positive side.
+        DirectX::XMFLOAT3 eye;
+
+        // From a model to clip space matrix, in the SimpleMath row vector convention. Either depth direction works.
+        static View Create(DirectX::SimpleMath::Matrix const& worldViewProjection, DirectX::SimpleMath::Vector3 const& eye) noexcept;
+    };
+
+    struct CullStatistics
+    {
+        size_t meshletCount;
+        size_t triangleCount;
+        size_t frustumCulled;       // Meshlets outside the frustum.
+        size_t backfaceCulled;      // Meshlets inside the frustum facing entirely away from the eye.
+        size_t visibleTriangles;
+
+        CullStatistics& operator+= (CullStatistics const& other) noexcept;
+    };
+
+    Meshlets() noexcept = default;
+
+    Meshlets(Meshlets const&) = delete;
+    Meshlets& operator= (Meshlets const&) = delete;
+
+    Meshlets(Meshlets&&) = default;
+    Meshlets& operator= (Meshlets&&) = default;
+
+    ~Meshlets() = default;
+
+    // Packs triangles into meshlets in index order, starting a new meshlet when the next triangle doesn't fit.
+    // Neighbouring triangles share most of their vertices once MeshOptimizer has ordered them, so meshlets are
+    // built after it. Indices are relative to the first vertex of positions.
+    void Build(const DirectX::XMFLOAT3* positions, size_t positionStride, const uint32_t* indices, size_t indexCount);
+
+    // Replaces the meshlets with arrays another Meshlets built, such as those saved in a cooked model.
+    // Returns false, leaving the object empty, if a range is out of bounds.
+    bool Assign(
+        const Meshlet* meshlets,
+        const MeshletBounds* bounds,
+        size_t meshletCount,
+        const uint32_t* vertexIndices,
+        size_t vertexIndexCount,
+        const uint32_t* primitives,
+        size_t primitiveCount);
+
+    // Appends the index of every meshlet that may be visible from view, and adds the counts to statistics.
+    void Cull(View const& view, std::vector<uint32_t>& visible, CullStatistics& statistics) const;
+
+    // Triangle corners are packed into one uint32_t, 10 bits each, as DirectXMesh packs them.
+    static uint32_t PackPrimitive(uint32_t i0, uint32_t i1, uint32_t i2) noexcept  { return i0 | (i1 << 10) | (i2 << 20); }
+    static uint32_t GetCorner(uint32_t primitive, uint32_t corner) noexcept         { return (primitive >> (corner * 10)) & 0x3ff; }
+
+    const auto GetMeshletCount() const noexcept     { return m_meshlets.size(); }
+    const auto GetMeshlets() const noexcept         { return m_meshlets.data(); }
+    const auto GetBounds() const noexcept           { return m_bounds.data(); }
+    const auto GetVertexIndexCount() const noexcept { return m_vertexIndices.size(); }
+    const auto GetVertexIndices() const noexcept    { return m_vertexIndices.data(); }
+    const auto GetPrimitiveCount() const noexcept   { return m_primitives.size(); }
+    const auto GetPrimitives() const noexcept       { return m_primitives.data(); }
+
+    const auto GetSizeInBytes() const noexcept
+    {
+        return m_meshlets.size() * (sizeof(Meshlet) + sizeof(MeshletBounds)) +
+               (m_vertexIndices.size() + m_primitives.size()) * sizeof(uint32_t);
+    }
+
+private:
+
+    std::vector<Meshlet>       m_meshlets;
+    std::vector<MeshletBounds> m_bounds;
+    std::vector<uint32_t>      m_vertexIndices;
+    std::vector<uint32_t>      m_primitives;
+};
@@ -0,0 +1,105 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
+#include "FBXModel.h"
+#include "CookedModel.h"
+#include "Benchmarks.h"
+#include "ModelCooker.h"
+
+namespace
+{
+    constexpr wchar_t CookSwitch[] = L"-cook";
+
+    // The FBX models Game::CreateDeviceDependentResources loads.
+    const char* const g_gameModels[] =
+    {
+        "Models\\Dove.fbx",
+    };
+
+    void Log(const char* format, ...)
+    {
+        char buffer[512];
+
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+
+        OutputDebugStringA(buffer);
+        OutputDebugStringA("\n");
+    }
+
+    // Returns the paths following the -cook switch, up to the next switch.
+    std::vector<std::string> GetCookPaths(const wchar_t* cmdLine)
+    {
+        std::wistringstream args(cmdLine ? cmdLine : L"");
+        std::wstring arg;
+        std::vector<std::string> paths;
+        bool isCookArg = false;
+
+        while (args >> arg)
+        {
+            if (arg[0] == L'-')
+            {
+                isCookArg = _wcsicmp(arg.c_str(), CookSwitch) == 0;
+                continue;
+            }
+
+            if (isCookArg)
+            {
+                const auto length = WideCharToMultiByte(CP_ACP, 0, arg.c_str(), -1, nullptr, 0, nullptr, nullptr);
+                std::string path(static_cast<size_t>(std::max(length, 1)) - 1, '\0');
+                WideCharToMultiByte(CP_ACP, 0, arg.c_str(), -1, path.data(), length, nullptr, nullptr);
+                paths.push_back(std::move(path));
+            }
+        }
+        return paths;
+    }
+}
+
+bool ModelCooker::IsRequested(const wchar_t* cmdLine) noexcept
+{
+    return Benchmarks::HasSwitch(cmdLine, CookSwitch);
+}
+
+int ModelCooker::Run(const wchar_t* cmdLine)
+{
+    auto paths = GetCookPaths(cmdLine);
+    if (paths.empty())
+        paths.assign(std::begin(g_gameModels), std::end(g_gameModels));
+
+    // Loading uploads the meshes, so the FBX SDK path still needs a device.
+    Benchmarks::HeadlessDevice device;
+
+    for (const auto& path : paths)
+    {
+        const auto cookedPath = CookedModel::GetCookedPath(path.c_str());
+
+        try
+        {
+            Benchmarks::Stopwatch stopwatch;
+            FBXModel model(device.GetD3DDevice(), device.GetCommandQueue(), path.c_str());
+
+            if (model.GetMeshCount() == 0)
+            {
+                Log("Cook failed: no meshes loaded from %s", path.c_str());
+                return 1;
+            }
+
+            model.SaveCooked(cookedPath.c_str());
+            Log("Cooked %s to %s in %.1f ms", path.c_str(), cookedPath.c_str(), stopwatch.GetElapsedMilliseconds());
+        }
+        catch (const std::exception& e)
+        {
+            Log("Cook failed: %s: %s", path.c_str(), e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
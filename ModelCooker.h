@@ -0,0 +1,15 @@
+#pragma once
+
+// Offline cook step, run from the command line instead of the game:
+//
+//   Win32GameDR.exe -cook                      cooks every FBX model the game loads
+//   Win32GameDR.exe -cook Models\Model.fbx     cooks the named file
+//
+// Each model is loaded through the FBX SDK and saved next to it as a cooked model (see CookedModel.h), which the game
+// then loads instead while it is newer than the FBX file. Results are written to the debugger output window.
+
+namespace ModelCooker
+{
+    bool IsRequested(const wchar_t* cmdLine) noexcept;
+    int  Run(const wchar_t* cmdLine);
+}
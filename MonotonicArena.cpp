@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "MonotonicArena.h"
+
+MonotonicArena::MonotonicArena(size_t blockSize) noexcept :
+    m_blockSize(blockSize), m_current(nullptr), m_remaining(0), m_bytesUsed(0), m_bytesReserved(0)
+{
+}
+
+void* MonotonicArena::AllocateBytes(size_t size, size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    auto padding = static_cast<size_t>(-reinterpret_cast<uintptr_t>(m_current) & (alignment - 1));
+
+    if (!m_current || padding + size > m_remaining)
+    {
+        // new[] aligns to __STDCPP_DEFAULT_NEW_ALIGNMENT__, which covers every type the importer stores.
+        assert(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+        // An oversized request gets a block of its own.
+        const auto blockSize = std::max(m_blockSize, size);
+
+        m_blocks.push_back(std::make_unique_for_overwrite<uint8_t[]>(blockSize));
+        m_current   = m_blocks.back().get();
+        m_remaining = blockSize;
+        m_bytesReserved += blockSize;
+        padding = 0;
+    }
+
+    auto bytes = m_current + padding;
+    m_current   += padding + size;
+    m_remaining -= padding + size;
+    m_bytesUsed += size;
+
+    return bytes;
+}
+
+void MonotonicArena::Release() noexcept
+{
+    m_blocks.clear();
+    m_blocks.shrink_to_fit();
+
+    m_current       = nullptr;
+    m_remaining     = 0;
+    m_bytesUsed     = 0;
+    m_bytesReserved = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// Monotonic arena for short lived scratch data, such as the control point tables of an FBX import.
+// Arrays are carved from large blocks by bumping a pointer, and are never freed one by one. Release frees every
+// block at once, so thousands of small new/delete pairs become a handful of block allocations.
+// Only trivially destructible types can be allocated, since no destructors are run.
+
+class MonotonicArena
+{
+public:
+
+    static constexpr size_t DefaultBlockSize = 256 * 1024;
+
+    explicit MonotonicArena(size_t blockSize = DefaultBlockSize) noexcept;
+
+    MonotonicArena(MonotonicArena const&) = delete;
+    MonotonicArena& operator= (MonotonicArena const&) = delete;
+
+    MonotonicArena(MonotonicArena&&) = default;
+    MonotonicArena& operator= (MonotonicArena&&) = default;
+
+    ~MonotonicArena() = default;
+
+    // Returns count value initialized elements, valid until Release.
+    template<typename T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "The arena never runs destructors.");
+
+        auto elements = static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+        std::uninitialized_value_construct_n(elements, count);
+        return elements;
+    }
+
+    // Frees every block. All pointers the arena returned are invalid afterwards.
+    void Release() noexcept;
+
+    // Bytes handed out, bytes reserved in blocks, and the number of blocks allocated from the heap since the last Release.
+    const auto GetBytesUsed() const noexcept                    { return m_bytesUsed; }
+    const auto GetBytesReserved() const noexcept                { return m_bytesReserved; }
+    const auto GetBlockCount() const noexcept                   { return m_blocks.size(); }
+
+private:
+
+    void* AllocateBytes(size_t size, size_t alignment);
+
+    std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+
+    size_t   m_blockSize;
+    uint8_t* m_current;         // Next free byte of the last block.
+    size_t   m_remaining;       // Free bytes left in the last block.
+    size_t   m_bytesUsed;
+    size_t   m_bytesReserved;
+};
@@ -99,7 +99,7 @@ namespace PSOs
     {
         Cubes, MeshOpaque, MeshAlphaBlend,
         GeoSphere, AOBlurHorz, AOBlurVert, ShadowBlurHorz, ShadowBlurVert,
-        Skinning, PostProcess, Fxaa,
+        Skinning, SkinningDualQuaternion, PostProcess, Fxaa,
         Count
     };
 }
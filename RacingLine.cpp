@@ -0,0 +1,358 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationStructs.h"
+#include "RacingLine.h"
+
+namespace
+{
+    // Point at t in [0, 1] on the centripetal Catmull-Rom segment from p1 to p2, by the Barry and Goldman pyramid.
+    // Knots are spaced by the square root of the distance between points.
+    Vector3 CatmullRom(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector3& p3, float t) noexcept
+    {
+        auto knot = [](const Vector3& a, const Vector3& b) { return std::max(std::sqrt(Vector3::Distance(a, b)), 1e-4f); };
+
+        const auto t1 = knot(p0, p1);
+        const auto t2 = t1 + knot(p1, p2);
+        const auto t3 = t2 + knot(p2, p3);
+        const auto u  = t1 + (t2 - t1) * t;
+
+        const auto a1 = Vector3::Lerp(p0, p1, u / t1);
+        const auto a2 = Vector3::Lerp(p1, p2, (u - t1) / (t2 - t1));
+        const auto a3 = Vector3::Lerp(p2, p3, (u - t2) / (t3 - t2));
+        const auto b1 = Vector3::Lerp(a1, a2, u / t2);
+        const auto b2 = Vector3::Lerp(a2, a3, (u - t1) / (t3 - t1));
+
+        return Vector3::Lerp(b1, b2, (u - t1) / (t2 - t1));
+    }
+}
+
+RacingLine::RacingLine(const std::vector<Checkpoint>& track, RacingLineSettings const& settings) :
+    m_length(0),
+    m_spacing(0),
+    m_gridMinX(0),
+    m_gridMinZ(0),
+    m_cellSize(settings.gridCellSize),
+    m_gridWidth(0),
+    m_gridHeight(0)
+{
+    if (track.size() < 3)
+        throw std::exception("RacingLine needs a track with at least three checkpoints.");
+
+    BuildSamples(track, settings.sampleSpacing);
+    BuildSpeedLimits(track, settings);
+    BuildGrid(settings.gridCellSize);
+}
+
+void RacingLine::BuildSamples(const std::vector<Checkpoint>& track, float sampleSpacing)
+{
+    const auto count = track.size();
+
+    std::vector<Vector3> points(count);
+    for (size_t i = 0; i < count; ++i)
+        points[i] = Vector3::Lerp(track[i].signpost1, track[i].signpost2, 0.5f);    // Halfway b/n signposts.
+
+    // Measure the spline along a fine polyline, which is then resampled at equal distances.
+    std::vector<Vector3> polyline;
+    std::vector<float>   polylineDistances;
+    polyline.reserve(count * SplineSteps);
+    polylineDistances.reserve(count * SplineSteps);
+    m_checkpointDistances.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto& p0 = points[(i + count - 1) % count];
+        const auto& p1 = points[i];
+        const auto& p2 = points[(i + 1) % count];
+        const auto& p3 = points[(i + 2) % count];
+
+        for (uint32_t step = 0; step < SplineSteps; ++step)
+        {
+            const auto point = CatmullRom(p0, p1, p2, p3, static_cast<float>(step) / SplineSteps);
+
+            if (!polyline.empty())
+                m_length += Vector3::Distance(polyline.back(), point);
+
+            if (step == 0)
+                m_checkpointDistances[i] = m_length;
+
+            polyline.push_back(point);
+            polylineDistances.push_back(m_length);
+        }
+    }
+
+    m_length += Vector3::Distance(polyline.back(), polyline.front());
+
+    const auto sampleCount = std::max(static_cast<size_t>(std::ceil(m_length / sampleSpacing)), count);
+    m_spacing = m_length / sampleCount;
+    m_samples.resize(sampleCount);
+
+    for (size_t k = 0, j = 0; k < sampleCount; ++k)
+    {
+        const auto distance = k * m_spacing;
+        while (j + 1 < polyline.size() && polylineDistances[j + 1] <= distance)
+            ++j;
+
+        const auto& next = j + 1 < polyline.size() ? polyline[j + 1] : polyline.front();
+        const auto nextDistance = j + 1 < polyline.size() ? polylineDistances[j + 1] : m_length;
+        const auto t = (distance - polylineDistances[j]) / std::max(nextDistance - polylineDistances[j], 1e-6f);
+
+        m_samples[k].position = Vector3::Lerp(polyline[j], next, std::min(t, 1.0f));
+    }
+
+    // Tangents by central differences, and curvature as the angle turned at each sample over the distance between them.
+    for (size_t k = 0; k < sampleCount; ++k)
+    {
+        const auto& prev = m_samples[(k + sampleCount - 1) % sampleCount].position;
+        const auto& next = m_samples[(k + 1) % sampleCount].position;
+        auto& sample = m_samples[k];
+
+        const auto in  = sample.position - prev;
+        const auto out = next - sample.position;
+
+        sample.tangent = next - prev;
+        sample.tangent.Normalize();
+        sample.curvature = std::atan2(in.Cross(out).Length(), in.Dot(out)) / m_spacing;
+    }
+}
+
+void RacingLine::BuildSpeedLimits(const std::vector<Checkpoint>& track, RacingLineSettings const& settings)
+{
+    const auto count = track.size();
+    const auto sampleCount = m_samples.size();
+
+    // Samples take the limit of the checkpoint they are heading for, lowered to the speed at which the cornering
+    // acceleration holds the car to the line's curvature: a = v * v * curvature.
+    for (size_t k = 0, stage = 0; k < sampleCount; ++k)
+    {
+        const auto distance = k * m_spacing;
+        while (stage + 1 < count && distance >= m_checkpointDistances[stage + 1])
+            ++stage;
+
+        auto& sample = m_samples[k];
+        sample.speedLimit = track[(stage + 1) % count].speedLimit * PhysicsConstants::KphToMps;
+
+        if (sample.curvature > 0.0f)
+            sample.speedLimit = std::min(sample.speedLimit, std::sqrt(settings.corneringAccel / sample.curvature));
+    }
+
+    // Brake for the corners ahead: v * v = u * u + 2 * a * s. The second pass carries braking zones back across the
+    // first checkpoint.
+    const auto brakingSq = 2.0f * settings.brakingDecel * m_spacing;
+
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (auto k = sampleCount; k-- > 0;)
+        {
+            const auto nextLimit = m_samples[(k + 1) % sampleCount].speedLimit;
+            m_samples[k].speedLimit = std::min(m_samples[k].speedLimit, std::sqrt(nextLimit * nextLimit + brakingSq));
+        }
+    }
+}
+
+void RacingLine::BuildGrid(float cellSize)
+{
+    const auto sampleCount = m_samples.size();
+
+    auto minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+    for (const auto& sample : m_samples)
+    {
+        minX = std::min(minX, sample.position.x);
+        minZ = std::min(minZ, sample.position.z);
+        maxX = std::max(maxX, sample.position.x);
+        maxZ = std::max(maxZ, sample.position.z);
+    }
+
+    m_gridMinX   = minX;
+    m_gridMinZ   = minZ;
+    m_gridWidth  = static_cast<uint32_t>((maxX - minX) / cellSize) + 1;
+    m_gridHeight = static_cast<uint32_t>((maxZ - minZ) / cellSize) + 1;
+
+    auto cellX = [&](float x) { return std::min(static_cast<uint32_t>((x - m_gridMinX) / cellSize), m_gridWidth - 1); };
+    auto cellZ = [&](float z) { return std::min(static_cast<uint32_t>((z - m_gridMinZ) / cellSize), m_gridHeight - 1); };
+
+    // Bins the segments in two passes, counting then filling, so each cell's segments are contiguous.
+    auto forEachCell = [&](size_t segment, auto&& function)
+    {
+        const auto& a = m_samples[segment].position;
+        const auto& b = m_samples[(segment + 1) % sampleCount].position;
+
+        for (auto z = cellZ(std::min(a.z, b.z)); z <= cellZ(std::max(a.z, b.z)); ++z)
+            for (auto x = cellX(std::min(a.x, b.x)); x <= cellX(std::max(a.x, b.x)); ++x)
+                function(z * m_gridWidth + x);
+    };
+
+    m_cellStarts.assign(static_cast<size_t>(m_gridWidth) * m_gridHeight + 1, 0);
+
+    for (size_t segment = 0; segment < sampleCount; ++segment)
+        forEachCell(segment, [&](size_t cell) { ++m_cellStarts[cell + 1]; });
+
+    std::partial_sum(m_cellStarts.begin(), m_cellStarts.end(), m_cellStarts.begin());
+
+    std::vector<uint32_t> cellEnds(m_cellStarts.begin(), m_cellStarts.end() - 1);
+    m_cellSegments.resize(m_cellStarts.back());
+
+    for (size_t segment = 0; segment < sampleCount; ++segment)
+        forEachCell(segment, [&](size_t cell) { m_cellSegments[cellEnds[cell]++] = static_cast<uint32_t>(segment); });
+}
+
+float RacingLine::Wrap(float distance) const noexcept
+{
+    distance = std::fmod(distance, m_length);
+    if (distance < 0.0f)
+        distance += m_length;
+
+    // Adding the length to a tiny negative remainder can round up to the length itself.
+    return distance < m_length ? distance : 0.0f;
+}
+
+RacingLine::Sample RacingLine::Evaluate(float distance) const noexcept
+{
+    const auto position = Wrap(distance) / m_spacing;
+    const auto index = std::min(static_cast<size_t>(position), m_samples.size() - 1);
+    const auto t = position - index;
+
+    const auto& a = m_samples[index];
+    const auto& b = m_samples[(index + 1) % m_samples.size()];
+
+    Sample sample;
+    sample.position   = Vector3::Lerp(a.position, b.position, t);
+    sample.tangent    = Vector3::Lerp(a.tangent, b.tangent, t);
+    sample.tangent.Normalize();
+    sample.curvature  = a.curvature + (b.curvature - a.curvature) * t;
+    sample.speedLimit = a.speedLimit + (b.speedLimit - a.speedLimit) * t;
+    return sample;
+}
+
+float RacingLine::ProjectOnSegment(const Vector3& position, size_t index, float& distanceSq) const noexcept
+{
+    const auto& a = m_samples[index].position;
+    const auto& b = m_samples[(index + 1) % m_samples.size()].position;
+
+    const auto ab = b - a;
+    const auto lengthSq = ab.LengthSquared();
+    const auto t = lengthSq > 0.0f ? std::clamp((position - a).Dot(ab) / lengthSq, 0.0f, 1.0f) : 0.0f;
+
+    distanceSq = Vector3::DistanceSquared(position, a + t * ab);
+    return (index + t) * m_spacing;
+}
+
+float RacingLine::FindNearest(const Vector3& position, float* offset) const noexcept
+{
+    const auto cellX = static_cast<int32_t>(std::clamp((position.x - m_gridMinX) / m_cellSize, 0.0f, m_gridWidth - 1.0f));
+    const auto cellZ = static_cast<int32_t>(std::clamp((position.z - m_gridMinZ) / m_cellSize, 0.0f, m_gridHeight - 1.0f));
+    const auto maxRing = static_cast<int32_t>(std::max(m_gridWidth, m_gridHeight));
+
+    auto bestSq = FLT_MAX;
+    auto bestDistance = 0.0f;
+
+    auto searchCell = [&](int32_t x, int32_t z)
+    {
+        if (x < 0 || z < 0 || x >= static_cast<int32_t>(m_gridWidth) || z >= static_cast<int32_t>(m_gridHeight))
+            return;
+
+        const auto cell = static_cast<size_t>(z) * m_gridWidth + x;
+        for (auto i = m_cellStarts[cell]; i < m_cellStarts[cell + 1]; ++i)
+        {
+            float distanceSq;
+            const auto distance = ProjectOnSegment(position, m_cellSegments[i], distanceSq);
+
+            if (distanceSq < bestSq)
+            {
+                bestSq = distanceSq;
+                bestDistance = distance;
+            }
+        }
+    };
+
+    // Search square rings of cells outwards from the position's cell.
+    for (int32_t ring = 0; ring <= maxRing; ++ring)
+    {
+        for (auto z = cellZ - ring; z <= cellZ + ring; ++z)
+        {
+            if (z == cellZ - ring || z == cellZ + ring)
+            {
+                for (auto x = cellX - ring; x <= cellX + ring; ++x)
+                    searchCell(x, z);
+            }
+            else
+            {
+                searchCell(cellX - ring, z);
+                searchCell(cellX + ring, z);
+            }
+        }
+
+        // Every cell outside this ring is at least this far from the position.
+        const auto ringDistance = ring * m_cellSize;
+        if (bestSq <= ringDistance * ringDistance)
+            break;
+    }
+
+    if (offset)
+        *offset = std::sqrt(bestSq);
+
+    return Wrap(bestDistance);
+}
+
+float RacingLine::Track(const Vector3& position, float distance) const noexcept
+{
+    const auto sampleCount = m_samples.size();
+    auto center = std::min(static_cast<size_t>(Wrap(distance) / m_spacing), sampleCount - 1);
+
+    // While the nearest segment is at the edge of the window the position may be nearer one beyond it, so the window
+    // moves on to centre it. Going all the way round without settling means the position is far from the line.
+    for (size_t moved = 0; moved < sampleCount; moved += TrackWindow)
+    {
+        auto bestSq = FLT_MAX;
+        auto bestDistance = 0.0f;
+        size_t bestOffset = 0;
+
+        for (size_t offset = 0; offset <= 2 * TrackWindow; ++offset)
+        {
+            const auto index = (center + offset + sampleCount - TrackWindow % sampleCount) % sampleCount;
+
+            float distanceSq;
+            const auto segmentDistance = ProjectOnSegment(position, index, distanceSq);
+
+            if (distanceSq < bestSq)
+            {
+                bestSq = distanceSq;
+                bestDistance = segmentDistance;
+                bestOffset = offset;
+            }
+        }
+
+        if (bestOffset != 0 && bestOffset != 2 * TrackWindow)
+            return Wrap(bestDistance);
+
+        center = (center + bestOffset + sampleCount - TrackWindow % sampleCount) % sampleCount;
+    }
+
+    return FindNearest(position);
+}
+
+Vector3 RacingLine::Steer(const Vector3& position, const Vector3& velocity, float distance, float elapsedTime,
+    float* speedLimit) const noexcept
+{
+    // Aiming further ahead the faster the car goes turns it in before a corner rather than at it.
+    const auto limit = Evaluate(distance).speedLimit;
+    const auto speed = velocity.Length() / elapsedTime;
+    const auto target = Evaluate(distance + LookaheadDistance + speed * LookaheadTime).position;
+
+    // Change the velocity towards the target at the speed limit, by as much as the car can in a step.
+    auto desired = target - position;
+    desired.Normalize();
+    desired *= limit * elapsedTime;
+
+    auto change = desired - velocity;
+    const auto maxChange = PhysicsConstants::Acceleration * elapsedTime;
+    const auto changeLength = change.Length();
+
+    if (changeLength > maxChange)
+        change *= maxChange / changeLength;
+
+    if (speedLimit)
+        *speedLimit = limit;
+
+    // Using v = u + at
+    return change / elapsedTime;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+// AnimationStructs.h must also be included before this header.
+
+// A closed racing line through the checkpoints of a track, compiled once so AI cars can follow it cheaply.
+// The line is a centripetal Catmull-Rom spline through the midpoints of the checkpoint gates, which unlike the uniform
+// form can't loop or cusp where checkpoints are unevenly spaced. It is resampled at equal steps of arc length, so the
+// point at a distance along the line is found in constant time, without solving for the spline parameter.
+//
+// Each sample carries a speed limit: the lower of the checkpoint's limit and the speed at which the curvature there can
+// be taken at the cornering acceleration, reduced where needed so that a car braking at the braking deceleration
+// reaches each corner at its limit. Distances along the line are measured from the first checkpoint.
+//
+// The nearest point query finds segments through a uniform grid over the line in the XZ plane. Cars that already know
+// roughly where they are on the line use Track instead, which searches only the samples around their last position.
+// Steer then turns a car towards a point further along the line, so following it costs a few lookups per step.
+
+struct RacingLineSettings
+{
+    float sampleSpacing;    // Arc length between samples, in metres. Rounded down to divide the line evenly.
+    float corneringAccel;   // Lateral acceleration the cars hold through corners, in m/s/s.
+    float brakingDecel;     // Deceleration the cars brake at before corners, in m/s/s.
+    float gridCellSize;     // Side of a nearest point grid cell, in metres.
+};
+
+class RacingLine
+{
+public:
+
+    static constexpr RacingLineSettings DefaultSettings = { 0.25f, 4.0f, 8.0f, 4.0f };
+
+    struct Sample
+    {
+        Vector3 position;
+        Vector3 tangent;    // Unit direction of travel.
+        float   curvature;  // Reciprocal of the turning radius, in 1/m.
+        float   speedLimit; // In metres per second.
+    };
+
+    RacingLine(const std::vector<Checkpoint>& track, RacingLineSettings const& settings = DefaultSettings);
+
+    RacingLine(RacingLine const&) = delete;
+    RacingLine& operator= (RacingLine const&) = delete;
+
+    RacingLine(RacingLine&&) = default;
+    RacingLine& operator= (RacingLine&&) = default;
+
+    ~RacingLine() = default;
+
+    const auto GetLength() const noexcept                       { return m_length; }
+    const auto GetSampleCount() const noexcept                  { return m_samples.size(); }
+    const auto& GetSample(size_t index) const noexcept          { return m_samples[index]; }
+
+    // Distance along the line at which it passes through a checkpoint.
+    const auto GetCheckpointDistance(uint32_t checkpoint) const noexcept { return m_checkpointDistances[checkpoint]; }
+
+    // Wraps a distance along the line into [0, GetLength()).
+    float Wrap(float distance) const noexcept;
+
+    // The line at a distance along it, interpolated between the two samples either side. Any distance is wrapped.
+    Sample Evaluate(float distance) const noexcept;
+
+    // Distance along the line of the point on it nearest position. offset, if given, receives how far position is from
+    // that point.
+    float FindNearest(const Vector3& position, float* offset = nullptr) const noexcept;
+
+    // As FindNearest, for a position known to have been near distance along the line recently. Only the segments
+    // around distance are searched, moving along the line while the nearest is at the edge of the search, so the cost
+    // doesn't grow with the length of the line. Where the line passes near itself, the part followed is the one nearer
+    // distance.
+    float Track(const Vector3& position, float distance) const noexcept;
+
+    // Acceleration for a car on auto navigation at distance along the line, moving at velocity metres per step. It
+    // turns the car towards a point ahead on the line, at the line's speed limit, and is no larger than
+    // PhysicsConstants::Acceleration. speedLimit, if given, receives the speed limit at distance in metres per second.
+    Vector3 Steer(const Vector3& position, const Vector3& velocity, float distance, float elapsedTime,
+        float* speedLimit = nullptr) const noexcept;
+
+private:
+
+    static constexpr uint32_t SplineSteps       = 64;      // Steps per spline segment when measuring its arc length.
+    static constexpr uint32_t TrackWindow       = 2;       // Segments searched either side by Track.
+    static constexpr float    LookaheadDistance = 2.0f;    // Metres ahead of the car that Steer aims for when stopped.
+    static constexpr float    LookaheadTime     = 0.5f;    // Seconds of travel added to that at the car's speed.
+
+    void BuildSamples(const std::vector<Checkpoint>& track, float sampleSpacing);
+    void BuildSpeedLimits(const std::vector<Checkpoint>& track, RacingLineSettings const& settings);
+    void BuildGrid(float cellSize);
+
+    // Distance along the line of the point nearest position on the segment from sample index to the next, and the
+    // squared distance to it.
+    float ProjectOnSegment(const Vector3& position, size_t index, float& distanceSq) const noexcept;
+
+    std::vector<Sample>   m_samples;
+    std::vector<float>    m_checkpointDistances;
+    float                 m_length;
+    float                 m_spacing;
+
+    // Segments starting at each sample, binned by the grid cells their bounds overlap. Cell c holds the segments from
+    // m_cellSegments[m_cellStarts[c]] up to m_cellSegments[m_cellStarts[c + 1]].
+    float                 m_gridMinX;
+    float                 m_gridMinZ;
+    float                 m_cellSize;
+    uint32_t              m_gridWidth;
+    uint32_t              m_gridHeight;
+    std::vector<uint32_t> m_cellStarts;
+    std::vector<uint32_t> m_cellSegments;
+};
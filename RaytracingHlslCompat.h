@@ -140,6 +140,16 @@ struct BoneConstants
 {
     XMFLOAT4X3 boneTransforms[MAX_BONES];
 };
+// Rigid bone transform as a unit dual quaternion, 8 floats per bone instead of the 12 of a 4x3 matrix.
+struct BoneDualQuaternion
+{
+    Vector4 real;   // Rotation.
+    Vector4 dual;   // Half the translation, multiplied by the rotation.
+};
+struct BoneDualQuaternionConstants
+{
+    BoneDualQuaternion bones[MAX_BONES];
+};
 
 // Structured buffer element structures.
 struct Material
@@ -300,6 +310,17 @@ struct VertexFbxBones
     uint32_t boneIndices;
 };
 
+// Quantized VertexFbxBones, read by the skinning shaders built with COMPACT_VERTICES and decoded by VertexCompression.hlsli.
+struct VertexFbxBonesCompact
+{
+    Vector3  position;
+    uint32_t normal;        // Octahedral, 2 x SNORM16.
+    uint32_t texCoord;      // 2 x FLOAT16.
+    uint32_t tangent;       // Octahedral, 2 x SNORM16.
+    uint32_t boneWeights;   // 4 x UNORM8.
+    uint32_t boneIndices;   // 4 x UINT8.
+};
+
 //struct VertexSkinnedFbx
 //{
 //    Vector3 position;
@@ -3,18 +3,123 @@
 //***************************************************************************************
 
 #include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "CollisionStructs.h"
+#include "SweptCollision.h"
+#include "CollisionMesh.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
 #include "SDKMESHModel.h"
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
 using namespace DX;
 
+namespace
+{
+    // Reorders the triangles of a part in its CPU copy of the index buffer. The SDKMESH loader gives every part a
+    // copy of the whole vertex and index buffers of its mesh, so the vertices are renumbered too if the part draws
+    // every index of its copy from the first vertex, as then no other indices refer to them.
+    // Builds meshlets from the new order, unless meshlets is nullptr.
+    // Appends a chain of simplified levels to the index buffer, unless lods is nullptr, and adds them after the full
+    // detail level lods already holds.
+    void OptimizeMeshPart(
+        ID3D12Device* device,
+        ModelMeshPart& part,
+        MeshOptimizer::MeshStatistics& statistics,
+        Meshlets* meshlets,
+        std::vector<MeshSimplifier::Lod>* lods)
+    {
+        if (part.primitiveType != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST || !part.indexBuffer || !part.vertexBuffer || part.indexCount < 3)
+            return;
+
+        // Triangles are sorted by their positions, which the exporter writes first.
+        if (!part.vbDecl || part.vbDecl->empty() ||
+            part.vbDecl->front().Format != DXGI_FORMAT_R32G32B32_FLOAT || part.vbDecl->front().AlignedByteOffset != 0)
+            return;
+
+        const bool isIndex16 = part.indexFormat == DXGI_FORMAT_R16_UINT;
+        const size_t indexSize = isIndex16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        auto indexData  = static_cast<uint8_t*>(part.indexBuffer.Memory()) + part.startIndex * indexSize;
+        auto vertexData = static_cast<uint8_t*>(part.vertexBuffer.Memory()) + size_t(part.vertexOffset) * part.vertexStride;
+        const size_t vertexCount = part.vertexBufferSize / part.vertexStride - static_cast<size_t>(part.vertexOffset);
+
+        std::vector<uint32_t> indices(part.indexCount);
+        if (isIndex16)
+            std::copy_n(reinterpret_cast<const uint16_t*>(indexData), part.indexCount, indices.begin());
+        else
+            std::copy_n(reinterpret_cast<const uint32_t*>(indexData), part.indexCount, indices.begin());
+
+        // A part indexing past the end of its vertex buffer is left as it is.
+        if (*std::max_element(indices.begin(), indices.end()) >= vertexCount)
+            return;
+
+        statistics.before += MeshOptimizer::Analyze(indices.data(), indices.size(), vertexCount, part.vertexStride);
+
+        MeshOptimizer::OptimizeTriangleOrder(indices.data(), indices.size(),
+            reinterpret_cast<const XMFLOAT3*>(vertexData), part.vertexStride, vertexCount);
+
+        const bool ownsBuffers = part.vertexOffset == 0 && part.startIndex == 0 &&
+                                 part.indexCount * indexSize == part.indexBufferSize;
+        if (ownsBuffers)
+        {
+            std::vector<uint32_t> remap(vertexCount);
+            MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap.data());
+            MeshOptimizer::RemapVertices(vertexData, vertexCount, part.vertexStride, remap.data());
+        }
+
+        statistics.after += MeshOptimizer::Analyze(indices.data(), indices.size(), vertexCount, part.vertexStride);
+
+        if (meshlets)
+            meshlets->Build(reinterpret_cast<const XMFLOAT3*>(vertexData), part.vertexStride, indices.data(), indices.size());
+
+        auto storeIndices = [isIndex16](const uint32_t* first, const uint32_t* last, uint8_t* destination)
+        {
+            if (isIndex16)
+                std::transform(first, last, reinterpret_cast<uint16_t*>(destination),
+                    [](uint32_t index) { return static_cast<uint16_t>(index); });
+            else
+                std::copy(first, last, reinterpret_cast<uint32_t*>(destination));
+        };
+
+        storeIndices(indices.data(), indices.data() + indices.size(), indexData);
+
+        if (!lods)
+            return;
+
+        // The chain's full detail level starts at 0 in indices, which is this part's range of the buffer.
+        MeshSimplifier::BuildLodChain(indices, reinterpret_cast<const XMFLOAT3*>(vertexData), part.vertexStride, vertexCount, *lods);
+        (*lods)[0].startIndex = part.startIndex;
+        if (lods->size() == 1)
+            return;
+
+        // The levels go after the whole buffer, in a new copy, as the loader gives no other part this one's copy.
+        const size_t firstIndex = part.indexBufferSize / indexSize;
+        const size_t lodIndexCount = indices.size() - part.indexCount;
+
+        auto indexBuffer = GraphicsMemory::Get(device).Allocate(part.indexBufferSize + lodIndexCount * indexSize, 16, GraphicsMemory::TAG_INDEX);
+        memcpy(indexBuffer.Memory(), part.indexBuffer.Memory(), part.indexBufferSize);
+        storeIndices(indices.data() + part.indexCount, indices.data() + indices.size(),
+            static_cast<uint8_t*>(indexBuffer.Memory()) + part.indexBufferSize);
+
+        for (size_t i = 1; i < lods->size(); ++i)
+        {
+            (*lods)[i].startIndex += static_cast<uint32_t>(firstIndex - part.indexCount);
+        }
+
+        part.indexBufferSize = static_cast<uint32_t>(indexBuffer.Size());
+        part.indexBuffer = std::move(indexBuffer);
+    }
+}
+
 SDKMESHModel::SDKMESHModel(
     ID3D12Device* device,
     ID3D12CommandQueue* commandQueue,
     const wchar_t* renderingFile,
     const wchar_t* collisionFile) noexcept :
-   m_d3dDevice(device), m_commandQueue(commandQueue)
+   m_meshStatistics(), m_meshlets(), m_lods(), m_d3dDevice(device), m_commandQueue(commandQueue)
 //StaticModel::StaticModel(ID3D12Device* device, const wchar_t* renderingFile, const wchar_t* collisionFile) noexcept
 {
     m_renderingModel = Model::CreateFromSDKMESH(device, renderingFile);
@@ -26,6 +131,9 @@ SDKMESHModel::SDKMESHModel(
 void SDKMESHModel::UploadModels()
 //void StaticModel::GetModelData(DirectX::Model const& model)
 {
+    // The collision model is only queried through m_collisionMesh, so its triangle order doesn't matter.
+    OptimizeMesh();
+
     ResourceUploadBatch resourceUpload(m_d3dDevice);
     resourceUpload.Begin();
 
@@ -45,5 +153,87 @@ void SDKMESHModel::UploadModels()
     m_indexFormat = meshPart->indexFormat;
     m_triangles   = meshPart->indexCount / 3;
 
-    //OptimizeMesh();
+    // Build the collision spatial index once, rather than walking every triangle per query.
+    const bool isIndex16 = m_indexFormat == DXGI_FORMAT_R16_UINT;
+    m_collisionMesh.Build(&m_vertices->Position, meshPart->vertexStride,
+        isIndex16 ? m_indices16 : nullptr, isIndex16 ? nullptr : m_indices32, m_triangles);
+}
+
+void SDKMESHModel::OptimizeMesh()
+{
+    m_meshlets.resize(m_renderingModel->meshes.size());
+    m_lods.resize(m_renderingModel->meshes.size());
+
+    for (size_t i = 0; i < m_renderingModel->meshes.size(); ++i)
+    {
+        auto& modelMesh = m_renderingModel->meshes[i];
+        m_meshlets[i].resize(modelMesh->opaqueMeshParts.size());
+        m_lods[i].resize(modelMesh->opaqueMeshParts.size());
+
+        for (size_t j = 0; j < modelMesh->opaqueMeshParts.size(); ++j)
+        {
+            auto& meshPart = *modelMesh->opaqueMeshParts[j];
+
+            // A part that can't be simplified keeps just its full detail level.
+            m_lods[i][j] = { { meshPart.startIndex, meshPart.indexCount, 0.0f } };
+
+            OptimizeMeshPart(m_d3dDevice, meshPart, m_meshStatistics, &m_meshlets[i][j], &m_lods[i][j]);
+        }
+
+        for (auto& meshPart : modelMesh->alphaMeshParts)
+        {
+            OptimizeMeshPart(m_d3dDevice, *meshPart, m_meshStatistics, nullptr, nullptr);
+        }
+    }
+}
+
+size_t SDKMESHModel::SelectLod(
+    size_t meshPos,
+    size_t meshPartPos,
+    Vector3 const& cameraPosition,
+    float projectionScale,
+    float maxPixelError) const noexcept
+{
+    const auto& lods = m_lods.at(meshPos).at(meshPartPos);
+    const auto& modelBounds = m_renderingModel->meshes.at(meshPos)->boundingSphere;
+
+    BoundingSphere bounds;
+    modelBounds.Transform(bounds, m_world);
+
+    // Inside the sphere, any part of the mesh may be right in front of the camera.
+    const auto distance = Vector3::Distance(cameraPosition, bounds.Center) - bounds.Radius;
+    if (distance <= 0.0f)
+        return 0;
+
+    // Level errors are in model space, so they scale with the world matrix.
+    const auto scale = modelBounds.Radius > 0.0f ? bounds.Radius / modelBounds.Radius : 1.0f;
+    const auto maxError = maxPixelError * distance / (projectionScale * scale);
+
+    size_t lod = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error <= maxError)
+        ++lod;
+
+    return lod;
+}
+
+void SDKMESHModel::Draw(size_t meshPos, size_t meshPartPos, size_t lod, ID3D12GraphicsCommandList* cmdList)
+{
+    auto& modelMesh = m_renderingModel->meshes.at(meshPos);
+    auto& meshPart  = modelMesh->opaqueMeshParts.at(meshPartPos);
+    const auto& level = m_lods.at(meshPos).at(meshPartPos).at(lod);
+
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+    vertexBufferView.BufferLocation = meshPart->staticVertexBuffer->GetGPUVirtualAddress();
+    vertexBufferView.StrideInBytes  = meshPart->vertexStride;
+    vertexBufferView.SizeInBytes    = meshPart->vertexBufferSize;
+    cmdList->IASetVertexBuffers(0, 1, &vertexBufferView);
+
+    D3D12_INDEX_BUFFER_VIEW indexBufferView;
+    indexBufferView.BufferLocation = meshPart->staticIndexBuffer->GetGPUVirtualAddress();
+    indexBufferView.SizeInBytes    = meshPart->indexBufferSize;
+    indexBufferView.Format         = meshPart->indexFormat;
+    cmdList->IASetIndexBuffer(&indexBufferView);
+
+    cmdList->IASetPrimitiveTopology(meshPart->primitiveType);
+    cmdList->DrawIndexedInstanced(level.indexCount, 1, level.startIndex, meshPart->vertexOffset, 0);
 }
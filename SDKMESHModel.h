@@ -5,6 +5,8 @@
 
 #pragma once
 
+// CollisionMesh.h, MeshOptimizer.h, Meshlets.h and MeshSimplifier.h must be in the #include list before this header.
+
 class SDKMESHModel
 {
 public:
@@ -70,12 +72,26 @@ private:
     uint32_t*   m_indices32;
     uint32_t    m_triangles;
 
+    CollisionMesh m_collisionMesh; // Spatial index over the collision model triangles.
+
+    // Vertex cache cost of the rendering model as loaded and as optimized.
+    MeshOptimizer::MeshStatistics m_meshStatistics;
+
+    // Meshlets of each opaque part of the rendering model, indexed by mesh then part.
+    std::vector<std::vector<Meshlets>> m_meshlets;
+
+    // Levels of detail of each opaque part of the rendering model, indexed by mesh then part, full detail first.
+    std::vector<std::vector<std::vector<MeshSimplifier::Lod>>> m_lods;
+
     ID3D12Device*       m_d3dDevice;
     ID3D12CommandQueue* m_commandQueue;
 
 private:
     void UploadModels();
-    //VOID OptimizeMesh();
+
+    // Reorders the rendering model's triangles and vertices in its CPU copies, before they are uploaded, and builds
+    // the meshlets and levels of detail of its opaque parts from the new order.
+    void OptimizeMesh();
 
 public:
     //void GetModelData(DirectX::Model const& model);
@@ -115,12 +131,12 @@ public:
         //return meshPart->indexBufferSize / static_cast<uint32_t>(sizeof(uint16_t));
     }
 
-    //const auto GetIndexStart(size_t meshPos, size_t meshPartPos) const noexcept
-    //{
-    //    auto& modelMesh = m_renderingModel->meshes.at(meshPos);
-    //    auto& meshPart = modelMesh->opaqueMeshParts.at(meshPartPos);
-    //    return meshPart->startIndex;
-    //}
+    const auto GetIndexStart(size_t meshPos, size_t meshPartPos) const noexcept
+    {
+        auto& modelMesh = m_renderingModel->meshes.at(meshPos);
+        auto& meshPart  = modelMesh->opaqueMeshParts.at(meshPartPos);
+        return meshPart->startIndex;
+    }
 
     const auto GetIndexFormat(size_t meshPos, size_t meshPartPos) const noexcept
     {
@@ -150,6 +166,51 @@ public:
         return meshPart->vertexStride;
     }
 
+    const auto& GetMeshStatistics() const noexcept
+    {
+        return m_meshStatistics;
+    }
+
+    const auto GetMeshCount() const noexcept
+    {
+        return m_renderingModel->meshes.size();
+    }
+
+    const auto GetMeshPartCount(size_t meshPos) const noexcept
+    {
+        return m_renderingModel->meshes.at(meshPos)->opaqueMeshParts.size();
+    }
+
+    // Meshlets of an opaque part, in model space. Their vertex indices are relative to the part's vertex offset.
+    const Meshlets& GetMeshlets(size_t meshPos, size_t meshPartPos) const noexcept
+    {
+        return m_meshlets.at(meshPos).at(meshPartPos);
+    }
+
+    // Screen space error, in pixels, that SelectLod allows by default.
+    static constexpr float MaxLodPixelError = 1.0f;
+
+    const auto GetLodCount(size_t meshPos, size_t meshPartPos) const noexcept
+    {
+        return m_lods.at(meshPos).at(meshPartPos).size();
+    }
+
+    // Level 0 is the full detail part. Index ranges are in the part's index buffer, after its own indices.
+    const auto& GetLod(size_t meshPos, size_t meshPartPos, size_t lod) const noexcept
+    {
+        return m_lods.at(meshPos).at(meshPartPos).at(lod);
+    }
+
+    // Coarsest level of an opaque part whose error, seen from cameraPosition at the nearest point of the mesh's world
+    // space bounding sphere, projects to at most maxPixelError pixels. projectionScale is the viewport height in
+    // pixels over 2 tan(fovY / 2).
+    size_t SelectLod(
+        size_t meshPos,
+        size_t meshPartPos,
+        DirectX::SimpleMath::Vector3 const& cameraPosition,
+        float projectionScale,
+        float maxPixelError = MaxLodPixelError) const noexcept;
+
     //void SetPosition(DirectX::SimpleMath::Vector3 const& pos) { m_position = pos; }
     void SetWorld(DirectX::SimpleMath::Vector3 const& pos,
                   DirectX::SimpleMath::Vector3 const& orient) noexcept
@@ -212,6 +273,9 @@ public:
         meshPart->Draw(cmdList);
     }
 
+    // Draws one level of detail of an opaque part.
+    void Draw(size_t meshPos, size_t meshPartPos, size_t lod, ID3D12GraphicsCommandList* cmdList);
+
     // Returns raw pointer to model for read only usage by caller.
     //const auto GetRenderingModel() const            { return m_renderingModel.get(); }
 
@@ -255,6 +319,24 @@ public:
         return m_triangles;
     }
 
+    const CollisionMesh& GetCollisionMesh() const noexcept
+    {
+        return m_collisionMesh;
+    }
+
+    // Interpolated ground height and upward surface normal at (x, z), in collision model space.
+    bool GetGroundHeight(float x, float z, float& height, DirectX::SimpleMath::Vector3& normal) const
+    {
+        return m_collisionMesh.GetGroundHeight(x, z, height, normal);
+    }
+
+    // Ground height and normal of the first surface straight down from origin, within maxDistance.
+    bool RaycastDown(DirectX::SimpleMath::Vector3 const& origin, float maxDistance,
+                     float& height, DirectX::SimpleMath::Vector3& normal) const
+    {
+        return m_collisionMesh.RaycastDown(origin, maxDistance, height, normal);
+    }
+
     const auto GetBoundingBox(size_t meshPos) const noexcept
     {
         auto& modelMesh = m_collisionModel->meshes.at(meshPos);
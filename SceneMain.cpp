@@ -18,6 +18,9 @@ SceneMain::SceneMain(Game* game, bool isRaster) noexcept
     m_blasBuffers[BLASType::Dynamic] = std::make_unique<AccelerationStructureBuffers[]>(DynamicBLAS::dynamicCount);
     m_geometryDesc = std::make_unique<D3D12_RAYTRACING_GEOMETRY_DESC[]>(SceneGeometries::sceneCount);
     m_tlasInstanceDesc = std::make_unique<D3D12_RAYTRACING_INSTANCE_DESC[]>(TLASInstances::tlasCount); // Make shared?
+    m_doveLodLevel = 0;
+    m_isDoveSkinningDirty = true;
+    m_broadPhase = std::make_unique<BroadPhase>();
 
     Initialize();
 }
@@ -66,6 +69,14 @@ void SceneMain::Initialize()
     XMStoreFloat3x4(&m_cubeTransforms3x4[2], transform);
     m_cubeTransforms4x4[2] = transform;
 
+    // Add the dynamic objects to the broad phase in DynamicObjects order, so each proxy is its object's index.
+    // Their bounds are set on every Update.
+    for (uint32_t i = 0; i < DynamicObjects::dynamicObjectCount; i++)
+    {
+        [[maybe_unused]] const auto proxy = m_broadPhase->Add(BoundingBox());
+        assert(proxy == i);
+    }
+
     // Initial static model world transforms.
     //m_suzanne->SetPosition(Vector3(0, 1,-2));
     //auto& world = Matrix::CreateTranslation(m_suzanne->GetPosition());
@@ -98,6 +109,7 @@ void SceneMain::Initialize()
 
     sdkMeshModel = m_game->GetSdkMeshModel(SDKMESHModels::MiniRacecar);
     sdkMeshModel->SetWorld(Vector3(6, 0, 12), -Vector3::UnitZ, Vector3::Up);
+    m_simulation = std::make_unique<Simulation>(sdkMeshModel->GetPosition(), sdkMeshModel->GetForward(), sdkMeshModel->GetBoundingBox(0));
     //m_SDKMESHModel[SDKMESHModels::MiniRacecar]->SetWorld(Vector3(6, 0, 12), -Vector3::UnitZ, Vector3::Up);
     //m_miniracecar->SetWorld(Vector3(6, 0, 12), Vector3(0, XM_PI, 0));
     //m_miniracecar->SetWorld(Vector3(6, 0, -1), Vector3::Zero);
@@ -108,6 +120,10 @@ void SceneMain::Initialize()
 
     auto fbxModel = m_game->GetFbxModel(FBXModels::Dove);
     fbxModel->SetWorld(Vector3(0, 0.15f, 12), Vector3::Zero);
+
+    // Pose the dove once, so its animated bounds are valid for choosing its first animation level of detail.
+    fbxModel->AdvanceTime(0.0f);
+    m_doveLod = std::make_unique<AnimationLodManager>(fbxModel->GetSkeleton());
     //m_FBXModel[FBXModels::Dove]->SetWorld(Vector3(0, 0.15f, 12), Vector3::Zero);
     //m_dove->SetWorld(world);
 
@@ -162,6 +178,8 @@ void SceneMain::Initialize()
     deviceResources->ExecuteCommandList();  // Start acceleration structure construction.
     deviceResources->WaitForGpu();          // Wait for GPU to finish (any locally created temp GPU resources will get released once we
                                             // go out of scope.
+
+    m_simulation->Start();
 }
 
 void SceneMain::Update()
@@ -242,18 +260,29 @@ void SceneMain::Update()
 
     // Test camera position for collision with the model forming the ground plane.
     BoundingSphere cameraSphere = { m_camera->GetPosition3f() , 0.5f }; // Bounding sphere centre and radius.
-    CollisionTriangle groundTriangle = {};
+    //CollisionTriangle groundTriangle = {};
 
     // Get pointer to current model.
     auto sdkMeshModel = m_game->GetSdkMeshModel(SDKMESHModels::Racetrack);
     //auto sdkMeshModel = m_SDKMESHModel[SDKMESHModels::Racetrack].get();
 
-    m_game->TestGroundCollision(sdkMeshModel, cameraSphere, groundTriangle);
+    //m_game->TestGroundCollision(sdkMeshModel, cameraSphere, groundTriangle);
     //TestGroundCollision(m_SDKMESHModel[SDKMESHModels::Racetrack].get(), cameraSphere, groundTriangle);
 
-    if (groundTriangle.collision == ContainmentType::INTERSECTS)
+    //if (groundTriangle.collision == ContainmentType::INTERSECTS)
+    //{
+    //    const auto groundHeight = (groundTriangle.pointa.y + groundTriangle.pointb.y + groundTriangle.pointc.y) / 3.f;
+    //    m_camera->SetPosition(cameraSphere.Center.x, groundHeight + cameraSphere.Radius, cameraSphere.Center.z);
+    //}
+
+    // Keep the camera one sphere radius above the ground whenever it comes within one radius of the surface.
+    // The height is interpolated across the triangle, so the camera follows slopes smoothly.
+    float groundHeight = 0.f;
+    Vector3 groundNormal;
+    const Vector3 rayOrigin = { cameraSphere.Center.x, cameraSphere.Center.y + cameraSphere.Radius, cameraSphere.Center.z };
+
+    if (sdkMeshModel->RaycastDown(rayOrigin, 2.f * cameraSphere.Radius, groundHeight, groundNormal))
     {
-        const auto groundHeight = (groundTriangle.pointa.y + groundTriangle.pointb.y + groundTriangle.pointc.y) / 3.f;
         m_camera->SetPosition(cameraSphere.Center.x, groundHeight + cameraSphere.Radius, cameraSphere.Center.z);
     }
 
@@ -356,188 +385,113 @@ void SceneMain::Update()
     //BuildTopLevelAS(m_blasBuffers, true); // update TLAS with new blas instance data
     //UpdateTopLevelAS(m_blasBuffers); // update TLAS with new blas instance data
 
+    // Car physics and AI run at a fixed rate on the simulation thread. Pass it this frame's controls, and place the
+    // car where it is now, interpolated between the simulation's last two ticks.
+    m_simulation->SetInput({ keyState.Up, keyState.B, keyTracker->released.N });
+
+    const auto car = m_simulation->GetCar();
     sdkMeshModel = m_game->GetSdkMeshModel(SDKMESHModels::MiniRacecar); // Update model pointer.
-    //sdkMeshModel = m_SDKMESHModel[SDKMESHModels::MiniRacecar].get(); // Update model pointer.
+    sdkMeshModel->SetWorld(car.position, car.forward, Vector3(0, 1, 0));
 
-    // Update mini race car track position.
-    static CarState carState =
+    // Pass game time to FbxLoader to update bone palette.
+    //auto fbxModel = m_FBXModel[FBXModels::Dove].get();
+    // Choose the dove's animation level of detail from its size on screen, and pose it only on the frames its level
+    // is due. In between the palette holds, and the dove is neither skinned nor refit, unless the level interpolates
+    // towards the pose sampled ahead, which changes the palette every frame.
+    // The bounds follow the palette, transformed from its per-bone boxes, so they track the wings as they flap.
+    BoundingSphere doveBounds;
+    fbxModel->GetBoundingSphere(0).Transform(doveBounds, fbxModel->GetWorld());
+    const auto outputSize = deviceResources->GetOutputSize();
+    m_doveLod->SetView(m_camera->GetPosition3f(), m_camera->GetFovY(), static_cast<float>(outputSize.bottom - outputSize.top));
+
+    const auto doveLodLevel = m_doveLod->SelectLevel(doveBounds, m_doveLodLevel);
+    if (doveLodLevel != m_doveLodLevel)
     {
-        0, 0, Vector3::Zero, // Car is stationary at beginning.
-    };
+        m_doveLodLevel = doveLodLevel;
+        fbxModel->ResetLod();
+    }
+
+    const auto& doveLevel = m_doveLod->GetLevel(doveLodLevel);
+    if (fbxModel->AdvanceTimeLod(totalTime, doveLevel.updateInterval, doveLevel.interpolate, m_doveLod->GetBoneRemap(doveLodLevel), elapsedTime))
+    {
+        m_isDoveSkinningDirty = true;
+    }
+    //m_dove->AdvanceTime(totalTime);
+
+    // Rotate dove.
+    //auto& world = Matrix::CreateRotationY(elapsedTime) * m_dove->GetWorld();
+    fbxModel->SetWorld(fbxModel->GetPosition(), Vector3(0, totalTime, 0));
+    //m_dove->SetWorld(m_dove->GetPosition(), Vector3(0, totalTime, 0));
+    //m_dove->SetWorld(world);
 
-    // Apply physical forces to moving scene objects.
-    // Apply gravity.
-    //if (doPhysics)
-    //    carState.velocity = carState.velocity + PhysicsConstants::gravity * elapsedTime;
+    TestDynamicCollisions();
 
-    const auto speed = carState.velocity.Length();
-    bool isPowered = false; // Flag to indicate car is under power from accelerator, brake or reverse gear.
-    static bool isAutoNav = false; // Flag to switch car switch car control to auto navigation.
+    //PIXEndEvent();
+}
 
-    // Set car's velocity to zero if speed is under threshold.
-    //if (speed < 0.005f)
-    //{
-    //    carState.velocity = Vector3::Zero;
-    //    speed = 0;
-    //}
+void SceneMain::TestDynamicCollisions()
+{
+    // Update the world shapes of the dynamic objects, and their axis-aligned bounds in the broad phase.
+    const BoundingOrientedBox cubeBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0.1f, 0.1f, 0.1f), XMFLOAT4(0, 0, 0, 1));
+    for (uint32_t i = 0; i < SceneMain::CubeInstanceCount; i++)
+        cubeBox.Transform(m_dynamicBoxes[DynamicObjects::dynamicRedCube + i].obox, m_cubeTransforms4x4[i]);
 
-    // Apply car control from user input.
-    Vector3 worldAccel = {};
-    Vector3 worldReverse = {};
-    //Vector3 worldBrake = {};
-    auto carPos = sdkMeshModel->GetPosition();
-    auto carOrient = sdkMeshModel->GetOrientation();
-    auto carForward = sdkMeshModel->GetForward();
-    //auto carPos = m_miniracecar->GetPosition();
-    //auto carOrient = m_miniracecar->GetOrientation();
-    //auto carForward = m_miniracecar->GetForward();
-
-    // Start auto navigation.
-    if (keyTracker->released.N)
-    {
-        isAutoNav = true;
-    }
-    // Acceleration.
-    if (keyState.Up)
-    {
-        if (speed < PhysicsConstants::MaxSpeed * elapsedTime)
-            // Transform forward acceleration to current orientation.
-            Vector3::TransformNormal(PhysicsConstants::ForwardAccel, sdkMeshModel->GetWorld(), worldAccel);
-        //Vector3::TransformNormal(PhysicsConstants::ForwardAccel, m_miniracecar->GetWorld(), worldAccel);
-        //carState.velocity = carState.velocity + worldAccel * elapsedTime;
-        isPowered = true;
-    }
-    // Reverse.
-    if (keyState.Down)
-    {
-        if (speed < PhysicsConstants::MaxReverse * elapsedTime)
-            // Transform brake force to current orientation.
-            Vector3::TransformNormal(PhysicsConstants::ReverseAccel, sdkMeshModel->GetWorld(), worldReverse);
-        //Vector3::TransformNormal(PhysicsConstants::ReverseAccel, m_miniracecar->GetWorld(), worldReverse);
-        //carState.velocity = carState.velocity + worldBrake * elapsedTime;
-        //auto brake = carState.velocity + worldBrake * elapsedTime;
-        //carState.velocity.Clamp(Vector3::Zero, brake);
-        //carState.velocity = Vector3::Max(Vector3::Zero, brake);
-        isPowered = true;
-    }
-    // Brake.
-    if (keyState.B && speed)
-    {
-        carState.velocity *= 1 - PhysicsConstants::BrakeForce;
-        // Transform forward acceleration to current orientation.
-        //Vector3::TransformNormal(PhysicsConstants::brakeForce, m_miniracecar->GetWorld(), worldBrake);
-        //carState.velocity = carState.velocity + worldAccel * elapsedTime;
-    }
-    // Turn right.
-    if (keyState.Right)
+    const auto racecar = m_game->GetSdkMeshModel(SDKMESHModels::MiniRacecar);
+    BoundingOrientedBox racecarBox;
+    BoundingOrientedBox::CreateFromBoundingBox(racecarBox, racecar->GetBoundingBox(0));
+    racecarBox.Transform(m_dynamicBoxes[DynamicObjects::dynamicMiniRacecar].obox, racecar->GetWorld());
+
+    const auto dove = m_game->GetFbxModel(FBXModels::Dove);
+    auto& doveSphere = m_dynamicSpheres[DynamicObjects::dynamicDoveSphere - DynamicBoxCount].sphere;
+    dove->GetBoundingSphere(0).Transform(doveSphere, dove->GetWorld());
+
+    auto& cameraSphere = m_dynamicSpheres[DynamicObjects::dynamicCameraSphere - DynamicBoxCount].sphere;
+    cameraSphere = { m_camera->GetPosition3f(), 0.5f };
+
+    for (uint32_t i = 0; i < DynamicBoxCount; i++)
     {
-        carOrient.y -= PhysicsConstants::RotationGain * elapsedTime * speed;
+        XMFLOAT3 corners[BoundingOrientedBox::CORNER_COUNT];
+        m_dynamicBoxes[i].obox.GetCorners(corners);
+
+        BoundingBox bounds;
+        BoundingBox::CreateFromPoints(bounds, BoundingOrientedBox::CORNER_COUNT, corners, sizeof(XMFLOAT3));
+        m_broadPhase->Update(i, bounds);
+        m_dynamicBoxes[i].collision = ContainmentType::DISJOINT;
     }
-    // Turn left.
-    if (keyState.Left)
+
+    for (uint32_t i = 0; i < DynamicSphereCount; i++)
     {
-        carOrient.y += PhysicsConstants::RotationGain * elapsedTime * speed;
+        BoundingBox bounds;
+        BoundingBox::CreateFromSphere(bounds, m_dynamicSpheres[i].sphere);
+        m_broadPhase->Update(DynamicBoxCount + i, bounds);
+        m_dynamicSpheres[i].collision = ContainmentType::DISJOINT;
     }
 
-    // Auto navigation.
-    const uint32_t lastCheckPtId = static_cast<uint32_t>(Racetracks::track.size()) - 1;
-    const uint32_t nextCheckPtId = carState.nextCheckpoint;
-    const uint32_t prevCheckPtId = nextCheckPtId ? nextCheckPtId - 1 : lastCheckPtId; // If cp0 is next, cpLast is previous.
-    const auto& nextCheckPt = Racetracks::track[nextCheckPtId];
-    const auto& prevCheckPt = Racetracks::track[prevCheckPtId];
+    // Only the pairs whose bounds overlap need their shapes tested.
+    m_broadPhase->FindPairs();
 
-    if (isAutoNav)
+    const auto collision = [this](uint32_t object) -> ContainmentType&
     {
-        // Get vector to next checkpoint target.
-        const auto nextTarget = Vector3::Lerp(nextCheckPt.signpost1, nextCheckPt.signpost2, 0.5f); // Target halfway b/n signposts.
-        const auto prevTarget = Vector3::Lerp(prevCheckPt.signpost1, prevCheckPt.signpost2, 0.5f); // Target halfway b/n signposts.
-        auto targetVector = nextTarget - carPos;
-
-        // Normalize and scale target vector by acceleration factor.
-        targetVector.Normalize();
-        worldAccel = PhysicsConstants::Acceleration * targetVector;
-
-        // Update car orientation.
-        const auto stageDist = Vector3::DistanceSquared(prevTarget, nextTarget);
-        const auto distInStage = Vector3::Distance(prevTarget, carPos);
-        const auto t = distInStage / stageDist;
-        //carOrient.y  = std::lerp(carOrient.y, nextCheckPt.orientation, t);
-        carForward = Vector3::Lerp(carForward, nextCheckPt.forward, t);
-    }
+        return object < DynamicBoxCount ? m_dynamicBoxes[object].collision : m_dynamicSpheres[object - DynamicBoxCount].collision;
+    };
 
-    //carState.velocity = carState.velocity + worldDrag * elapsedTime;
-    //auto drag = carState.velocity + worldDrag * elapsedTime;
-    //carState.velocity.Clamp(Vector3::Zero, drag);
-    //carState.velocity = Vector3::Max(Vector3::Zero, drag);
-
-    // Update velocity and position.
-    // Using v = u + at
-    carState.velocity += worldAccel * elapsedTime;
-    //carState.velocity += (worldAccel + worldReverse) * elapsedTime;
-    const auto speedLimit = nextCheckPt.speedLimit * PhysicsConstants::KphToMps * elapsedTime;
-    if (speed > speedLimit)
-        carState.velocity *= 1 - PhysicsConstants::BrakeForce;
-
-    // Apply drag only when car is unpowered.
-    //if (!isPowered || !isAutoNav)
-    //    carState.velocity *= 1 - PhysicsConstants::DragCoeff;
-    //    //carState.velocity = Vector3::Max(v, PhysicsConstants::terminalVel);
-
-    carPos += carState.velocity; // position + velocity = new position
-    //auto carPos = m_miniracecar->GetPosition() + carState.velocity; // position + velocity = new position
-
-    sdkMeshModel->SetWorld(carPos, carForward, Vector3(0, 1, 0));
-    //m_miniracecar->SetWorld(carPos, carForward, Vector3(0,1,0));
-    //m_miniracecar->SetWorld(carPos, carOrient);
-    //m_miniracecar->SetWorld(carPos, m_miniracecar->GetOrientation());
-
-    // Test for contact with track surface and checkpoints.
-    BoundingBox worldBox = {};
-    const auto carBox = sdkMeshModel->GetBoundingBox(0);
-    //auto carBox = m_miniracecar->GetBoundingBox(0);
-    carBox.Transform(worldBox, sdkMeshModel->GetWorld());
-    //carBox.Transform(worldBox, m_miniracecar->GetWorld());
-
-    CollisionRay checkPtRay = { nextCheckPt.signpost1, nextCheckPt.signpost2 - nextCheckPt.signpost1 };
-    checkPtRay.direction.Normalize();// Collision ray direction must be normalized.
-    float fdist = 0;                    // Required by intersection ray-box intersection test but unused. 
-
-    if (worldBox.Intersects(checkPtRay.origin, checkPtRay.direction, fdist))
+    for (const auto& pair : m_broadPhase->GetPairs())
     {
-        if (nextCheckPtId < lastCheckPtId)
-            carState.nextCheckpoint++;
+        // Pairs are ordered, so a box is always first and a sphere always second.
+        bool intersects;
+        if (pair.second < DynamicBoxCount)
+            intersects = m_dynamicBoxes[pair.first].obox.Intersects(m_dynamicBoxes[pair.second].obox);
+        else if (pair.first < DynamicBoxCount)
+            intersects = m_dynamicBoxes[pair.first].obox.Intersects(m_dynamicSpheres[pair.second - DynamicBoxCount].sphere);
         else
-            carState.nextCheckpoint = 0;
-    }
-    /*
-    TestGroundCollision(m_racetrack.get(), worldBox, groundTriangle);
+            intersects = m_dynamicSpheres[pair.first - DynamicBoxCount].sphere.Intersects(m_dynamicSpheres[pair.second - DynamicBoxCount].sphere);
 
-    if (groundTriangle.collision == ContainmentType::INTERSECTS)
-    {
-        //carState.velocity = Vector3::Zero;
-        auto groundHeight = (groundTriangle.pointa.y + groundTriangle.pointb.y + groundTriangle.pointc.y) / 3.f;
-        auto carPos = m_miniracecar->GetPosition();
-        m_miniracecar->SetWorld(Vector3(carPos.x, groundHeight, carPos.z), m_miniracecar->GetOrientation());
+        if (intersects)
+        {
+            collision(pair.first)  = ContainmentType::INTERSECTS;
+            collision(pair.second) = ContainmentType::INTERSECTS;
+        }
     }
-    */
-    //else
-    //{
-    //    m_miniracecar->SetWorld(m_miniracecar->GetPosition(), m_miniracecar->GetOrientation());
-    //    //m_miniracecar->SetWorld(m_miniracecar->GetPosition(), Vector3(0, -totalTime / 4.f, 0));
-    //}
-
-    // Pass game time to FbxLoader to update bone palette.
-    //auto fbxModel = m_FBXModel[FBXModels::Dove].get();
-    fbxModel->AdvanceTime(totalTime);
-    //m_dove->AdvanceTime(totalTime);
-
-    // Rotate dove.
-    //auto& world = Matrix::CreateRotationY(elapsedTime) * m_dove->GetWorld();
-    fbxModel->SetWorld(fbxModel->GetPosition(), Vector3(0, totalTime, 0));
-    //m_dove->SetWorld(m_dove->GetPosition(), Vector3(0, totalTime, 0));
-    //m_dove->SetWorld(world);
-
-    //PIXEndEvent();
 }
 
 void SceneMain::Render()
@@ -577,45 +531,57 @@ void SceneMain::Render()
     //    shadowManager->CopyPreviousFrameBuffer(commandList);
     //}
 
-    // Reset compute command list and allocator.
-    deviceResources->ResetComputeCommandList();
-    const auto computeCommandList = deviceResources->GetComputeCommandList();
-
-    // Set the descriptor heap and root signature on the compute command list.
     const auto descHeap = m_game->GetDescriptorHeap(DescriptorHeaps::SrvUav);
     auto rootSig = m_game->GetRootSignature(RootSignatures::Compute);
     ID3D12DescriptorHeap* heap[] = { descHeap->Heap() };
-    computeCommandList->SetDescriptorHeaps(1, heap);
-    computeCommandList->SetComputeRootSignature(rootSig);
-    //commandList->SetComputeRootSignature(m_rootSig[RootSignatures::ComputeSkinning].Get());
+    const auto graphicsMemory = m_game->GetGraphicsMemory();
+    ID3D12PipelineState* pipelineState = nullptr;
 
-    // Perform vertex skinning asnynchronously on the compute queue.
-    auto fbxModel = m_game->GetFbxModel(FBXModels::Dove);
-    const auto paletteSize = fbxModel->GetBonePaletteSize();
-    //auto paletteSize = m_dove->GetBonePaletteSize();
+    // Skin the dove and refit its BLAS only if it was posed since it was last skinned. Between updates of its
+    // animation level of detail the palette holds, and skinning would reproduce the vertices already in the buffer.
+    const auto isDoveSkinned = m_isDoveSkinningDirty;
+    m_isDoveSkinningDirty = false;
+
+    if (isDoveSkinned)
+    {
+        // Reset compute command list and allocator.
+        deviceResources->ResetComputeCommandList();
+        const auto computeCommandList = deviceResources->GetComputeCommandList();
+
+        // Set the descriptor heap and root signature on the compute command list.
+        computeCommandList->SetDescriptorHeaps(1, heap);
+        computeCommandList->SetComputeRootSignature(rootSig);
+        //commandList->SetComputeRootSignature(m_rootSig[RootSignatures::ComputeSkinning].Get());
+
+        // Perform vertex skinning asnynchronously on the compute queue.
+        auto fbxModel = m_game->GetFbxModel(FBXModels::Dove);
+        // The dual quaternion palette is 8 floats per bone rather than 12, so it also uploads less.
+        const auto dualQuaternion = fbxModel->GetSkinningMode() == FBXModel::SkinningMode::DualQuaternion;
+        const auto paletteSize = fbxModel->GetSkinningPaletteSize();
+        //auto paletteSize = m_dove->GetBonePaletteSize();
     
-    // The debug layer now requires explicit 256 byte alignment to bind the cbv.
-    const auto graphicsMemory = m_game->GetGraphicsMemory();
-    const auto boneCBMem = graphicsMemory->Allocate(paletteSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
-    memcpy(boneCBMem.Memory(), fbxModel->GetBonePalette3X4(), paletteSize);
-    //memcpy(cb0Memory.Memory(), m_dove->GetBonePalette3X4(), paletteSize);
-    computeCommandList->SetComputeRootConstantBufferView(ComputeRootSigParams::BoneCB, boneCBMem.GpuAddress());
-    //computeCommandList->SetComputeRootConstantBufferView(ComputeRootSigParams::FrameConstants, cb0Memory.GpuAddress());
-    auto pipelineState = m_game->GetPipelineState(PSOs::Skinning);
-    computeCommandList->SetPipelineState(pipelineState);
-    //commandList->SetComputeRootConstantBufferView(ComputeRootSigParams::FrameConstants, cb0Memory.GpuAddress());
-    //commandList->SetPipelineState(m_pipelineState[PSOs::ComputeSkinning].Get());
-
-    // How many groups do we need to dispatch to cover a batch of vertices, where each group covers 256 vertices?
-    // (64 is defined in the ComputeShader)
-    uint32_t numGroupsX = static_cast<uint32_t>(ceilf(static_cast<float>(fbxModel->GetVertexCount(0)) / 64.f));
-    //uint32_t numGroupsX = static_cast<uint32_t>(ceilf(static_cast<float>(m_dove->GetVertexCount(0)) / 256.f));
-    computeCommandList->Dispatch(numGroupsX, 1, 1);
-    //commandList->Dispatch(numGroupsX, 1, 1);
-
-    // Send the compute command list to the GPU for processing.
-    deviceResources->ExecuteAndWaitForGpuCompute();
-    graphicsMemory->Commit(deviceResources->GetComputeCommandQueue());
+        // The debug layer now requires explicit 256 byte alignment to bind the cbv.
+        const auto boneCBMem = graphicsMemory->Allocate(paletteSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+        memcpy(boneCBMem.Memory(), fbxModel->GetSkinningPalette(), paletteSize);
+        //memcpy(cb0Memory.Memory(), m_dove->GetBonePalette3X4(), paletteSize);
+        computeCommandList->SetComputeRootConstantBufferView(ComputeRootSigParams::BoneCB, boneCBMem.GpuAddress());
+        //computeCommandList->SetComputeRootConstantBufferView(ComputeRootSigParams::FrameConstants, cb0Memory.GpuAddress());
+        pipelineState = m_game->GetPipelineState(dualQuaternion ? PSOs::SkinningDualQuaternion : PSOs::Skinning);
+        computeCommandList->SetPipelineState(pipelineState);
+        //commandList->SetComputeRootConstantBufferView(ComputeRootSigParams::FrameConstants, cb0Memory.GpuAddress());
+        //commandList->SetPipelineState(m_pipelineState[PSOs::ComputeSkinning].Get());
+
+        // How many groups do we need to dispatch to cover a batch of vertices, where each group covers 256 vertices?
+        // (64 is defined in the ComputeShader)
+        uint32_t numGroupsX = static_cast<uint32_t>(ceilf(static_cast<float>(fbxModel->GetVertexCount(0)) / 64.f));
+        //uint32_t numGroupsX = static_cast<uint32_t>(ceilf(static_cast<float>(m_dove->GetVertexCount(0)) / 256.f));
+        computeCommandList->Dispatch(numGroupsX, 1, 1);
+        //commandList->Dispatch(numGroupsX, 1, 1);
+
+        // Send the compute command list to the GPU for processing.
+        deviceResources->ExecuteAndWaitForGpuCompute();
+        graphicsMemory->Commit(deviceResources->GetComputeCommandQueue());
+    }
 
     //D3D12_RESOURCE_BARRIER uavBarrier = {};
     //uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(m_dove->GetSkinnedVertexBuffer(0));
@@ -623,7 +589,8 @@ void SceneMain::Render()
 
     // Update acceleration structures.
     // Due to deformation of the dove's geometry by skinning, we need to rebuild the dynamic BLAS only.
-    BuildDynamicBLAS(device, commandList, true);  // Update BLAS with deformed bottom-level geometry.
+    if (isDoveSkinned)
+        BuildDynamicBLAS(device, commandList, true);  // Update BLAS with deformed bottom-level geometry.
     //m_game->BuildDynamicBLAS(device, commandList, true);  // Update BLAS with deformed bottom-level geometry.
     //BuildBLAS(device, commandList, false);  // Update BLAS with new bottom-level geometry data.
     BuildTLASInstanceDescs();
@@ -876,6 +843,10 @@ void SceneMain::Render()
 
         meshConstants.world = sdkMeshModel->GetWorld().Transpose();
 
+        // Each palmtree mesh draws the coarsest level of detail whose error stays under a pixel on screen.
+        const auto outputSize = deviceResources->GetOutputSize();
+        const auto projectionScale = 0.5f * static_cast<float>(outputSize.bottom - outputSize.top) / std::tan(0.5f * m_camera->GetFovY());
+
         for (uint32_t meshIndex = 0; meshIndex < 2; meshIndex++)
         {
             meshConstants.instanceID = ShaderInstances::instPalmtree + meshIndex;
@@ -902,7 +873,8 @@ void SceneMain::Render()
             commandList->SetGraphicsRootConstantBufferView(GraphicsRootSigParams::MeshCB, cb1Memory.GpuAddress());
             //auto& modelMesh = m_palmtree->GetRenderingModel()->meshes.at(meshIndex);
             //auto& meshPart  = modelMesh->opaqueMeshParts.at(0);
-            sdkMeshModel->Draw(meshIndex, 0, commandList);
+            const auto lod = sdkMeshModel->SelectLod(meshIndex, 0, m_camera->GetPosition3f(), projectionScale);
+            sdkMeshModel->Draw(meshIndex, 0, lod, commandList);
             //meshPart->Draw(commandList);
         }
 
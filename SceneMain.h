@@ -88,11 +88,40 @@ private:
     void BuildDynamicBLAS(ID3D12Device10* device, ID3D12GraphicsCommandList7* commandList, bool isUpdate);
     void BuildTLASInstanceDescs();
 
+    // Finds the dynamic objects whose bounds overlap with the broad phase, then tests each candidate pair's shapes.
+    void TestDynamicCollisions();
+
     std::unique_ptr<XMFLOAT3X4[]> m_cubeTransforms3x4;
     std::unique_ptr<Matrix[]>     m_cubeTransforms4x4;
 
     std::unique_ptr<StructuredBuffer<PrevFrameData>> m_prevFrameStructBuffer; // CPU writeable structured buffer.
 
+    // Car physics and AI, stepped on a thread of their own.
+    std::unique_ptr<Simulation> m_simulation;
+
+    // Animation level of detail of the dove.
+    std::unique_ptr<AnimationLodManager> m_doveLod;
+    uint32_t       m_doveLodLevel;
+    bool           m_isDoveSkinningDirty;   // The dove was posed since it was last skinned.
+
+    // Dynamic objects tested against each other for collision. Boxes come first, then spheres.
+    enum DynamicObjects
+    {
+        dynamicRedCube, dynamicGreenCube, dynamicBlueCube,
+        dynamicMiniRacecar,
+        dynamicSphereFirst,
+        dynamicDoveSphere = dynamicSphereFirst,
+        dynamicCameraSphere,
+        dynamicObjectCount
+    };
+
+    static constexpr uint32_t DynamicBoxCount    = DynamicObjects::dynamicSphereFirst;
+    static constexpr uint32_t DynamicSphereCount = DynamicObjects::dynamicObjectCount - DynamicObjects::dynamicSphereFirst;
+
+    std::unique_ptr<BroadPhase> m_broadPhase;   // Proxies are the DynamicObjects indexes.
+    CollisionBox    m_dynamicBoxes[DynamicBoxCount];
+    CollisionSphere m_dynamicSpheres[DynamicSphereCount];
+
 public:
 
     static constexpr uint32_t    CubeInstanceCount = 3; // number of raytraced cube instances
@@ -0,0 +1,259 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationStructs.h"
+#include "RacingLine.h"
+#include "SweptCollision.h"
+#include "Simulation.h"
+
+namespace
+{
+    // Right handed world matrix of a car at position facing forward, as SDKMESHModel::SetWorld builds it.
+    Matrix CreateCarWorld(const Vector3& position, const Vector3& forward) noexcept
+    {
+        const auto zaxis = XMVector3Normalize(forward);
+        const auto xaxis = XMVector3Normalize(XMVector3Cross(Vector3::Up, zaxis));
+        const auto yaxis = XMVector3Cross(zaxis, xaxis);
+
+        Matrix world;
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&world._11), xaxis);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&world._21), yaxis);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&world._31), zaxis);
+        world._14 = world._24 = world._34 = 0.f;
+        world._41 = position.x; world._42 = position.y; world._43 = position.z;
+        world._44 = 1.f;
+        return world;
+    }
+
+    int64_t GetCounter() noexcept
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+}
+
+Simulation::Simulation(const Vector3& carPosition, const Vector3& carForward, const BoundingBox& carBox) :
+    m_racingLine(Racetracks::track),
+    m_carState{ 0, 0, Vector3::Zero },  // Car is stationary at beginning.
+    m_carPosition(carPosition),
+    m_carForward(carForward),
+    m_carBox(carBox),
+    m_isAutoNav(false),
+    m_lineDistance(m_racingLine.FindNearest(carPosition)),
+    m_tick(0),
+    m_startTime(0),
+    m_isRunning(false),
+    m_input{},
+    m_snapshots{},
+    m_writeSnapshot(0),
+    m_currentSnapshot(1),
+    m_previousSnapshot(2)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    m_countsPerTick = static_cast<double>(frequency.QuadPart) * TickSeconds;
+    m_startTime = GetCounter();
+
+    // Both snapshots the renderer reads start out as the initial state.
+    Publish();
+    Publish();
+}
+
+Simulation::~Simulation()
+{
+    Stop();
+}
+
+void Simulation::Start()
+{
+    assert(!m_thread.joinable());
+
+    // The next tick is due a tick from now, however long the simulation was stopped.
+    m_startTime = GetCounter() - static_cast<int64_t>(m_tick * m_countsPerTick);
+
+    m_isRunning = true;
+    m_thread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop()
+{
+    m_isRunning = false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void Simulation::SetInput(const Input& input)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Auto navigation is latched here, as the frame that switches it on may be between ticks.
+    const auto isAutoNav = m_input.autoNav;
+    m_input = input;
+    m_input.autoNav |= isAutoNav;
+}
+
+void Simulation::Run()
+{
+    // Sleeps are rounded up to the scheduler period, 15.6 ms by default. That is nearly a tick, so most wakes would
+    // find no tick due and the rest two. A 1 ms period lets the thread wake within a millisecond of each tick.
+    timeBeginPeriod(1);
+
+    while (m_isRunning)
+    {
+        const auto elapsed = std::max(GetCounter() - m_startTime, int64_t(0));
+        auto ticksDue = static_cast<uint64_t>(static_cast<double>(elapsed) / m_countsPerTick);
+
+        // A longer stall, such as a debugger break, is skipped rather than simulated in a burst.
+        if (ticksDue > m_tick + MaxCatchUpTicks)
+        {
+            m_startTime += static_cast<int64_t>((ticksDue - m_tick - MaxCatchUpTicks) * m_countsPerTick);
+            ticksDue = m_tick + MaxCatchUpTicks;
+        }
+
+        // Runs every tick that is due.
+        while (m_tick < ticksDue && m_isRunning)
+            Step();
+
+        // Ticks are far cheaper than their interval, so sleep until the next is due instead of spinning.
+        const auto nextTickTime = m_startTime + static_cast<int64_t>((m_tick + 1) * m_countsPerTick);
+        const auto waitSeconds = static_cast<double>(nextTickTime - GetCounter()) / m_countsPerTick * TickSeconds;
+
+        if (waitSeconds > 0)
+            std::this_thread::sleep_for(std::chrono::duration<double>(waitSeconds));
+    }
+
+    timeEndPeriod(1);
+}
+
+void Simulation::Step()
+{
+    Input input;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        input = m_input;
+    }
+
+    StepCar(input);
+    ++m_tick;
+
+    Publish();
+}
+
+void Simulation::StepCar(const Input& input)
+{
+    // The physics are unchanged from the per-frame update, which ran them once per frame with velocity in metres per
+    // frame. Stepping at a fixed rate makes that a constant, so the car now behaves as it did at 60 frames per second.
+    constexpr auto elapsedTime = static_cast<float>(TickSeconds);
+
+    auto& carState = m_carState;
+    const auto speed = carState.velocity.Length();
+
+    // Start auto navigation.
+    if (input.autoNav)
+    {
+        m_isAutoNav = true;
+    }
+
+    // Apply car control from user input.
+    Vector3 worldAccel = {};
+
+    // Acceleration.
+    if (input.accelerate)
+    {
+        if (speed < PhysicsConstants::MaxSpeed * elapsedTime)
+            // Transform forward acceleration to current orientation.
+            Vector3::TransformNormal(PhysicsConstants::ForwardAccel, CreateCarWorld(m_carPosition, m_carForward), worldAccel);
+    }
+    // Brake.
+    if (input.brake && speed)
+    {
+        carState.velocity *= 1 - PhysicsConstants::BrakeForce;
+    }
+
+    // Auto navigation.
+    const uint32_t lastCheckPtId = static_cast<uint32_t>(Racetracks::track.size()) - 1;
+    const uint32_t nextCheckPtId = carState.nextCheckpoint;
+    const auto& nextCheckPt = Racetracks::track[nextCheckPtId];
+    auto speedLimit = nextCheckPt.speedLimit * PhysicsConstants::KphToMps;
+
+    if (m_isAutoNav)
+    {
+        // Follow the racing line, steering for a point ahead on it at its speed limit.
+        m_lineDistance = m_racingLine.Track(m_carPosition, m_lineDistance);
+        worldAccel = m_racingLine.Steer(m_carPosition, carState.velocity, m_lineDistance, elapsedTime, &speedLimit);
+
+        // Face the direction of travel.
+        if (speed)
+            m_carForward = carState.velocity / speed;
+    }
+
+    // Update velocity and position.
+    // Using v = u + at
+    carState.velocity += worldAccel * elapsedTime;
+    speedLimit *= elapsedTime;
+    if (speed > speedLimit)
+        carState.velocity *= 1 - PhysicsConstants::BrakeForce;
+
+    m_carPosition += carState.velocity; // position + velocity = new position
+
+    // Test for contact with checkpoints, sweeping the box from where the car was at the start of the tick, so a fast
+    // car can't be carried through the gate between the signposts without touching it.
+    BoundingBox worldBox = {};
+    m_carBox.Transform(worldBox, CreateCarWorld(m_carPosition, m_carForward));
+
+    BoundingBox prevWorldBox = worldBox;
+    prevWorldBox.Center = Vector3(worldBox.Center) - carState.velocity;
+    float timeOfImpact = 0;
+
+    if (SweptCollision::SweepBoxSegment(prevWorldBox, carState.velocity, nextCheckPt.signpost1, nextCheckPt.signpost2, timeOfImpact))
+    {
+        if (nextCheckPtId < lastCheckPtId)
+            carState.nextCheckpoint++;
+        else
+            carState.nextCheckpoint = 0;
+    }
+}
+
+void Simulation::Publish()
+{
+    auto& snapshot = m_snapshots[m_writeSnapshot];
+    snapshot.tick = m_tick;
+    snapshot.time = m_startTime + static_cast<int64_t>(m_tick * m_countsPerTick);
+    snapshot.car  = { m_carPosition, m_carForward, m_carState.velocity, m_carState.nextCheckpoint };
+
+    // The oldest snapshot becomes the next one written.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::swap(m_previousSnapshot, m_currentSnapshot);
+    std::swap(m_currentSnapshot, m_writeSnapshot);
+}
+
+Simulation::CarSnapshot Simulation::GetCar() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto& previous = m_snapshots[m_previousSnapshot];
+    const auto& current  = m_snapshots[m_currentSnapshot];
+
+    // Show the previous snapshot when the current one is due, reaching the current one a tick later, when the next is
+    // due. Past that the simulation has stalled, so hold at the current one.
+    const auto alpha = std::clamp(static_cast<float>((GetCounter() - current.time) / m_countsPerTick), 0.0f, 1.0f);
+
+    CarSnapshot car = current.car;
+    car.position = Vector3::Lerp(previous.car.position, current.car.position, alpha);
+    car.forward  = Vector3::Lerp(previous.car.forward, current.car.forward, alpha);
+    car.velocity = Vector3::Lerp(previous.car.velocity, current.car.velocity, alpha);
+    return car;
+}
+
+Simulation::CarSnapshot Simulation::GetLatestCar() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshots[m_currentSnapshot].car;
+}
+
+uint64_t Simulation::GetTicks() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshots[m_currentSnapshot].tick;
+}
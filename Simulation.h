@@ -0,0 +1,105 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+// AnimationStructs.h and RacingLine.h must also be included before this header.
+
+// Car physics and AI, stepped at a fixed rate on a thread of their own. They then behave the same at any frame rate,
+// and don't compete with command list recording on the main thread.
+//
+// Each tick publishes a snapshot of the simulation state. Snapshots are triple buffered: the simulation fills one while
+// the renderer reads the last two, and publishing only swaps indices under the lock. The renderer draws the state
+// interpolated between those two, so motion is smooth at any frame rate at the cost of up to one tick of latency.
+// Snapshots are stamped with the time their tick was due rather than when it ran, so a late wake of the simulation
+// thread doesn't show up as a jump in the interpolation.
+
+class Simulation
+{
+public:
+
+    static constexpr double   TickSeconds     = 1.0 / 60;
+    static constexpr uint64_t MaxCatchUpTicks = 6;      // Ticks run back to back after a stall, 0.1 s as in StepTimer.
+
+    // Controls sampled by each tick. Steering and reverse are not simulated, as in the per-frame car update this
+    // replaced.
+    struct Input
+    {
+        bool accelerate;
+        bool brake;
+        bool autoNav;       // Switches to auto navigation, which stays on once set.
+    };
+
+    struct CarSnapshot
+    {
+        Vector3  position;
+        Vector3  forward;
+        Vector3  velocity;          // Metres per tick.
+        uint32_t nextCheckpoint;
+    };
+
+    // carBox is the car's model space bounding box, used to detect it passing checkpoints.
+    Simulation(const Vector3& carPosition, const Vector3& carForward, const BoundingBox& carBox);
+
+    Simulation(Simulation const&) = delete;
+    Simulation& operator= (Simulation const&) = delete;
+
+    Simulation(Simulation&&) = delete;
+    Simulation& operator= (Simulation&&) = delete;
+
+    ~Simulation();
+
+    // Starts and stops the simulation thread.
+    void Start();
+    void Stop();
+
+    void SetInput(const Input& input);
+
+    // Advances the simulation one tick on the calling thread, for headless runs. Must not be called while the
+    // simulation thread is running.
+    void Step();
+
+    // The car as it is now, interpolated between the last two snapshots.
+    CarSnapshot GetCar() const;
+
+    // The car as of the last tick, without interpolation.
+    CarSnapshot GetLatestCar() const;
+
+    // Ticks simulated so far.
+    uint64_t GetTicks() const;
+
+private:
+
+    struct Snapshot
+    {
+        uint64_t    tick;
+        int64_t     time;           // QueryPerformanceCounter value at which the tick was due.
+        CarSnapshot car;
+    };
+
+    void Run();
+    void StepCar(const Input& input);
+    void Publish();
+
+    RacingLine  m_racingLine;
+
+    // Simulation state, owned by whichever thread is stepping.
+    CarState    m_carState;
+    Vector3     m_carPosition;
+    Vector3     m_carForward;
+    BoundingBox m_carBox;
+    bool        m_isAutoNav;
+    float       m_lineDistance;     // How far along the racing line the car is.
+    uint64_t    m_tick;
+    int64_t     m_startTime;        // QueryPerformanceCounter value at which tick 0 was due. Tick n is due n ticks later.
+
+    std::thread       m_thread;
+    std::atomic<bool> m_isRunning;
+
+    // Guards the input and the snapshot indices.
+    mutable std::mutex m_mutex;
+    Input              m_input;
+    Snapshot           m_snapshots[3];
+    uint32_t           m_writeSnapshot;
+    uint32_t           m_currentSnapshot;
+    uint32_t           m_previousSnapshot;
+    double             m_countsPerTick;    // QueryPerformanceCounter counts in one tick.
+};
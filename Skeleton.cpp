@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+void Skeleton::AddBone(int parentIndex, Matrix const& offset)
+{
+    // Keeps the arrays in topological order.
+    assert(parentIndex < static_cast<int>(m_parentIndices.size()));
+
+    m_parentIndices.push_back(parentIndex);
+    m_offsets.push_back(offset);
+}
+
+XMMATRIX XM_CALLCONV Skeleton::CombineBone(const BoneTransform* pose, XMMATRIX* combined, uint32_t i) const noexcept
+{
+    // Local scale, rotation and translation, then parent to child. Parents precede children,
+    // so combined[parent] already holds the parent's model space transform.
+    auto transform = XMMatrixAffineTransformation(
+        XMLoadFloat3(&pose[i].scale), g_XMZero, XMLoadFloat4(&pose[i].rotation), XMLoadFloat3(&pose[i].translation));
+
+    const auto parent = m_parentIndices[i];
+    if (parent >= 0)
+        transform = XMMatrixMultiply(transform, combined[parent]);
+
+    combined[i] = transform;
+
+    return XMMatrixMultiply(m_offsets[i], transform);
+}
+
+void Skeleton::CalculatePalette(const BoneTransform* pose, XMMATRIX* combined, XMFLOAT3X4* palette, const uint32_t* lodRemap) const
+{
+    const auto boneCount = GetBoneCount();
+
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+        // Collapsed bones map to an ancestor, which precedes them, so its palette entry is already written.
+        if (lodRemap && lodRemap[i] != i)
+        {
+            palette[i] = palette[lodRemap[i]];
+            continue;
+        }
+
+        // XMFLOAT3X4 is column major, so the palette is loaded in HLSL without a transpose.
+        XMStoreFloat3x4(&palette[i], CombineBone(pose, combined, i));
+    }
+}
+
+void Skeleton::CalculateDualQuaternionPalette(const BoneTransform* pose, XMMATRIX* combined, BoneDualQuaternion* palette,
+                                              const uint32_t* lodRemap) const
+{
+    const auto boneCount = GetBoneCount();
+
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+        if (lodRemap && lodRemap[i] != i)
+        {
+            palette[i] = palette[lodRemap[i]];
+            continue;
+        }
+
+        palette[i] = ToDualQuaternion(CombineBone(pose, combined, i));
+    }
+}
+
+void Skeleton::BuildLodRemap(uint32_t maxDepth, std::vector<uint32_t>& remap) const
+{
+    const auto boneCount = GetBoneCount();
+
+    std::vector<uint32_t> depths(boneCount);
+    remap.resize(boneCount);
+
+    for (uint32_t i = 0; i < boneCount; ++i)
+    {
+        const auto parent = m_parentIndices[i];
+        depths[i] = parent < 0 ? 0 : depths[parent] + 1;
+
+        // The parent is already remapped, so a collapsed chain resolves to its first kept ancestor.
+        remap[i] = (parent < 0 || depths[i] <= maxDepth) ? i : remap[parent];
+    }
+}
+
+BoneDualQuaternion XM_CALLCONV Skeleton::ToDualQuaternion(FXMMATRIX transform) noexcept
+{
+    XMVECTOR scale, rotation, translation;
+    if (!XMMatrixDecompose(&scale, &rotation, &translation, transform))
+    {
+        // A degenerate scale leaves no rotation to recover.
+        rotation    = XMQuaternionIdentity();
+        translation = transform.r[3];
+    }
+
+    // dual = 0.5 * t * real, with t the pure quaternion (translation, 0).
+    // XMQuaternionMultiply(Q1, Q2) returns Q2 * Q1, hence the argument order.
+    const auto dual = XMVectorScale(XMQuaternionMultiply(rotation, XMVectorAndInt(translation, g_XMMask3)), 0.5f);
+
+    BoneDualQuaternion result;
+    XMStoreFloat4(&result.real, rotation);
+    XMStoreFloat4(&result.dual, dual);
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// RaytracingHlslCompat.h and AnimationClip.h must be in the #include list before this header.
+
+// Bone hierarchy and bind pose offsets, shared by every instance of an animated model.
+// The hierarchy is flattened into a parent index array in topological order, parents before children,
+// so a single pass over contiguous arrays concatenates the whole hierarchy.
+
+class Skeleton
+{
+public:
+
+    Skeleton() noexcept = default;
+
+    Skeleton(Skeleton const&) = delete;
+    Skeleton& operator= (Skeleton const&) = delete;
+
+    Skeleton(Skeleton&&) = default;
+    Skeleton& operator= (Skeleton&&) = default;
+
+    ~Skeleton() = default;
+
+    // parentIndex is -1 for a root bone, otherwise the index of a bone already added.
+    // offset is the inverse bind pose matrix of the bone.
+    void AddBone(int parentIndex, DirectX::SimpleMath::Matrix const& offset);
+
+    // Concatenates the local transforms of pose from parent to child, then prepends each bone's offset.
+    // combined is caller owned scratch space for one model space transform per bone, so evaluation doesn't allocate.
+    // palette receives the packed 3x4 skinning matrices, in the same layout as FBXModel::GetBonePalette3X4.
+    // lodRemap, from BuildLodRemap, evaluates a subset of the bones and copies the rest from their ancestors.
+    void CalculatePalette(const BoneTransform* pose, DirectX::XMMATRIX* combined, DirectX::XMFLOAT3X4* palette,
+                          const uint32_t* lodRemap = nullptr) const;
+
+    // As CalculatePalette, but palette receives unit dual quaternions for dual quaternion skinning.
+    // Dual quaternions only represent rotation and translation, so any scale in the skinning transforms is dropped.
+    void CalculateDualQuaternionPalette(const BoneTransform* pose, DirectX::XMMATRIX* combined, BoneDualQuaternion* palette,
+                                        const uint32_t* lodRemap = nullptr) const;
+
+    // Maps every bone deeper than maxDepth below its root to its nearest ancestor at maxDepth, and every other bone
+    // to itself. Vertices of collapsed bones then move rigidly with that ancestor, so a level of detail skips them.
+    void BuildLodRemap(uint32_t maxDepth, std::vector<uint32_t>& remap) const;
+
+    // Converts the rotation and translation of an affine transform to a unit dual quaternion.
+    static BoneDualQuaternion XM_CALLCONV ToDualQuaternion(DirectX::FXMMATRIX transform) noexcept;
+
+    const auto GetBoneCount() const noexcept                    { return static_cast<uint32_t>(m_parentIndices.size()); }
+    const auto GetParentIndex(uint32_t bone) const noexcept     { return m_parentIndices[bone]; }
+    const auto GetOffset(uint32_t bone) const noexcept          { return m_offsets[bone]; }
+
+private:
+
+    // Concatenates bone i into combined[i] and returns its skinning transform, offset then model space.
+    DirectX::XMMATRIX XM_CALLCONV CombineBone(const BoneTransform* pose, DirectX::XMMATRIX* combined, uint32_t i) const noexcept;
+
+    std::vector<int>               m_parentIndices;
+    std::vector<DirectX::XMMATRIX> m_offsets;   // 16 byte aligned, so they load without conversion.
+};
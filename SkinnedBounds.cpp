@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "SkinnedBounds.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+void SkinnedBounds::Reset(uint32_t boneCount)
+{
+    m_minimums.assign(boneCount, XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+    m_maximums.assign(boneCount, XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+
+    m_bones.clear();
+    m_centers.clear();
+    m_extents.clear();
+}
+
+void SkinnedBounds::AddVertex(XMFLOAT3 const& position, const uint8_t* boneIndices, XMFLOAT4 const& weights)
+{
+    const float w[4] = { weights.x, weights.y, weights.z, 1.0f - weights.x - weights.y - weights.z };
+    const auto p = XMLoadFloat3(&position);
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (w[i] <= 0.0f)
+            continue;
+
+        const auto bone = boneIndices[i];
+        if (bone >= m_minimums.size())
+            throw std::exception("SkinnedBounds vertex references a bone outside the skeleton");
+
+        XMStoreFloat3(&m_minimums[bone], XMVectorMin(XMLoadFloat3(&m_minimums[bone]), p));
+        XMStoreFloat3(&m_maximums[bone], XMVectorMax(XMLoadFloat3(&m_maximums[bone]), p));
+    }
+}
+
+void SkinnedBounds::Finalize()
+{
+    m_bones.clear();
+    m_centers.clear();
+    m_extents.clear();
+
+    for (uint32_t bone = 0; bone < m_minimums.size(); ++bone)
+    {
+        const auto minimum = XMLoadFloat3(&m_minimums[bone]);
+        const auto maximum = XMLoadFloat3(&m_maximums[bone]);
+
+        // Bones without weighted vertices don't contribute.
+        if (XMVector3Greater(minimum, maximum))
+            continue;
+
+        XMFLOAT4 center, extents;
+        XMStoreFloat4(&center, XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f));
+        XMStoreFloat4(&extents, XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f));
+
+        m_bones.push_back(bone);
+        m_centers.push_back(center);
+        m_extents.push_back(extents);
+    }
+
+    m_minimums.clear();
+    m_minimums.shrink_to_fit();
+    m_maximums.clear();
+    m_maximums.shrink_to_fit();
+}
+
+template<typename GetTransform>
+bool SkinnedBounds::Merge(GetTransform&& getTransform, BoundingBox& box) const
+{
+    if (m_bones.empty())
+        return false;
+
+    auto minimum = g_XMFltMax.v;
+    auto maximum = XMVectorNegate(g_XMFltMax);
+
+    for (size_t i = 0; i < m_bones.size(); ++i)
+    {
+        const auto transform = getTransform(m_bones[i]);
+
+        // The transformed box is centred on the transformed centre, and its extents along each axis are the
+        // extents projected onto the absolute values of the transform's rows.
+        const auto center = XMVector3Transform(XMLoadFloat4(&m_centers[i]), transform);
+        const auto extents = XMLoadFloat4(&m_extents[i]);
+
+        auto radius = XMVectorMultiply(XMVectorSplatX(extents), XMVectorAbs(transform.r[0]));
+        radius = XMVectorMultiplyAdd(XMVectorSplatY(extents), XMVectorAbs(transform.r[1]), radius);
+        radius = XMVectorMultiplyAdd(XMVectorSplatZ(extents), XMVectorAbs(transform.r[2]), radius);
+
+        minimum = XMVectorMin(minimum, XMVectorSubtract(center, radius));
+        maximum = XMVectorMax(maximum, XMVectorAdd(center, radius));
+    }
+
+    BoundingBox::CreateFromPoints(box, minimum, maximum);
+    return true;
+}
+
+bool SkinnedBounds::Calculate(const XMFLOAT3X4* palette, BoundingBox& box) const
+{
+    return Merge([palette](uint32_t bone)
+    {
+        // XMFLOAT3X4 rows are the columns of the row vector matrix the shader multiplies by.
+        const auto& m = palette[bone];
+        return XMMatrixTranspose(XMMATRIX(
+            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m.m[0])),
+            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m.m[1])),
+            XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m.m[2])),
+            g_XMIdentityR3));
+    }, box);
+}
+
+bool SkinnedBounds::Calculate(const BoneDualQuaternion* palette, BoundingBox& box) const
+{
+    return Merge([palette](uint32_t bone)
+    {
+        const auto real = XMLoadFloat4(&palette[bone].real);
+        const auto dual = XMLoadFloat4(&palette[bone].dual);
+
+        // translation = 2 * dual * conjugate(real). XMQuaternionMultiply(Q1, Q2) returns Q2 * Q1.
+        const auto translation = XMVectorScale(XMQuaternionMultiply(XMQuaternionConjugate(real), dual), 2.0f);
+
+        auto transform = XMMatrixRotationQuaternion(real);
+        transform.r[3] = XMVectorSelect(g_XMIdentityR3, translation, g_XMSelect1110);
+        return transform;
+    }, box);
+}
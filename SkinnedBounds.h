@@ -0,0 +1,59 @@
+#pragma once
+
+// RaytracingHlslCompat.h must be in the #include list before this header.
+
+// Conservative bounds of a skinned mesh from per-bone boxes.
+// At import, each bone gets a box around the bind pose vertices it influences. Every frame, only those boxes are
+// transformed by the bone palette and merged, which costs O(bones) rather than O(vertices). A linear blend skinned
+// vertex is a weighted average of its bones' transforms of it, so it lies inside the merged box.
+// Dual quaternion skinning blends the transforms before applying them, so there the box can be marginally tight
+// at strongly twisted joints.
+// The boxes depend only on the mesh, so instances of a model share them and bound themselves from their own palette.
+
+class SkinnedBounds
+{
+public:
+
+    SkinnedBounds() noexcept = default;
+
+    SkinnedBounds(SkinnedBounds const&) = delete;
+    SkinnedBounds& operator= (SkinnedBounds const&) = delete;
+
+    SkinnedBounds(SkinnedBounds&&) = default;
+    SkinnedBounds& operator= (SkinnedBounds&&) = default;
+
+    ~SkinnedBounds() = default;
+
+    // Starts fitting boxes for boneCount bones.
+    void Reset(uint32_t boneCount);
+
+    // Grows the box of each bone with a non-zero weight. As in the skinning shader, weights.w is ignored and
+    // recalculated so the weights sum to one.
+    void AddVertex(DirectX::XMFLOAT3 const& position, const uint8_t* boneIndices, DirectX::XMFLOAT4 const& weights);
+
+    // Packs the boxes of the bones that influence vertices, after the last AddVertex.
+    void Finalize();
+
+    // Model space box of the mesh skinned with a palette, as produced by Skeleton::CalculatePalette.
+    // Returns false, leaving box unchanged, if no bone influences any vertex.
+    bool Calculate(const DirectX::XMFLOAT3X4* palette, DirectX::BoundingBox& box) const;
+    bool Calculate(const BoneDualQuaternion* palette, DirectX::BoundingBox& box) const;
+
+    const auto GetBoxCount() const noexcept                     { return m_bones.size(); }
+    const auto IsEmpty() const noexcept                         { return m_bones.empty(); }
+
+private:
+
+    // Merges the boxes, each transformed by the matrix getTransform returns for its bone.
+    template<typename GetTransform>
+    bool Merge(GetTransform&& getTransform, DirectX::BoundingBox& box) const;
+
+    // Bind pose extents while fitting.
+    std::vector<DirectX::XMFLOAT3> m_minimums;
+    std::vector<DirectX::XMFLOAT3> m_maximums;
+
+    // Packed boxes of the bones that influence vertices.
+    std::vector<uint32_t>          m_bones;
+    std::vector<DirectX::XMFLOAT4> m_centers;
+    std::vector<DirectX::XMFLOAT4> m_extents;
+};
@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
+#include "FBXModel.h"
+#include "Skinning.h"
+#include "VertexCompression.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t SkinningChunkSize = 4096; // Vertices per thread pool work item.
+    constexpr size_t DecodeBlockSize   = 256;  // Compact vertices decoded at a time, into a buffer on the stack.
+
+    // Ignore boneWeights.w and instead calculate the last weight value to ensure all bone weights sum to unity.
+    XMVECTOR XM_CALLCONV GetWeights(FBXModel::Vertex const& vertex) noexcept
+    {
+        const auto weights = XMLoadFloat4(&vertex.boneWeights);
+        const auto sum = XMVector3Dot(weights, g_XMOne);
+        return XMVectorSelect(weights, XMVectorSubtract(g_XMOne, sum), g_XMSelect1110);
+    }
+
+    // Calls kernel(first, count) for each chunk of vertices, on the thread pool if there is more than one chunk.
+    template<typename Kernel>
+    void ForEachChunk(size_t vertexCount, Kernel&& kernel)
+    {
+        const size_t chunkCount = (vertexCount + SkinningChunkSize - 1) / SkinningChunkSize;
+
+        // Small meshes aren't worth waking the thread pool for.
+        if (chunkCount <= 1)
+        {
+            kernel(size_t(0), vertexCount);
+            return;
+        }
+
+        std::vector<size_t> chunks(chunkCount);
+        std::iota(chunks.begin(), chunks.end(), size_t(0));
+
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            const auto first = chunk * SkinningChunkSize;
+            kernel(first, std::min(SkinningChunkSize, vertexCount - first));
+        });
+    }
+
+    // Decodes compact vertices a block at a time and skins each block with kernel, a full precision range kernel.
+    template<typename Palette, typename RangeKernel>
+    void SkinCompactRange(
+        const FBXModel::CompactVertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const Palette* palette,
+        uint32_t boneCount,
+        RangeKernel kernel) noexcept
+    {
+        FBXModel::Vertex decoded[DecodeBlockSize];
+
+        for (size_t first = 0; first < vertexCount; first += DecodeBlockSize)
+        {
+            const auto count = std::min(DecodeBlockSize, vertexCount - first);
+            std::transform(input + first, input + first + count, decoded, VertexCompression::Decompress);
+            kernel(decoded, output + first, count, palette, boneCount);
+        }
+    }
+
+    // q * v * conjugate(q) for a unit quaternion q, as v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v).
+    XMVECTOR XM_CALLCONV RotateByUnitQuaternion(FXMVECTOR v, FXMVECTOR q, FXMVECTOR qw) noexcept
+    {
+        const auto t = XMVectorMultiplyAdd(qw, v, XMVector3Cross(q, v));
+        return XMVectorMultiplyAdd(g_XMTwo, XMVector3Cross(q, t), v);
+    }
+}
+
+void Skinning::SkinVertexRange(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const XMFLOAT3X4* palette,
+    uint32_t boneCount) noexcept
+{
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const auto& vertex = input[v];
+        const auto weights = GetWeights(vertex);
+
+        // The blend is linear in the matrices, so blend the four 3x4 palette entries first and transform once.
+        XMVECTOR row0 = g_XMZero;
+        XMVECTOR row1 = g_XMZero;
+        XMVECTOR row2 = g_XMZero;
+
+        auto blend = [&](uint32_t i, FXMVECTOR w)
+        {
+            assert(vertex.boneIndices[i] < boneCount);
+            const auto& bone = palette[vertex.boneIndices[i]];
+
+            row0 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(bone.m[0])), w, row0);
+            row1 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(bone.m[1])), w, row1);
+            row2 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(bone.m[2])), w, row2);
+        };
+
+        blend(0, XMVectorSplatX(weights));
+        blend(1, XMVectorSplatY(weights));
+        blend(2, XMVectorSplatZ(weights));
+        blend(3, XMVectorSplatW(weights));
+
+        // XMFLOAT3X4 rows are the columns of the row vector matrix the shader multiplies by.
+        const auto blended = XMMatrixTranspose(XMMATRIX(row0, row1, row2, g_XMIdentityR3));
+
+        auto& out = output[v];
+        XMStoreFloat3(&out.pos, XMVector3Transform(XMLoadFloat3(&vertex.pos), blended));
+
+        // Blending can output vertex normals of different length, which will skew interpolation if not normalized.
+        XMStoreFloat3(&out.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), blended)));
+        XMStoreFloat3(&out.tangent, XMVector3TransformNormal(XMLoadFloat3(&vertex.tangent), blended));
+        out.texC = vertex.texC;
+    }
+}
+
+void Skinning::SkinVertices(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const XMFLOAT3X4* palette,
+    uint32_t boneCount)
+{
+    ForEachChunk(vertexCount, [&](size_t first, size_t count)
+    {
+        SkinVertexRange(input + first, output + first, count, palette, boneCount);
+    });
+}
+
+void Skinning::SkinVerticesReference(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const XMFLOAT3X4* palette,
+    uint32_t boneCount)
+{
+    // mul(float4(p, 1), boneTransform) for a float4x3 bone transform stored as XMFLOAT3X4.
+    auto transform = [](XMFLOAT3X4 const& m, Vector3 const& p, float w)
+    {
+        return Vector3(
+            m.m[0][0] * p.x + m.m[0][1] * p.y + m.m[0][2] * p.z + m.m[0][3] * w,
+            m.m[1][0] * p.x + m.m[1][1] * p.y + m.m[1][2] * p.z + m.m[1][3] * w,
+            m.m[2][0] * p.x + m.m[2][1] * p.y + m.m[2][2] * p.z + m.m[2][3] * w);
+    };
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const auto& vertex = input[v];
+
+        float weights[4] = { vertex.boneWeights.x, vertex.boneWeights.y, vertex.boneWeights.z, 0.0f };
+        weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+
+        Vector3 outPos, outNormal, outTangent;
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            assert(vertex.boneIndices[i] < boneCount);
+            const auto& bone = palette[vertex.boneIndices[i]];
+
+            outPos     += transform(bone, vertex.pos, 1.0f) * weights[i];
+            outNormal  += transform(bone, vertex.normal, 0.0f) * weights[i];
+            outTangent += transform(bone, vertex.tangent, 0.0f) * weights[i];
+        }
+
+        outNormal.Normalize();
+
+        output[v] = FBXModel::SkinnedVertex(outPos, outNormal, vertex.texC, outTangent);
+    }
+}
+
+void Skinning::SkinVertexRangeDualQuaternion(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const BoneDualQuaternion* palette,
+    uint32_t boneCount) noexcept
+{
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const auto& vertex = input[v];
+        const auto weights = GetWeights(vertex);
+
+        assert(vertex.boneIndices[0] < boneCount);
+        const auto firstReal = XMLoadFloat4(&palette[vertex.boneIndices[0]].real);
+
+        XMVECTOR real = g_XMZero;
+        XMVECTOR dual = g_XMZero;
+
+        auto blend = [&](uint32_t i, FXMVECTOR w)
+        {
+            assert(vertex.boneIndices[i] < boneCount);
+            const auto& bone = palette[vertex.boneIndices[i]];
+            const auto boneReal = XMLoadFloat4(&bone.real);
+
+            // q and -q are the same rotation. Blend every bone in the hemisphere of the first, so they don't cancel out.
+            const auto weight = XMVectorSelect(w, XMVectorNegate(w), XMVectorLess(XMVector4Dot(firstReal, boneReal), g_XMZero));
+
+            real = XMVectorMultiplyAdd(boneReal, weight, real);
+            dual = XMVectorMultiplyAdd(XMLoadFloat4(&bone.dual), weight, dual);
+        };
+
+        blend(0, XMVectorSplatX(weights));
+        blend(1, XMVectorSplatY(weights));
+        blend(2, XMVectorSplatZ(weights));
+        blend(3, XMVectorSplatW(weights));
+
+        // Dividing both parts by the length of the real part gives a unit dual quaternion.
+        const auto invLength = XMVector4ReciprocalLength(real);
+        real = XMVectorMultiply(real, invLength);
+        dual = XMVectorMultiply(dual, invLength);
+
+        const auto realW = XMVectorSplatW(real);
+
+        // translation = 2 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz))
+        auto translation = XMVectorMultiply(realW, dual);
+        translation = XMVectorNegativeMultiplySubtract(XMVectorSplatW(dual), real, translation);
+        translation = XMVectorAdd(translation, XMVector3Cross(real, dual));
+        translation = XMVectorAdd(translation, translation);
+
+        auto& out = output[v];
+        XMStoreFloat3(&out.pos, XMVectorAdd(RotateByUnitQuaternion(XMLoadFloat3(&vertex.pos), real, realW), translation));
+
+        // A unit rotation keeps the length of normals and tangents, so unlike linear blending nothing is renormalized.
+        XMStoreFloat3(&out.normal, RotateByUnitQuaternion(XMLoadFloat3(&vertex.normal), real, realW));
+        XMStoreFloat3(&out.tangent, RotateByUnitQuaternion(XMLoadFloat3(&vertex.tangent), real, realW));
+        out.texC = vertex.texC;
+    }
+}
+
+void Skinning::SkinVerticesDualQuaternion(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const BoneDualQuaternion* palette,
+    uint32_t boneCount)
+{
+    ForEachChunk(vertexCount, [&](size_t first, size_t count)
+    {
+        SkinVertexRangeDualQuaternion(input + first, output + first, count, palette, boneCount);
+    });
+}
+
+void Skinning::SkinVerticesDualQuaternionReference(
+    const FBXModel::Vertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const BoneDualQuaternion* palette,
+    uint32_t boneCount)
+{
+    auto dot = [](Vector4 const& a, Vector4 const& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; };
+
+    // v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v)
+    auto rotate = [](Vector4 const& q, Vector3 const& v)
+    {
+        const Vector3 qv(q.x, q.y, q.z);
+        return v + 2.0f * qv.Cross(qv.Cross(v) + q.w * v);
+    };
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const auto& vertex = input[v];
+
+        float weights[4] = { vertex.boneWeights.x, vertex.boneWeights.y, vertex.boneWeights.z, 0.0f };
+        weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+
+        assert(vertex.boneIndices[0] < boneCount);
+        const auto& firstReal = palette[vertex.boneIndices[0]].real;
+
+        Vector4 real, dual;
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            assert(vertex.boneIndices[i] < boneCount);
+            const auto& bone = palette[vertex.boneIndices[i]];
+
+            const float weight = dot(firstReal, bone.real) < 0.0f ? -weights[i] : weights[i];
+
+            real += bone.real * weight;
+            dual += bone.dual * weight;
+        }
+
+        const float length = std::sqrt(dot(real, real));
+        real /= length;
+        dual /= length;
+
+        const Vector3 realXyz(real.x, real.y, real.z);
+        const Vector3 dualXyz(dual.x, dual.y, dual.z);
+        const Vector3 translation = 2.0f * (real.w * dualXyz - dual.w * realXyz + realXyz.Cross(dualXyz));
+
+        const auto outPos     = rotate(real, vertex.pos) + translation;
+        const auto outNormal  = rotate(real, vertex.normal);
+        const auto outTangent = rotate(real, vertex.tangent);
+
+        output[v] = FBXModel::SkinnedVertex(outPos, outNormal, vertex.texC, outTangent);
+    }
+}
+
+void Skinning::SkinVerticesCompact(
+    const FBXModel::CompactVertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const XMFLOAT3X4* palette,
+    uint32_t boneCount)
+{
+    ForEachChunk(vertexCount, [&](size_t first, size_t count)
+    {
+        SkinCompactRange(input + first, output + first, count, palette, boneCount, SkinVertexRange);
+    });
+}
+
+void Skinning::SkinVerticesDualQuaternionCompact(
+    const FBXModel::CompactVertex* input,
+    FBXModel::SkinnedVertex* output,
+    size_t vertexCount,
+    const BoneDualQuaternion* palette,
+    uint32_t boneCount)
+{
+    ForEachChunk(vertexCount, [&](size_t first, size_t count)
+    {
+        SkinCompactRange(input + first, output + first, count, palette, boneCount, SkinVertexRangeDualQuaternion);
+    });
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// RaytracingHlslCompat.h and FBXModel.h must be in the #include list before this header.
+
+// CPU linear blend skinning, matching ComputeShaderSkinning.hlsl.
+// Each vertex blends four bones of a packed 3x4 palette, as produced by FBXModel::GetBonePalette3X4.
+// As in the shader, the fourth weight is ignored and recalculated so the weights sum to one, normals are
+// renormalized after blending, and tangents are not.
+//
+// CPU dual quaternion skinning, matching ComputeShaderSkinningDQ.hlsl.
+// Each vertex blends four bones of a dual quaternion palette, as produced by FBXModel::GetBoneDualQuaternions,
+// with the same weights. The blend is renormalized, so it stays a rigid transform and normals keep their length.
+
+namespace Skinning
+{
+    // SIMD kernel. Large vertex counts are split across the thread pool.
+    void SkinVertices(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const DirectX::XMFLOAT3X4* palette,
+        uint32_t boneCount);
+
+    // Single threaded scalar version of the same calculation, written to follow the shader line by line.
+    // Used as the baseline and the reference the SIMD kernel is validated against.
+    void SkinVerticesReference(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const DirectX::XMFLOAT3X4* palette,
+        uint32_t boneCount);
+
+    // Single threaded SIMD kernel over a range of vertices.
+    void SkinVertexRange(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const DirectX::XMFLOAT3X4* palette,
+        uint32_t boneCount) noexcept;
+
+    // Dual quaternion versions of the three functions above.
+    void SkinVerticesDualQuaternion(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const BoneDualQuaternion* palette,
+        uint32_t boneCount);
+
+    void SkinVerticesDualQuaternionReference(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const BoneDualQuaternion* palette,
+        uint32_t boneCount);
+
+    void SkinVertexRangeDualQuaternion(
+        const FBXModel::Vertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const BoneDualQuaternion* palette,
+        uint32_t boneCount) noexcept;
+
+    // Versions of SkinVertices and SkinVerticesDualQuaternion that read FBXModel::CompactVertex, matching the
+    // skinning shaders built with COMPACT_VERTICES. Vertices are decoded a block at a time, as VertexCompression.hlsli
+    // decodes them, then skinned with the full precision kernel.
+    void SkinVerticesCompact(
+        const FBXModel::CompactVertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const DirectX::XMFLOAT3X4* palette,
+        uint32_t boneCount);
+
+    void SkinVerticesDualQuaternionCompact(
+        const FBXModel::CompactVertex* input,
+        FBXModel::SkinnedVertex* output,
+        size_t vertexCount,
+        const BoneDualQuaternion* palette,
+        uint32_t boneCount);
+}
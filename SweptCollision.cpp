@@ -0,0 +1,303 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "SweptCollision.h"
+
+namespace
+{
+    // Earliest time in [0, 1] at which a ray from origin along d comes within radius of point.
+    bool RayPoint(const Vector3& origin, const Vector3& d, const Vector3& point, float radius, float& time) noexcept
+    {
+        const auto m = origin - point;
+        const auto a = d.Dot(d);
+        const auto b = m.Dot(d);
+        const auto c = m.Dot(m) - radius * radius;
+
+        if (c <= 0.0f)
+        {
+            time = 0.0f;
+            return true;
+        }
+
+        // Moving away from the point, or not moving.
+        if (b >= 0.0f || a <= 0.0f)
+            return false;
+
+        const auto discriminant = b * b - a * c;
+        if (discriminant < 0.0f)
+            return false;
+
+        time = (-b - std::sqrt(discriminant)) / a;
+        return time <= 1.0f;
+    }
+
+    // Earliest time in [0, 1] at which a ray from origin along d comes within radius of the segment pq, away from its
+    // ends. Contact at the ends is found by RayPoint.
+    bool RayCylinder(const Vector3& origin, const Vector3& d, const Vector3& p, const Vector3& q, float radius, float& time) noexcept
+    {
+        // Ericson, Real-Time Collision Detection, 5.3.7, solving for the times the ray is radius from the line pq.
+        const auto e = q - p;
+        const auto m = origin - p;
+
+        const auto ee = e.Dot(e);
+        if (ee <= 0.0f)
+            return false;
+
+        const auto md = m.Dot(d);
+        const auto me = m.Dot(e);
+        const auto de = d.Dot(e);
+
+        const auto a = ee * d.Dot(d) - de * de;
+        const auto b = ee * md - me * de;
+        const auto c = ee * (m.Dot(m) - radius * radius) - me * me;
+
+        float t = 0.0f;
+
+        if (c > 0.0f)
+        {
+            // Moving parallel to the line, away from it, or not at all.
+            if (a <= 1e-6f * ee * d.Dot(d) || b >= 0.0f)
+                return false;
+
+            const auto discriminant = b * b - a * c;
+            if (discriminant < 0.0f)
+                return false;
+
+            t = (-b - std::sqrt(discriminant)) / a;
+            if (t > 1.0f)
+                return false;
+        }
+
+        const auto s = me + t * de;
+        if (s < 0.0f || s > ee)
+            return false;
+
+        time = t;
+        return true;
+    }
+
+    // Narrows [enter, exit] to the times at which the box, moving along d, overlaps the points projected onto axis.
+    // Axes need not be normalized, but degenerate axes are skipped.
+    bool SweepAxis(const Vector3& axis, const BoundingBox& box, const Vector3& d, const Vector3* points, size_t count,
+        float& enter, float& exit) noexcept
+    {
+        if (axis.LengthSquared() <= 1e-12f)
+            return true;
+
+        float lo = points[0].Dot(axis);
+        float hi = lo;
+        for (size_t i = 1; i < count; ++i)
+        {
+            const auto projection = points[i].Dot(axis);
+            lo = std::min(lo, projection);
+            hi = std::max(hi, projection);
+        }
+
+        const auto center = Vector3(box.Center).Dot(axis);
+        const auto radius = std::abs(box.Extents.x * axis.x) + std::abs(box.Extents.y * axis.y) + std::abs(box.Extents.z * axis.z);
+
+        // The box overlaps the points while its centre has moved by an amount in [lo, hi] along the axis.
+        lo -= center + radius;
+        hi -= center - radius;
+
+        const auto speed = d.Dot(axis);
+        if (speed == 0.0f)
+            return lo <= 0.0f && hi >= 0.0f;
+
+        auto t0 = lo / speed;
+        auto t1 = hi / speed;
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        enter = std::max(enter, t0);
+        exit  = std::min(exit, t1);
+        return enter <= exit;
+    }
+}
+
+bool SweptCollision::SweepSphereTriangle(
+    const BoundingSphere& sphere,
+    const Vector3& displacement,
+    const Vector3& a,
+    const Vector3& b,
+    const Vector3& c,
+    float& time) noexcept
+{
+    const Vector3 center = sphere.Center;
+    const auto radius = sphere.Radius;
+
+    auto normal = (b - a).Cross(c - a);
+    const auto lengthSq = normal.LengthSquared();
+
+    if (lengthSq > 0.0f)
+    {
+        normal /= std::sqrt(lengthSq);
+
+        auto isInside = [&](const Vector3& point)
+        {
+            return (b - a).Cross(point - a).Dot(normal) >= 0.0f &&
+                   (c - b).Cross(point - b).Dot(normal) >= 0.0f &&
+                   (a - c).Cross(point - c).Dot(normal) >= 0.0f;
+        };
+
+        // The sphere first touches the face's interior where its point nearest the plane meets the plane.
+        const auto distance = normal.Dot(center - a);
+        const auto side = distance >= 0.0f ? 1.0f : -1.0f;
+
+        if (std::abs(distance) <= radius)
+        {
+            if (isInside(center - distance * normal))
+            {
+                time = 0.0f;
+                return true;
+            }
+        }
+        else
+        {
+            const auto approach = -side * normal.Dot(displacement);
+            const auto t = (std::abs(distance) - radius) / approach;
+
+            if (approach > 0.0f && t <= 1.0f && isInside(center + t * displacement - side * radius * normal))
+            {
+                time = t;
+                return true;
+            }
+        }
+    }
+
+    // Otherwise it first touches an edge or a vertex.
+    const Vector3 points[3] = { a, b, c };
+    bool isHit = false;
+    float t;
+    time = 1.0f;
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        if (RayCylinder(center, displacement, points[i], points[(i + 1) % 3], radius, t) && t <= time)
+        {
+            time = t;
+            isHit = true;
+        }
+
+        if (RayPoint(center, displacement, points[i], radius, t) && t <= time)
+        {
+            time = t;
+            isHit = true;
+        }
+    }
+
+    return isHit;
+}
+
+bool SweptCollision::SweepBoxTriangle(
+    const BoundingBox& box,
+    const Vector3& displacement,
+    const Vector3& a,
+    const Vector3& b,
+    const Vector3& c,
+    float& time) noexcept
+{
+    const Vector3 points[3] = { a, b, c };
+    const Vector3 edges[3] = { b - a, c - b, a - c };
+    const Vector3 axes[3] = { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ };
+
+    float enter = 0.0f;
+    float exit  = 1.0f;
+
+    // The box face normals, the triangle normal, and the cross products of the triangle edges with the box axes.
+    for (const auto& axis : axes)
+    {
+        if (!SweepAxis(axis, box, displacement, points, 3, enter, exit))
+            return false;
+    }
+
+    if (!SweepAxis(edges[0].Cross(-edges[2]), box, displacement, points, 3, enter, exit))
+        return false;
+
+    for (const auto& edge : edges)
+    {
+        for (const auto& axis : axes)
+        {
+            if (!SweepAxis(edge.Cross(axis), box, displacement, points, 3, enter, exit))
+                return false;
+        }
+    }
+
+    time = enter;
+    return true;
+}
+
+bool SweptCollision::SweepSphereSegment(
+    const BoundingSphere& sphere,
+    const Vector3& displacement,
+    const Vector3& p,
+    const Vector3& q,
+    float& time) noexcept
+{
+    const Vector3 center = sphere.Center;
+    bool isHit = false;
+    float t;
+    time = 1.0f;
+
+    if (RayCylinder(center, displacement, p, q, sphere.Radius, t) && t <= time)
+    {
+        time = t;
+        isHit = true;
+    }
+
+    if (RayPoint(center, displacement, p, sphere.Radius, t) && t <= time)
+    {
+        time = t;
+        isHit = true;
+    }
+
+    if (RayPoint(center, displacement, q, sphere.Radius, t) && t <= time)
+    {
+        time = t;
+        isHit = true;
+    }
+
+    return isHit;
+}
+
+bool SweptCollision::SweepBoxSegment(
+    const BoundingBox& box,
+    const Vector3& displacement,
+    const Vector3& p,
+    const Vector3& q,
+    float& time) noexcept
+{
+    const Vector3 points[2] = { p, q };
+    const auto segment = q - p;
+    const Vector3 axes[3] = { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ };
+
+    float enter = 0.0f;
+    float exit  = 1.0f;
+
+    // The box face normals, and the cross products of the segment with the box axes.
+    for (const auto& axis : axes)
+    {
+        if (!SweepAxis(axis, box, displacement, points, 2, enter, exit) ||
+            !SweepAxis(segment.Cross(axis), box, displacement, points, 2, enter, exit))
+            return false;
+    }
+
+    time = enter;
+    return true;
+}
+
+BoundingBox SweptCollision::GetSweptBounds(const BoundingSphere& sphere, const Vector3& displacement) noexcept
+{
+    BoundingBox box;
+    BoundingBox::CreateFromSphere(box, sphere);
+    return GetSweptBounds(box, displacement);
+}
+
+BoundingBox SweptCollision::GetSweptBounds(const BoundingBox& box, const Vector3& displacement) noexcept
+{
+    BoundingBox end = box;
+    end.Center = Vector3(box.Center) + displacement;
+
+    BoundingBox bounds;
+    BoundingBox::CreateMerged(bounds, box, end);
+    return bounds;
+}
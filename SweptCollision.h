@@ -0,0 +1,49 @@
+#pragma once
+
+// RaytracingHlslCompat.h declares 'using' DirectX namespaces, so it must be in the #include list first.
+
+// Continuous collision tests for volumes that translate over a frame, so that fast or low frame rate movement can't
+// tunnel through thin geometry. The volume starts where it is and moves by displacement. Each test returns true if it
+// touches the target during the move, with time receiving the fraction of displacement travelled before contact.
+// A volume that already touches the target reports a time of zero.
+//
+// Boxes are axis aligned and do not rotate during the move, so the tests are exact: separating axis tests over the
+// axes of the box swept against the target. Spheres are tested as a ray against the target inflated by the radius.
+
+namespace SweptCollision
+{
+    bool SweepSphereTriangle(
+        const BoundingSphere& sphere,
+        const Vector3& displacement,
+        const Vector3& a,
+        const Vector3& b,
+        const Vector3& c,
+        float& time) noexcept;
+
+    bool SweepBoxTriangle(
+        const BoundingBox& box,
+        const Vector3& displacement,
+        const Vector3& a,
+        const Vector3& b,
+        const Vector3& c,
+        float& time) noexcept;
+
+    // Line segments from p to q, such as a checkpoint gate between two signposts.
+    bool SweepSphereSegment(
+        const BoundingSphere& sphere,
+        const Vector3& displacement,
+        const Vector3& p,
+        const Vector3& q,
+        float& time) noexcept;
+
+    bool SweepBoxSegment(
+        const BoundingBox& box,
+        const Vector3& displacement,
+        const Vector3& p,
+        const Vector3& q,
+        float& time) noexcept;
+
+    // Bounds of the volume over the whole move.
+    BoundingBox GetSweptBounds(const BoundingSphere& sphere, const Vector3& displacement) noexcept;
+    BoundingBox GetSweptBounds(const BoundingBox& box, const Vector3& displacement) noexcept;
+}
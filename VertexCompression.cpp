@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "RaytracingHlslCompat.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "AnimationClip.h"
+#include "AnimationCompression.h"
+#include "Skeleton.h"
+#include "AnimationInstance.h"
+#include "SkinnedBounds.h"
+#include "FBXModel.h"
+#include "VertexCompression.h"
+
+using namespace DirectX::SimpleMath;
+using namespace DirectX::PackedVector;
+
+static_assert(sizeof(FBXModel::CompactVertex) == sizeof(VertexFbxBonesCompact), "CompactVertex must match the shader layout.");
+static_assert(sizeof(FBXModel::CompactVertex) * 2 == sizeof(FBXModel::Vertex), "CompactVertex is half the size of Vertex.");
+
+namespace
+{
+    uint32_t EncodeSnorm16(float value) noexcept
+    {
+        const auto snorm = static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        return static_cast<uint16_t>(snorm);
+    }
+
+    float DecodeSnorm16(uint32_t bits) noexcept
+    {
+        return std::max(static_cast<int16_t>(bits & 0xffff) / 32767.0f, -1.0f);
+    }
+
+    uint32_t EncodeUnorm8(float value) noexcept
+    {
+        return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+}
+
+uint32_t VertexCompression::EncodeOctahedral(Vector3 const& v) noexcept
+{
+    const float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+
+    // A zero vector has no direction, so it is stored as +z.
+    if (length == 0.0f)
+        return 0;
+
+    float x = v.x / length;
+    float y = v.y / length;
+
+    // Fold the lower half over the upper half.
+    if (v.z < 0.0f)
+    {
+        const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    return EncodeSnorm16(x) | (EncodeSnorm16(y) << 16);
+}
+
+Vector3 VertexCompression::DecodeOctahedral(uint32_t packed) noexcept
+{
+    const float ex = DecodeSnorm16(packed);
+    const float ey = DecodeSnorm16(packed >> 16);
+
+    Vector3 n(ex, ey, 1.0f - std::abs(ex) - std::abs(ey));
+
+    // Unfold the lower half.
+    const float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+
+    n.Normalize();
+    return n;
+}
+
+uint32_t VertexCompression::EncodeHalf2(Vector2 const& v) noexcept
+{
+    return static_cast<uint32_t>(XMConvertFloatToHalf(v.x)) | (static_cast<uint32_t>(XMConvertFloatToHalf(v.y)) << 16);
+}
+
+Vector2 VertexCompression::DecodeHalf2(uint32_t packed) noexcept
+{
+    return Vector2(XMConvertHalfToFloat(static_cast<HALF>(packed & 0xffff)), XMConvertHalfToFloat(static_cast<HALF>(packed >> 16)));
+}
+
+uint32_t VertexCompression::EncodeWeights(Vector4 const& weights) noexcept
+{
+    // Rounding each weight up could take the sum past one, which would make the recalculated fourth weight negative.
+    const uint32_t x = EncodeUnorm8(weights.x);
+    const uint32_t y = std::min(EncodeUnorm8(weights.y), 255u - x);
+    const uint32_t z = std::min(EncodeUnorm8(weights.z), 255u - x - y);
+    const uint32_t w = 255u - x - y - z;
+
+    return x | (y << 8) | (z << 16) | (w << 24);
+}
+
+Vector4 VertexCompression::DecodeWeights(uint32_t packed) noexcept
+{
+    return Vector4(
+        static_cast<float>(packed & 0xff),
+        static_cast<float>((packed >> 8) & 0xff),
+        static_cast<float>((packed >> 16) & 0xff),
+        static_cast<float>(packed >> 24)) / 255.0f;
+}
+
+FBXModel::CompactVertex VertexCompression::Compress(FBXModel::Vertex const& vertex) noexcept
+{
+    FBXModel::CompactVertex compact;
+    compact.pos         = vertex.pos;
+    compact.normal      = EncodeOctahedral(vertex.normal);
+    compact.texC        = EncodeHalf2(vertex.texC);
+    compact.tangent     = EncodeOctahedral(vertex.tangent);
+    compact.boneWeights = EncodeWeights(vertex.boneWeights);
+    std::copy(std::begin(vertex.boneIndices), std::end(vertex.boneIndices), compact.boneIndices);
+    return compact;
+}
+
+FBXModel::Vertex VertexCompression::Decompress(FBXModel::CompactVertex const& compact) noexcept
+{
+    FBXModel::Vertex vertex(compact.pos, DecodeOctahedral(compact.normal), DecodeHalf2(compact.texC), DecodeOctahedral(compact.tangent));
+    vertex.boneWeights = DecodeWeights(compact.boneWeights);
+    std::copy(std::begin(compact.boneIndices), std::end(compact.boneIndices), vertex.boneIndices);
+    return vertex;
+}
+
+void VertexCompression::Quantize(FBXModel::Vertex* vertices, size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        vertices[i] = Decompress(Compress(vertices[i]));
+    }
+}
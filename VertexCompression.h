@@ -0,0 +1,28 @@
+#pragma once
+
+// RaytracingHlslCompat.h and FBXModel.h must be in the #include list before this header.
+
+// Encoding of FBXModel::CompactVertex, matching the decoding in VertexCompression.hlsli.
+// Unit vectors are octahedral encoded: projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is folded
+// over the upper half, leaving two coordinates in [-1, 1] that are stored as SNORM16. Directions stay within 0.04
+// degrees, in 4 bytes instead of 12. Texture coordinates are half floats and bone weights are UNORM8.
+
+namespace VertexCompression
+{
+    uint32_t EncodeOctahedral(DirectX::SimpleMath::Vector3 const& v) noexcept;
+    DirectX::SimpleMath::Vector3 DecodeOctahedral(uint32_t packed) noexcept;
+
+    uint32_t EncodeHalf2(DirectX::SimpleMath::Vector2 const& v) noexcept;
+    DirectX::SimpleMath::Vector2 DecodeHalf2(uint32_t packed) noexcept;
+
+    // The first three weights are rounded so they never sum to more than one, as skinning recalculates the fourth
+    // from them. The fourth stores the remainder.
+    uint32_t EncodeWeights(DirectX::SimpleMath::Vector4 const& weights) noexcept;
+    DirectX::SimpleMath::Vector4 DecodeWeights(uint32_t packed) noexcept;
+
+    FBXModel::CompactVertex Compress(FBXModel::Vertex const& vertex) noexcept;
+    FBXModel::Vertex Decompress(FBXModel::CompactVertex const& vertex) noexcept;
+
+    // Replaces each vertex with the decompressed value of its compact encoding.
+    void Quantize(FBXModel::Vertex* vertices, size_t count) noexcept;
+}
@@ -0,0 +1,35 @@
+//=============================================================================
+// VertexCompression.hlsli by Maico De Blasio (C) 2023 All Rights Reserved.
+//
+// Decodes the quantized attributes of VertexFbxBonesCompact, as encoded on
+// the CPU by VertexCompression.cpp.
+//=============================================================================
+
+#pragma once
+
+// Unit vector from an octahedral encoding, two SNORM16 coordinates on the
+// octahedron |x| + |y| + |z| = 1 with its lower half folded over the upper half.
+float3 DecodeOctahedral(uint packed)
+{
+    // Sign extend each 16 bit half.
+    const float2 e = max(float2(int2(packed << 16, packed) >> 16) / 32767.f, -1.f);
+
+    float3 n = float3(e.x, e.y, 1.f - abs(e.x) - abs(e.y));
+
+    // Unfold the lower half.
+    const float t = saturate(-n.z);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+
+    return normalize(n);
+}
+
+float2 DecodeHalf2(uint packed)
+{
+    return float2(f16tof32(packed), f16tof32(packed >> 16));
+}
+
+float4 DecodeUnorm4(uint packed)
+{
+    return float4(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff, packed >> 24) / 255.f;
+}
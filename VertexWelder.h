@@ -0,0 +1,108 @@
+#pragma once
+
+// Hashed vertex welding, used to dedupe the un-indexed vertex streams read from FBX files.
+// Each vertex is reduced to a key of N float attributes (pos, normal, texC, tangent etc.).
+//
+// Exact mode (epsilon == 0): vertices weld only when every attribute compares equal with operator==,
+// so the result is identical to a sequential search of previously emitted vertices.
+// -0.0f is folded into +0.0f, and vertices containing a NaN never weld (NaN != NaN).
+//
+// Epsilon mode (epsilon > 0): attributes are quantized to an epsilon sized grid before hashing,
+// so vertices that land in the same grid cell are welded.
+
+template<size_t N>
+class VertexWelder
+{
+public:
+
+    static constexpr uint32_t NotFound = UINT32_MAX;
+
+    explicit VertexWelder(float epsilon = 0.0f, size_t expectedVertexCount = 0) :
+        m_invEpsilon(epsilon > 0.0f ? 1.0f / epsilon : 0.0f), m_vertexCount(0)
+    {
+        m_map.reserve(expectedVertexCount);
+    }
+
+    VertexWelder(VertexWelder const&) = delete;
+    VertexWelder& operator= (VertexWelder const&) = delete;
+
+    VertexWelder(VertexWelder&&) = default;
+    VertexWelder& operator= (VertexWelder&&) = default;
+
+    // Returns the index of the first vertex that welds with the attributes passed in.
+    // If there is no match, the vertex is added with index GetVertexCount() - 1, and NotFound is returned.
+    uint32_t FindOrAdd(const std::array<float, N>& attributes)
+    {
+        Key key;
+
+        if (!MakeKey(attributes, key))
+        {
+            ++m_vertexCount; // Unweldable, always a new vertex.
+            return NotFound;
+        }
+
+        auto [it, inserted] = m_map.try_emplace(key, m_vertexCount);
+
+        if (inserted)
+        {
+            ++m_vertexCount;
+            return NotFound;
+        }
+        return it->second;
+    }
+
+    const auto GetVertexCount() const noexcept { return m_vertexCount; }
+
+private:
+
+    using Key = std::array<uint32_t, N>;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept
+        {
+            // FNV-1a over 32 bit words, followed by a final avalanche mix.
+            uint64_t h = 14695981039346656037ull;
+            for (auto word : key)
+            {
+                h ^= word;
+                h *= 1099511628211ull;
+            }
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+    };
+
+    bool MakeKey(const std::array<float, N>& attributes, Key& key) const noexcept
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            float f = attributes[i];
+
+            if (f != f) // NaN
+                return false;
+
+            if (m_invEpsilon > 0.0f)
+            {
+                // Round to nearest grid cell, clamped to int32 range.
+                double q = std::floor(static_cast<double>(f) * m_invEpsilon + 0.5);
+                q = std::min(std::max(q, static_cast<double>(INT32_MIN)), static_cast<double>(INT32_MAX));
+                key[i] = static_cast<uint32_t>(static_cast<int32_t>(q));
+            }
+            else
+            {
+                if (f == 0.0f)
+                    f = 0.0f; // Fold -0.0f into +0.0f, as they compare equal.
+                std::memcpy(&key[i], &f, sizeof(float));
+            }
+        }
+        return true;
+    }
+
+    float    m_invEpsilon;
+    uint32_t m_vertexCount;
+
+    std::unordered_map<Key, uint32_t, KeyHash> m_map;
+};
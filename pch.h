@@ -30,6 +30,7 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <timeapi.h>
 
 // Use latest DirectX headers from https://github.com/microsoft/DirectX-Headers
 #define USING_DIRECTX_HEADERS
@@ -73,10 +74,15 @@
 
 // Additional includes not in default template
 #include <array>
+#include <atomic>
+#include <execution>
 #include <fstream>
 #include <iomanip>
+#include <mutex>
+#include <numeric>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 
 #ifdef _DEBUG
@@ -115,6 +121,7 @@
 // Link necessary FBX SDK libraries.
 #pragma comment(lib,"libfbxsdk") //required for run-time
 #pragma comment(lib, "wininet")
+#pragma comment(lib, "winmm") // timeBeginPeriod
 
 namespace DX
 {